@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+"""
+******************************************************************************
+@file           : sync_led_frame.py
+@brief          : Copy the shared frame codec into the ESP8266 sketch folder
+******************************************************************************
+@description
+common/led_frame.h is the only copy to edit. The STM32 build reads it through
+its include path (../common); the Arduino IDE only compiles files inside the
+sketch folder, so the ESP8266 firmware keeps a copy next to the .ino. Run this
+after every change to the header; --check (used by the host build) fails if
+the copy is out of date.
+
+Usage:
+    python3 common/sync_led_frame.py           # refresh the copy
+    python3 common/sync_led_frame.py --check   # exit 1 if it differs
+
+Standard library only.
+******************************************************************************
+"""
+
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCE = os.path.join(ROOT, "common", "led_frame.h")
+COPIES = [
+    os.path.join(ROOT, "esp8266-firmware", "led_frame.h"),
+]
+
+
+def read(path):
+    try:
+        with open(path, "rb") as f:
+            return f.read()
+    except FileNotFoundError:
+        return None
+
+
+def main():
+    check = "--check" in sys.argv[1:]
+    source = read(SOURCE)
+    stale = [path for path in COPIES if read(path) != source]
+
+    for path in stale:
+        rel = os.path.relpath(path, ROOT)
+        if check:
+            print(f"{rel} differs from common/led_frame.h (run common/sync_led_frame.py)")
+        else:
+            with open(path, "wb") as f:
+                f.write(source)
+            print(f"Updated {rel}")
+    return 1 if check and stale else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -31,6 +31,22 @@
  * Web Interface:
  * - Homepage:        http://esp8266-led.local/  (or http://ESP8266_IP/)
  * - Pattern control: http://esp8266-led.local/pattern?p=<1-4>
+ * - Custom blink:    http://esp8266-led.local/led?mask=<1-15>&period=<ms>
+ *                    [&duty=<0-100>][&phase=<ms>]  (→ LED_SET)
+ * - Scene (batched): http://esp8266-led.local/scene?s=<set>;<set>...
+ *                    (one LED_SCENE command, one ACK)
+ * - Locked group:    http://esp8266-led.local/sync?mask=<1-15>&period=<ms>
+ *                    [&mode=<0-3>]  (→ LED_SYNC: in phase, anti-phase, chase,
+ *                    breathe)
+ * - Scheduled:       add &at=<shared ms> or &in=<ms> to /pattern, /led,
+ *                    /scene or /sync (→ LED_AT, applied at that shared-clock time)
+ * - Shared clock:    http://esp8266-led.local/time
+ * - STM32 memory:    http://esp8266-led.local/mem  (stack/heap telemetry)
+ * - STM32 CPU load:  http://esp8266-led.local/stats  (run-time statistics)
+ * - STM32 low power: http://esp8266-led.local/power  (SLEEP/STOP residency,
+ *                    per LED pattern)
+ * - Latency trace:   http://esp8266-led.local/trace  (per-stage timestamps of
+ *                    recent commands on both boards, for latency_report.py)
  *
  * UART Protocol:
  * - Baud rate: 115200
@@ -45,6 +61,28 @@
  * Command Format:
  * - LED_CMD:1  (enter LED menu)
  * - LED_CMD:x  (select pattern 1-4)
+ * - LED_SET:mask,period,duty,phase  (blink any LEDs, see led_frame.h)
+ *
+ * Binary Framing (led_frame.h, shared with STM32):
+ * - "PROTO:BIN" sent at startup; "OK:ProtoBin" reply switches commands,
+ *   PINGs and PONGs to CRC16-checked binary frames
+ * - ASCII lines are still accepted from the STM32 at any time
+ *
+ * Pipelined Commands:
+ * - Each LED command carries a sequence number ("LED_CMD:2#17") that the
+ *   STM32 echoes in its ACK ("OK:Pattern2#17")
+ * - Up to MAX_INFLIGHT_COMMANDS commands may await their ACK at once; the
+ *   HTTP request is answered when its own ACK arrives (or times out), so
+ *   loop() never blocks waiting for the STM32
+ *
+ * Coordinated Boards:
+ * - The shared clock is NTP time in ms (wrapping at 2^32), or millis()
+ *   until NTP has synced; it is sent to the STM32 as TIME every
+ *   TIME_SYNC_INTERVAL_MS
+ * - Read /time from one board and send the same at= to every board: each
+ *   STM32 switches on its own sequencer interrupt at that time, so the
+ *   boards stay within NTP accuracy of each other regardless of Wi-Fi and
+ *   UART latency
  *
  * Benefits:
  * - See Wi-Fi status and IP address in Serial Monitor
@@ -61,7 +99,10 @@
 #include <ESP8266WebServer.h>
 #include <ESP8266mDNS.h>
 #include <SoftwareSerial.h>
+#include <time.h>
+#include <sys/time.h>
 #include "index.h"  // HTML web interface
+#include "led_frame.h"  // Binary frame codec (shared with STM32 firmware)
 
 // ========================================
 // Configuration Section - CHANGE THESE!
@@ -88,6 +129,14 @@ const int COMMAND_DELAY_MS = 50;                 // Delay between commands
 const unsigned long ECHO_PING_INTERVAL_MS = 10000; // UART connection test interval (10 seconds base)
 const unsigned long ECHO_PING_JITTER_MS = 2000;  // Random jitter: 0-2000ms uniform distribution
 const unsigned long ECHO_TIMEOUT_MS = 1000;      // Timeout for ECHO response
+const bool USE_BINARY_PROTOCOL = true;           // Negotiate binary framing with STM32
+const unsigned long ACK_TIMEOUT_MS = 500;        // Max wait for an LED command ACK
+const unsigned long TIME_SYNC_INTERVAL_MS = 5000; // Shared clock (TIME) update interval
+const char* NTP_SERVER = "pool.ntp.org";         // Shared clock source for coordinated boards
+const unsigned long MEM_POLL_INTERVAL_MS = 30000; // STM32 stack/heap telemetry (MEM) poll interval
+const unsigned long STATS_POLL_INTERVAL_MS = 30000; // STM32 CPU statistics (STATS) window
+const unsigned long POWER_POLL_INTERVAL_MS = 30000; // STM32 SLEEP/STOP residency (POWER) window
+const unsigned long TRACE_POLL_INTERVAL_MS = 2000; // STM32 trace records (TRACE) poll, while commands run
 
 /**
  * @brief SoftwareSerial pin configuration
@@ -112,6 +161,58 @@ struct RequestLog {
   String ack;                // Last ACK received from STM32
 };
 
+/**
+ * @brief Latency trace stages on the ESP8266 (order of the "E" fields in /trace)
+ * @note The STM32 adds RX_ISR, TASK_WAKE, DISPATCH, APPLIED and ACK
+ *       (stm32-firmware/includes/trace.h) for the same sequence number
+ */
+enum TraceStage {
+  TRACE_HTTP_IN = 0,         // Request handler entered
+  TRACE_TX_START,            // First command byte written to the STM32
+  TRACE_TX_DONE,             // Last command byte written (SoftwareSerial blocks)
+  TRACE_ACK_RX,              // ACK line/frame parsed
+  TRACE_HTTP_OUT,            // HTTP response written
+  TRACE_STAGE_COUNT
+};
+
+/**
+ * @struct PendingCommand
+ * @brief LED command sent to the STM32 and still waiting for its ACK
+ * @note The WiFiClient copy keeps the HTTP connection open after the
+ *       handler returns; the response is written when the ACK arrives
+ */
+struct PendingCommand {
+  bool active;               // Slot in use
+  uint8_t seq;               // Sequence number echoed by the STM32
+  unsigned long sentAt;      // Send timestamp (millis) for timeout
+  String pattern;            // Requested pattern ("1".."4"), "" for LED_SET
+  String endpoint;           // Request path recorded in /clients
+  WiFiClient client;         // HTTP client to answer
+  String ip;                 // Client IP (captured at request time)
+  String userAgent;          // User-Agent (captured at request time)
+  uint32_t trace[TRACE_STAGE_COUNT];  // micros() per TraceStage
+};
+
+/**
+ * @struct TraceRecord
+ * @brief Stage timestamps of one acknowledged command, from one board
+ */
+struct TraceRecord {
+  uint8_t seq;                       // Command sequence number (correlation ID)
+  uint32_t t[TRACE_STAGE_COUNT];     // ESP8266: micros(); STM32: CPU cycles
+};
+
+/**
+ * @struct TraceRing
+ * @brief Last TRACE_RING_SIZE records (the oldest is overwritten when full)
+ */
+#define TRACE_RING_SIZE 32
+struct TraceRing {
+  TraceRecord records[TRACE_RING_SIZE];
+  uint8_t tail;                      // Oldest record
+  uint8_t count;
+};
+
 // ========================================
 // Global Objects
 // ========================================
@@ -140,6 +241,76 @@ bool waitingForEcho = false;
  */
 String lastAckReceived = "";
 
+/**
+ * @brief Task the STM32 reported after its last watchdog (IWDG) reset
+ */
+String lastWatchdogReset = "";
+
+/**
+ * @brief Latest STM32 stack/heap telemetry ("heap=..,min=..,fail=..;task=words,...")
+ */
+String lastMemReport = "";
+unsigned long lastMemReportAt = 0;
+unsigned long lastMemPoll = 0;
+
+/**
+ * @brief Latest STM32 CPU statistics ("ms=..,idle=..,sleep=..,isr=..;task=permille,...")
+ * @note Each STATS request starts a new window on the STM32, so only this
+ *       poll may send it
+ */
+String lastStatsReport = "";
+unsigned long lastStatsReportAt = 0;
+unsigned long lastStatsPoll = 0;
+
+/**
+ * @brief Latest STM32 low-power residency ("ms=..,sleep=..,stop=..,uart=..;p1=..,...")
+ * @note Each POWER request starts a new window on the STM32, as with STATS
+ */
+String lastPowerReport = "";
+unsigned long lastPowerReportAt = 0;
+unsigned long lastPowerPoll = 0;
+
+/**
+ * @brief millis() of the last write to the STM32 (wake preamble, see wakeSTM32())
+ */
+unsigned long lastSTM32Write = 0;
+
+/**
+ * @brief Latency trace: this board's records and the STM32's (TR: lines),
+ *        matched by sequence number in latency_report.py
+ * @note requestStartUs is stamped by every LED request handler and copied
+ *       into the command by reserveCommand()
+ */
+TraceRing espTrace;
+TraceRing stmTrace;
+uint32_t stmTraceHz = 0;             // STM32 cycle counter rate (from TR:END)
+unsigned long requestStartUs = 0;
+unsigned long lastTracePoll = 0;
+bool traceNewRecords = false;        // Commands traced since the last TRACE
+bool traceMoreOnStm32 = false;       // TR:END reported records left
+
+/**
+ * @brief LED commands in flight (matched to ACKs by sequence number)
+ */
+#define MAX_INFLIGHT_COMMANDS 4
+PendingCommand pendingCommands[MAX_INFLIGHT_COMMANDS];
+uint8_t nextSequence = 0;
+
+/**
+ * @brief Binary framing state
+ * @note binaryProtocol is set once the STM32 answers PROTO:BIN with OK:ProtoBin
+ */
+bool binaryProtocol = false;
+led_frame_parser_t frameParser;
+
+/**
+ * @brief Scheduled (LED_AT) state of the command being sent
+ * @note Set by readScheduleArgs() for every request, used by transmitCommand()
+ */
+bool commandScheduled = false;
+uint32_t commandDueMs = 0;
+unsigned long lastTimeSync = 0;
+
 // ========================================
 // Function Declarations
 // ========================================
@@ -148,12 +319,45 @@ void setupWiFi();
 void setupWebServer();
 void handleRoot();
 void handlePattern();
+void handleLedSet();
+void handleScene();
+void handleSync();
 void handleClients();
+void handleTime();
+void handleMem();
+void handleStats();
+void handlePower();
+void handleTrace();
 void handleNotFound();
-void sendCommandToSTM32(String pattern);
+bool readScheduleArgs();
+uint32_t sharedClockMs();
+bool sharedClockFromNtp();
+void sendTimeToSTM32();
+void transmitCommand(PendingCommand& cmd, const String& line, uint8_t frameType,
+                     const uint8_t* payload, uint8_t len);
+int sendCommandToSTM32(String pattern);
+int sendLedSetToSTM32(const led_set_params_t& params, const String& args);
+int sendSceneToSTM32(const led_scene_t& scene, const String& args);
+int sendSyncToSTM32(const led_sync_params_t& params, const String& args);
+int sendParamCommandToSTM32(const char* keyword, uint8_t frameType, uint8_t* payload, uint8_t len,
+                            const String& args, const String& endpoint);
+int reserveCommand(const String& pattern, const String& endpoint);
+void parkClient(PendingCommand& cmd);
+void completeCommand(PendingCommand& cmd, const String& ack);
+void servicePendingCommands();
 void logRequest(String endpoint);
+void recordRequest(const String& ip, const String& userAgent, const String& endpoint, const String& ack);
 void checkUARTConnection();
 void processSTM32Response();
+void negotiateProtocol();
+void wakeSTM32();
+void sendFrameToSTM32(uint8_t type, const uint8_t* payload, uint8_t len);
+void processSTM32Frame();
+void onSTM32Ping(bool binary);
+void onSTM32Pong();
+void onSTM32Ack(const String& ack, int seq);
+void onSTM32Trace(const String& fields);
+void traceRecord(TraceRing& ring, uint8_t seq, const uint32_t* t);
 
 // ========================================
 // Setup Function (Runs Once)
@@ -178,6 +382,10 @@ void setup() {
   Serial.println("SoftwareSerial: STM32 commands");
   Serial.println("========================================");
 
+  // Offer binary framing to STM32 (reply handled in processSTM32Response)
+  led_frame_parser_reset(&frameParser);
+  negotiateProtocol();
+
   // Connect to Wi-Fi network
   setupWiFi();
 
@@ -200,9 +408,12 @@ void loop() {
   // Update mDNS
   MDNS.update();
 
-  // Process any responses from STM32
+  // Process any responses from STM32 (completes pipelined commands)
   processSTM32Response();
 
+  // Answer HTTP requests whose ACK timed out
+  servicePendingCommands();
+
   // Check UART connection periodically
   checkUARTConnection();
 
@@ -282,6 +493,11 @@ void setupWiFi() {
     } else {
       Serial.println("[mDNS] ✗ Error starting mDNS responder");
     }
+
+    // Shared clock for coordinated boards (millis() until NTP answers)
+    configTime(0, 0, NTP_SERVER);
+    Serial.print("[TIME] NTP server: ");
+    Serial.println(NTP_SERVER);
   } else {
     Serial.println("[WIFI] ✗ Connection Failed!");
     Serial.println("[WIFI] Troubleshooting:");
@@ -302,7 +518,15 @@ void setupWebServer() {
   // Register URL handlers
   server.on("/", HTTP_GET, handleRoot);
   server.on("/pattern", HTTP_GET, handlePattern);
+  server.on("/led", HTTP_GET, handleLedSet);
+  server.on("/scene", HTTP_GET, handleScene);
+  server.on("/sync", HTTP_GET, handleSync);
   server.on("/clients", HTTP_GET, handleClients);
+  server.on("/time", HTTP_GET, handleTime);
+  server.on("/mem", HTTP_GET, handleMem);
+  server.on("/stats", HTTP_GET, handleStats);
+  server.on("/power", HTTP_GET, handlePower);
+  server.on("/trace", HTTP_GET, handleTrace);
   server.onNotFound(handleNotFound);
 
   // Start server
@@ -328,6 +552,8 @@ void handleRoot() {
 // ========================================
 
 void handlePattern() {
+  requestStartUs = micros();  // Latency trace: TRACE_HTTP_IN
+
   // Check if pattern parameter exists
   if (!server.hasArg("p")) {
     Serial.println("[HTTP] GET /pattern - ERROR: Missing parameter");
@@ -345,21 +571,198 @@ void handlePattern() {
     return;
   }
 
+  if (!readScheduleArgs()) {
+    Serial.println("[HTTP] GET /pattern - ERROR: Invalid schedule");
+    server.send(400, "text/plain", "ERROR: Invalid 'at' / 'in' (ms, at most " +
+                String(LED_AT_MAX_AHEAD_MS) + " ms ahead)");
+    return;
+  }
+
   Serial.println("[HTTP] GET /pattern?p=" + pattern);
 
-  // Send commands to STM32 (this updates lastAckReceived)
-  sendCommandToSTM32(pattern);
+  // Send command to STM32 without waiting for the ACK
+  int slot = sendCommandToSTM32(pattern);
+  if (slot < 0) {
+    Serial.println("[HTTP] GET /pattern - ERROR: Too many commands in flight");
+    server.send(503, "text/plain", "ERROR: STM32 busy, try again");
+    return;
+  }
+
+  parkClient(pendingCommands[slot]);
+}
+
+// ========================================
+// Handler: Parameterized Blink (LED_SET)
+// ========================================
+
+void handleLedSet() {
+  requestStartUs = micros();  // Latency trace: TRACE_HTTP_IN
+
+  if (!server.hasArg("mask") || !server.hasArg("period")) {
+    Serial.println("[HTTP] GET /led - ERROR: Missing parameter");
+    server.send(400, "text/plain", "ERROR: 'mask' and 'period' are required");
+    return;
+  }
+
+  // duty defaults to 50%, phase to 0 ms
+  String args = server.arg("mask") + "," + server.arg("period") + "," +
+                (server.hasArg("duty") ? server.arg("duty") : String("50")) + "," +
+                (server.hasArg("phase") ? server.arg("phase") : String("0"));
+
+  // Same validation as the STM32 (led_frame.h), so bad requests stop here
+  led_set_params_t params;
+  if (led_set_parse(args.c_str(), &params) != 0) {
+    Serial.println("[HTTP] GET /led - ERROR: Invalid parameters: " + args);
+    server.send(400, "text/plain",
+                "ERROR: Invalid LED_SET (mask 1-15, period " + String(LED_SET_PERIOD_MIN_MS) +
+                "-" + String(LED_SET_PERIOD_MAX_MS) + " ms, duty 0-100, phase < period)");
+    return;
+  }
 
-  // Log the request AFTER getting ACK from STM32
-  // This ensures the correct ACK is captured in the request log
-  String endpoint = "/pattern?p=" + pattern;
-  logRequest(endpoint);
+  if (!readScheduleArgs()) {
+    Serial.println("[HTTP] GET /led - ERROR: Invalid schedule");
+    server.send(400, "text/plain", "ERROR: Invalid 'at' / 'in' (ms, at most " +
+                String(LED_AT_MAX_AHEAD_MS) + " ms ahead)");
+    return;
+  }
 
-  // Send success response to browser
-  String response = "Pattern " + pattern + " sent to STM32";
-  server.send(200, "text/plain", response);
+  Serial.println("[HTTP] GET /led " + args);
 
-  Serial.println("[HTTP] Response sent to browser");
+  int slot = sendLedSetToSTM32(params, args);
+  if (slot < 0) {
+    Serial.println("[HTTP] GET /led - ERROR: Too many commands in flight");
+    server.send(503, "text/plain", "ERROR: STM32 busy, try again");
+    return;
+  }
+
+  parkClient(pendingCommands[slot]);
+}
+
+// ========================================
+// Handler: Batched Scene (LED_SCENE)
+// ========================================
+
+void handleScene() {
+  requestStartUs = micros();  // Latency trace: TRACE_HTTP_IN
+
+  if (!server.hasArg("s")) {
+    Serial.println("[HTTP] GET /scene - ERROR: Missing parameter");
+    server.send(400, "text/plain", "ERROR: Missing 's' parameter");
+    return;
+  }
+
+  // s = "mask,period,duty,phase;mask,period,duty,phase..." (one group per LED set)
+  String args = server.arg("s");
+  led_scene_t scene;
+  if (led_scene_parse(args.c_str(), &scene) != 0) {
+    Serial.println("[HTTP] GET /scene - ERROR: Invalid scene: " + args);
+    server.send(400, "text/plain",
+                "ERROR: Invalid scene (1-" + String(LED_SCENE_MAX_GROUPS) +
+                " LED_SET groups separated by ';', no LED in two groups)");
+    return;
+  }
+
+  if (!readScheduleArgs()) {
+    Serial.println("[HTTP] GET /scene - ERROR: Invalid schedule");
+    server.send(400, "text/plain", "ERROR: Invalid 'at' / 'in' (ms, at most " +
+                String(LED_AT_MAX_AHEAD_MS) + " ms ahead)");
+    return;
+  }
+
+  Serial.println("[HTTP] GET /scene " + args);
+
+  int slot = sendSceneToSTM32(scene, args);
+  if (slot < 0) {
+    Serial.println("[HTTP] GET /scene - ERROR: Too many commands in flight");
+    server.send(503, "text/plain", "ERROR: STM32 busy, try again");
+    return;
+  }
+
+  parkClient(pendingCommands[slot]);
+}
+
+// ========================================
+// Handler: Synchronized LED Group (LED_SYNC)
+// ========================================
+
+void handleSync() {
+  requestStartUs = micros();  // Latency trace: TRACE_HTTP_IN
+
+  if (!server.hasArg("mask") || !server.hasArg("period")) {
+    Serial.println("[HTTP] GET /sync - ERROR: Missing parameter");
+    server.send(400, "text/plain", "ERROR: 'mask' and 'period' are required");
+    return;
+  }
+
+  // mode defaults to 0 (in phase)
+  String args = server.arg("mask") + "," + server.arg("period") + "," +
+                (server.hasArg("mode") ? server.arg("mode") : String("0"));
+
+  led_sync_params_t params;
+  if (led_sync_parse(args.c_str(), &params) != 0) {
+    Serial.println("[HTTP] GET /sync - ERROR: Invalid parameters: " + args);
+    server.send(400, "text/plain",
+                "ERROR: Invalid LED_SYNC (mask 1-15, period " + String(LED_SET_PERIOD_MIN_MS) +
+                "-" + String(LED_SET_PERIOD_MAX_MS) + " ms, mode 0 in phase, 1 anti-phase, 2 chase, 3 breathe)");
+    return;
+  }
+
+  if (!readScheduleArgs()) {
+    Serial.println("[HTTP] GET /sync - ERROR: Invalid schedule");
+    server.send(400, "text/plain", "ERROR: Invalid 'at' / 'in' (ms, at most " +
+                String(LED_AT_MAX_AHEAD_MS) + " ms ahead)");
+    return;
+  }
+
+  Serial.println("[HTTP] GET /sync " + args);
+
+  int slot = sendSyncToSTM32(params, args);
+  if (slot < 0) {
+    Serial.println("[HTTP] GET /sync - ERROR: Too many commands in flight");
+    server.send(503, "text/plain", "ERROR: STM32 busy, try again");
+    return;
+  }
+
+  parkClient(pendingCommands[slot]);
+}
+
+/**
+ * @brief Read the optional at=<shared ms> / in=<ms from now> arguments
+ * @return false if one is present but malformed or too far ahead
+ * @note Sets commandScheduled / commandDueMs for the command sent next
+ */
+bool readScheduleArgs() {
+  commandScheduled = false;
+  if (!server.hasArg("at") && !server.hasArg("in")) {
+    return true;
+  }
+
+  bool absolute = server.hasArg("at");
+  String text = server.arg(absolute ? "at" : "in");
+  const char* cursor = text.c_str();
+  uint32_t value;
+  if (led_frame_parse_u32(&cursor, &value) != 0 || *cursor != '\0') {
+    return false;
+  }
+
+  uint32_t now = sharedClockMs();
+  commandDueMs = absolute ? value : now + value;
+  if ((int32_t)(commandDueMs - now) > (int32_t)LED_AT_MAX_AHEAD_MS) {
+    return false;
+  }
+  commandScheduled = true;
+  return true;
+}
+
+/**
+ * @brief Park the current HTTP client on a pending command
+ * @note The response is sent by completeCommand() once the matching ACK
+ *       arrives, so the request log captures the correct ACK
+ */
+void parkClient(PendingCommand& cmd) {
+  cmd.client = server.client();
+  cmd.ip = cmd.client.remoteIP().toString();
+  cmd.userAgent = server.header("User-Agent");
 }
 
 // ========================================
@@ -370,7 +773,8 @@ void handleClients() {
   Serial.println("[HTTP] GET /clients - Serving client history");
 
   // Build JSON response
-  String json = "{\"totalRequests\":" + String(totalRequests) + ",\"recentRequests\":[";
+  String json = "{\"totalRequests\":" + String(totalRequests) +
+                ",\"lastWatchdogReset\":\"" + lastWatchdogReset + "\",\"recentRequests\":[";
 
   // Add recent requests in reverse order (newest first)
   bool firstEntry = true;
@@ -400,6 +804,123 @@ void handleClients() {
   server.send(200, "application/json", json);
 }
 
+// ========================================
+// Handler: Shared Clock
+// ========================================
+
+void handleTime() {
+  // Clients read this once and send the same at= to every board
+  String json = "{\"sharedMs\":" + String(sharedClockMs()) +
+                ",\"ntp\":" + String(sharedClockFromNtp() ? "true" : "false") +
+                ",\"maxAheadMs\":" + String(LED_AT_MAX_AHEAD_MS) + "}";
+  server.send(200, "application/json", json);
+}
+
+// ========================================
+// Handlers: STM32 Telemetry (JSON)
+// ========================================
+
+/**
+ * @brief Append "name=value,name=value" (STM32 reply format) as JSON members
+ * @param json Output, gets ',"name":value' per entry
+ * @param list Entries; "a/b" values (ISR share/calls) become {"permille":a,"<countKey>":b}
+ * @param countKey JSON member for the second half of "a/b" values
+ */
+void appendTelemetryFields(String& json, const String& list, const char* countKey) {
+  int start = 0;
+  while (start < (int)list.length()) {
+    int end = list.indexOf(',', start);
+    if (end < 0) end = list.length();
+    int eq = list.lastIndexOf('=', end - 1);  // Task names may hold spaces, not '='
+    if (eq > start) {
+      String value = list.substring(eq + 1, end);
+      int slash = value.indexOf('/');
+      if (slash >= 0) {
+        value = "{\"permille\":" + value.substring(0, slash) +
+                ",\"" + countKey + "\":" + value.substring(slash + 1) + "}";
+      }
+      json += ",\"" + list.substring(start, eq) + "\":" + value;
+    }
+    start = end + 1;
+  }
+}
+
+/**
+ * @brief Serve a polled STM32 reply: "<summary>;<per-task>" as JSON
+ * @param report Reply without its "MEM:" / "STATS:" / "PWR:" prefix
+ * @param receivedAt millis() of the reply
+ * @param tasksKey JSON member holding the per-task values
+ * @param summaryCountKey / tasksCountKey JSON member for "a/b" counts
+ */
+void sendTelemetryJson(const String& report, unsigned long receivedAt, const char* tasksKey,
+                       const char* summaryCountKey, const char* tasksCountKey) {
+  if (report.length() == 0) {
+    server.send(503, "application/json", "{\"error\":\"No reply from STM32 yet\"}");
+    return;
+  }
+
+  int split = report.indexOf(';');
+  String summary = (split >= 0) ? report.substring(0, split) : report;
+  String tasks = (split >= 0) ? report.substring(split + 1) : "";
+
+  String json = "{\"ageMs\":" + String(millis() - receivedAt);
+  appendTelemetryFields(json, summary, summaryCountKey);
+  String taskFields = "";
+  appendTelemetryFields(taskFields, tasks, tasksCountKey);
+  json += ",\"" + String(tasksKey) + "\":{" + (taskFields.length() > 0 ? taskFields.substring(1) : "") + "}}";
+
+  server.send(200, "application/json", json);
+}
+
+void handleMem() {
+  // Latest MEM reply: "heap=43808,min=43616,fail=0;ESP8266_C=94,Print_Tas=171,..."
+  sendTelemetryJson(lastMemReport, lastMemReportAt, "stackFreeWords", "calls", "calls");
+}
+
+void handleStats() {
+  // Latest STATS reply: "ms=30000,idle=968,sleep=961,usart2=1/14,...;ESP8266_C=12,..."
+  sendTelemetryJson(lastStatsReport, lastStatsReportAt, "taskPermille", "calls", "calls");
+}
+
+void handlePower() {
+  // Latest POWER reply: "ms=30000,sleep=41/2841,stop=951/300,uart=12;p1=951/30000"
+  // → {"stop":{"permille":951,"entries":300},...,"patterns":{"p1":{"permille":951,"ms":30000}}}
+  sendTelemetryJson(lastPowerReport, lastPowerReportAt, "patterns", "entries", "ms");
+}
+
+// ========================================
+// Handler: Latency Trace (text, for latency_report.py)
+// ========================================
+
+/**
+ * @brief Append a ring as "<tag> <seq> <t0> ... <t4>" lines and empty it
+ */
+void appendTraceRing(String& out, char tag, TraceRing& ring) {
+  for (uint8_t i = 0; i < ring.count; i++) {
+    const TraceRecord& rec = ring.records[(ring.tail + i) % TRACE_RING_SIZE];
+    out += tag;
+    out += ' ';
+    out += String((unsigned)rec.seq);
+    for (uint8_t s = 0; s < TRACE_STAGE_COUNT; s++) {
+      out += ' ';
+      out += String(rec.t[s]);
+    }
+    out += '\n';
+  }
+  ring.tail = 0;
+  ring.count = 0;
+}
+
+void handleTrace() {
+  // Records are handed out once: append captures to one file for the tool
+  String out;
+  out.reserve(64 + (espTrace.count + stmTrace.count) * 64);
+  out = "# led-trace esp_hz=1000000 stm_hz=" + String(stmTraceHz) + "\n";
+  appendTraceRing(out, 'E', espTrace);
+  appendTraceRing(out, 'S', stmTrace);
+  server.send(200, "text/plain", out);
+}
+
 // ========================================
 // Handler: 404 Not Found
 // ========================================
@@ -417,29 +938,200 @@ void handleNotFound() {
 // Send Command to STM32 via UART
 // ========================================
 
-void sendCommandToSTM32(String pattern) {
-  Serial.println("[STM32] Sending LED command...");
+/**
+ * @brief Claim a pending command slot and assign the next sequence number
+ * @return Slot, or -1 if MAX_INFLIGHT_COMMANDS are in flight
+ */
+int reserveCommand(const String& pattern, const String& endpoint) {
+  int slot = -1;
+  for (int i = 0; i < MAX_INFLIGHT_COMMANDS; i++) {
+    if (!pendingCommands[i].active) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0) {
+    return -1;
+  }
 
-  // Clear previous ACK before sending new command
-  lastAckReceived = "";
+  PendingCommand& cmd = pendingCommands[slot];
+  cmd.active = true;
+  cmd.seq = nextSequence++;
+  cmd.sentAt = millis();
+  cmd.pattern = pattern;
+  cmd.endpoint = endpoint;
+  memset(cmd.trace, 0, sizeof(cmd.trace));
+  cmd.trace[TRACE_HTTP_IN] = requestStartUs;
+  return slot;
+}
+
+/**
+ * @brief Send an LED command tagged with the next sequence number
+ * @return Pending command slot, or -1 if MAX_INFLIGHT_COMMANDS are in flight
+ * @note Returns immediately; the ACK is matched in onSTM32Ack()
+ */
+int sendCommandToSTM32(String pattern) {
+  int slot = reserveCommand(pattern, "/pattern?p=" + pattern);
+  if (slot < 0) {
+    return -1;
+  }
+  PendingCommand& cmd = pendingCommands[slot];
 
   // Send pattern command directly (no menu mode needed)
-  Serial.print("[STM32] → Sending: LED_CMD:");
-  Serial.print(pattern);
-  stm32Serial.print("LED_CMD:");
-  stm32Serial.println(pattern);
-  Serial.println(" [SENT]");
+  uint8_t payload[2] = { (uint8_t)pattern.toInt(), cmd.seq };
+  transmitCommand(cmd, "LED_CMD:" + pattern + LED_CMD_SEQ_SEPARATOR + String((unsigned)cmd.seq),
+                  LED_FRAME_LED_CMD, payload, sizeof(payload));
 
-  // Wait for ACK to arrive (max 500ms)
-  // Process incoming data so ACK gets captured
-  unsigned long startWait = millis();
-  while (lastAckReceived.length() == 0 && (millis() - startWait < 500)) {
-    processSTM32Response();  // Process incoming messages
-    delay(10);  // Small delay to avoid tight loop
+  return slot;
+}
+
+/**
+ * @brief Send a parameterized command (LED_SET, LED_SCENE) with the next
+ *        sequence number
+ * @param keyword ASCII keyword ("LED_SET")
+ * @param frameType Binary frame type
+ * @param payload Binary payload, with one spare byte at payload[len] for seq
+ * @param len Binary payload length without seq
+ * @param args ASCII arguments (same content as payload)
+ * @param endpoint Request path recorded in /clients
+ * @return Pending command slot, or -1 if MAX_INFLIGHT_COMMANDS are in flight
+ */
+int sendParamCommandToSTM32(const char* keyword, uint8_t frameType, uint8_t* payload, uint8_t len,
+                            const String& args, const String& endpoint) {
+  int slot = reserveCommand("", endpoint);
+  if (slot < 0) {
+    return -1;
+  }
+  PendingCommand& cmd = pendingCommands[slot];
+
+  payload[len] = cmd.seq;
+  transmitCommand(cmd, String(keyword) + ":" + args + LED_CMD_SEQ_SEPARATOR + String((unsigned)cmd.seq),
+                  frameType, payload, len + 1);
+
+  return slot;
+}
+
+/**
+ * @brief Send one LED command, wrapped in LED_AT if the request was scheduled
+ * @param cmd Pending command (gets its TX trace stamps)
+ * @param line ASCII command without terminator ("LED_CMD:2#17")
+ * @param frameType Binary frame type of the same command
+ * @param payload Binary payload including the sequence number
+ * @param len Binary payload length
+ */
+void transmitCommand(PendingCommand& cmd, const String& line, uint8_t frameType,
+                     const uint8_t* payload, uint8_t len) {
+  Serial.print("[STM32] → Sending: " + line);
+  if (commandScheduled) {
+    Serial.print(" at " + String(commandDueMs));
   }
 
-  if (lastAckReceived.length() == 0) {
-    Serial.println("[STM32] Warning: No ACK received");
+  cmd.trace[TRACE_TX_START] = micros();
+  if (binaryProtocol) {
+    if (commandScheduled) {
+      // [due LE32][inner type][inner payload]; a full scene still fits
+      uint8_t wrapped[LED_FRAME_MAX_PAYLOAD];
+      led_frame_put_le32(wrapped, commandDueMs);
+      wrapped[4] = frameType;
+      memcpy(&wrapped[LED_AT_HEADER_SIZE], payload, len);
+      sendFrameToSTM32(LED_FRAME_LED_AT, wrapped, len + LED_AT_HEADER_SIZE);
+    } else {
+      sendFrameToSTM32(frameType, payload, len);
+    }
+    cmd.trace[TRACE_TX_DONE] = micros();
+    Serial.println(" [SENT as frame]");
+  } else {
+    wakeSTM32();
+    if (commandScheduled) {
+      stm32Serial.print("LED_AT:" + String(commandDueMs) + LED_AT_SEPARATOR);
+    }
+    stm32Serial.println(line);
+    cmd.trace[TRACE_TX_DONE] = micros();
+    Serial.println(" [SENT]");
+  }
+}
+
+/**
+ * @brief Send an LED_SET command tagged with the next sequence number
+ * @param params Validated parameters
+ * @param args Same parameters as ASCII ("mask,period,duty,phase")
+ * @return Pending command slot, or -1 if MAX_INFLIGHT_COMMANDS are in flight
+ */
+int sendLedSetToSTM32(const led_set_params_t& params, const String& args) {
+  uint8_t payload[LED_SET_PAYLOAD_SIZE + 1];
+  led_set_encode(&params, payload);
+  return sendParamCommandToSTM32("LED_SET", LED_FRAME_LED_SET, payload, LED_SET_PAYLOAD_SIZE, args,
+                                 "/led?mask=" + String(params.mask) + "&period=" + String(params.period_ms) +
+                                 "&duty=" + String(params.duty) + "&phase=" + String(params.phase_ms));
+}
+
+/**
+ * @brief Send a whole scene as one LED_SCENE command (one ACK)
+ * @param scene Validated scene
+ * @param args Same scene as ASCII ("group;group...")
+ * @return Pending command slot, or -1 if MAX_INFLIGHT_COMMANDS are in flight
+ */
+int sendSceneToSTM32(const led_scene_t& scene, const String& args) {
+  uint8_t payload[LED_SCENE_MAX_GROUPS * LED_SET_PAYLOAD_SIZE + 1];
+  uint8_t len = led_scene_encode(&scene, payload);
+  return sendParamCommandToSTM32("LED_SCENE", LED_FRAME_LED_SCENE, payload, len, args,
+                                 "/scene?s=" + args);
+}
+
+/**
+ * @brief Send an LED_SYNC command tagged with the next sequence number
+ * @param params Validated parameters
+ * @param args Same parameters as ASCII ("mask,period,mode")
+ * @return Pending command slot, or -1 if MAX_INFLIGHT_COMMANDS are in flight
+ */
+int sendSyncToSTM32(const led_sync_params_t& params, const String& args) {
+  uint8_t payload[LED_SYNC_PAYLOAD_SIZE + 1];
+  led_sync_encode(&params, payload);
+  return sendParamCommandToSTM32("LED_SYNC", LED_FRAME_LED_SYNC, payload, LED_SYNC_PAYLOAD_SIZE, args,
+                                 "/sync?mask=" + String(params.mask) + "&period=" + String(params.period_ms) +
+                                 "&mode=" + String(params.mode));
+}
+
+/**
+ * @brief Log a finished command and answer its parked HTTP client
+ * @param ack ACK text from the STM32 ("" on timeout)
+ */
+void completeCommand(PendingCommand& cmd, const String& ack) {
+  recordRequest(cmd.ip, cmd.userAgent, cmd.endpoint, ack);
+
+  String body = (cmd.pattern.length() > 0) ? "Pattern " + cmd.pattern + " sent to STM32"
+                                           : "Command sent to STM32 (" + (ack.length() > 0 ? ack : String("no ACK")) + ")";
+  if (cmd.client.connected()) {
+    cmd.client.print("HTTP/1.1 200 OK\r\n"
+                     "Content-Type: text/plain\r\n"
+                     "Connection: close\r\n"
+                     "Content-Length: " + String(body.length()) + "\r\n\r\n" + body);
+    cmd.trace[TRACE_HTTP_OUT] = micros();
+    cmd.client.stop();
+    Serial.println("[HTTP] Response sent to browser");
+  }
+
+  // Timed-out commands have no STM32 record to match
+  if (ack.length() > 0) {
+    traceRecord(espTrace, cmd.seq, cmd.trace);
+    traceNewRecords = true;
+  }
+
+  cmd.active = false;
+  cmd.client = WiFiClient();
+}
+
+/**
+ * @brief Time out commands whose ACK never arrived
+ */
+void servicePendingCommands() {
+  unsigned long now = millis();
+  for (PendingCommand& cmd : pendingCommands) {
+    if (cmd.active && now - cmd.sentAt >= ACK_TIMEOUT_MS) {
+      Serial.print("[STM32] Warning: No ACK received for #");
+      Serial.println((unsigned)cmd.seq);
+      completeCommand(cmd, "");
+    }
   }
 }
 
@@ -448,11 +1140,14 @@ void sendCommandToSTM32(String pattern) {
 // ========================================
 
 void logRequest(String endpoint) {
-  // Get client IP
-  String clientIP = server.client().remoteIP().toString();
+  // Log the current HTTP client with the last ACK seen
+  recordRequest(server.client().remoteIP().toString(), server.header("User-Agent"),
+                endpoint, lastAckReceived);
+}
 
-  // Get User-Agent header
-  String userAgent = server.header("User-Agent");
+void recordRequest(const String& clientIP, const String& userAgentHeader,
+                   const String& endpoint, const String& ack) {
+  String userAgent = userAgentHeader;
   if (userAgent.length() == 0) {
     userAgent = "Unknown";
   }
@@ -462,7 +1157,7 @@ void logRequest(String endpoint) {
   recentRequests[requestIndex].endpoint = endpoint;
   recentRequests[requestIndex].timestamp = millis();
   recentRequests[requestIndex].userAgent = userAgent;
-  recentRequests[requestIndex].ack = lastAckReceived;
+  recentRequests[requestIndex].ack = ack;
 
   // Increment counters
   requestIndex = (requestIndex + 1) % MAX_REQUESTS;
@@ -499,7 +1194,12 @@ void checkUARTConnection() {
 
     Serial.println("[UART] --------------------------------");
     Serial.println("[UART] → Sending PING to STM32...");
-    stm32Serial.println("PING");
+    if (binaryProtocol) {
+      sendFrameToSTM32(LED_FRAME_PING, NULL, 0);
+    } else {
+      wakeSTM32();
+      stm32Serial.println("PING");
+    }
     waitingForEcho = true;
     lastEchoReceived = now;
 
@@ -507,6 +1207,37 @@ void checkUARTConnection() {
     nextPingJitter = random(0, ECHO_PING_JITTER_MS);
   }
 
+  // Keep the STM32's shared clock fresh (before the first LED_AT, too)
+  if (lastTimeSync == 0 || now - lastTimeSync >= TIME_SYNC_INTERVAL_MS) {
+    sendTimeToSTM32();
+  }
+
+  // Refresh the STM32 stack/heap telemetry (answered with MEM:...)
+  if (now - lastMemPoll >= MEM_POLL_INTERVAL_MS) {
+    wakeSTM32();
+    stm32Serial.println("MEM");
+    lastMemPoll = now;
+  }
+  if (now - lastStatsPoll >= STATS_POLL_INTERVAL_MS) {
+    wakeSTM32();
+    stm32Serial.println("STATS");
+    lastStatsPoll = now;
+  }
+  if (now - lastPowerPoll >= POWER_POLL_INTERVAL_MS) {
+    wakeSTM32();
+    stm32Serial.println("POWER");
+    lastPowerPoll = now;
+  }
+
+  // Collect the STM32 side of traced commands (answered with TR:... lines)
+  if (traceMoreOnStm32 || (traceNewRecords && now - lastTracePoll >= TRACE_POLL_INTERVAL_MS)) {
+    wakeSTM32();
+    stm32Serial.println("TRACE");
+    lastTracePoll = now;
+    traceNewRecords = false;
+    traceMoreOnStm32 = false;
+  }
+
   // Check for PONG timeout
   if (waitingForEcho && (now - lastEchoReceived > ECHO_TIMEOUT_MS)) {
     if (uartConnectionOK) {
@@ -518,6 +1249,252 @@ void checkUARTConnection() {
   }
 }
 
+// ========================================
+// Shared Clock (Coordinated Boards)
+// ========================================
+
+/**
+ * @brief True once NTP has set the system time
+ */
+bool sharedClockFromNtp() {
+  return time(nullptr) > 1600000000;  // Epoch seconds after Sep 2020
+}
+
+/**
+ * @brief Shared clock in ms: NTP time once synced, millis() before that
+ * @note Wraps at 2^32; the STM32 only uses differences
+ */
+uint32_t sharedClockMs() {
+  if (!sharedClockFromNtp()) {
+    return millis();
+  }
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (uint32_t)((uint64_t)tv.tv_sec * 1000ULL + tv.tv_usec / 1000);
+}
+
+/**
+ * @brief Send the current shared clock to the STM32 (TIME)
+ */
+void sendTimeToSTM32() {
+  uint32_t now = sharedClockMs();
+  if (binaryProtocol) {
+    uint8_t payload[4];
+    led_frame_put_le32(payload, now);
+    sendFrameToSTM32(LED_FRAME_TIME, payload, sizeof(payload));
+  } else {
+    wakeSTM32();
+    stm32Serial.print("TIME:");
+    stm32Serial.println(now);
+  }
+  lastTimeSync = millis();
+}
+
+// ========================================
+// Binary Protocol Negotiation
+// ========================================
+
+void negotiateProtocol() {
+  if (!USE_BINARY_PROTOCOL) {
+    return;
+  }
+  Serial.println("[UART] → Offering binary framing (" LED_FRAME_NEGOTIATE_REQ ")");
+  wakeSTM32();
+  stm32Serial.println(LED_FRAME_NEGOTIATE_REQ);
+}
+
+/**
+ * @brief Wake the STM32 from STOP mode before writing (led_frame.h, "Link Wake")
+ * @note The preamble is only sent after LED_LINK_WAKE_IDLE_MS of silence;
+ *       call it before every write so back-to-back writes skip it
+ */
+void wakeSTM32() {
+  unsigned long now = millis();
+  if (now - lastSTM32Write >= LED_LINK_WAKE_IDLE_MS) {
+    for (int i = 0; i < 2; i++) {
+      stm32Serial.write((uint8_t)LED_LINK_WAKE_BYTE);
+      delayMicroseconds(LED_LINK_WAKE_US);
+    }
+  }
+  lastSTM32Write = now;
+}
+
+void sendFrameToSTM32(uint8_t type, const uint8_t* payload, uint8_t len) {
+  uint8_t frame[LED_FRAME_MAX_SIZE];
+  size_t size = led_frame_encode(type, payload, len, frame, sizeof(frame));
+  wakeSTM32();
+  stm32Serial.write(frame, size);
+}
+
+// ========================================
+// STM32 Message Handlers (ASCII and Binary)
+// ========================================
+
+void onSTM32Ping(bool binary) {
+  // Respond immediately with PONG
+  if (binary) {
+    sendFrameToSTM32(LED_FRAME_STM32_PONG, NULL, 0);
+  } else {
+    wakeSTM32();
+    stm32Serial.println("STM32_PONG");
+  }
+  Serial.println("[UART] --------------------------------");
+  Serial.println("[UART] ← STM32_PING received");
+  Serial.println("[UART] → Sent STM32_PONG response");
+  Serial.println("[UART] --------------------------------");
+}
+
+void onSTM32Pong() {
+  if (!uartConnectionOK) {
+    Serial.println("[UART] ✓ UART connection restored!");
+  }
+  uartConnectionOK = true;
+  waitingForEcho = false;
+  Serial.println("[UART] ← PONG received");
+  Serial.println("[UART] ✓ Connection confirmed");
+  Serial.println("[UART] --------------------------------");
+}
+
+/**
+ * @brief Record an ACK and complete the command it belongs to
+ * @param seq Echoed sequence number, or LED_CMD_NO_SEQ (older STM32
+ *        firmware) to complete the oldest command in flight
+ */
+void onSTM32Ack(const String& ack, int seq) {
+  uint32_t receivedUs = micros();
+  lastAckReceived = ack;  // Save ACK (or ERROR) for request tracking
+  Serial.print(ack.startsWith("OK:") ? "[STM32] ← ACK: " : "[STM32] ← ERROR: ");
+  Serial.println(ack);
+
+  PendingCommand* match = NULL;
+  for (PendingCommand& cmd : pendingCommands) {
+    if (!cmd.active) {
+      continue;
+    }
+    if (seq == LED_CMD_NO_SEQ) {
+      if (match == NULL || (long)(cmd.sentAt - match->sentAt) < 0) {
+        match = &cmd;
+      }
+    } else if (cmd.seq == (uint8_t)seq) {
+      match = &cmd;
+      break;
+    }
+  }
+
+  if (match != NULL) {
+    match->trace[TRACE_ACK_RX] = receivedUs;
+    completeCommand(*match, ack);
+  } else {
+    Serial.println("[STM32] Warning: ACK matches no command in flight");
+  }
+}
+
+// ========================================
+// Latency Trace
+// ========================================
+
+/**
+ * @brief Store a record, overwriting the oldest when the ring is full
+ * @param t TRACE_STAGE_COUNT timestamps
+ */
+void traceRecord(TraceRing& ring, uint8_t seq, const uint32_t* t) {
+  TraceRecord& rec = ring.records[(ring.tail + ring.count) % TRACE_RING_SIZE];
+  rec.seq = seq;
+  memcpy(rec.t, t, sizeof(rec.t));
+  if (ring.count < TRACE_RING_SIZE) {
+    ring.count++;
+  } else {
+    ring.tail = (ring.tail + 1) % TRACE_RING_SIZE;
+  }
+}
+
+/**
+ * @brief Store one STM32 trace line
+ * @param fields "<seq>,<t0>,...,<t4>" or "END,<records left>,<cycles per second>"
+ */
+void onSTM32Trace(const String& fields) {
+  const char* p = fields.c_str();
+  uint32_t values[1 + TRACE_STAGE_COUNT];
+
+  if (fields.startsWith("END,")) {
+    uint32_t left, hz;
+    p += 4;
+    if (led_frame_parse_u32(&p, &left) == 0 && *p++ == ',' && led_frame_parse_u32(&p, &hz) == 0) {
+      traceMoreOnStm32 = (left > 0);
+      stmTraceHz = hz;
+    }
+    return;
+  }
+
+  for (uint8_t i = 0; i < 1 + TRACE_STAGE_COUNT; i++) {
+    if ((i > 0 && *p++ != ',') || led_frame_parse_u32(&p, &values[i]) != 0) {
+      Serial.println("[STM32] ✗ Malformed trace record dropped");
+      return;
+    }
+  }
+  traceRecord(stmTrace, (uint8_t)values[0], &values[1]);
+}
+
+// ========================================
+// Binary Frame Dispatch
+// ========================================
+
+void frameSTM32Ping() { onSTM32Ping(true); }
+void framePong() { onSTM32Pong(); }
+
+void frameAck() {
+  // Translate to the ASCII ACK text so logs and /clients stay unchanged
+  int seq = (frameParser.len >= 3) ? frameParser.payload[2] : LED_CMD_NO_SEQ;
+  if (frameParser.len < 2) {
+    onSTM32Ack("ERROR:BadAckFrame", seq);
+  } else if (frameParser.payload[0] == LED_FRAME_ACK_INVALID_PATTERN) {
+    onSTM32Ack("ERROR:InvalidPattern", seq);
+  } else if (frameParser.payload[0] == LED_FRAME_ACK_INVALID_PARAMS) {
+    onSTM32Ack(frameParser.payload[1] == LED_ACK_LED_SCENE ? "ERROR:InvalidLedScene"
+               : frameParser.payload[1] == LED_ACK_LED_SYNC ? "ERROR:InvalidLedSync"
+                                                            : "ERROR:InvalidLedSet", seq);
+  } else if (frameParser.payload[0] == LED_FRAME_ACK_SCHEDULE_FULL) {
+    onSTM32Ack("ERROR:ScheduleFull", seq);
+  } else if (frameParser.payload[0] == LED_FRAME_ACK_BAD_TIME) {
+    onSTM32Ack("ERROR:BadTime", seq);
+  } else if (frameParser.payload[0] != LED_FRAME_ACK_OK) {
+    onSTM32Ack("ERROR:BadFrame", seq);
+  } else if (frameParser.payload[1] == LED_ACK_LED_SET) {
+    onSTM32Ack("OK:LedSet", seq);
+  } else if (frameParser.payload[1] == LED_ACK_LED_SCENE) {
+    onSTM32Ack("OK:LedScene", seq);
+  } else if (frameParser.payload[1] == LED_ACK_LED_SYNC) {
+    onSTM32Ack("OK:LedSync", seq);
+  } else if (frameParser.payload[1] == 4) {
+    onSTM32Ack("OK:AllOFF", seq);
+  } else {
+    onSTM32Ack("OK:Pattern" + String(frameParser.payload[1]), seq);
+  }
+}
+
+/**
+ * @brief Frame type → handler table (unlisted types are ignored)
+ */
+struct FrameHandler {
+  uint8_t type;
+  void (*handler)();
+};
+
+const FrameHandler FRAME_HANDLERS[] = {
+  { LED_FRAME_STM32_PING, frameSTM32Ping },
+  { LED_FRAME_PONG,       framePong },
+  { LED_FRAME_ACK,        frameAck },
+};
+
+void processSTM32Frame() {
+  for (const FrameHandler& entry : FRAME_HANDLERS) {
+    if (entry.type == frameParser.type) {
+      entry.handler();
+      return;
+    }
+  }
+}
+
 // ========================================
 // Process STM32 Responses
 // ========================================
@@ -528,44 +1505,79 @@ void processSTM32Response() {
   while (stm32Serial.available()) {
     char c = stm32Serial.read();
 
+    // Binary frame: SYNC at a line boundary, or continuation of a frame
+    if (led_frame_parser_busy(&frameParser) ||
+        ((uint8_t)c == LED_FRAME_SYNC && rxBuffer.length() == 0)) {
+      led_frame_result_t result = led_frame_parse_byte(&frameParser, (uint8_t)c);
+      if (result == LED_FRAME_COMPLETE) {
+        processSTM32Frame();
+      } else if (result != LED_FRAME_INCOMPLETE) {
+        Serial.println("[STM32] ✗ Corrupted frame dropped");
+      }
+      continue;
+    }
+
     if (c == '\n' || c == '\r') {
       if (rxBuffer.length() > 0) {
         // Check for STM32_PING (connection test from STM32)
         if (rxBuffer.startsWith("STM32_PING")) {
-          // Respond immediately with PONG
-          stm32Serial.println("STM32_PONG");
-          Serial.println("[UART] --------------------------------");
-          Serial.println("[UART] ← STM32_PING received");
-          Serial.println("[UART] → Sent STM32_PONG response");
-          Serial.println("[UART] --------------------------------");
+          onSTM32Ping(false);
         }
         // Check for PONG (reply to our PING)
         else if (rxBuffer.startsWith("PONG")) {
-          if (!uartConnectionOK) {
-            Serial.println("[UART] ✓ UART connection restored!");
+          onSTM32Pong();
+        }
+        // Check for binary framing acceptance
+        else if (rxBuffer.startsWith(LED_FRAME_NEGOTIATE_ACK)) {
+          binaryProtocol = true;
+          Serial.println("[UART] ✓ Binary framing enabled");
+          sendTimeToSTM32();
+        }
+        // Check for acknowledgments and errors
+        else if (rxBuffer.startsWith("OK:") || rxBuffer.startsWith("ERROR:")) {
+          // Split off the echoed sequence number ("OK:Pattern2#17")
+          int sep = rxBuffer.lastIndexOf(LED_CMD_SEQ_SEPARATOR);
+          if (sep > 0) {
+            onSTM32Ack(rxBuffer.substring(0, sep), rxBuffer.substring(sep + 1).toInt());
+          } else {
+            onSTM32Ack(rxBuffer, LED_CMD_NO_SEQ);
           }
-          uartConnectionOK = true;
-          waitingForEcho = false;
-          Serial.println("[UART] ← PONG received");
-          Serial.println("[UART] ✓ Connection confirmed");
-          Serial.println("[UART] --------------------------------");
         }
-        // Check for acknowledgments
-        else if (rxBuffer.startsWith("OK:")) {
-          lastAckReceived = rxBuffer;  // Save ACK for request tracking
-          Serial.print("[STM32] ← ACK: ");
-          Serial.println(rxBuffer);
+        // STM32 was reset by its IWDG; names the task that hung
+        else if (rxBuffer.startsWith("WDT_RESET:")) {
+          lastWatchdogReset = rxBuffer.substring(10);
+          Serial.println("[STM32] ✗ Watchdog reset, hung task: " + lastWatchdogReset);
         }
-        // Check for errors
-        else if (rxBuffer.startsWith("ERROR:")) {
-          lastAckReceived = rxBuffer;  // Save ERROR as ACK for request tracking
-          Serial.print("[STM32] ← ERROR: ");
-          Serial.println(rxBuffer);
+        // Stack/heap telemetry (reply to MEM)
+        else if (rxBuffer.startsWith("MEM:")) {
+          if (rxBuffer.length() > 4) {  // Empty until the first sample
+            lastMemReport = rxBuffer.substring(4);
+            lastMemReportAt = millis();
+          }
+        }
+        // CPU statistics (reply to STATS)
+        else if (rxBuffer.startsWith("STATS:")) {
+          lastStatsReport = rxBuffer.substring(6);
+          lastStatsReportAt = millis();
+        }
+        // Sleep/STOP residency (reply to POWER)
+        else if (rxBuffer.startsWith("PWR:")) {
+          lastPowerReport = rxBuffer.substring(4);
+          lastPowerReportAt = millis();
+        }
+        // Latency trace records (reply to TRACE)
+        else if (rxBuffer.startsWith("TR:")) {
+          onSTM32Trace(rxBuffer.substring(3));
         }
         // Other messages
         else {
           Serial.print("[STM32] ← ");
           Serial.println(rxBuffer);
+          // STM32 rebooted: offer binary framing again
+          if (rxBuffer.indexOf("LED Controller Ready") >= 0) {
+            negotiateProtocol();
+            lastTimeSync = 0;  // Its shared clock is gone too
+          }
         }
 
         rxBuffer = "";
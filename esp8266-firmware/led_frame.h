@@ -0,0 +1,731 @@
+/**
+ ******************************************************************************
+ * @file           : led_frame.h
+ * @brief          : Binary Framed Protocol (ESP8266 <-> STM32) - Shared Codec
+ ******************************************************************************
+ * @description
+ * Compact binary framing for the UART2 link, shared verbatim by the STM32
+ * firmware, the ESP8266 sketch and host-side tools. Header-only, no HAL or
+ * RTOS dependencies, valid C99 and C++.
+ *
+ * Edit this copy (common/led_frame.h) only: the STM32 build reads it through
+ * its include path, the ESP8266 sketch folder holds a copy refreshed by
+ * common/sync_led_frame.py (Arduino only compiles files inside the sketch).
+ *
+ * Frame Layout:
+ * ┌──────┬──────┬─────┬───────────────┬───────────┐
+ * │ SYNC │ TYPE │ LEN │ PAYLOAD (LEN) │ CRC16 LE  │
+ * │ 0xA5 │ 1 B  │ 1 B │ 0..32 bytes   │ 2 bytes   │
+ * └──────┴──────┴─────┴───────────────┴───────────┘
+ * CRC16-CCITT (poly 0x1021, init 0xFFFF) over TYPE, LEN and PAYLOAD.
+ *
+ * Negotiation:
+ * - Both sides always accept ASCII lines AND binary frames (SYNC byte never
+ *   starts an ASCII line), so either end may reset at any time
+ * - ESP8266 sends "PROTO:BIN\r\n" at startup; STM32 answers "OK:ProtoBin\r\n"
+ * - After that the ESP8266 sends binary frames; the STM32 answers each
+ *   request in the format it arrived in
+ * - Old STM32 firmware never answers, so the ESP8266 stays on ASCII
+ *
+ * Sequence Numbers (pipelined commands):
+ * - LED commands may carry an 8-bit sequence number that the STM32 echoes in
+ *   its ACK, so several commands can be in flight at once
+ * - ASCII: "LED_CMD:2#17" → "OK:Pattern2#17" (no "#seq" → plain ACK)
+ * - Binary: LED_CMD [pattern][seq] → ACK [status][pattern][seq]
+ * - ACKs without a sequence number come from older firmware and belong to
+ *   the oldest outstanding command
+ *
+ * Parameterized Blink (LED_SET):
+ * - ASCII: "LED_SET:<mask>,<period_ms>,<duty_pct>,<phase_ms>[#seq]"
+ *   e.g. "LED_SET:3,500,20,250#9" → "OK:LedSet#9" / "ERROR:InvalidLedSet#9"
+ * - Binary: LED_SET [mask][period LE16][duty][phase LE16] (+ [seq])
+ *   → ACK [status][LED_ACK_LED_SET][seq]
+ * - Both ends validate with led_set_validate() before acting
+ *
+ * Scenes (LED_SCENE, several LED_SET groups applied together, one ACK):
+ * - ASCII: "LED_SCENE:<group>;<group>...[#seq]", group = LED_SET arguments
+ *   e.g. "LED_SCENE:1,200,50,0;2,2000,50,0;12,500,100,0#4" → "OK:LedScene#4"
+ * - Binary: LED_SCENE [group 6 B] × n (+ [seq]), n = 1..LED_SCENE_MAX_GROUPS
+ *   → ACK [status][LED_ACK_LED_SCENE][seq]
+ * - Groups must not share LEDs; LEDs in no group turn off
+ *
+ * Synchronized Blink (LED_SYNC, one time base for a group of LEDs):
+ * - ASCII: "LED_SYNC:<mask>,<period_ms>,<mode>[#seq]", mode 0 = in phase,
+ *   1 = anti-phase (alternate LEDs half a period apart), 2 = chase (one
+ *   LED at a time), e.g. "LED_SYNC:15,400,2#3" → "OK:LedSync#3"
+ * - Binary: LED_SYNC [mask][period LE16][mode] (+ [seq])
+ *   → ACK [status][LED_ACK_LED_SYNC][seq]
+ * - LEDs outside the mask turn off
+ *
+ * Shared Time and Scheduled Commands (coordinated boards):
+ * - ESP8266 → STM32 "TIME:<ms>" / TIME [ms LE32]: the sender's shared clock
+ *   (NTP-derived milliseconds, wrapping at 2^32), sent periodically
+ * - "LED_AT:<due_ms>@<LED_CMD|LED_SET|LED_SCENE|LED_SYNC line>" / LED_AT [due LE32]
+ *   [inner type][inner payload]: run the inner command when the shared
+ *   clock reaches due_ms; the ACK is the inner command's ACK, sent when the
+ *   command is queued
+ * - A due time already passed runs at once; one more than
+ *   LED_AT_MAX_AHEAD_MS ahead is rejected (clock error)
+ *
+ * Link Wake (STM32 in STOP mode):
+ * - The STM32 stops its clocks when idle; the falling edge of a start bit
+ *   on its RX pin wakes it, but that byte is lost
+ * - Before writing after LED_LINK_WAKE_IDLE_MS of silence, the ESP8266
+ *   sends LED_LINK_WAKE_BYTE twice, LED_LINK_WAKE_US apart, then waits
+ *   LED_LINK_WAKE_US (the second byte covers a STOP entered just as the
+ *   first one arrived)
+ * - 0xFF has no low bit but the start bit: received while awake it is a
+ *   complete byte the STM32 skips outside frames; cut short by the wakeup
+ *   the line just looks idle
+ * - The STM32 only enters STOP after LED_LINK_STOP_QUIET_MS without RX, so
+ *   replies and follow-up commands of one exchange need no preamble
+ *
+ * Usage Example:
+ * ```c
+ * uint8_t buf[LED_FRAME_MAX_SIZE];
+ * uint8_t pattern = 2;
+ * size_t n = led_frame_encode(LED_FRAME_LED_CMD, &pattern, 1, buf, sizeof(buf));
+ *
+ * led_frame_parser_t parser;
+ * led_frame_parser_reset(&parser);
+ * for (size_t i = 0; i < n; i++) {
+ *     if (led_frame_parse_byte(&parser, buf[i]) == LED_FRAME_COMPLETE) {
+ *         // parser.type / parser.payload / parser.len hold the frame
+ *     }
+ * }
+ * ```
+ ******************************************************************************
+ */
+
+#ifndef __LED_FRAME_H
+#define __LED_FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * Protocol Constants
+ *===========================================================================*/
+
+#define LED_FRAME_SYNC         0xA5  // Start-of-frame marker (never valid ASCII)
+#define LED_FRAME_MAX_PAYLOAD  32    // Largest payload accepted by the parser
+#define LED_FRAME_OVERHEAD     5     // SYNC + TYPE + LEN + CRC16
+#define LED_FRAME_MAX_SIZE     (LED_FRAME_MAX_PAYLOAD + LED_FRAME_OVERHEAD)
+
+/** Separator before the sequence number in ASCII LED_CMD / ACK lines */
+#define LED_CMD_SEQ_SEPARATOR  '#'
+#define LED_CMD_NO_SEQ         (-1)  // Command/ACK without sequence number
+
+/** LED_SET limits (checked by led_set_validate()) */
+#define LED_SET_MASK_ALL       0x0F   // Green, Orange, Red, Blue
+#define LED_SET_PERIOD_MIN_MS  10
+#define LED_SET_PERIOD_MAX_MS  60000
+#define LED_SET_DUTY_MAX       100    // Percent on
+#define LED_SET_PAYLOAD_SIZE   6      // Binary payload without seq
+#define LED_ACK_LED_SET        0      // ACK "pattern" byte for LED_SET
+
+/** LED_SCENE limits */
+#define LED_SCENE_MAX_GROUPS   4      // One per LED at most
+#define LED_SCENE_SEPARATOR    ';'    // Between ASCII groups
+#define LED_ACK_LED_SCENE      5      // ACK "pattern" byte for LED_SCENE
+
+/** LED_SYNC limits (period as LED_SET, checked by led_sync_validate()) */
+#define LED_SYNC_MODE_COUNT    4      // In phase, anti-phase, chase, breathe
+#define LED_SYNC_PAYLOAD_SIZE  4      // Binary payload without seq
+#define LED_ACK_LED_SYNC       6      // ACK "pattern" byte for LED_SYNC
+
+/** Scheduled commands */
+#define LED_AT_SEPARATOR       '@'      // Between due time and inner command
+#define LED_AT_HEADER_SIZE     5        // Binary: due LE32 + inner type
+#define LED_AT_MAX_AHEAD_MS    600000UL // 10 minutes
+
+/** Link wake preamble (see "Link Wake" above) */
+#define LED_LINK_WAKE_BYTE      0xFF  // Never valid ASCII, never starts a frame
+#define LED_LINK_WAKE_IDLE_MS   5     // Silence after which the ESP8266 sends it
+#define LED_LINK_WAKE_US        1000  // STOP exit + PLL relock, with margin
+#define LED_LINK_STOP_QUIET_MS  20    // STM32 RX silence before STOP is allowed
+
+/** ASCII negotiation lines (sent with trailing \r\n) */
+#define LED_FRAME_NEGOTIATE_REQ  "PROTO:BIN"
+#define LED_FRAME_NEGOTIATE_ACK  "OK:ProtoBin"
+
+/**
+ * @brief  Frame types
+ *
+ * Payloads:
+ * - PING / PONG / STM32_PING / STM32_PONG: none
+ * - LED_CMD: [pattern] or [pattern][seq] (1..4, same numbering as LED_CMD:x)
+ * - LED_SET: [mask][period LE16][duty][phase LE16] or ... [seq]
+ * - LED_SCENE: 1..4 LED_SET payloads back to back, or ... [seq]
+ * - LED_SYNC: [mask][period LE16][mode] or ... [seq]
+ * - TIME:    [shared ms LE32]
+ * - LED_AT:  [due ms LE32][inner type][inner payload incl. seq]
+ * - ACK:     [status][pattern] or [status][pattern][seq]
+ *            (status from led_frame_status_code_t, seq echoed from LED_CMD;
+ *            pattern = LED_ACK_LED_SET for LED_SET)
+ */
+typedef enum {
+    LED_FRAME_PING        = 0x01,  /**< ESP8266 → STM32 connection test */
+    LED_FRAME_PONG        = 0x02,  /**< STM32 → ESP8266 reply to PING */
+    LED_FRAME_STM32_PING  = 0x03,  /**< STM32 → ESP8266 connection test */
+    LED_FRAME_STM32_PONG  = 0x04,  /**< ESP8266 → STM32 reply to STM32_PING */
+    LED_FRAME_LED_CMD     = 0x10,  /**< ESP8266 → STM32 pattern selection */
+    LED_FRAME_ACK         = 0x11,  /**< STM32 → ESP8266 command result */
+    LED_FRAME_LED_SET     = 0x12,  /**< ESP8266 → STM32 parameterized blink */
+    LED_FRAME_LED_SCENE   = 0x13,  /**< ESP8266 → STM32 several LED_SET groups */
+    LED_FRAME_TIME        = 0x14,  /**< ESP8266 → STM32 shared clock */
+    LED_FRAME_LED_AT      = 0x15,  /**< ESP8266 → STM32 command at a due time */
+    LED_FRAME_LED_SYNC    = 0x16,  /**< ESP8266 → STM32 synchronized LED group */
+    LED_FRAME_TYPE_COUNT           /**< Size for type-indexed dispatch tables */
+} led_frame_type_t;
+
+/** ACK status codes */
+typedef enum {
+    LED_FRAME_ACK_OK              = 0x00,
+    LED_FRAME_ACK_INVALID_PATTERN = 0x01,
+    LED_FRAME_ACK_BAD_LENGTH      = 0x02,
+    LED_FRAME_ACK_INVALID_PARAMS  = 0x03,
+    LED_FRAME_ACK_SCHEDULE_FULL   = 0x04,  /**< LED_AT: queue full */
+    LED_FRAME_ACK_BAD_TIME        = 0x05   /**< LED_AT: no clock or too far ahead */
+} led_frame_status_code_t;
+
+/** LED_SET parameters */
+typedef struct {
+    uint8_t mask;          /**< LEDs, bit 0 = Green .. bit 3 = Blue */
+    uint8_t duty;          /**< Percent of the period the LEDs are on */
+    uint16_t period_ms;    /**< Blink period */
+    uint16_t phase_ms;     /**< Delay of the on-edge within the period */
+} led_set_params_t;
+
+/** LED_SCENE: groups applied at the same instant */
+typedef struct {
+    uint8_t count;                                  /**< 1..LED_SCENE_MAX_GROUPS */
+    led_set_params_t group[LED_SCENE_MAX_GROUPS];
+} led_scene_t;
+
+/** LED_SYNC parameters */
+typedef struct {
+    uint8_t mask;          /**< LEDs, bit 0 = Green .. bit 3 = Blue */
+    uint8_t mode;          /**< 0 in phase, 1 anti-phase, 2 chase, 3 breathe */
+    uint16_t period_ms;    /**< Shared blink period */
+} led_sync_params_t;
+
+/** Result of feeding one byte to the parser */
+typedef enum {
+    LED_FRAME_INCOMPLETE = 0,  /**< Need more bytes */
+    LED_FRAME_COMPLETE,        /**< Valid frame available in parser */
+    LED_FRAME_CRC_ERROR,       /**< Frame dropped: CRC mismatch */
+    LED_FRAME_LENGTH_ERROR     /**< Frame dropped: LEN > LED_FRAME_MAX_PAYLOAD */
+} led_frame_result_t;
+
+/** Parser state machine */
+typedef enum {
+    LED_FRAME_STATE_SYNC = 0,
+    LED_FRAME_STATE_TYPE,
+    LED_FRAME_STATE_LEN,
+    LED_FRAME_STATE_PAYLOAD,
+    LED_FRAME_STATE_CRC_LO,
+    LED_FRAME_STATE_CRC_HI
+} led_frame_state_t;
+
+/** Incremental frame parser (one per link direction) */
+typedef struct {
+    led_frame_state_t state;
+    uint8_t type;
+    uint8_t len;
+    uint8_t index;
+    uint16_t crc;
+    uint8_t crc_lo;
+    uint8_t payload[LED_FRAME_MAX_PAYLOAD];
+} led_frame_parser_t;
+
+/*============================================================================
+ * Codec Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Update CRC16-CCITT with one byte
+ * @param  crc: Running CRC (start with 0xFFFF)
+ * @param  byte: Next data byte
+ * @retval Updated CRC
+ */
+static inline uint16_t led_frame_crc16_update(uint16_t crc, uint8_t byte)
+{
+    crc ^= (uint16_t)byte << 8;
+    for (int bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+/**
+ * @brief  Encode a frame into a caller-supplied buffer
+ * @param  type: Frame type
+ * @param  payload: Payload bytes (may be NULL if len == 0)
+ * @param  len: Payload length (<= LED_FRAME_MAX_PAYLOAD)
+ * @param  out: Output buffer
+ * @param  out_size: Output buffer size
+ * @retval Encoded frame size, or 0 if it does not fit
+ */
+static inline size_t led_frame_encode(uint8_t type, const uint8_t *payload, uint8_t len,
+                                      uint8_t *out, size_t out_size)
+{
+    if (len > LED_FRAME_MAX_PAYLOAD || out_size < (size_t)len + LED_FRAME_OVERHEAD) {
+        return 0;
+    }
+
+    uint16_t crc = 0xFFFF;
+    out[0] = LED_FRAME_SYNC;
+    out[1] = type;
+    out[2] = len;
+    crc = led_frame_crc16_update(crc, type);
+    crc = led_frame_crc16_update(crc, len);
+    for (uint8_t i = 0; i < len; i++) {
+        out[3 + i] = payload[i];
+        crc = led_frame_crc16_update(crc, payload[i]);
+    }
+    out[3 + len] = (uint8_t)(crc & 0xFF);
+    out[4 + len] = (uint8_t)(crc >> 8);
+
+    return (size_t)len + LED_FRAME_OVERHEAD;
+}
+
+/**
+ * @brief  Reset parser to hunt for the next SYNC byte
+ * @param  p: Parser
+ * @retval None
+ */
+static inline void led_frame_parser_reset(led_frame_parser_t *p)
+{
+    p->state = LED_FRAME_STATE_SYNC;
+    p->len = 0;
+    p->index = 0;
+}
+
+/**
+ * @brief  Check whether the parser is in the middle of a frame
+ * @param  p: Parser
+ * @retval Non-zero if SYNC has been seen and the frame is not finished
+ */
+static inline int led_frame_parser_busy(const led_frame_parser_t *p)
+{
+    return p->state != LED_FRAME_STATE_SYNC;
+}
+
+/**
+ * @brief  Feed one received byte to the parser
+ * @param  p: Parser
+ * @param  byte: Received byte
+ * @retval LED_FRAME_COMPLETE when p->type / p->payload / p->len hold a
+ *         CRC-checked frame; error codes when a frame was dropped
+ *
+ * Bytes outside a frame that are not LED_FRAME_SYNC are ignored, so callers
+ * route them to their ASCII line handler before calling this function.
+ */
+static inline led_frame_result_t led_frame_parse_byte(led_frame_parser_t *p, uint8_t byte)
+{
+    switch (p->state) {
+        case LED_FRAME_STATE_SYNC:
+            if (byte == LED_FRAME_SYNC) {
+                p->crc = 0xFFFF;
+                p->state = LED_FRAME_STATE_TYPE;
+            }
+            break;
+
+        case LED_FRAME_STATE_TYPE:
+            p->type = byte;
+            p->crc = led_frame_crc16_update(p->crc, byte);
+            p->state = LED_FRAME_STATE_LEN;
+            break;
+
+        case LED_FRAME_STATE_LEN:
+            if (byte > LED_FRAME_MAX_PAYLOAD) {
+                led_frame_parser_reset(p);
+                return LED_FRAME_LENGTH_ERROR;
+            }
+            p->len = byte;
+            p->index = 0;
+            p->crc = led_frame_crc16_update(p->crc, byte);
+            p->state = (byte > 0) ? LED_FRAME_STATE_PAYLOAD : LED_FRAME_STATE_CRC_LO;
+            break;
+
+        case LED_FRAME_STATE_PAYLOAD:
+            p->payload[p->index++] = byte;
+            p->crc = led_frame_crc16_update(p->crc, byte);
+            if (p->index >= p->len) {
+                p->state = LED_FRAME_STATE_CRC_LO;
+            }
+            break;
+
+        case LED_FRAME_STATE_CRC_LO:
+            p->crc_lo = byte;
+            p->state = LED_FRAME_STATE_CRC_HI;
+            break;
+
+        case LED_FRAME_STATE_CRC_HI: {
+            uint16_t received = (uint16_t)(p->crc_lo | ((uint16_t)byte << 8));
+            p->state = LED_FRAME_STATE_SYNC;
+            return (received == p->crc) ? LED_FRAME_COMPLETE : LED_FRAME_CRC_ERROR;
+        }
+
+        default:
+            led_frame_parser_reset(p);
+            break;
+    }
+
+    return LED_FRAME_INCOMPLETE;
+}
+
+/**
+ * @brief  Read a little-endian 32-bit value
+ * @param  p: 4 bytes
+ * @retval Value
+ */
+static inline uint32_t led_frame_get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief  Write a little-endian 32-bit value
+ * @param  p: 4 bytes
+ * @param  value: Value
+ * @retval None
+ */
+static inline void led_frame_put_le32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @brief  Parse an unsigned 32-bit decimal (TIME, LED_AT due time)
+ * @param  text: In: digits; out: first character after them
+ * @param  value: Parsed value
+ * @retval 0 on success, -1 if there are no digits or the value overflows
+ */
+static inline int led_frame_parse_u32(const char **text, uint32_t *value)
+{
+    const char *c = *text;
+    uint32_t v = 0;
+
+    if (*c < '0' || *c > '9') {
+        return -1;
+    }
+    while (*c >= '0' && *c <= '9') {
+        uint32_t digit = (uint32_t)(*c++ - '0');
+        if (v > (0xFFFFFFFFUL - digit) / 10) {
+            return -1;
+        }
+        v = v * 10 + digit;
+    }
+    *text = c;
+    *value = v;
+    return 0;
+}
+
+/**
+ * @brief  Parse comma-separated decimal fields "<a>,<b>,..."
+ * @param  cursor: In: start of the fields; out: first character after them
+ * @param  field: Parsed values
+ * @param  count: Number of fields expected
+ * @retval 0 if exactly count fields were read, -1 otherwise
+ *
+ * Strict: decimal digits only, no signs or spaces, at most 5 digits per
+ * field (no overflow possible).
+ */
+static inline int led_frame_parse_fields(const char **cursor, uint32_t *field, int count)
+{
+    const char *text = *cursor;
+
+    for (int i = 0; i < count; i++) {
+        int digits = 0;
+        field[i] = 0;
+        while (*text >= '0' && *text <= '9') {
+            if (++digits > 5) {
+                return -1;
+            }
+            field[i] = field[i] * 10 + (uint32_t)(*text++ - '0');
+        }
+        if (digits == 0) {
+            return -1;
+        }
+        if (i < count - 1 && *text++ != ',') {
+            return -1;
+        }
+    }
+    *cursor = text;
+    return 0;
+}
+
+/*============================================================================
+ * LED_SET Parameters
+ *===========================================================================*/
+
+/**
+ * @brief  Check LED_SET parameters against the protocol limits
+ * @param  p: Parameters
+ * @retval 0 if valid, -1 otherwise
+ */
+static inline int led_set_validate(const led_set_params_t *p)
+{
+    if (p->mask == 0 || (p->mask & ~LED_SET_MASK_ALL) != 0) {
+        return -1;
+    }
+    if (p->period_ms < LED_SET_PERIOD_MIN_MS || p->period_ms > LED_SET_PERIOD_MAX_MS) {
+        return -1;
+    }
+    if (p->duty > LED_SET_DUTY_MAX || p->phase_ms >= p->period_ms) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Parse the four LED_SET fields "<mask>,<period>,<duty>,<phase>"
+ * @param  cursor: In: start of the fields; out: first character after them
+ * @param  p: Parsed parameters (valid only if 0 is returned)
+ * @retval 0 if the fields are well formed and led_set_validate() passes
+ *
+ * Strict: exactly four fields (led_frame_parse_fields()).
+ */
+static inline int led_set_parse_fields(const char **cursor, led_set_params_t *p)
+{
+    uint32_t field[4];
+
+    if (led_frame_parse_fields(cursor, field, 4) != 0) {
+        return -1;
+    }
+    if (field[0] > 0xFF || field[1] > 0xFFFF || field[2] > 0xFF || field[3] > 0xFFFF) {
+        return -1;
+    }
+
+    p->mask = (uint8_t)field[0];
+    p->period_ms = (uint16_t)field[1];
+    p->duty = (uint8_t)field[2];
+    p->phase_ms = (uint16_t)field[3];
+    return led_set_validate(p);
+}
+
+/**
+ * @brief  Parse ASCII LED_SET arguments "<mask>,<period>,<duty>,<phase>"
+ * @param  text: Arguments; must end at '\0' or LED_CMD_SEQ_SEPARATOR
+ * @param  p: Parsed parameters (valid only if 0 is returned)
+ * @retval 0 if the text is well formed and led_set_validate() passes
+ */
+static inline int led_set_parse(const char *text, led_set_params_t *p)
+{
+    if (led_set_parse_fields(&text, p) != 0) {
+        return -1;
+    }
+    return (*text == '\0' || *text == LED_CMD_SEQ_SEPARATOR) ? 0 : -1;
+}
+
+/**
+ * @brief  Encode LED_SET parameters as a binary payload
+ * @param  p: Parameters
+ * @param  out: LED_SET_PAYLOAD_SIZE bytes
+ * @retval None
+ */
+static inline void led_set_encode(const led_set_params_t *p, uint8_t *out)
+{
+    out[0] = p->mask;
+    out[1] = (uint8_t)(p->period_ms & 0xFF);
+    out[2] = (uint8_t)(p->period_ms >> 8);
+    out[3] = p->duty;
+    out[4] = (uint8_t)(p->phase_ms & 0xFF);
+    out[5] = (uint8_t)(p->phase_ms >> 8);
+}
+
+/**
+ * @brief  Decode a binary LED_SET payload
+ * @param  payload: Payload bytes
+ * @param  len: LED_SET_PAYLOAD_SIZE, or one more with a trailing seq
+ * @param  p: Decoded parameters (valid only if 0 is returned)
+ * @retval 0 if the length is right and led_set_validate() passes
+ */
+static inline int led_set_decode(const uint8_t *payload, uint8_t len, led_set_params_t *p)
+{
+    if (len != LED_SET_PAYLOAD_SIZE && len != LED_SET_PAYLOAD_SIZE + 1) {
+        return -1;
+    }
+    p->mask = payload[0];
+    p->period_ms = (uint16_t)(payload[1] | ((uint16_t)payload[2] << 8));
+    p->duty = payload[3];
+    p->phase_ms = (uint16_t)(payload[4] | ((uint16_t)payload[5] << 8));
+    return led_set_validate(p);
+}
+
+/*============================================================================
+ * LED_SCENE
+ *===========================================================================*/
+
+/**
+ * @brief  Check that scene groups are valid and share no LED
+ * @param  scene: Scene
+ * @retval 0 if valid, -1 otherwise
+ */
+static inline int led_scene_validate(const led_scene_t *scene)
+{
+    uint8_t used = 0;
+
+    if (scene->count == 0 || scene->count > LED_SCENE_MAX_GROUPS) {
+        return -1;
+    }
+    for (uint8_t i = 0; i < scene->count; i++) {
+        if (led_set_validate(&scene->group[i]) != 0 || (scene->group[i].mask & used) != 0) {
+            return -1;
+        }
+        used |= scene->group[i].mask;
+    }
+    return 0;
+}
+
+/**
+ * @brief  Parse ASCII LED_SCENE arguments "<group>;<group>..."
+ * @param  text: Arguments; must end at '\0' or LED_CMD_SEQ_SEPARATOR
+ * @param  scene: Parsed scene (valid only if 0 is returned)
+ * @retval 0 if every group parses and led_scene_validate() passes
+ */
+static inline int led_scene_parse(const char *text, led_scene_t *scene)
+{
+    scene->count = 0;
+    for (;;) {
+        if (scene->count >= LED_SCENE_MAX_GROUPS
+                || led_set_parse_fields(&text, &scene->group[scene->count]) != 0) {
+            return -1;
+        }
+        scene->count++;
+        if (*text != LED_SCENE_SEPARATOR) {
+            break;
+        }
+        text++;
+    }
+    if (*text != '\0' && *text != LED_CMD_SEQ_SEPARATOR) {
+        return -1;
+    }
+    return led_scene_validate(scene);
+}
+
+/**
+ * @brief  Encode a scene as a binary payload
+ * @param  scene: Valid scene
+ * @param  out: At least count × LED_SET_PAYLOAD_SIZE bytes
+ * @retval Payload length
+ */
+static inline uint8_t led_scene_encode(const led_scene_t *scene, uint8_t *out)
+{
+    for (uint8_t i = 0; i < scene->count; i++) {
+        led_set_encode(&scene->group[i], &out[i * LED_SET_PAYLOAD_SIZE]);
+    }
+    return (uint8_t)(scene->count * LED_SET_PAYLOAD_SIZE);
+}
+
+/**
+ * @brief  Decode a binary LED_SCENE payload
+ * @param  payload: Payload bytes
+ * @param  len: n × LED_SET_PAYLOAD_SIZE, or one more with a trailing seq
+ * @param  scene: Decoded scene (valid only if 0 is returned)
+ * @retval 0 if the length is right and led_scene_validate() passes
+ */
+static inline int led_scene_decode(const uint8_t *payload, uint8_t len, led_scene_t *scene)
+{
+    uint8_t groups = (uint8_t)(len / LED_SET_PAYLOAD_SIZE);
+
+    if ((len % LED_SET_PAYLOAD_SIZE) > 1 || groups == 0 || groups > LED_SCENE_MAX_GROUPS) {
+        return -1;
+    }
+    scene->count = groups;
+    for (uint8_t i = 0; i < groups; i++) {
+        led_set_decode(&payload[i * LED_SET_PAYLOAD_SIZE], LED_SET_PAYLOAD_SIZE, &scene->group[i]);
+    }
+    return led_scene_validate(scene);
+}
+
+/*============================================================================
+ * LED_SYNC
+ *===========================================================================*/
+
+/**
+ * @brief  Check LED_SYNC parameters against the protocol limits
+ * @param  p: Parameters
+ * @retval 0 if valid, -1 otherwise
+ */
+static inline int led_sync_validate(const led_sync_params_t *p)
+{
+    if (p->mask == 0 || (p->mask & ~LED_SET_MASK_ALL) != 0) {
+        return -1;
+    }
+    if (p->period_ms < LED_SET_PERIOD_MIN_MS || p->period_ms > LED_SET_PERIOD_MAX_MS) {
+        return -1;
+    }
+    return (p->mode < LED_SYNC_MODE_COUNT) ? 0 : -1;
+}
+
+/**
+ * @brief  Parse ASCII LED_SYNC arguments "<mask>,<period>,<mode>"
+ * @param  text: Arguments; must end at '\0' or LED_CMD_SEQ_SEPARATOR
+ * @param  p: Parsed parameters (valid only if 0 is returned)
+ * @retval 0 if the text is well formed and led_sync_validate() passes
+ */
+static inline int led_sync_parse(const char *text, led_sync_params_t *p)
+{
+    uint32_t field[3];
+
+    if (led_frame_parse_fields(&text, field, 3) != 0
+            || (*text != '\0' && *text != LED_CMD_SEQ_SEPARATOR)) {
+        return -1;
+    }
+    if (field[0] > 0xFF || field[1] > 0xFFFF || field[2] > 0xFF) {
+        return -1;
+    }
+
+    p->mask = (uint8_t)field[0];
+    p->period_ms = (uint16_t)field[1];
+    p->mode = (uint8_t)field[2];
+    return led_sync_validate(p);
+}
+
+/**
+ * @brief  Encode LED_SYNC parameters as a binary payload
+ * @param  p: Parameters
+ * @param  out: LED_SYNC_PAYLOAD_SIZE bytes
+ * @retval None
+ */
+static inline void led_sync_encode(const led_sync_params_t *p, uint8_t *out)
+{
+    out[0] = p->mask;
+    out[1] = (uint8_t)(p->period_ms & 0xFF);
+    out[2] = (uint8_t)(p->period_ms >> 8);
+    out[3] = p->mode;
+}
+
+/**
+ * @brief  Decode a binary LED_SYNC payload
+ * @param  payload: Payload bytes
+ * @param  len: LED_SYNC_PAYLOAD_SIZE, or one more with a trailing seq
+ * @param  p: Decoded parameters (valid only if 0 is returned)
+ * @retval 0 if the length is right and led_sync_validate() passes
+ */
+static inline int led_sync_decode(const uint8_t *payload, uint8_t len, led_sync_params_t *p)
+{
+    if (len != LED_SYNC_PAYLOAD_SIZE && len != LED_SYNC_PAYLOAD_SIZE + 1) {
+        return -1;
+    }
+    p->mask = payload[0];
+    p->period_ms = (uint16_t)(payload[1] | ((uint16_t)payload[2] << 8));
+    p->mode = payload[3];
+    return led_sync_validate(p);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LED_FRAME_H */
@@ -44,6 +44,9 @@
 #if defined( __ICCARM__) || defined(__GNUC__) || defined(__CC_ARM)
 	#include <stdint.h>
 	extern uint32_t SystemCoreClock;
+	void runtime_stats_timer_init(void);
+	uint32_t runtime_stats_counter(void);
+	void low_power_suppress_ticks_and_sleep(uint32_t expected_idle_ticks);
 #endif
 
 #define configUSE_PREEMPTION			1
@@ -62,10 +65,19 @@
 #define configQUEUE_REGISTRY_SIZE		8
 #define configCHECK_FOR_STACK_OVERFLOW	0
 #define configUSE_RECURSIVE_MUTEXES		1
-#define configUSE_MALLOC_FAILED_HOOK	0
+#define configUSE_MALLOC_FAILED_HOOK	1   /* Counted by telemetry (MEM fail=) */
 #define configUSE_APPLICATION_TASK_TAG	0
 #define configUSE_COUNTING_SEMAPHORES	1
-#define configGENERATE_RUN_TIME_STATS	0
+#define configGENERATE_RUN_TIME_STATS	1   /* DWT CYCCNT based, see runtime_stats.h */
+
+/* Run time stats clock: extended DWT cycle counter / 2^RUNTIME_STATS_SHIFT */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()	runtime_stats_timer_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()		runtime_stats_counter()
+
+/* Tickless idle: SysTick stopped, RTC wakeup timer + STOP mode (low_power.h) */
+#define configUSE_TICKLESS_IDLE					2
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP	2
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime )	low_power_suppress_ticks_and_sleep( xExpectedIdleTime )
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 		0
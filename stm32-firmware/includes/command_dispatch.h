@@ -0,0 +1,124 @@
+/**
+ ******************************************************************************
+ * @file           : command_dispatch.h
+ * @brief          : Table-Driven ASCII Command Dispatcher
+ ******************************************************************************
+ * @description
+ * Maps received command lines ("KEYWORD" or "KEYWORD:args") to handler
+ * functions through a static command table. A small hash index over the
+ * keywords is built once at init, so lookup cost does not grow with the
+ * number of commands (one hash pass + one string compare).
+ *
+ * No HAL or FreeRTOS dependencies - builds and runs on a Linux host as-is.
+ *
+ * Usage Example:
+ * ```c
+ * static void cmd_ping(const char *args) { ... }
+ * static void cmd_led(const char *args)  { ... }   // args = "2" for "LED_CMD:2"
+ *
+ * static const command_entry_t commands[] = {
+ *     { "PING",    cmd_ping },
+ *     { "LED_CMD", cmd_led  },
+ * };
+ * static command_dispatcher_t dispatcher;
+ *
+ * COMMAND_TABLE_CHECK(commands);
+ * command_dispatcher_init(&dispatcher, commands, COMMAND_TABLE_SIZE(commands));
+ * command_dispatch(&dispatcher, "LED_CMD:2");   // → cmd_led("2")
+ * ```
+ ******************************************************************************
+ */
+
+#ifndef __COMMAND_DISPATCH_H
+#define __COMMAND_DISPATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*============================================================================
+ * Configuration
+ *===========================================================================*/
+
+/** Hash index slots (power of two, at least 2× the number of commands) */
+#define COMMAND_HASH_SLOTS      32
+
+/** Separator between keyword and arguments */
+#define COMMAND_ARG_SEPARATOR   ':'
+
+/** Number of entries in a static command table */
+#define COMMAND_TABLE_SIZE(table)  (sizeof(table) / sizeof((table)[0]))
+
+/** Compile-time check that a static table keeps the probe chains short */
+#define COMMAND_TABLE_CHECK(table) \
+    _Static_assert(2 * COMMAND_TABLE_SIZE(table) <= COMMAND_HASH_SLOTS, \
+                   "COMMAND_HASH_SLOTS must be at least 2x the command table size")
+
+/*============================================================================
+ * Types
+ *===========================================================================*/
+
+/**
+ * @brief  Command handler
+ * @param  args: Text after the separator ("" if the line has no arguments)
+ */
+typedef void (*command_handler_t)(const char *args);
+
+/** One command table entry */
+typedef struct {
+    const char *keyword;          // Exact keyword, e.g. "LED_CMD"
+    command_handler_t handler;    // Called with the argument text
+} command_entry_t;
+
+/** Dispatcher instance (command table + hash index) */
+typedef struct {
+    const command_entry_t *table;
+    uint8_t count;
+    uint8_t slots[COMMAND_HASH_SLOTS];  // Table index per slot, 0xFF = empty
+} command_dispatcher_t;
+
+/** Dispatch result */
+typedef enum {
+    COMMAND_DISPATCHED = 0,       /**< Handler found and called */
+    COMMAND_UNKNOWN,              /**< No entry for this keyword */
+    COMMAND_EMPTY                 /**< Empty line */
+} command_result_t;
+
+/*============================================================================
+ * Public API
+ *===========================================================================*/
+
+/**
+ * @brief  Build the hash index for a command table
+ * @param  d: Dispatcher to initialize
+ * @param  table: Command table (must stay valid, typically static const)
+ * @param  count: Number of entries (< COMMAND_HASH_SLOTS)
+ * @retval 0 on success, -1 if the table does not fit or has duplicates
+ */
+int command_dispatcher_init(command_dispatcher_t *d, const command_entry_t *table, uint8_t count);
+
+/**
+ * @brief  Look up a line's keyword and call its handler
+ * @param  d: Initialized dispatcher
+ * @param  line: Null-terminated line without terminator
+ * @retval COMMAND_DISPATCHED, COMMAND_UNKNOWN or COMMAND_EMPTY
+ */
+command_result_t command_dispatch(const command_dispatcher_t *d, const char *line);
+
+/**
+ * @brief  Find the table entry for a line's keyword without calling it
+ * @param  d: Initialized dispatcher
+ * @param  line: Null-terminated line
+ * @param  args: [OUT] Argument text (may be NULL)
+ * @retval Matching entry, or NULL if unknown
+ */
+const command_entry_t *command_lookup(const command_dispatcher_t *d, const char *line, const char **args);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COMMAND_DISPATCH_H */
@@ -0,0 +1,174 @@
+/**
+ ******************************************************************************
+ * @file           : config_store.h
+ * @brief          : Flash-Backed Key/Value Store (Last Pattern, Tunables)
+ ******************************************************************************
+ * @description
+ * Keeps a handful of 32-bit settings across resets and watchdog events in
+ * two reserved flash sectors, so the board comes back with the operator's
+ * last pattern instead of waiting for an HTTP client to resend it.
+ *
+ * Flash Layout (STM32F407VG, 1 MB):
+ * ┌──────────────┬────────────┬─────────┬──────────────────────────────┐
+ * │ Sector       │ Address    │ Size    │ Use                          │
+ * ├──────────────┼────────────┼─────────┼──────────────────────────────┤
+ * │ 0 - 9        │ 0x08000000 │ 768 KB  │ Firmware (linker FLASH area) │
+ * │ 10           │ 0x080C0000 │ 128 KB  │ Config store, bank A         │
+ * │ 11           │ 0x080E0000 │ 128 KB  │ Config store, bank B         │
+ * └──────────────┴────────────┴─────────┴──────────────────────────────┘
+ * The linker script must stop at sector 10 (FLASH LENGTH = 768K).
+ *
+ * Log Format (one bank active, the other erased and waiting):
+ * - Slot 0:  bank header [generation][magic], magic programmed last
+ * - Slot 1+: records [value][key | crc16(key, value) << 16], header word
+ *            programmed last, so a record cut off by a power loss has no
+ *            valid CRC and is skipped
+ * - A set() appends one 8-byte record; the last valid record of a key wins
+ * - A full bank is compacted into the other one (latest value per key),
+ *   whose header is written last with generation + 1: a power cut during
+ *   compaction leaves the old bank in charge
+ *
+ * Wear Leveling:
+ * Every write goes to the next free slot, so a bank takes 16383 writes
+ * before it is compacted, and the two banks alternate. Unchanged values
+ * are not written at all. Compaction only programs: the idle bank is
+ * erased ahead of time, by config_store_init() at boot and, after a
+ * run-time compaction, by config_store_service() from the watchdog monitor
+ * (never with the scheduler suspended). A set() never erases: if the bank
+ * fills again before the monitor has erased its successor, the value is
+ * kept in the RAM cache (get() returns it) and config_store_service()
+ * compacts it into flash right after the erase. A power cut before then
+ * loses it.
+ *
+ * Sector Erase Stall:
+ * The F407 has a single flash bank, so a ~1-2 s sector erase stalls every
+ * instruction fetch from flash, interrupts included. UART2 RX DMA keeps
+ * writing to SRAM meanwhile, but its 64-byte buffer only covers ~5 ms, so
+ * the monitor erases only while the link is quiet; a line arriving during
+ * the stall can still be lost (once per 16383 writes).
+ *
+ * Thread Safety:
+ * - config_store_get(): any task, reads the RAM cache
+ * - config_store_set(): task context only (suspends the scheduler while
+ *   programming, ~40 us per record)
+ *
+ * Host Testing:
+ * All flash access goes through a config_store_flash_ops_t (default: the
+ * HAL flash driver). config_store_set_flash_ops() swaps in a simulated
+ * flash, e.g. one that cuts the power after N operations
+ * (tests/test_config_store.c).
+ ******************************************************************************
+ */
+
+#ifndef __CONFIG_STORE_H
+#define __CONFIG_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "FreeRTOS.h"
+
+/*============================================================================
+ * Configuration
+ *===========================================================================*/
+
+/** Bank A / B flash sectors and addresses */
+#ifndef CONFIG_STORE_BANK_A
+#define CONFIG_STORE_BANK_A         0x080C0000UL
+#define CONFIG_STORE_BANK_B         0x080E0000UL
+#define CONFIG_STORE_SECTOR_A       FLASH_SECTOR_10
+#define CONFIG_STORE_SECTOR_B       FLASH_SECTOR_11
+#endif
+
+/** Bank size (bytes) */
+#ifndef CONFIG_STORE_BANK_SIZE
+#define CONFIG_STORE_BANK_SIZE      (128UL * 1024UL)
+#endif
+
+/** Compile-time log level for store messages (LOG_LEVEL_xxx, print_task.h) */
+#ifndef CONFIG_STORE_LOG_LEVEL
+#define CONFIG_STORE_LOG_LEVEL      LOG_LEVEL_INFO
+#endif
+
+/*============================================================================
+ * Types
+ *===========================================================================*/
+
+/** Stored settings (never renumber: the values are keys in flash) */
+typedef enum {
+    CONFIG_KEY_PATTERN = 1,         /**< Last applied pattern (LED_Pattern_t) or CONFIG_PATTERN_SCENE */
+    CONFIG_KEY_LOG_LEVEL,           /**< Run-time log threshold (log_level_t) */
+    CONFIG_KEY_PING_INTERVAL_MS,    /**< STM32_PING base interval */
+    CONFIG_KEY_PING_JITTER_MS,      /**< STM32_PING random jitter */
+    CONFIG_KEY_SCENE_TIMING,        /**< Scene, one key per LED (4): period_ms << 16 | phase_ms */
+    CONFIG_KEY_SCENE_TIMING_LAST = CONFIG_KEY_SCENE_TIMING + 3,
+    CONFIG_KEY_SCENE_SHAPE,         /**< Scene, one key per LED (4): on_ms << 16 | breathe << 8 | level, 0 = off */
+    CONFIG_KEY_SCENE_SHAPE_LAST = CONFIG_KEY_SCENE_SHAPE + 3,
+    CONFIG_KEY_COUNT
+} config_key_t;
+
+/** CONFIG_KEY_PATTERN value: a run-time scene (LED_SET / LED_SCENE / LED_SYNC) */
+#define CONFIG_PATTERN_SCENE        0xFFUL
+
+/** Flash access used by the store */
+typedef struct {
+    uint32_t (*read_word)(uint32_t addr);               /**< Read an aligned word */
+    int (*program_word)(uint32_t addr, uint32_t value); /**< Program a word, 0 on success */
+    int (*erase_bank)(uint32_t addr, uint32_t sector);  /**< Erase a bank (CONFIG_STORE_BANK_x, _SECTOR_x), 0 on success */
+} config_store_flash_ops_t;
+
+/*============================================================================
+ * Public Function Interfaces
+ *===========================================================================*/
+
+/**
+ * @brief  Mount the store: pick the active bank, load the RAM cache and
+ *         erase the idle bank if needed
+ * @note   Call from main() before the scheduler starts and before any
+ *         config_store_get()
+ * @retval None
+ */
+void config_store_init(void);
+
+/**
+ * @brief  Replace the flash access (host tests)
+ * @param  ops: Flash operations, NULL for the HAL flash driver
+ * @retval None
+ * @note   Call before config_store_init(); the ops must stay valid
+ */
+void config_store_set_flash_ops(const config_store_flash_ops_t *ops);
+
+/**
+ * @brief  Read a stored setting
+ * @param  key: Setting
+ * @param  value: [OUT] Stored value (unchanged if not stored)
+ * @retval 0 if stored, -1 if never written (caller keeps its default)
+ */
+int config_store_get(config_key_t key, uint32_t *value);
+
+/**
+ * @brief  Store a setting (no flash write if the value is unchanged)
+ * @param  key: Setting
+ * @param  value: New value
+ * @retval 0 on success, -1 on an invalid key or flash error
+ * @note   Never erases. On a full bank whose successor is not erased yet
+ *         the value is cached and written by config_store_service().
+ */
+int config_store_set(config_key_t key, uint32_t value);
+
+/**
+ * @brief  Erase the bank retired by the last compaction, if any, then
+ *         compact the sets deferred on a full bank into it
+ * @retval pdTRUE if a sector was erased (the CPU stalled ~1-2 s)
+ * @note   Task context, scheduler running. Called by the watchdog monitor
+ *         right after it refreshes the IWDG, while the UART2 link is quiet.
+ */
+BaseType_t config_store_service(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CONFIG_STORE_H */
@@ -11,8 +11,10 @@
  * - UART3 (huart3): Debug logging (print_task)
  *
  * Architecture:
- * - Interrupt-based reception (HAL_UART_Receive_IT)
+ * - DMA circular reception with IDLE-line detection (HAL_UARTEx_ReceiveToIdle_DMA)
+ *   or per-byte interrupt reception (HAL_UART_Receive_IT), see UART_RX_USE_DMA
  * - Stream buffer for ISR-to-Task communication
+ * - Non-blocking TX queue drained by DMA/IT completion (UART_TX_USE_DMA)
  * - TRUE task blocking (yields CPU while waiting)
  * - Processes LED_CMD: messages from ESP8266
  * - Responds to PING for connection monitoring
@@ -34,15 +36,77 @@ extern "C" {
 #include "stream_buffer.h"
 
 /* Configuration */
-#define UART_RX_BUFFER_SIZE       64   // Buffer for incoming command lines
+#define UART_RX_BUFFER_SIZE       128  // Command line buffer (longest: LED_AT + 4-group LED_SCENE)
 #define UART_STREAM_BUFFER_SIZE   128  // Stream buffer size (bytes)
 
+/**
+ * UART2 RX mode selection
+ * 1 = DMA circular buffer + IDLE-line interrupt (one ISR per burst)
+ * 0 = Per-byte interrupt reception (one ISR per character)
+ */
+#ifndef UART_RX_USE_DMA
+#define UART_RX_USE_DMA           1
+#endif
+
+#define UART_DMA_RX_BUFFER_SIZE   64   // Circular DMA target (bytes)
+
+/**
+ * UART2 TX mode selection (replies are queued, never blocking the task)
+ * 1 = DMA transfer per queued run (HAL_UART_Transmit_DMA)
+ * 0 = Interrupt-driven transfer (HAL_UART_Transmit_IT)
+ */
+#ifndef UART_TX_USE_DMA
+#define UART_TX_USE_DMA           1
+#endif
+
+#define UART_TX_BUFFER_SIZE       256  // TX queue ring (bytes)
+
+/**
+ * Bytes drained from the stream buffer per xStreamBufferReceive call.
+ * The task scans the whole chunk for line terminators, so one wakeup
+ * handles a complete command. 1 = legacy one-byte-per-wakeup behaviour.
+ */
+#ifndef UART_RX_CHUNK_SIZE
+#define UART_RX_CHUNK_SIZE        32
+#endif
+
+/**
+ * Compile-time log level for this module (LOG_LEVEL_xxx, print_task.h)
+ * LOG_LEVEL_INFO  = LED changes, link state, errors (default)
+ * LOG_LEVEL_DEBUG = + PING/PONG traffic
+ * LOG_LEVEL_TRACE = + every received line ("[ESP8266] ← Received: '...'")
+ */
+#ifndef ESP8266_LOG_LEVEL
+#define ESP8266_LOG_LEVEL         LOG_LEVEL_INFO
+#endif
+
+/**
+ * RX path profiling (DWT cycle counter)
+ * 1 = count wakeups and receive/scan cycles per command line and log a
+ *     summary every ESP8266_COMM_PROFILE_LINES lines
+ * 0 = disabled (no overhead)
+ */
+#ifndef ESP8266_COMM_PROFILE
+#define ESP8266_COMM_PROFILE      0
+#endif
+#ifndef ESP8266_COMM_PROFILE_LINES
+#define ESP8266_COMM_PROFILE_LINES 16
+#endif
+
 /* Initialization function - call before starting scheduler */
 void esp8266_comm_task_init(void);
 
 /* Task function */
 void esp8266_comm_task_handler(void *parameters);
 
+/* UART2 TX complete hook - called from HAL_UART_TxCpltCallback (ISR context) */
+void esp8266_comm_uart_tx_complete(UART_HandleTypeDef *huart);
+
+/* Link quiet check for STOP mode - called by low_power with interrupts masked.
+ * pdTRUE when nothing is queued or in flight on UART2 and nothing has been
+ * received for LED_LINK_STOP_QUIET_MS (led_frame.h) */
+BaseType_t esp8266_comm_link_quiet(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,79 @@
+/**
+ ******************************************************************************
+ * @file           : led_curve.h
+ * @brief          : LED Brightness Curves (level → PWM duty, fades, breathing)
+ ******************************************************************************
+ * @description
+ * Pure functions used by the PWM engine to generate duty-cycle frames.
+ * No HAL or FreeRTOS dependencies, so the same file builds on the host.
+ *
+ * Levels are perceptual brightness 0-255. Duty is in timer counts,
+ * 0 (off) to LED_CURVE_DUTY_MAX (always on).
+ *
+ * Curves:
+ * - LINEAR: duty proportional to level (looks fast at the bottom)
+ * - GAMMA:  duty = (level / 255)^2.2 × max (looks even to the eye)
+ ******************************************************************************
+ */
+
+#ifndef __LED_CURVE_H
+#define __LED_CURVE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*============================================================================
+ * Definitions
+ *===========================================================================*/
+
+/** Full-scale duty (timer counts per PWM period) */
+#define LED_CURVE_DUTY_MAX  4000
+
+/** Full brightness level */
+#define LED_LEVEL_MAX       255
+
+/** Level → duty mapping */
+typedef enum {
+    LED_CURVE_LINEAR = 0,
+    LED_CURVE_GAMMA
+} led_curve_t;
+
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Convert a brightness level to a PWM duty
+ * @param  level: 0 (off) .. LED_LEVEL_MAX
+ * @param  curve: LED_CURVE_LINEAR or LED_CURVE_GAMMA
+ * @retval Duty, 0 .. LED_CURVE_DUTY_MAX
+ */
+uint16_t led_curve_duty(uint8_t level, led_curve_t curve);
+
+/**
+ * @brief  Level at a point of a fade
+ * @param  from: Start level
+ * @param  to: End level
+ * @param  elapsed_ms: Time since the fade started
+ * @param  duration_ms: Fade length (0 = jump to the end level)
+ * @retval Level, reaches 'to' when elapsed_ms >= duration_ms
+ */
+uint8_t led_curve_fade(uint8_t from, uint8_t to, uint32_t elapsed_ms, uint32_t duration_ms);
+
+/**
+ * @brief  Level at a point of a breathing cycle (0 → peak → 0)
+ * @param  peak: Maximum level
+ * @param  t_ms: Time since breathing started
+ * @param  period_ms: Length of one full cycle (0 = hold at peak)
+ * @retval Level (triangle wave; use LED_CURVE_GAMMA for a smooth look)
+ */
+uint8_t led_curve_breathe(uint8_t peak, uint32_t t_ms, uint32_t period_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LED_CURVE_H */
@@ -1,40 +1,84 @@
 /**
  ******************************************************************************
  * @file           : led_effects.h
- * @brief          : LED Pattern Control Using FreeRTOS Software Timers
+ * @brief          : LED Pattern Control Using Keyframe Sequences
  ******************************************************************************
  * @description
- * This header defines the interface for LED pattern control using FreeRTOS
- * software timers. Provides multiple blinking patterns without blocking tasks.
+ * This header defines the interface for LED pattern control. Patterns are
+ * const keyframe tables in flash, played by a sequencer that is advanced
+ * by one hardware timer tick for all LEDs.
  *
  * Implementation Strategy:
- * - Uses 2 auto-reload software timers (one per LED)
- * - Timers execute in Timer Service Task context (NOT interrupt!)
- * - Timer callbacks toggle GPIO pins directly
- * - Periods dynamically changed using xTimerChangePeriod()
+ * - A pattern (led_sequence_t) is a set of looping tracks
+ * - A track is a list of keyframes: LED mask, brightness, duration
+ * - TIM7 (one-pulse mode) wakes the sequencer only at the next keyframe
+ *   edge of any track; static patterns leave it stopped
+ * - Brightness is applied through the TIM4 PWM engine (led_pwm.h), which
+ *   also performs keyframe fades
  *
  * Hardware Mapping:
  * ┌──────────────┬──────────┬──────────┬─────────────┐
- * │ LED Name     │ Color    │ GPIO Pin │ Timer       │
+ * │ LED Name     │ Color    │ GPIO Pin │ PWM Channel │
  * ├──────────────┼──────────┼──────────┼─────────────┤
- * │ LD4          │ Green    │ PD12     │ led_timer1  │
- * │ LD3          │ Orange   │ PD13     │ led_timer2  │
+ * │ LD4          │ Green    │ PD12     │ TIM4 CH1    │
+ * │ LD3          │ Orange   │ PD13     │ TIM4 CH2    │
+ * │ LD5          │ Red      │ PD14     │ TIM4 CH3    │
+ * │ LD6          │ Blue     │ PD15     │ TIM4 CH4    │
  * └──────────────┴──────────┴──────────┴─────────────┘
  *
  * Available Patterns:
  * ┌──────────┬────────────────┬─────────────────────────────────┐
  * │ Pattern  │ Name           │ Description                     │
  * ├──────────┼────────────────┼─────────────────────────────────┤
- * │ NONE     │ All OFF        │ Both LEDs OFF (timers stopped)  │
- * │ 1        │ Always ON      │ Both LEDs ON (static, no timer) │
+ * │ NONE     │ All OFF        │ All LEDs OFF (tick stopped)     │
+ * │ 1        │ Always ON      │ Both LEDs ON (static, no tick)  │
  * │ 2        │ Async Blink    │ Green: 100ms, Orange: 1000ms    │
- * │ 3        │ Sync Blink     │ Both: 100ms (synchronized)      │
+ * │ 3        │ Sync Blink     │ Both: 100ms (one shared track)  │
  * └──────────┴────────────────┴─────────────────────────────────┘
  *
+ * Adding a Pattern:
+ * ```c
+ * LED_TRACK(police_red,
+ *     LED_KEY(LED_MASK(LED_RED), LED_LEVEL_MAX, 150),
+ *     LED_KEY(LED_MASK(LED_RED), 0,             150));
+ * LED_TRACK(police_blue,
+ *     LED_KEY(LED_MASK(LED_BLUE), 0,             150),
+ *     LED_KEY(LED_MASK(LED_BLUE), LED_LEVEL_MAX, 150));
+ * LED_SEQUENCE(police_sequence, LED_TRACK_REF(police_red), LED_TRACK_REF(police_blue));
+ *
+ * led_effects_play(&police_sequence);
+ * ```
+ *
+ * Phase-Locked Groups:
+ * All tracks of a sequence share one time base, so tracks with the same
+ * period never drift apart. LED_TRACK_REF_PHASE() starts a track part-way
+ * through its cycle; led_effects_sync() builds such a group at run time:
+ * ┌────────────┬──────────────────────────────────────────────┐
+ * │ Mode       │ LED i of n in the mask                       │
+ * ├────────────┼──────────────────────────────────────────────┤
+ * │ IN_PHASE   │ All on together for period/2                 │
+ * │ ANTI_PHASE │ Every other LED offset by period/2           │
+ * │ CHASE      │ On for period/n, offset by i × period/n      │
+ * │ BREATHE    │ All breathe together, 0 → level → 0 (gamma)  │
+ * └────────────┴──────────────────────────────────────────────┘
+ * A breathing LED is one held keyframe: the PWM engine renders the curve
+ * frame by frame (led_pwm_breathe()), so TIM7 stays stopped.
+ *
+ * Scheduled Changes:
+ * led_effects_set_pattern_at() / led_effects_blink_at() queue a change for
+ * an RTOS tick (1 tick = 1 ms). The queue is kept in due order and TIM7 is
+ * armed for the head, so the change is applied by the sequencer interrupt
+ * at that tick, not by a task that happens to be scheduled.
+ *
+ * Persistence:
+ * led_effects_save() stores what is playing (a table pattern, or the
+ * per-LED timing of a run-time scene) once it has been applied;
+ * led_effects_restore() plays it again at boot (config_store.h keys).
+ *
  * Thread Safety:
- * - Timer callbacks run in Timer Service Task (configTIMER_TASK_PRIORITY)
- * - HAL_GPIO_TogglePin() is atomic and ISR-safe
- * - No synchronization needed for pattern changes
+ * - led_effects_play() builds the new schedule off to the side and swaps
+ *   it in with one critical section (no timer command queue involved)
+ * - Edges are applied in the TIM7 interrupt with the _from_isr PWM setters
  ******************************************************************************
  */
 
@@ -47,52 +91,158 @@ extern "C" {
 
 #include "main.h"
 #include "FreeRTOS.h"
-#include "timers.h"
+#include "led_pwm.h"
+
+/*============================================================================
+ * Configuration Constants
+ *===========================================================================*/
+
+/** TIM7 count rate (Hz); keyframe durations are in ms */
+#define LED_SEQ_TIMER_HZ        2000
+
+/** TIM7 prescaler: 84 MHz APB1 timer clock → 2 kHz (1 kHz does not fit 16 bits) */
+#define LED_SEQ_TIM_PRESCALER   (84000000UL / LED_SEQ_TIMER_HZ - 1)
+
+/** Longest single TIM7 shot (ms); longer waits are split */
+#define LED_SEQ_MAX_SHOT_MS     (0x10000UL / (LED_SEQ_TIMER_HZ / 1000U))
+
+/** Maximum tracks in one sequence */
+#define LED_SEQ_MAX_TRACKS      LED_COUNT
+
+/** Sequences that can wait for their due tick (led_effects_*_at()) */
+#ifndef LED_SEQ_PENDING_MAX
+#define LED_SEQ_PENDING_MAX     4
+#endif
+
+/**
+ * Group edge skew profiling (DWT cycle counter)
+ * 1 = measure the cycles between the first and last LED update of each
+ *     wakeup that changes several LEDs, and log the maximum
+ *     ("[LED] sync: ...") on the next pattern change
+ * 0 = disabled (no overhead)
+ */
+#ifndef LED_SYNC_PROFILE
+#define LED_SYNC_PROFILE        0
+#endif
 
 /*============================================================================
  * Type Definitions
  *===========================================================================*/
 
 /**
- * @brief  LED pattern enumeration
+ * @brief  One keyframe: set the LEDs in mask to level, then hold
+ * @note   duration_ms = 0 holds the keyframe forever (ends the track)
+ */
+typedef struct {
+    uint8_t mask;           /**< LED_MASK() bits this keyframe drives */
+    uint8_t level;          /**< Brightness 0 .. LED_LEVEL_MAX */
+    uint8_t fade;           /**< LED_KEY_MODE_STEP, LED_KEY_MODE_FADE or LED_KEY_MODE_BREATHE */
+    uint16_t duration_ms;   /**< Time until the next keyframe */
+} led_keyframe_t;
+
+/** A looping list of keyframes */
+typedef struct {
+    const led_keyframe_t *frames;
+    uint8_t count;
+    uint16_t phase_ms;      /**< Start this far into the loop (phase offset) */
+} led_track_t;
+
+/** A pattern: tracks that play side by side */
+typedef struct {
+    const led_track_t *tracks;
+    uint8_t num_tracks;
+} led_sequence_t;
+
+/** led_keyframe_t.fade values */
+#define LED_KEY_MODE_STEP        0   /**< Jump to level */
+#define LED_KEY_MODE_FADE        1   /**< Fade to level over duration_ms */
+#define LED_KEY_MODE_BREATHE   2   /**< Breathe 0 → level → 0 every duration_ms */
+
+/*
+ * Pattern table macros (all data is const, placed in flash)
  *
- * Defines all available LED blinking patterns. Each pattern has different
- * timing and visual characteristics.
+ * LED_KEY(mask, level, ms)          step to level, hold ms
+ * LED_KEY_FADE(mask, level, ms)     fade to level over ms
+ * LED_KEY_BREATHE(mask, peak, ms)   breathe with an ms period (alone in its
+ *                                   track: it keeps going until replaced)
+ * LED_TRACK(name, keys...)          define a track
+ * LED_SEQUENCE(name, tracks...)     define a sequence of LED_TRACK_REF(track)
+ * LED_TRACK_REF_PHASE(name, ms)     track reference starting ms into its loop
+ */
+#define LED_KEY(mask, level, ms)        { (uint8_t)(mask), (uint8_t)(level), LED_KEY_MODE_STEP, (uint16_t)(ms) }
+#define LED_KEY_FADE(mask, level, ms)   { (uint8_t)(mask), (uint8_t)(level), LED_KEY_MODE_FADE, (uint16_t)(ms) }
+#define LED_KEY_BREATHE(mask, peak, ms) { (uint8_t)(mask), (uint8_t)(peak), LED_KEY_MODE_BREATHE, (uint16_t)(ms) }
+
+#define LED_TRACK(name, ...) \
+    static const led_keyframe_t name##_frames[] = { __VA_ARGS__ }
+
+#define LED_TRACK_REF_PHASE(name, ms) \
+    { name##_frames, (uint8_t)(sizeof(name##_frames) / sizeof(name##_frames[0])), (uint16_t)(ms) }
+
+#define LED_TRACK_REF(name)     LED_TRACK_REF_PHASE(name, 0)
+
+#define LED_SEQUENCE(name, ...) \
+    static const led_track_t name##_tracks[] = { __VA_ARGS__ }; \
+    static const led_sequence_t name = \
+        { name##_tracks, (uint8_t)(sizeof(name##_tracks) / sizeof(name##_tracks[0])) }
+
+/**
+ * @brief  LED pattern enumeration
  *
  * LED_PATTERN_NONE (0):
- *   Both LEDs OFF
- *   Timers: Stopped (no CPU overhead)
- *   Use case: Power saving, application exit
+ *   All LEDs OFF, sequencer tick stopped
  *
  * LED_PATTERN_1:
- *   Both LEDs always ON
- *   Timers: Stopped (static state, no periodic activity)
- *   Implementation: Direct GPIO write (HIGH)
- *   Use case: Maximum brightness indicator
+ *   Green and Orange always ON (single keyframe, no tick)
  *
  * LED_PATTERN_2:
  *   Asynchronous blinking at different frequencies
- *   Timer1 (Green): 100ms period → toggle every 100ms (5 Hz blink rate)
- *   Timer2 (Orange): 1000ms period → toggle every 1s (0.5 Hz blink rate)
- *   Visual: Green blinks fast, Orange blinks slowly (10:1 ratio)
- *   Use case: Activity indicator with status differentiation
+ *   Green track: 100ms OFF / 100ms ON
+ *   Orange track: 1000ms OFF / 1000ms ON
  *
  * LED_PATTERN_3:
- *   Synchronized blinking at same frequency
- *   Both timers: 100ms period (5 Hz blink rate)
- *   Visual: Both LEDs blink in sync (may start out of phase)
- *   Use case: Alert or attention-grabbing indicator
+ *   Synchronized blinking at the same frequency
+ *   One track drives both LEDs: 100ms OFF / 100ms ON (always in phase)
  *
  * @note Pattern changes are instantaneous - old pattern stops, new starts
- * @note Toggle period = 2 × blink period (ON + OFF time)
  */
 typedef enum {
-    LED_PATTERN_NONE = 0,   /**< All LEDs OFF (timers stopped) */
+    LED_PATTERN_NONE = 0,   /**< All LEDs OFF */
     LED_PATTERN_1,          /**< Always ON 2 LEDs (static) */
     LED_PATTERN_2,          /**< Different frequency: Green 100ms, Orange 1000ms */
-    LED_PATTERN_3           /**< Same frequency: Both 100ms (synchronized) */
+    LED_PATTERN_3,          /**< Same frequency: Both 100ms (synchronized) */
+    LED_PATTERN_COUNT
 } LED_Pattern_t;
 
+/** Phase relation of the LEDs in a led_effects_sync() group */
+typedef enum {
+    LED_SYNC_IN_PHASE = 0,  /**< All LEDs switch together */
+    LED_SYNC_ANTI_PHASE,    /**< Alternate LEDs half a period apart */
+    LED_SYNC_CHASE,         /**< One LED at a time, in led_id_t order */
+    LED_SYNC_BREATHE        /**< All LEDs breathe together */
+} led_sync_mode_t;
+
+/** One group of a run-time blink scene (led_effects_blink()) */
+typedef struct {
+    uint8_t mask;           /**< LED_MASK() bits, no LED in two groups */
+    uint8_t level;          /**< On brightness */
+    uint16_t period_ms;     /**< Blink period */
+    uint16_t on_ms;         /**< On time per period: 0 = off, >= period = on */
+    uint16_t phase_ms;      /**< Delay of the on-edge within the period */
+    uint8_t breathe;        /**< 1 = breathe 0 → level → 0 every period instead
+                                 (on_ms and phase_ms ignored) */
+} led_blink_t;
+
+/*============================================================================
+ * Peripheral Handles
+ *===========================================================================*/
+
+/**
+ * @brief  TIM7 handle (sequencer tick)
+ * @note   Owned and initialized by led_effects_init()
+ */
+extern TIM_HandleTypeDef htim7;
+
 /*============================================================================
  * Public Function Interfaces
  *===========================================================================*/
@@ -102,17 +252,11 @@ typedef enum {
  * @retval None
  *
  * Initialization Steps:
- * 1. Creates led_timer1 for Green LED (LD4/PD12)
- * 2. Creates led_timer2 for Orange LED (LD3/PD13)
- * 3. Sets both LEDs to OFF state
- *
- * Timer Configuration:
- * - Type: Auto-reload (periodic execution)
- * - Initial period: 100ms (can be changed per pattern)
- * - Callbacks: led_timer1_callback, led_timer2_callback
+ * 1. Starts TIM4 PWM on PD12-PD15 (led_pwm_init)
+ * 2. Configures TIM7 in one-pulse mode for sequencer wakeups (not armed)
+ * 3. Plays LED_PATTERN_NONE (all LEDs OFF)
  *
  * @note Must be called BEFORE starting FreeRTOS scheduler
- * @note Timers are created but NOT started (LEDs remain OFF)
  */
 void led_effects_init(void);
 
@@ -121,75 +265,126 @@ void led_effects_init(void);
  * @param  pattern: Desired pattern from LED_Pattern_t enum
  * @retval None
  *
- * Pattern Switching Logic:
- * 1. Stop all running timers (clean slate)
- * 2. Configure LEDs and timers based on selected pattern
- * 3. Start timers if needed (patterns 2 and 3)
- *
- * Pattern Implementation:
- * PATTERN_NONE:
- *   - Timers: Stopped
- *   - LEDs: Both OFF
- *
- * PATTERN_1:
- *   - Timers: Stopped (not needed)
- *   - LEDs: Both ON (static)
- *
- * PATTERN_2:
- *   - Timer1: 100ms period (Green LED)
- *   - Timer2: 1000ms period (Orange LED)
- *   - LEDs: Initially OFF, then toggled by timers
- *
- * PATTERN_3:
- *   - Timer1: 100ms period (Green LED)
- *   - Timer2: 100ms period (Orange LED)
- *   - LEDs: Initially OFF, then toggled by timers
+ * Looks up the pattern's keyframe table and plays it with
+ * led_effects_play(). Unknown values turn all LEDs off.
  *
  * @note Can be called from any task (command handler typically)
- * @note Pattern change is immediate - no gradual transition
- * @note xTimerChangePeriod() also starts timer if stopped
  */
 void led_effects_set_pattern(LED_Pattern_t pattern);
 
 /**
- * @brief  Timer 1 callback - Controls Green LED (LD4/PD12)
- * @param  xTimer: Timer handle (unused, required by FreeRTOS API)
+ * @brief  Play a keyframe sequence (replaces the current one)
+ * @param  sequence: Sequence to play, must stay valid while playing
+ *                   (normally a LED_SEQUENCE in flash)
  * @retval None
  *
- * Execution Context:
- * - Called by Timer Service Task (NOT hardware interrupt!)
- * - Priority: configTIMER_TASK_PRIORITY (from FreeRTOSConfig.h)
- * - Can safely call FreeRTOS APIs (non-ISR versions)
- *
- * Behavior:
- * - Toggles Green LED state (ON → OFF or OFF → ON)
- * - Called periodically based on timer period (100ms or 1000ms)
- * - Auto-reload timer: executes indefinitely until stopped
+ * All tracks restart at their first keyframe. LEDs not driven by any
+ * track are turned off. The swap is atomic with respect to the TIM7
+ * interrupt.
  *
- * @note HAL_GPIO_TogglePin() is atomic and ISR-safe
- * @note Keep callback short to avoid blocking timer service task
+ * @note Call from one task at a time (the command handler)
  */
-void led_timer1_callback(TimerHandle_t xTimer);
+void led_effects_play(const led_sequence_t *sequence);
 
 /**
- * @brief  Timer 2 callback - Controls Orange LED (LD3/PD13)
- * @param  xTimer: Timer handle (unused, required by FreeRTOS API)
- * @retval None
- *
- * Execution Context:
- * - Called by Timer Service Task (NOT hardware interrupt!)
- * - Priority: configTIMER_TASK_PRIORITY (from FreeRTOSConfig.h)
- * - Can safely call FreeRTOS APIs (non-ISR versions)
+ * @brief  Play a run-time blink scene (replaces the current pattern)
+ * @param  blinks: Blink groups, copied before returning
+ * @param  count: Number of groups
+ * @retval 0 on success, -1 if a group is invalid (period 0, phase_ms >=
+ *         period_ms, unknown or repeated LED) or no LED is given
  *
- * Behavior:
- * - Toggles Orange LED state (ON → OFF or OFF → ON)
- * - Called periodically based on timer period (100ms or 1000ms)
- * - Auto-reload timer: executes indefinitely until stopped
+ * All groups start together on one time base. LEDs in no group are
+ * turned off.
+ */
+int led_effects_blink(const led_blink_t *blinks, uint8_t count);
+
+/**
+ * @brief  led_effects_set_pattern() at a given RTOS tick
+ * @param  pattern: Desired pattern
+ * @param  due_tick: xTaskGetTickCount() value to switch at; a tick that has
+ *                   already passed switches immediately
+ * @retval 0 if queued (or applied), -1 if the pattern is unknown or
+ *         LED_SEQ_PENDING_MAX changes are already waiting
+ */
+int led_effects_set_pattern_at(LED_Pattern_t pattern, TickType_t due_tick);
+
+/**
+ * @brief  led_effects_blink() at a given RTOS tick
+ * @param  blinks: Blink groups, copied before returning
+ * @param  count: Number of groups
+ * @param  due_tick: xTaskGetTickCount() value to start at (passed = now)
+ * @retval 0 if queued (or applied), -1 on invalid groups or full queue
+ */
+int led_effects_blink_at(const led_blink_t *blinks, uint8_t count, TickType_t due_tick);
+
+/**
+ * @brief  Blink a group of LEDs on one shared time base
+ * @param  mask: LED_MASK() bits of the group
+ * @param  period_ms: Blink period of every LED in the group
+ * @param  level: On brightness
+ * @param  mode: Phase relation (in phase, anti-phase, chase, breathe)
+ * @retval 0 on success, -1 if mask is empty or period_ms is too short
+ *         (at least 2 ms, and one ms per LED for CHASE)
  *
- * @note HAL_GPIO_TogglePin() is atomic and ISR-safe
- * @note Keep callback short to avoid blocking timer service task
+ * Replaces the current pattern like led_effects_play(); LEDs outside the
+ * mask are turned off.
+ */
+int led_effects_sync(uint8_t mask, uint16_t period_ms, uint8_t level, led_sync_mode_t mode);
+
+/**
+ * @brief  led_effects_sync() at a given RTOS tick
+ * @param  mask: LED_MASK() bits of the group
+ * @param  period_ms: Blink period of every LED in the group
+ * @param  level: On brightness
+ * @param  mode: Phase relation (in phase, anti-phase, chase, breathe)
+ * @param  due_tick: xTaskGetTickCount() value to start at (passed = now)
+ * @retval 0 if queued (or applied), -1 on invalid arguments or full queue
+ */
+int led_effects_sync_at(uint8_t mask, uint16_t period_ms, uint8_t level,
+                        led_sync_mode_t mode, TickType_t due_tick);
+
+/**
+ * @brief  Store what is playing in the config store if it changed
+ * @retval None
+ * @note   Task context (flash writes). Called by the watchdog monitor every
+ *         WATCHDOG_CHECK_PERIOD_MS, so an LED_AT change is stored after
+ *         its due tick, not when it was queued. Table patterns and blink
+ *         scenes are kept; other led_effects_play() sequences are not.
+ */
+void led_effects_save(void);
+
+/**
+ * @brief  Play the pattern or scene stored by led_effects_save()
+ * @retval pdTRUE if something was restored
+ * @note   Call from main() after config_store_init() and led_effects_init()
+ */
+BaseType_t led_effects_restore(void);
+
+/**
+ * @brief  Sequencer wakeup hook (ISR context)
+ * @param  htim: Timer handle passed to HAL_TIM_PeriodElapsedCallback
+ * @retval None
+ * @note   Called from HAL_TIM_PeriodElapsedCallback in main.c; ignores
+ *         other timers
+ */
+void led_effects_tick(TIM_HandleTypeDef *htim);
+
+/**
+ * @brief  Check that the LEDs need no timer until the next command
+ * @retval pdTRUE if TIM7 is stopped (every track holding, nothing
+ *         scheduled) and the PWM outputs are steady (led_pwm_is_steady())
+ * @note   Called by low_power with interrupts masked to decide between
+ *         SLEEP and STOP
+ */
+BaseType_t led_effects_is_idle(void);
+
+/**
+ * @brief  Pattern that is playing
+ * @retval LED_PATTERN_xxx, or LED_PATTERN_COUNT for a run-time scene
+ *         (led_effects_blink(), led_effects_sync(), led_effects_play())
+ * @note   Used to attribute low-power residency to patterns (POWER reply)
  */
-void led_timer2_callback(TimerHandle_t xTimer);
+LED_Pattern_t led_effects_get_pattern(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,173 @@
+/**
+ ******************************************************************************
+ * @file           : led_pwm.h
+ * @brief          : TIM4 Hardware PWM Engine for the Four Discovery LEDs
+ ******************************************************************************
+ * @description
+ * Drives LD3-LD6 with TIM4 PWM instead of GPIO writes, adding per-LED
+ * brightness, fades and breathing.
+ *
+ * Hardware Mapping:
+ * ┌──────────────┬──────────┬──────────┬─────────────┐
+ * │ LED Name     │ Color    │ GPIO Pin │ Channel     │
+ * ├──────────────┼──────────┼──────────┼─────────────┤
+ * │ LD4          │ Green    │ PD12     │ TIM4 CH1    │
+ * │ LD3          │ Orange   │ PD13     │ TIM4 CH2    │
+ * │ LD5          │ Red      │ PD14     │ TIM4 CH3    │
+ * │ LD6          │ Blue     │ PD15     │ TIM4 CH4    │
+ * └──────────────┴──────────┴──────────┴─────────────┘
+ *
+ * Duty Updates:
+ * - Static levels are written straight to CCR1-4 (no DMA, no interrupts)
+ * - While a fade or breathing effect runs, a circular DMA buffer of
+ *   LED_PWM_DMA_FRAMES frames feeds CCR1-4 through the TIM4 DMA burst
+ *   register on every update event (1 frame = 1 PWM period = 1 ms)
+ * - The DMA half/complete interrupt refills the idle half, i.e. one ISR
+ *   per LED_PWM_DMA_FRAMES / 2 steps instead of one per step
+ * - DMA stops by itself once every LED is static again
+ *
+ * DMA: TIM4_CH1 request on DMA1 Stream0 Channel 2 (TIM_CR2.CCDS = 1, so the
+ * request fires on the update event). Stream6 (TIM4_UP) is used by USART2 TX.
+ ******************************************************************************
+ */
+
+#ifndef __LED_PWM_H
+#define __LED_PWM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "FreeRTOS.h"
+#include "led_curve.h"
+
+/*============================================================================
+ * Configuration Constants
+ *===========================================================================*/
+
+/** PWM frequency (Hz); also the duty update rate of running effects */
+#define LED_PWM_FREQ_HZ         1000
+
+/**
+ * @brief  TIM4 prescaler
+ * @note   84 MHz APB1 timer clock / 21 = 4 MHz, / LED_CURVE_DUTY_MAX = 1 kHz
+ */
+#define LED_PWM_PRESCALER       (84000000UL / (LED_PWM_FREQ_HZ * LED_CURVE_DUTY_MAX) - 1)
+
+/**
+ * @brief  Frames in the circular DMA buffer (even)
+ * @note   32 frames × 4 channels × 2 bytes = 256 bytes; refilled 16 at a time
+ */
+#define LED_PWM_DMA_FRAMES      32
+
+/** Curve used by led_pwm_set() and the LED patterns */
+#ifndef LED_PWM_DEFAULT_CURVE
+#define LED_PWM_DEFAULT_CURVE   LED_CURVE_GAMMA
+#endif
+
+/*============================================================================
+ * Types
+ *===========================================================================*/
+
+/** LEDs in TIM4 channel order */
+typedef enum {
+    LED_GREEN = 0,      /**< LD4, PD12, TIM4 CH1 */
+    LED_ORANGE,         /**< LD3, PD13, TIM4 CH2 */
+    LED_RED,            /**< LD5, PD14, TIM4 CH3 */
+    LED_BLUE,           /**< LD6, PD15, TIM4 CH4 */
+    LED_COUNT
+} led_id_t;
+
+/** Bit mask of LEDs */
+#define LED_MASK(led)   (1U << (led))
+#define LED_MASK_ALL    ((1U << LED_COUNT) - 1)
+
+/*============================================================================
+ * Peripheral Handles
+ *===========================================================================*/
+
+/**
+ * @brief  TIM4 handle (PWM on CH1-CH4)
+ * @note   Owned and initialized by led_pwm_init(); MSP setup (pins, DMA)
+ *         lives in the USER CODE blocks of stm32f4xx_hal_msp.c
+ */
+extern TIM_HandleTypeDef htim4;
+
+/*============================================================================
+ * Public Function Interfaces
+ *===========================================================================*/
+
+/**
+ * @brief  Configure TIM4, switch PD12-PD15 to it and start PWM, LEDs off
+ * @note   Called from led_effects_init(); the boot blink in main() still
+ *         uses the pins as GPIO before this
+ * @retval None
+ */
+void led_pwm_init(void);
+
+/**
+ * @brief  Set an LED to a fixed brightness (cancels any running effect)
+ * @param  led: LED_GREEN .. LED_BLUE
+ * @param  level: 0 (off) .. LED_LEVEL_MAX
+ * @retval None
+ */
+void led_pwm_set(led_id_t led, uint8_t level);
+
+/**
+ * @brief  Fade an LED from its current level to a target level
+ * @param  led: LED_GREEN .. LED_BLUE
+ * @param  level: Target level
+ * @param  duration_ms: Fade time (0 = same as led_pwm_set())
+ * @param  curve: LED_CURVE_LINEAR or LED_CURVE_GAMMA
+ * @retval None
+ */
+void led_pwm_fade(led_id_t led, uint8_t level, uint16_t duration_ms, led_curve_t curve);
+
+/**
+ * @brief  led_pwm_set() for interrupt context
+ * @note   ISR priority must be at or below configMAX_SYSCALL_INTERRUPT_PRIORITY
+ */
+void led_pwm_set_from_isr(led_id_t led, uint8_t level);
+
+/**
+ * @brief  led_pwm_fade() for interrupt context
+ * @note   ISR priority must be at or below configMAX_SYSCALL_INTERRUPT_PRIORITY
+ */
+void led_pwm_fade_from_isr(led_id_t led, uint8_t level, uint16_t duration_ms, led_curve_t curve);
+
+/**
+ * @brief  Breathe an LED (0 → peak → 0) until the next set/fade
+ * @param  led: LED_GREEN .. LED_BLUE
+ * @param  peak: Maximum level
+ * @param  period_ms: Length of one breath
+ * @retval None
+ */
+void led_pwm_breathe(led_id_t led, uint8_t peak, uint16_t period_ms);
+
+/**
+ * @brief  led_pwm_breathe() for interrupt context
+ * @note   ISR priority must be at or below configMAX_SYSCALL_INTERRUPT_PRIORITY
+ */
+void led_pwm_breathe_from_isr(led_id_t led, uint8_t peak, uint16_t period_ms);
+
+/**
+ * @brief  Current brightness level of an LED
+ * @param  led: LED_GREEN .. LED_BLUE
+ * @retval Level (for a running effect: the level of the last frame queued)
+ */
+uint8_t led_pwm_get(led_id_t led);
+
+/**
+ * @brief  Check that every output is a constant level
+ * @retval pdTRUE if no effect runs and each LED is fully off or fully on
+ * @note   TIM4 stops in STOP mode and freezes its outputs mid-period, so
+ *         only these levels look the same with the timer halted
+ */
+BaseType_t led_pwm_is_steady(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LED_PWM_H */
@@ -0,0 +1,138 @@
+/**
+ ******************************************************************************
+ * @file           : low_power.h
+ * @brief          : Tickless Idle with RTC Wakeup and STOP Mode
+ ******************************************************************************
+ * @description
+ * Implements portSUPPRESS_TICKS_AND_SLEEP (configUSE_TICKLESS_IDLE 2): when
+ * every task is blocked for at least configEXPECTED_IDLE_TIME_BEFORE_SLEEP
+ * ticks, SysTick is stopped and the core sleeps until the next task is due
+ * or an interrupt arrives, instead of waking on every 1 ms tick.
+ *
+ * Wakeup Timer:
+ * The F407 has no LPTIM, so the RTC wakeup timer (WUT) ends the sleep. The
+ * RTC runs from the LSI (no LSE on the Discovery board), which is only
+ * accurate to a few percent, so low_power_init() measures the LSI against
+ * the CPU clock once at boot. The sleep length is read back from the RTC
+ * sub-second counter and the kernel tick is advanced by it; what drift
+ * remains is absorbed by the ESP8266's periodic TIME resync.
+ *
+ * Sleep Modes:
+ * ┌───────┬───────────────────────────────────┬─────────────────────────────┐
+ * │ Mode  │ Entered when                      │ Wakes on                    │
+ * ├───────┼───────────────────────────────────┼─────────────────────────────┤
+ * │ SLEEP │ Tickless idle, any of the STOP    │ WUT, any interrupt (TIM7,   │
+ * │       │ conditions fails                  │ UART2/3, DMA)               │
+ * │ STOP  │ >= LOW_POWER_STOP_MIN_TICKS idle, │ WUT, falling edge on PA3    │
+ * │       │ LEDs idle (led_effects_is_idle()),│ (UART2 RX start bit, EXTI3) │
+ * │       │ UART2 quiet, UART3 idle           │                             │
+ * └───────┴───────────────────────────────────┴─────────────────────────────┘
+ * STOP halts every clock but the LSI: TIM4 (PWM), TIM7 (sequencer), the
+ * UARTs and their DMA all freeze, hence the conditions. The byte whose
+ * start bit wakes the core is lost; the ESP8266 sends a wake preamble
+ * first (led_frame.h, "Link Wake"), and STOP is held off for
+ * LED_LINK_STOP_QUIET_MS after every UART wakeup. After STOP the PLL is
+ * restarted and selected again before anything else runs (~200 us).
+ *
+ * POWER Reply (window since the previous POWER request):
+ * ┌──────────────────────────────────────────────────────────────────────┐
+ * │ PWR:ms=<window>,sleep=<‰>/<n>,stop=<‰>/<n>,uart=<n>;<led>=<‰>/<ms>,..│
+ * └──────────────────────────────────────────────────────────────────────┘
+ * Example: PWR:ms=30000,sleep=41/2841,stop=951/300,uart=12;p1=951/30000
+ * - sleep: share of the window in tickless SLEEP / number of entries
+ * - stop:  share of the window in STOP / number of entries
+ * - uart:  STOP exits caused by UART2 RX (wake preamble)
+ * - <led>: what the LEDs played (p1-p3, off = LED_CMD 4, scene = run-time
+ *          LED_SET/LED_SCENE): its STOP share / time it played in the window
+ * Select a pattern, discard the first reply and read the next: that window
+ * is the pattern's residency, from which its idle current follows.
+ * The STATS sleep share (runtime_stats.h) includes both modes.
+ *
+ * Thread Safety:
+ * - low_power_suppress_ticks_and_sleep(): idle task, scheduler suspended
+ * - low_power_format(): one task (owns the window)
+ ******************************************************************************
+ */
+
+#ifndef __LOW_POWER_H
+#define __LOW_POWER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "FreeRTOS.h"
+#include <stddef.h>
+
+/*============================================================================
+ * Configuration
+ *===========================================================================*/
+
+/** 1 = allow STOP mode, 0 = tickless SLEEP only */
+#ifndef LOW_POWER_USE_STOP
+#define LOW_POWER_USE_STOP  1
+#endif
+
+/** Shortest expected idle time worth a STOP entry (PLL relock ~200 us) */
+#ifndef LOW_POWER_STOP_MIN_TICKS
+#define LOW_POWER_STOP_MIN_TICKS  3
+#endif
+
+/** LSI measurement time at boot (busy wait, 1/32 ms resolution) */
+#ifndef LOW_POWER_LSI_CAL_MS
+#define LOW_POWER_LSI_CAL_MS  50
+#endif
+
+/** NVIC priority of the RTC wakeup and EXTI3 interrupts */
+#define LOW_POWER_IRQ_PRIORITY  6
+
+/*============================================================================
+ * Public API
+ *===========================================================================*/
+
+/**
+ * @brief  Start the RTC on the LSI, calibrate it and set up the wakeup lines
+ * @retval None
+ * @note   Call before the scheduler starts. If the RTC already runs from
+ *         another clock, it is left alone (resetting the backup domain
+ *         would lose the watchdog record) and tickless idle falls back to
+ *         plain WFI.
+ */
+void low_power_init(void);
+
+/**
+ * @brief  Sleep with the tick suppressed (portSUPPRESS_TICKS_AND_SLEEP)
+ * @param  expected_idle_ticks: Ticks until the next task is due
+ * @retval None
+ * @note   Called by the idle task with the scheduler suspended
+ */
+void low_power_suppress_ticks_and_sleep(TickType_t expected_idle_ticks);
+
+/**
+ * @brief  RTC wakeup interrupt (RTC_WKUP_IRQHandler)
+ * @retval None
+ * @note   Normally handled before interrupts are unmasked again; this
+ *         only clears a flag left behind
+ */
+void low_power_rtc_wakeup_irq(void);
+
+/**
+ * @brief  UART2 RX wakeup interrupt (EXTI3_IRQHandler)
+ * @retval None
+ */
+void low_power_uart_wakeup_irq(void);
+
+/**
+ * @brief  Format the window since the previous call as a POWER reply line
+ * @param  buf: Output buffer
+ * @param  size: Buffer size (patterns that do not fit are left out)
+ * @retval Length written (without the terminator)
+ */
+int low_power_format(char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LOW_POWER_H */
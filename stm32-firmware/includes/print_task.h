@@ -14,8 +14,13 @@
  * Key Features:
  * - Exclusive UART3 ownership (no concurrent access issues)
  * - Non-blocking API for application tasks
- * - Queue-based message passing
+ * - Variable-length log ring: each message costs its length + 2 bytes
+ * - Strings in flash (literals) are enqueued by pointer, not copied
+ * - UART3 output via DMA, double buffered (PRINT_TX_USE_DMA)
  * - FIFO message ordering
+ * - Producers never wait: a full ring drops the message, counts it against
+ *   the calling task, and a "N messages dropped" summary follows later
+ * - ISR-safe variant (print_message_from_isr) for HAL callbacks
  * - Watchdog monitoring integration
  *
  * Usage Example:
@@ -26,10 +31,11 @@
  * // Character echo
  * print_char('A');
  *
- * // Formatted printing
- * char buffer[64];
- * snprintf(buffer, sizeof(buffer), "[SENSOR] Temp: %d°C\r\n", temp);
- * print_message(buffer);
+ * // Formatted printing (deferred: no buffer or snprintf in the caller)
+ * print_deferred("[SENSOR] Temp: %d°C\r\n", temp);
+ *
+ * // Leveled logging (define LOG_MODULE_LEVEL before including this header)
+ * LOG_WARN("[SENSOR] Temp high: %d°C\r\n", temp);
  * ```
  ******************************************************************************
  */
@@ -44,7 +50,6 @@ extern "C" {
 #include "main.h"
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
 
 /*============================================================================
  * Configuration Constants
@@ -52,15 +57,96 @@ extern "C" {
 
 /**
  * @brief  Maximum size of a single print message
- * @note   256 bytes is sufficient for debug messages
+ * @note   Longer messages are truncated to PRINT_MESSAGE_MAX_SIZE - 1 bytes
  */
 #define PRINT_MESSAGE_MAX_SIZE 256
 
 /**
- * @brief  Print message queue depth
- * @note   Number of messages that can be queued before blocking/dropping
+ * @brief  Log ring size (bytes)
+ * @note   Records are [2-byte header][text] or [2-byte header][pointer],
+ *         so a 20-character message uses 22 bytes instead of a 256-byte slot
+ */
+#define PRINT_RING_SIZE 1024
+
+/**
+ * @brief  UART3 TX mode selection
+ * @note   1 = coalesce records into two PRINT_TX_BUFFER_SIZE buffers and
+ *             send with HAL_UART_Transmit_DMA (CPU free while bytes shift out)
+ *         0 = blocking HAL_UART_Transmit of each coalesced buffer
+ */
+#ifndef PRINT_TX_USE_DMA
+#define PRINT_TX_USE_DMA 1
+#endif
+
+/**
+ * @brief  Size of each of the two UART3 TX buffers (bytes)
+ * @note   Must be >= PRINT_MESSAGE_MAX_SIZE so any record fits
+ */
+#define PRINT_TX_BUFFER_SIZE 256
+
+/**
+ * @brief  Retry interval when UART3 refuses a transfer (ms)
+ * @note   HAL_UART_Transmit_DMA returns HAL_BUSY while a polled transmit
+ *         (boot banner, fault path) holds the UART; the staged buffer is
+ *         kept and sent on the retry
+ */
+#define PRINT_TX_RETRY_MS 10
+
+/**
+ * @brief  Maximum number of print_deferred() arguments
+ */
+#define PRINT_DEFERRED_MAX_ARGS 4
+
+/**
+ * @brief  Deferred log output format on UART3
+ * @note   0 = print task expands deferred records to text (terminal-readable)
+ *         1 = send [0xFE][format address][nargs][args] records and decode
+ *             on the host: tools/log_decode.py firmware.elf < capture
+ */
+#ifndef PRINT_DEFERRED_BINARY
+#define PRINT_DEFERRED_BINARY 0
+#endif
+
+/** Start of a binary deferred record (never occurs in UTF-8 text) */
+#define PRINT_DEFERRED_MARKER 0xFE
+
+/**
+ * @brief  Log severity levels (lower = more severe)
+ * @note   Plain macros so they can be used in #if
+ */
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_TRACE 5
+
+/**
+ * @brief  Compile-time minimum level for modules that do not set their own
+ * @note   Calls above a module's level are removed by the compiler
+ *         (no format string in flash, no call at run time)
  */
-#define PRINT_QUEUE_DEPTH 5
+#ifndef LOG_LEVEL_DEFAULT
+#define LOG_LEVEL_DEFAULT LOG_LEVEL_INFO
+#endif
+
+/**
+ * @brief  Run-time threshold at boot
+ * @note   Lowered or raised with print_set_log_level() or LOG_LEVEL:n from
+ *         the ESP8266; it cannot bring back calls compiled out above
+ */
+#ifndef PRINT_LOG_LEVEL_RUNTIME
+#define PRINT_LOG_LEVEL_RUNTIME LOG_LEVEL_TRACE
+#endif
+
+/**
+ * @brief  Print task CPU profiling (DWT cycle counter)
+ * @note   1 = log "[PRINT_TASK] N bytes, C cycles/KB" after each KB sent
+ *         0 = disabled (no overhead)
+ */
+#ifndef PRINT_TASK_PROFILE
+#define PRINT_TASK_PROFILE 0
+#endif
 
 /**
  * @brief  Print task priority
@@ -75,20 +161,45 @@ extern "C" {
  */
 #define PRINT_TASK_STACK_SIZE 384
 
+/**
+ * @brief  Producer behaviour when the log ring is full
+ * @note   0 = drop the message at once and count it (default, never stalls
+ *             the caller)
+ *         1 = wait up to PRINT_ENQUEUE_TIMEOUT_MS for room, then drop
+ *         ISR producers never wait
+ */
+#ifndef PRINT_ENQUEUE_BLOCKING
+#define PRINT_ENQUEUE_BLOCKING 0
+#endif
+
 /**
  * @brief  Timeout for enqueuing print messages (milliseconds)
- * @note   100ms timeout prevents deadlock if queue fills unexpectedly
+ * @note   Only used with PRINT_ENQUEUE_BLOCKING = 1
  */
 #define PRINT_ENQUEUE_TIMEOUT_MS 100
 
-/*============================================================================
- * FreeRTOS Objects (Global Handles)
- *===========================================================================*/
+/**
+ * @brief  Number of producer tasks with their own drop counter
+ * @note   Drops from further tasks are counted as "other", drops from
+ *         interrupts as "ISR"
+ */
+#define PRINT_DROP_SOURCES 4
 
 /**
- * @brief  Print message queue handle
+ * @brief  Minimum interval between "N messages dropped" summaries (ms)
  */
-extern QueueHandle_t print_queue;
+#define PRINT_DROP_REPORT_MS 5000
+
+/*============================================================================
+ * Types
+ *===========================================================================*/
+
+/** Log severity (LOG_LEVEL_NONE..LOG_LEVEL_TRACE) */
+typedef uint8_t log_level_t;
+
+/*============================================================================
+ * Peripheral Handles
+ *===========================================================================*/
 
 /**
  * @brief  UART3 peripheral handle for debug logging
@@ -110,9 +221,14 @@ void print_task_init(void);
 /**
  * @brief  Send a string message to the print queue (debug logging)
  * @param  message: Null-terminated string to print to serial terminal
- * @retval BaseType_t: pdPASS if message queued successfully, pdFAIL if timeout
+ * @retval BaseType_t: pdPASS if message queued successfully, pdFAIL if the
+ *         ring was full (the drop is counted and reported later)
+ *
+ * Thread Safety: Safe to call from any task (use print_message_from_isr()
+ * in interrupts)
  *
- * Thread Safety: Safe to call from any task
+ * Strings located in flash (string literals, const tables) are queued by
+ * pointer; RAM strings (e.g. snprintf buffers) are copied, length bytes only.
  *
  * Example:
  * ```c
@@ -121,10 +237,33 @@ void print_task_init(void);
  */
 BaseType_t print_message(const char *message);
 
+/**
+ * @brief  Send a string message to the print queue from an interrupt
+ * @param  message: Null-terminated string to print to serial terminal
+ * @retval BaseType_t: pdPASS if queued, pdFAIL if the ring is full (counted
+ *         as an "ISR" drop)
+ *
+ * Thread Safety: Callable from ISRs at or below
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY (all HAL callbacks in this project).
+ * Never waits. Yields on exit if the print task was woken.
+ *
+ * Example:
+ * ```c
+ * print_message_from_isr("[UART2] Overrun, RX restarted\r\n");
+ * ```
+ */
+BaseType_t print_message_from_isr(const char *message);
+
+/**
+ * @brief  Total number of messages dropped because the ring was full
+ * @retval Count since boot (all sources)
+ */
+uint32_t print_get_dropped(void);
+
 /**
  * @brief  Send a single character to the print queue
  * @param  c: Character to print to serial terminal
- * @retval BaseType_t: pdPASS if character queued successfully, pdFAIL if timeout
+ * @retval BaseType_t: pdPASS if character queued successfully, pdFAIL if dropped
  *
  * Example:
  * ```c
@@ -133,6 +272,119 @@ BaseType_t print_message(const char *message);
  */
 BaseType_t print_char(char c);
 
+/**
+ * @brief  Queue a format string and raw arguments (use print_deferred())
+ * @param  fmt: printf-style format string, must be in flash (a literal)
+ * @param  nargs: Number of uintptr_t arguments that follow
+ * @retval BaseType_t: pdPASS if queued successfully, pdFAIL if dropped
+ */
+BaseType_t print_deferred_args(const char *fmt, uint8_t nargs, ...);
+
+/**
+ * @brief  Deferred formatted print: formatting happens in the print task
+ *         (or on the host), not in the caller
+ * @note   Up to PRINT_DEFERRED_MAX_ARGS integer or pointer arguments
+ *         (%d %u %x %c %lu %s %p), each passed as uintptr_t; more is a
+ *         compile error. %s arguments must point to strings that never
+ *         change (flash or static tables); binary mode can only decode
+ *         flash strings.
+ *
+ * Example:
+ * ```c
+ * print_deferred("[LED] Pattern %u set\r\n", pattern);
+ * ```
+ */
+#define print_deferred(fmt, ...) \
+    PRINT_CAT(PRINT_DEFERRED_, PRINT_COUNT_ARGS(__VA_ARGS__))((fmt), ##__VA_ARGS__)
+
+#define PRINT_CAT(a, b)        PRINT_CAT_(a, b)
+#define PRINT_CAT_(a, b)       a##b
+
+/* 0..4 arguments; 5..12 select PRINT_DEFERRED_X */
+#define PRINT_COUNT_ARGS(...)  PRINT_COUNT_ARGS_(_, ##__VA_ARGS__, X, X, X, X, X, X, X, X, 4, 3, 2, 1, 0)
+#define PRINT_COUNT_ARGS_(_, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, n, ...) n
+
+#define PRINT_DEFERRED_0(fmt)  print_deferred_args(fmt, 0)
+#define PRINT_DEFERRED_1(fmt, a1) \
+    print_deferred_args(fmt, 1, (uintptr_t)(a1))
+#define PRINT_DEFERRED_2(fmt, a1, a2) \
+    print_deferred_args(fmt, 2, (uintptr_t)(a1), (uintptr_t)(a2))
+#define PRINT_DEFERRED_3(fmt, a1, a2, a3) \
+    print_deferred_args(fmt, 3, (uintptr_t)(a1), (uintptr_t)(a2), (uintptr_t)(a3))
+#define PRINT_DEFERRED_4(fmt, a1, a2, a3, a4) \
+    print_deferred_args(fmt, 4, (uintptr_t)(a1), (uintptr_t)(a2), (uintptr_t)(a3), (uintptr_t)(a4))
+#define PRINT_DEFERRED_X(fmt, ...) \
+    print_deferred_args(fmt, (uint8_t)sizeof(struct { \
+        _Static_assert(0, "print_deferred: more than PRINT_DEFERRED_MAX_ARGS (4) arguments"); int unused; }))
+
+/**
+ * @brief  Run-time log threshold (read by the LOG_xxx macros)
+ * @note   Use print_set_log_level() to change it
+ */
+extern volatile log_level_t print_log_threshold;
+
+/**
+ * @brief  Set the run-time log threshold
+ * @param  level: LOG_LEVEL_NONE (silence) .. LOG_LEVEL_TRACE (everything)
+ * @retval pdPASS, or pdFAIL if level is out of range
+ */
+BaseType_t print_set_log_level(log_level_t level);
+
+/**
+ * @brief  Get the run-time log threshold
+ * @retval Current level
+ */
+log_level_t print_get_log_level(void);
+
+/*
+ * Leveled logging
+ *
+ * Each module sets its compile-time minimum before including this header:
+ *
+ *     #define LOG_MODULE_LEVEL  WATCHDOG_LOG_LEVEL
+ *     #include "print_task.h"
+ *
+ * LOG_ERROR..LOG_TRACE take print_deferred() arguments. A call above
+ * LOG_MODULE_LEVEL is a constant-false branch and is compiled out; the rest
+ * are checked against print_log_threshold before anything is queued.
+ */
+#ifndef LOG_MODULE_LEVEL
+#define LOG_MODULE_LEVEL LOG_LEVEL_DEFAULT
+#endif
+
+/** True if a message at this level would be queued */
+#define LOG_ENABLED(level) \
+    ((level) <= LOG_MODULE_LEVEL && (level) <= print_log_threshold)
+
+#define LOG_AT(level, fmt, ...) \
+    do { \
+        if (LOG_ENABLED(level)) { \
+            (void)print_deferred(fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_ERROR(fmt, ...)  LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)   LOG_AT(LOG_LEVEL_WARN,  fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)   LOG_AT(LOG_LEVEL_INFO,  fmt, ##__VA_ARGS__)
+#define LOG_DEBUG(fmt, ...)  LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_TRACE(fmt, ...)  LOG_AT(LOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
+
+/**
+ * @brief  UART3 TX complete hook (ISR context)
+ * @param  huart: UART handle passed to HAL_UART_TxCpltCallback
+ * @retval None
+ * @note   Called from HAL_UART_TxCpltCallback in main.c; ignores other UARTs
+ */
+void print_task_uart_tx_complete(UART_HandleTypeDef *huart);
+
+/**
+ * @brief  Check that no UART3 transfer is in flight
+ * @retval pdTRUE if the last staged block has been sent completely
+ * @note   Called by low_power with interrupts masked: USART3 stops in STOP
+ *         mode, so a transfer must not be cut off
+ */
+BaseType_t print_task_tx_idle(void);
+
 /**
  * @brief  Print task handler (main task loop)
  * @param  parameters: Task parameters (unused, required by FreeRTOS API)
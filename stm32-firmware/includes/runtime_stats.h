@@ -0,0 +1,165 @@
+/**
+ ******************************************************************************
+ * @file           : runtime_stats.h
+ * @brief          : Run-Time CPU Statistics (DWT Cycle Counter)
+ ******************************************************************************
+ * @description
+ * Feeds FreeRTOS run-time stats (configGENERATE_RUN_TIME_STATS) from the DWT
+ * cycle counter and adds what FreeRTOS does not measure: time spent asleep
+ * in the idle hook and time spent in selected interrupt handlers.
+ *
+ * Run-Time Clock:
+ * CYCCNT wraps every 25.6 s at 168 MHz. runtime_stats_counter() extends it
+ * to 64 bits (runtime_stats_extend(), valid while it is called at least
+ * once per wrap: every context switch calls it, and the watchdog task wakes
+ * every second) and returns it divided by 2^RUNTIME_STATS_SHIFT, so the
+ * 32-bit FreeRTOS task counters wrap after ~27 min instead of 25.6 s.
+ * All percentages are differences over a window shorter than that, so
+ * the wrap itself cancels out (unsigned subtraction).
+ *
+ * STATS Reply (one line, CPU share in permille over the window since the
+ * previous STATS request):
+ * ┌──────────────────────────────────────────────────────────────────────┐
+ * │ STATS:ms=<window>,idle=<‰>,sleep=<‰>,<isr>=<‰>/<calls>,...;<task>=<‰>│
+ * └──────────────────────────────────────────────────────────────────────┘
+ * Example: STATS:ms=30000,idle=968,sleep=961,usart2=1/14,usart3=2/210;
+ *          ESP8266_C=12,Print_Tas=9,Watchdog=3,Tmr Svc=0
+ * - idle:  IDLE task share (includes sleep)
+ * - sleep: time the core spent asleep (idle hook WFI, or tickless SLEEP
+ *          and STOP, low_power.h)
+ * - isr:   cycles inside the handler (including higher-priority ISRs that
+ *          preempted it); FreeRTOS also charges them to the interrupted task
+ *
+ * Thread Safety:
+ * - runtime_stats_counter(): FreeRTOS only (context switch, or with the
+ *   scheduler suspended), never both at once
+ * - RUNTIME_STATS_ISR_EXIT(): the instrumented ISR only (one writer each)
+ * - runtime_stats_format(): one task (owns the window baseline)
+ ******************************************************************************
+ */
+
+#ifndef __RUNTIME_STATS_H
+#define __RUNTIME_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "FreeRTOS.h"
+#include <stddef.h>
+
+/*============================================================================
+ * Configuration
+ *===========================================================================*/
+
+/** Run-time clock = CPU cycles >> RUNTIME_STATS_SHIFT (64 cycles = 0.38 us) */
+#define RUNTIME_STATS_SHIFT  6
+
+/** Maximum number of tasks reported */
+#define RUNTIME_STATS_MAX_TASKS  8
+
+/** Instrumented interrupt handlers (add one per ISR, and a name in .c) */
+typedef enum {
+    RUNTIME_ISR_USART2 = 0,     /**< USART2_IRQHandler (ESP8266 link) */
+    RUNTIME_ISR_USART3,         /**< USART3_IRQHandler (debug log) */
+    RUNTIME_ISR_COUNT
+} runtime_isr_t;
+
+/*============================================================================
+ * Wraparound Helpers (no HAL or kernel calls)
+ *===========================================================================*/
+
+/**
+ * @brief  Extend a wrapping 32-bit counter to 64 bits
+ * @param  total: Extended value so far
+ * @param  last: [IN/OUT] Raw value at the previous call
+ * @param  now: Raw value now
+ * @retval New extended value
+ * @note   Correct as long as calls are less than one wrap apart
+ */
+static inline uint64_t runtime_stats_extend(uint64_t total, uint32_t *last, uint32_t now)
+{
+    total += (uint32_t)(now - *last);
+    *last = now;
+    return total;
+}
+
+/**
+ * @brief  Share of a window in permille
+ * @param  part: Amount within the window
+ * @param  whole: Window length (same unit)
+ * @retval part * 1000 / whole, clamped to 1000 (0 for an empty window)
+ */
+static inline uint32_t runtime_stats_permille(uint64_t part, uint64_t whole)
+{
+    if (whole == 0) {
+        return 0;
+    }
+    part = (part * 1000U) / whole;
+    return (part > 1000U) ? 1000U : (uint32_t)part;
+}
+
+/*============================================================================
+ * Public API
+ *===========================================================================*/
+
+/**
+ * @brief  Start the cycle counter (portCONFIGURE_TIMER_FOR_RUN_TIME_STATS)
+ * @retval None
+ */
+void runtime_stats_timer_init(void);
+
+/**
+ * @brief  Run-time clock (portGET_RUN_TIME_COUNTER_VALUE)
+ * @retval Extended cycle count >> RUNTIME_STATS_SHIFT
+ */
+uint32_t runtime_stats_counter(void);
+
+/**
+ * @brief  Account the time the idle hook spent asleep
+ * @param  cycles: CPU cycles in WFI
+ * @retval None
+ */
+void runtime_stats_add_sleep(uint32_t cycles);
+
+/**
+ * @brief  Account time spent in STOP mode
+ * @param  cycles: STOP time in CPU cycles (measured by low_power on the RTC)
+ * @retval None
+ * @note   CYCCNT does not count in STOP: the run-time clock is advanced by
+ *         the same amount, so the idle task is charged for it. Interrupts
+ *         masked (no context switch may extend the clock meanwhile).
+ */
+void runtime_stats_add_stop(uint32_t cycles);
+
+/**
+ * @brief  Account one run of an instrumented ISR
+ * @param  isr: Handler
+ * @param  start: CYCCNT at handler entry (RUNTIME_STATS_ISR_ENTER())
+ * @retval None
+ */
+void runtime_stats_isr_exit(runtime_isr_t isr, uint32_t start);
+
+/**
+ * @brief  Format the window since the previous call as a STATS reply line
+ * @param  buf: Output buffer
+ * @param  size: Buffer size (tasks that do not fit are left out)
+ * @retval Length written (without the terminator)
+ */
+int runtime_stats_format(char *buf, size_t size);
+
+/** ISR instrumentation (compiled out without run-time stats) */
+#if configGENERATE_RUN_TIME_STATS
+#define RUNTIME_STATS_ISR_ENTER()           (DWT->CYCCNT)
+#define RUNTIME_STATS_ISR_EXIT(isr, start)  runtime_stats_isr_exit((isr), (start))
+#else
+#define RUNTIME_STATS_ISR_ENTER()           (0U)
+#define RUNTIME_STATS_ISR_EXIT(isr, start)  ((void)(start))
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RUNTIME_STATS_H */
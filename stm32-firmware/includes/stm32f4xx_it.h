@@ -56,6 +56,13 @@ void USART2_IRQHandler(void);
 void USART3_IRQHandler(void);
 void TIM6_DAC_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void DMA1_Stream0_IRQHandler(void);
+void DMA1_Stream3_IRQHandler(void);
+void DMA1_Stream5_IRQHandler(void);
+void DMA1_Stream6_IRQHandler(void);
+void TIM7_IRQHandler(void);
+void RTC_WKUP_IRQHandler(void);
+void EXTI3_IRQHandler(void);
 
 /* USER CODE END EFP */
 
@@ -0,0 +1,102 @@
+/**
+ ******************************************************************************
+ * @file           : telemetry.h
+ * @brief          : Stack High-Water Mark and Heap Telemetry
+ ******************************************************************************
+ * @description
+ * Samples every task's stack high-water mark and the FreeRTOS heap so stack
+ * sizes can be trimmed from measurements instead of trial and error (see
+ * "Memory Exhaustion" in docs/architecture.md).
+ *
+ * How it works:
+ * 1. The watchdog monitor calls telemetry_sample() every check period;
+ *    a full sample is taken every TELEMETRY_SAMPLE_PERIOD_MS
+ * 2. A sample walks all tasks with uxTaskGetSystemState() and reads
+ *    xPortGetFreeHeapSize() / xPortGetMinimumEverFreeHeapSize()
+ * 3. A task whose unused stack falls below TELEMETRY_STACK_ALERT_WORDS, or
+ *    a minimum free heap below TELEMETRY_HEAP_ALERT_BYTES, raises a
+ *    watchdog alert (once: both values only ever shrink)
+ * 4. The ESP8266 reads the latest sample with the MEM command
+ *
+ * MEM Reply (one line, stack values in words of unused stack):
+ * ┌──────────────────────────────────────────────────────────────────────┐
+ * │ MEM:heap=<free>,min=<min free>,fail=<malloc fails>;<task>=<words>,...│
+ * └──────────────────────────────────────────────────────────────────────┘
+ * Example: MEM:heap=43808,min=43616,fail=0;ESP8266_C=94,Print_Tas=171,...
+ *
+ * Thread Safety:
+ * - telemetry_sample(): watchdog task only
+ * - telemetry_format(): any task (scheduler suspended while formatting)
+ * - telemetry_malloc_failed(): vApplicationMallocFailedHook only
+ ******************************************************************************
+ */
+
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stddef.h>
+
+/*============================================================================
+ * Configuration
+ *===========================================================================*/
+
+/** Time between samples (ms, multiple of WATCHDOG_CHECK_PERIOD_MS) */
+#ifndef TELEMETRY_SAMPLE_PERIOD_MS
+#define TELEMETRY_SAMPLE_PERIOD_MS  10000
+#endif
+
+/** Maximum number of tasks in a sample (5 today: 3 app + IDLE + Tmr Svc) */
+#define TELEMETRY_MAX_TASKS  8
+
+/** Alert when a task has fewer unused stack words than this */
+#ifndef TELEMETRY_STACK_ALERT_WORDS
+#define TELEMETRY_STACK_ALERT_WORDS  32
+#endif
+
+/** Alert when the minimum-ever free heap drops below this (bytes) */
+#ifndef TELEMETRY_HEAP_ALERT_BYTES
+#define TELEMETRY_HEAP_ALERT_BYTES  2048
+#endif
+
+/** Compile-time log level for telemetry messages (LOG_LEVEL_xxx, print_task.h) */
+#ifndef TELEMETRY_LOG_LEVEL
+#define TELEMETRY_LOG_LEVEL  LOG_LEVEL_INFO
+#endif
+
+/*============================================================================
+ * Public API
+ *===========================================================================*/
+
+/**
+ * @brief  Take a sample if TELEMETRY_SAMPLE_PERIOD_MS has elapsed
+ * @retval None
+ * @note   Called by the watchdog monitor task; raises watchdog alerts
+ */
+void telemetry_sample(void);
+
+/**
+ * @brief  Format the latest sample as a MEM reply line
+ * @param  buf: Output buffer
+ * @param  size: Buffer size (tasks that do not fit are left out)
+ * @retval Length written (without the terminator), 0 before the first sample
+ */
+int telemetry_format(char *buf, size_t size);
+
+/**
+ * @brief  Count a failed pvPortMalloc() (from vApplicationMallocFailedHook)
+ * @retval None
+ */
+void telemetry_malloc_failed(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TELEMETRY_H */
@@ -0,0 +1,152 @@
+/**
+ ******************************************************************************
+ * @file           : trace.h
+ * @brief          : Command Latency Trace (DWT Cycle Counter)
+ ******************************************************************************
+ * @description
+ * Timestamps every acknowledged LED command at fixed points of its path
+ * through the STM32 and keeps the last TRACE_RING_SIZE records in a ring.
+ * The ESP8266 records its own stages for the same command and reads these
+ * records with the TRACE command; tools/latency_report.py merges both sides
+ * into per-stage latency histograms.
+ *
+ * Correlation:
+ * Records are keyed by the command sequence number (the "#seq" suffix or
+ * the seq byte of a frame) that the ESP8266 already uses to match ACKs.
+ * Commands without one (LED_CMD from older ESP firmware) are not recorded.
+ *
+ * Stages (raw DWT CYCCNT values, started by runtime_stats_timer_init();
+ * SystemCoreClock Hz, so they wrap every 25.6 s):
+ * ┌─────────────┬───────────────────────────────────────────────────────────┐
+ * │ Stage       │ Stamped                                                   │
+ * ├─────────────┼───────────────────────────────────────────────────────────┤
+ * │ RX_ISR      │ UART RX callback that delivered the command's last chunk  │
+ * │ TASK_WAKE   │ Comm task returned from xStreamBufferReceive()            │
+ * │ DISPATCH    │ Complete line or frame handed to the command handler      │
+ * │ APPLIED     │ Effects engine returned: PWM compares written (the GPIO   │
+ * │             │ edge follows within one PWM period); for LED_AT the time  │
+ * │             │ the sequence was queued                                   │
+ * │ ACK         │ ACK handed to the UART                                    │
+ * └─────────────┴───────────────────────────────────────────────────────────┘
+ *
+ * TRACE Reply (up to TRACE_DUMP_BATCH record lines, as many as the UART2
+ * TX queue has room for, then an END line; reported records are removed
+ * from the ring):
+ * ┌──────────────────────────────────────────────────────────────────────┐
+ * │ TR:<seq>,<rx_isr>,<task_wake>,<dispatch>,<applied>,<ack>             │
+ * │ TR:END,<records left>,<cycles per second>                            │
+ * └──────────────────────────────────────────────────────────────────────┘
+ *
+ * Thread Safety:
+ * - trace_rx_isr(): UART2 RX callback only (one 32-bit store)
+ * - Everything else: ESP8266 comm task only
+ ******************************************************************************
+ */
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include <stddef.h>
+
+/*============================================================================
+ * Configuration
+ *===========================================================================*/
+
+/** Set to 0 to compile the trace points out */
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE  1
+#endif
+
+/** Records kept (the oldest is overwritten when full) */
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE  32
+#endif
+
+/** Record lines per TRACE reply (~60 bytes each; the ESP8266 reads them
+ *  through a small SoftwareSerial buffer, so keep bursts short) */
+#ifndef TRACE_DUMP_BATCH
+#define TRACE_DUMP_BATCH  4
+#endif
+
+/** Longest TR: record line and END line, CR LF included */
+#define TRACE_LINE_MAX      (3 + 3 + 5 * 11 + 2)    // 8-bit seq, 32-bit stamps
+#define TRACE_END_LINE_MAX  (7 + 3 + 11 + 2)
+
+/** Stages of a record (order of the TR: fields) */
+typedef enum {
+    TRACE_RX_ISR = 0,   /**< UART RX callback */
+    TRACE_TASK_WAKE,    /**< Comm task woke with the chunk */
+    TRACE_DISPATCH,     /**< Command handler called */
+    TRACE_APPLIED,      /**< Effects engine updated */
+    TRACE_ACK,          /**< ACK sent */
+    TRACE_STAGE_COUNT
+} trace_stage_t;
+
+/*============================================================================
+ * Public API
+ *===========================================================================*/
+
+/**
+ * @brief  Stamp a UART RX callback (ISR context)
+ * @retval None
+ */
+void trace_rx_isr(void);
+
+/**
+ * @brief  Stamp the comm task waking with a received chunk
+ * @retval None
+ */
+void trace_chunk(void);
+
+/**
+ * @brief  Stamp a stage of the command being processed
+ * @param  stage: TRACE_DISPATCH or TRACE_APPLIED
+ * @retval None
+ * @note   TRACE_DISPATCH starts a new record from the last chunk's stamps
+ */
+void trace_mark(trace_stage_t stage);
+
+/**
+ * @brief  Stamp the ACK and store the record in the ring
+ * @param  seq: Sequence number of the command (LED_CMD_NO_SEQ: discarded)
+ * @retval None
+ */
+void trace_commit(int32_t seq);
+
+/**
+ * @brief  Format and remove the oldest record as a TR: line
+ * @param  buf: Output buffer
+ * @param  size: Buffer size
+ * @retval Length written (without the terminator), 0 if the ring is empty
+ */
+int trace_format(char *buf, size_t size);
+
+/**
+ * @brief  Number of records waiting to be read
+ * @retval Count (0..TRACE_RING_SIZE)
+ */
+uint8_t trace_pending(void);
+
+/** Trace points (compiled out when TRACE_ENABLE is 0) */
+#if TRACE_ENABLE
+#define TRACE_RX_ISR()       trace_rx_isr()
+#define TRACE_CHUNK()        trace_chunk()
+#define TRACE_MARK(stage)    trace_mark(stage)
+#define TRACE_COMMIT(seq)    trace_commit(seq)
+#else
+#define TRACE_RX_ISR()       do { } while (0)
+#define TRACE_CHUNK()        do { } while (0)
+#define TRACE_MARK(stage)    do { } while (0)
+#define TRACE_COMMIT(seq)    do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TRACE_H */
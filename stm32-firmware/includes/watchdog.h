@@ -11,6 +11,22 @@
  * 2. Tasks must call watchdog_feed(id) periodically
  * 3. Watchdog task monitors all registered tasks
  * 4. If a task doesn't feed within threshold → alert!
+ * 5. The monitor refreshes the hardware IWDG only while every registered
+ *    task is healthy: a hung task, a hung monitor or a dead scheduler all
+ *    end in an IWDG reset (WATCHDOG_USE_IWDG)
+ *
+ * Reset Forensics:
+ * Before letting the IWDG fire, the monitor writes the culprit task to the
+ * RTC backup registers (kept across system resets). watchdog_init() reads
+ * them back after an IWDG reset and logs the culprit; an IWDG reset with
+ * no record means the monitor itself or the scheduler stopped.
+ * ┌──────────┬──────────────────────────────────────────┐
+ * │ Register │ Content                                  │
+ * ├──────────┼──────────────────────────────────────────┤
+ * │ BKP0R    │ WATCHDOG_BKP_MAGIC | task ID             │
+ * │ BKP1R    │ Time since the task's last feed (ms)     │
+ * │ BKP2R-5R │ Task name (16 bytes)                     │
+ * └──────────┴──────────────────────────────────────────┘
  *
  * Example usage:
  * ```c
@@ -54,6 +70,33 @@ extern "C" {
 /** How often watchdog checks all tasks (ms) */
 #define WATCHDOG_CHECK_PERIOD_MS  1000
 
+/**
+ * Hardware independent watchdog (IWDG, LSI ~32 kHz)
+ * 1 = started by the monitor task, refreshed every WATCHDOG_CHECK_PERIOD_MS
+ *     while all tasks are healthy; reset WATCHDOG_IWDG_TIMEOUT_MS after
+ *     the last refresh
+ * 0 = alert only (no reset, e.g. while debugging a hang)
+ */
+#ifndef WATCHDOG_USE_IWDG
+#define WATCHDOG_USE_IWDG  1
+#endif
+
+/**
+ * IWDG timeout (ms, <= 8190 at prescaler 64)
+ * @note  Must exceed WATCHDOG_CHECK_PERIOD_MS plus the longest CPU stall:
+ *        the sector erase the monitor runs after a config_store compaction
+ *        (config_store_service(), ~1-2 s right after a refresh)
+ */
+#define WATCHDOG_IWDG_TIMEOUT_MS  4000
+
+/** BKP0R tag of a recorded culprit ("WD" in the upper half) */
+#define WATCHDOG_BKP_MAGIC  0x57440000UL
+
+/** Compile-time log level for watchdog messages (LOG_LEVEL_xxx, print_task.h) */
+#ifndef WATCHDOG_LOG_LEVEL
+#define WATCHDOG_LOG_LEVEL  LOG_LEVEL_INFO
+#endif
+
 /*============================================================================
  * Types
  *===========================================================================*/
@@ -142,6 +185,17 @@ void watchdog_feed(watchdog_id_t id);
  */
 void watchdog_set_callback(watchdog_callback_t callback);
 
+/**
+ * @brief  Raise an alert that is not a feed timeout (e.g. resource telemetry)
+ * @param  task_name: Task or resource concerned
+ * @param  reason: What was measured (static string)
+ * @param  value: Measured value
+ * @retval None
+ * @note   Printed in the same *** WATCHDOG ALERT *** format as a timeout;
+ *         does not affect the IWDG. Task context only.
+ */
+void watchdog_raise_alert(const char *task_name, const char *reason, uint32_t value);
+
 /**
  * @brief  Get statistics for a registered task
  * @param  id: Watchdog ID
@@ -153,6 +207,15 @@ void watchdog_set_callback(watchdog_callback_t callback);
  */
 BaseType_t watchdog_get_stats(watchdog_id_t id, uint32_t *last_feed_ms, uint32_t *timeout_ms);
 
+/**
+ * @brief  Culprit of the IWDG reset that started this boot
+ * @retval Task name recorded by the monitor, "Watchdog" if the IWDG fired
+ *         without a record (monitor or scheduler stopped), NULL if the last
+ *         reset was not an IWDG reset
+ * @note   Valid after watchdog_init()
+ */
+const char *watchdog_get_reset_culprit(void);
+
 #ifdef __cplusplus
 }
 #endif
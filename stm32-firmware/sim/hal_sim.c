@@ -0,0 +1,1145 @@
+/**
+ ******************************************************************************
+ * @file           : hal_sim.c
+ * @brief          : HAL Shim Implementation on a Simulated Clock
+ ******************************************************************************
+ * @description
+ * Implements stm32f4xx_hal.h for the host build (see hal_sim.h).
+ *
+ * Every peripheral keeps just enough state to know when its next event is
+ * due. sim_hal_next_event_ns() returns the earliest one and
+ * sim_hal_run_due() fires everything up to the current time, one event at
+ * a time and in time order, calling the same HAL callbacks as the IRQ
+ * handlers in stm32f4xx_it.c:
+ * ┌──────────────────────┬───────────────────────────────────────────────┐
+ * │ Event                │ Firmware callback                             │
+ * ├──────────────────────┼───────────────────────────────────────────────┤
+ * │ TIMx update (UIE)    │ HAL_TIM_PeriodElapsedCallback                 │
+ * │ TIM4 update (CC1DE)  │ DMA burst into CCR1-4, XferHalfCplt/XferCplt  │
+ * │ UART RX byte (DMA)   │ HAL_UARTEx_RxEventCallback at HT / TC         │
+ * │ UART RX line idle    │ HAL_UARTEx_RxEventCallback (write position)   │
+ * │ UART RX byte (IT)    │ HAL_UART_RxCpltCallback                       │
+ * │ UART TX done         │ HAL_UART_TxCpltCallback                       │
+ * │ IWDG expiry          │ Counted (sim_iwdg_expiries)                   │
+ * └──────────────────────┴───────────────────────────────────────────────┘
+ *
+ * Timer Model:
+ * A running counter is anchored at the time it last read 0; its value and
+ * next update follow from the clock and PSC / ARR (84 MHz APB1 timer
+ * clock). Updates nobody listens to (no UIE, no DMA, no one-pulse mode)
+ * are not queued, so a free-running PWM timer costs nothing.
+ *
+ * Limits:
+ * - TIM4 DMA reads its source as uint16_t (MSP: half-word memory size)
+ * - ARR changes take effect at once (the firmware only re-times TIM7,
+ *   which has no preload)
+ * - Flash programming ANDs the new word into the old one, like a NOR cell
+ ******************************************************************************
+ */
+
+#define _GNU_SOURCE
+#include "hal_sim.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/*============================================================================
+ * Private Definitions
+ *===========================================================================*/
+
+#define SIM_UART_COUNT          2
+#define SIM_TIM_COUNT           3
+#define SIM_DEFAULT_BAUD        115200U
+
+/** Simulated config sectors (flash sectors 10 and 11) */
+#define SIM_FLASH_CONFIG_BASE   0x080C0000UL
+#define SIM_FLASH_SECTOR_SIZE   (128UL * 1024UL)
+#define SIM_FLASH_CONFIG_SIZE   (2UL * SIM_FLASH_SECTOR_SIZE)
+
+/** IWDG key register values (RM0090 21.4.1) and LSI clock */
+#define SIM_IWDG_KEY_REFRESH    0xAAAAU
+#define SIM_IWDG_KEY_START      0xCCCCU
+#define SIM_LSI_HZ              32000ULL
+
+/** Event sources, in firing order when due at the same time */
+typedef enum {
+    EVENT_NONE = 0,
+    EVENT_TIM,
+    EVENT_UART_TX,
+    EVENT_UART_RX_BYTE,
+    EVENT_UART_RX_IDLE,
+    EVENT_IWDG
+} event_kind_t;
+
+/*============================================================================
+ * Private Types
+ *===========================================================================*/
+
+typedef struct {
+    TIM_TypeDef *regs;
+    TIM_HandleTypeDef *handle;      // Last handle initialised on this timer
+    uint64_t t0;                    // Time the counter last read 0
+    uint64_t next_update;           // Time of the next update event
+    uint32_t updates;               // Update interrupts delivered
+} sim_tim_t;
+
+typedef struct {
+    uint64_t ns;
+    uint8_t byte;
+} sim_wire_byte_t;
+
+typedef struct {
+    UART_HandleTypeDef *handle;
+
+    // Towards the MCU
+    sim_wire_byte_t *wire;
+    size_t wire_head;
+    size_t wire_count;
+    size_t wire_size;
+    uint64_t wire_end;              // Stop bit end of the last queued byte
+    uint64_t idle_ns;               // IDLE event time (0: none pending)
+    uint32_t overruns;
+    uint32_t rx_isrs;               // RX callbacks delivered (IDLE, DMA HT/TC, byte)
+    uint8_t rx_mode;                // 0 = off, 1 = IT, 2 = DMA to idle
+    uint8_t *rx_buf;
+    uint16_t rx_size;
+    uint16_t rx_count;              // IT mode: bytes still expected
+
+    // From the MCU
+    uint8_t *tx_data;               // Transfer in flight
+    uint16_t tx_len;
+    uint16_t tx_taken;              // Bytes of it already read by the peer
+    uint64_t tx_end;
+    uint8_t *peer;                  // Finished bytes not read yet
+    size_t peer_len;
+    size_t peer_size;
+    int sink_fd;
+} sim_uart_t;
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+uint32_t SystemCoreClock = 168000000UL;
+
+CoreDebug_Type sim_core_debug;
+GPIO_TypeDef sim_gpio[8] = {
+    { 0, 'A' }, { 0, 'B' }, { 0, 'C' }, { 0, 'D' },
+    { 0, 'E' }, { 0, 'F' }, { 0, 'G' }, { 0, 'H' }
+};
+USART_TypeDef sim_usart2;
+USART_TypeDef sim_usart3;
+TIM_TypeDef sim_tim4;
+TIM_TypeDef sim_tim6;
+TIM_TypeDef sim_tim7;
+RTC_TypeDef sim_rtc;
+
+static DWT_Type dwt;
+static IWDG_TypeDef iwdg_regs = { 0, 0, 0xFFFU, 0 };
+
+/** Clock */
+static uint64_t clock_ns = 0;
+static int clock_realtime = 0;
+static struct timespec clock_origin;
+static int dwt_host_clock = 0;
+
+/** Peripherals */
+static sim_tim_t tims[SIM_TIM_COUNT] = {
+    { &sim_tim4, NULL, 0, 0, 0 },
+    { &sim_tim6, NULL, 0, 0, 0 },
+    { &sim_tim7, NULL, 0, 0, 0 },
+};
+static sim_uart_t uarts[SIM_UART_COUNT] = {
+    { .sink_fd = -1 },
+    { .sink_fd = -1 },
+};
+static sim_uart_tx_hook_t uart_tx_hook = NULL;
+
+/** IWDG */
+static int iwdg_running = 0;
+static uint64_t iwdg_deadline = 0;
+static uint32_t iwdg_expiries = 0;
+
+/** RCC reset cause seen at boot */
+static uint32_t reset_flag = RCC_FLAG_PORRST;
+
+/** Pin log */
+static sim_pin_event_t *pin_log = NULL;
+static size_t pin_log_count = 0;
+static size_t pin_log_size = 0;
+static FILE *pin_log_sink = NULL;
+static uint16_t pin_levels[8][16];
+
+/*============================================================================
+ * Clock
+ *===========================================================================*/
+
+uint64_t sim_now_ns(void)
+{
+    if (clock_realtime) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t ns = (uint64_t)(ts.tv_sec - clock_origin.tv_sec) * 1000000000ULL
+                    + (uint64_t)ts.tv_nsec - (uint64_t)clock_origin.tv_nsec;
+        if (ns > clock_ns) {
+            clock_ns = ns;
+        }
+    }
+    return clock_ns;
+}
+
+void sim_clock_advance_to(uint64_t ns)
+{
+    if (!clock_realtime && ns > clock_ns) {
+        clock_ns = ns;
+    }
+}
+
+void sim_clock_use_realtime(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &clock_origin);
+    clock_origin.tv_nsec -= (long)(clock_ns % 1000000000ULL);
+    clock_origin.tv_sec -= (time_t)(clock_ns / 1000000000ULL);
+    if (clock_origin.tv_nsec < 0) {
+        clock_origin.tv_nsec += 1000000000L;
+        clock_origin.tv_sec--;
+    }
+    clock_realtime = 1;
+}
+
+void sim_dwt_use_host_clock(void)
+{
+    dwt_host_clock = 1;
+}
+
+DWT_Type *sim_dwt(void)
+{
+    uint64_t ns = sim_now_ns();
+    uint64_t per_us = SystemCoreClock / 1000000UL;
+
+    if (dwt_host_clock) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+
+    dwt.CYCCNT = (uint32_t)((ns / 1000ULL) * per_us + ((ns % 1000ULL) * per_us) / 1000ULL);
+    return &dwt;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(sim_now_ns() / SIM_NS_PER_MS);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    sim_clock_advance_to(sim_now_ns() + (uint64_t)Delay * SIM_NS_PER_MS);
+}
+
+void __disable_irq(void)
+{
+}
+
+void __enable_irq(void)
+{
+}
+
+/*============================================================================
+ * Pin Log
+ *===========================================================================*/
+
+static void pin_set(char port, uint8_t pin, uint16_t value, uint64_t ns)
+{
+    uint16_t *level = &pin_levels[(port - 'A') & 7][pin & 15];
+
+    if (*level == value) {
+        return;
+    }
+    *level = value;
+
+    if (pin_log_count == pin_log_size) {
+        pin_log_size = pin_log_size ? pin_log_size * 2 : 1024;
+        pin_log = realloc(pin_log, pin_log_size * sizeof(*pin_log));
+        if (pin_log == NULL) {
+            abort();
+        }
+    }
+    pin_log[pin_log_count++] = (sim_pin_event_t){ ns, port, pin, value };
+
+    if (pin_log_sink != NULL) {
+        fprintf(pin_log_sink, "%llu P%c%u %u\n", (unsigned long long)ns, port,
+                (unsigned int)pin, (unsigned int)value);
+    }
+}
+
+size_t sim_pin_log_count(void)
+{
+    return pin_log_count;
+}
+
+const sim_pin_event_t *sim_pin_log_get(size_t index)
+{
+    return (index < pin_log_count) ? &pin_log[index] : NULL;
+}
+
+void sim_pin_log_clear(void)
+{
+    pin_log_count = 0;
+}
+
+void sim_pin_log_set_sink(FILE *file)
+{
+    pin_log_sink = file;
+}
+
+uint16_t sim_pin_level(char port, uint8_t pin)
+{
+    return pin_levels[(port - 'A') & 7][pin & 15];
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    for (uint8_t pin = 0; pin < 16; pin++) {
+        if (GPIO_Pin & (1U << pin)) {
+            if (PinState == GPIO_PIN_SET) {
+                GPIOx->ODR |= 1U << pin;
+            } else {
+                GPIOx->ODR &= ~(1U << pin);
+            }
+            pin_set(GPIOx->name, pin, (PinState == GPIO_PIN_SET) ? 1 : 0, sim_now_ns());
+        }
+    }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    for (uint8_t pin = 0; pin < 16; pin++) {
+        if (GPIO_Pin & (1U << pin)) {
+            HAL_GPIO_WritePin(GPIOx, 1U << pin,
+                              (GPIOx->ODR & (1U << pin)) ? GPIO_PIN_RESET : GPIO_PIN_SET);
+        }
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    return (GPIOx->ODR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+/*============================================================================
+ * Timers
+ *===========================================================================*/
+
+static sim_tim_t *tim_state(TIM_TypeDef *regs)
+{
+    for (uint8_t i = 0; i < SIM_TIM_COUNT; i++) {
+        if (tims[i].regs == regs) {
+            return &tims[i];
+        }
+    }
+    abort();
+}
+
+/** Duration of a number of counter ticks */
+static uint64_t tim_ticks_ns(const TIM_TypeDef *regs, uint64_t ticks)
+{
+    return ticks * (regs->PSC + 1ULL) * 1000000000ULL / SIM_TIM_CLOCK_HZ;
+}
+
+/** Counter ticks in a duration */
+static uint64_t tim_ns_ticks(const TIM_TypeDef *regs, uint64_t ns)
+{
+    return ns * SIM_TIM_CLOCK_HZ / ((regs->PSC + 1ULL) * 1000000000ULL);
+}
+
+/** Re-anchor a counter so that it reads value now */
+static void tim_anchor(sim_tim_t *t, uint32_t value)
+{
+    uint64_t now = sim_now_ns();
+    uint64_t offset = tim_ticks_ns(t->regs, value);
+
+    t->t0 = (now > offset) ? now - offset : 0;
+    t->next_update = t->t0 + tim_ticks_ns(t->regs, t->regs->ARR + 1ULL);
+}
+
+/** Does anything observe this timer's update events? */
+static int tim_listened(const sim_tim_t *t)
+{
+    return (t->regs->CR1 & TIM_CR1_CEN)
+        && ((t->regs->DIER & (TIM_DIER_UIE | TIM_DIER_CC1DE)) || (t->regs->CR1 & TIM_CR1_OPM));
+}
+
+/** Skip update events nobody listened to */
+static void tim_catch_up(sim_tim_t *t)
+{
+    uint64_t now = sim_now_ns();
+    uint64_t period = tim_ticks_ns(t->regs, t->regs->ARR + 1ULL);
+
+    if ((t->regs->CR1 & TIM_CR1_CEN) && !tim_listened(t) && t->next_update <= now && period != 0) {
+        uint64_t skipped = (now - t->next_update) / period + 1;
+        t->t0 += skipped * period;
+        t->next_update += skipped * period;
+        t->regs->SR |= TIM_SR_UIF;
+    }
+}
+
+void sim_tim_enable(TIM_TypeDef *tim)
+{
+    sim_tim_t *t = tim_state(tim);
+
+    if (!(tim->CR1 & TIM_CR1_CEN)) {
+        tim->CR1 |= TIM_CR1_CEN;
+        tim_anchor(t, tim->CNT);
+    }
+}
+
+void sim_tim_disable(TIM_TypeDef *tim)
+{
+    if (tim->CR1 & TIM_CR1_CEN) {
+        tim->CNT = sim_tim_get_counter(tim);
+        tim->CR1 &= ~TIM_CR1_CEN;
+    }
+}
+
+void sim_tim_set_counter(TIM_TypeDef *tim, uint32_t value)
+{
+    tim->CNT = value;
+    if (tim->CR1 & TIM_CR1_CEN) {
+        tim_anchor(tim_state(tim), value);
+    }
+}
+
+uint32_t sim_tim_get_counter(TIM_TypeDef *tim)
+{
+    sim_tim_t *t = tim_state(tim);
+
+    if (tim->CR1 & TIM_CR1_CEN) {
+        tim_catch_up(t);
+        uint64_t now = sim_now_ns();
+        uint64_t ticks = (now > t->t0) ? tim_ns_ticks(tim, now - t->t0) : 0;
+        tim->CNT = (uint32_t)(ticks % (tim->ARR + 1ULL));
+    }
+    return tim->CNT;
+}
+
+void sim_tim_set_autoreload(TIM_TypeDef *tim, uint32_t value)
+{
+    sim_tim_t *t = tim_state(tim);
+
+    tim->ARR = value;
+    if (tim->CR1 & TIM_CR1_CEN) {
+        t->next_update = t->t0 + tim_ticks_ns(tim, value + 1ULL);
+    }
+}
+
+uint32_t sim_tim_get_flags(TIM_TypeDef *tim)
+{
+    tim_catch_up(tim_state(tim));
+    return tim->SR;
+}
+
+void sim_tim_set_compare(TIM_TypeDef *tim, uint32_t channel, uint32_t value)
+{
+    volatile uint32_t *ccr = &tim->CCR1 + channel / 4U;
+
+    *ccr = value;
+    if (tim == TIM4) {
+        // TIM4 CH1-4 drive LD4, LD3, LD5, LD6 (PD12-PD15, HAL_TIM_MspPostInit)
+        pin_set('D', (uint8_t)(12U + channel / 4U), (uint16_t)value, sim_now_ns());
+    }
+}
+
+static HAL_StatusTypeDef tim_init(TIM_HandleTypeDef *htim)
+{
+    sim_tim_t *t = tim_state(htim->Instance);
+    TIM_TypeDef *regs = htim->Instance;
+
+    t->handle = htim;
+    regs->PSC = htim->Init.Prescaler;
+    regs->ARR = htim->Init.Period;
+    regs->CR1 = (regs->CR1 & ~TIM_CR1_ARPE) | (htim->Init.AutoReloadPreload & TIM_CR1_ARPE);
+    regs->CNT = 0;
+    regs->SR |= TIM_SR_UIF;     // EGR.UG, as TIM_Base_SetConfig does
+    return HAL_OK;
+}
+
+__attribute__((weak)) void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim)
+{
+    (void)htim;
+}
+
+__attribute__((weak)) void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim)
+{
+    (void)htim;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim)
+{
+    HAL_TIM_Base_MspInit(htim);
+    return tim_init(htim);
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim)
+{
+    HAL_TIM_PWM_MspInit(htim);
+    return tim_init(htim);
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->DIER |= TIM_DIER_UIE;
+    sim_tim_enable(htim->Instance);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->DIER &= ~TIM_DIER_UIE;
+    sim_tim_disable(htim->Instance);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig,
+                                            uint32_t Channel)
+{
+    if (Channel > TIM_CHANNEL_4) {
+        return HAL_ERROR;
+    }
+    sim_tim_set_compare(htim->Instance, Channel, sConfig->Pulse);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+    htim->Instance->CCER |= 1UL << Channel;
+    sim_tim_enable(htim->Instance);
+    return HAL_OK;
+}
+
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim)
+{
+    if ((htim->Instance->SR & TIM_SR_UIF) && (htim->Instance->DIER & TIM_DIER_UIE)) {
+        htim->Instance->SR &= ~TIM_SR_UIF;
+        HAL_TIM_PeriodElapsedCallback(htim);
+    }
+}
+
+__attribute__((weak)) void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    (void)htim;
+}
+
+/*============================================================================
+ * DMA
+ *===========================================================================*/
+
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uintptr_t SrcAddress,
+                                   uintptr_t DstAddress, uint32_t DataLength)
+{
+    DMA_Stream_TypeDef *stream = hdma->Instance;
+
+    if (stream->CR & DMA_SxCR_EN) {
+        return HAL_BUSY;
+    }
+    stream->M0AR = SrcAddress;
+    stream->PAR = DstAddress;
+    stream->NDTR = DataLength;
+    stream->length = DataLength;
+    stream->CR = DMA_SxCR_EN | DMA_SxCR_TCIE | (hdma->Init.Mode & DMA_SxCR_CIRC)
+               | ((hdma->XferHalfCpltCallback != NULL) ? DMA_SxCR_HTIE : 0U);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+    hdma->Instance->CR &= ~(DMA_SxCR_EN | DMA_SxCR_HTIE | DMA_SxCR_TCIE);
+    hdma->Instance->NDTR = 0;
+    return HAL_OK;
+}
+
+/**
+ * @brief  One DMA request from a timer update: burst DCR.DBL + 1 items from
+ *         memory into the registers starting at DCR.DBA
+ */
+static void tim_dma_burst(sim_tim_t *t)
+{
+    TIM_TypeDef *regs = t->regs;
+    DMA_HandleTypeDef *hdma = (t->handle != NULL) ? t->handle->hdma[TIM_DMA_ID_CC1] : NULL;
+
+    if (hdma == NULL || !(hdma->Instance->CR & DMA_SxCR_EN) || hdma->Instance->NDTR == 0) {
+        return;
+    }
+
+    DMA_Stream_TypeDef *stream = hdma->Instance;
+    const uint16_t *src = (const uint16_t *)(uintptr_t)stream->M0AR;
+    uint32_t total = stream->length;
+    uint32_t base = regs->DCR & 0x1FU;
+    uint32_t burst = ((regs->DCR >> TIM_DCR_DBL_Pos) & 0x1FU) + 1U;
+
+    for (uint32_t i = 0; i < burst && stream->NDTR != 0; i++) {
+        uint32_t item = total - stream->NDTR;
+        uint32_t reg = base + i;
+        uint16_t value = src[item];
+
+        if (reg >= 13 && reg <= 16) {
+            sim_tim_set_compare(regs, (reg - 13U) * 4U, value);     // CCR1..CCR4
+        } else {
+            (&regs->CR1)[reg] = value;
+        }
+
+        stream->NDTR--;
+        if (stream->NDTR == total / 2 && (stream->CR & DMA_SxCR_HTIE) && hdma->XferHalfCpltCallback) {
+            hdma->XferHalfCpltCallback(hdma);
+        }
+        if (stream->NDTR == 0) {
+            if (stream->CR & DMA_SxCR_CIRC) {
+                stream->NDTR = total;
+            } else {
+                stream->CR &= ~DMA_SxCR_EN;
+            }
+            if ((stream->CR & DMA_SxCR_TCIE) && hdma->XferCpltCallback) {
+                hdma->XferCpltCallback(hdma);
+            }
+        }
+        if (!(stream->CR & DMA_SxCR_EN)) {
+            break;      // Aborted from a callback
+        }
+    }
+}
+
+/** Update event of a listened timer */
+static void tim_update(sim_tim_t *t)
+{
+    TIM_TypeDef *regs = t->regs;
+    uint64_t ns = t->next_update;
+
+    regs->SR |= TIM_SR_UIF;
+    if (regs->CR1 & TIM_CR1_OPM) {
+        regs->CR1 &= ~TIM_CR1_CEN;
+        regs->CNT = 0;
+    } else {
+        t->t0 = ns;
+        t->next_update = ns + tim_ticks_ns(regs, regs->ARR + 1ULL);
+    }
+
+    if ((regs->DIER & TIM_DIER_CC1DE) && (regs->CR2 & TIM_CR2_CCDS)) {
+        tim_dma_burst(t);
+    }
+    if (t->handle != NULL) {
+        if (regs->DIER & TIM_DIER_UIE) {
+            t->updates++;
+        }
+        HAL_TIM_IRQHandler(t->handle);
+    }
+}
+
+/*============================================================================
+ * UART
+ *===========================================================================*/
+
+static sim_uart_t *uart_state(UART_HandleTypeDef *huart)
+{
+    sim_uart_t *u = &uarts[(huart->Instance == USART2) ? 0 : 1];
+
+    u->handle = huart;
+    return u;
+}
+
+static uint64_t uart_char_ns(const UART_HandleTypeDef *huart)
+{
+    uint32_t baud = huart->Init.BaudRate ? huart->Init.BaudRate : SIM_DEFAULT_BAUD;
+    return 10ULL * 1000000000ULL / baud;
+}
+
+/** Hand finished TX bytes to the peer */
+static void uart_peer_append(sim_uart_t *u, const uint8_t *data, size_t len)
+{
+    if (u->peer_len + len > u->peer_size) {
+        u->peer_size = (u->peer_len + len) * 2 + 256;
+        u->peer = realloc(u->peer, u->peer_size);
+        if (u->peer == NULL) {
+            abort();
+        }
+    }
+    memcpy(&u->peer[u->peer_len], data, len);
+    u->peer_len += len;
+}
+
+/** Finished bytes to the sink and the hook */
+static void uart_output(sim_uart_t *u, const uint8_t *data, size_t len)
+{
+    if (u->sink_fd >= 0) {
+        ssize_t written = write(u->sink_fd, data, len);
+        (void)written;
+    }
+    if (uart_tx_hook != NULL) {
+        uart_tx_hook(u->handle, data, len);
+    }
+}
+
+static HAL_StatusTypeDef uart_start_tx(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    sim_uart_t *u = uart_state(huart);
+
+    if (huart->gState != HAL_UART_STATE_READY) {
+        return HAL_BUSY;
+    }
+    if (pData == NULL || Size == 0) {
+        return HAL_ERROR;
+    }
+    u->tx_data = realloc(u->tx_data, Size);
+    if (u->tx_data == NULL) {
+        abort();
+    }
+    memcpy(u->tx_data, pData, Size);
+    u->tx_len = Size;
+    u->tx_taken = 0;
+    u->tx_end = sim_now_ns() + Size * uart_char_ns(huart);
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData,
+                                    uint16_t Size, uint32_t Timeout)
+{
+    (void)Timeout;
+    if (huart->gState != HAL_UART_STATE_READY) {
+        return HAL_BUSY;
+    }
+    uart_peer_append(uart_state(huart), pData, Size);   // Polled: done on return
+    uart_output(uart_state(huart), pData, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    return uart_start_tx(huart, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    return uart_start_tx(huart, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    sim_uart_t *u = uart_state(huart);
+
+    if (pData == NULL || Size == 0) {
+        return HAL_ERROR;
+    }
+    u->rx_mode = 1;
+    u->rx_buf = pData;
+    u->rx_size = Size;
+    u->rx_count = Size;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    sim_uart_t *u = uart_state(huart);
+    DMA_Stream_TypeDef *stream = huart->hdmarx->Instance;
+
+    if (pData == NULL || Size == 0) {
+        return HAL_ERROR;
+    }
+    u->rx_mode = 2;
+    u->rx_buf = pData;
+    u->rx_size = Size;
+    stream->M0AR = (uintptr_t)pData;
+    stream->NDTR = Size;
+    stream->length = Size;
+    stream->CR = DMA_SxCR_EN | DMA_SxCR_TCIE | DMA_SxCR_HTIE | (huart->hdmarx->Init.Mode & DMA_SxCR_CIRC);
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    return HAL_OK;
+}
+
+__attribute__((weak)) void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+}
+
+__attribute__((weak)) void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+}
+
+__attribute__((weak)) void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+}
+
+__attribute__((weak)) void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    (void)huart;
+    (void)Size;
+}
+
+uint64_t sim_uart_rx(UART_HandleTypeDef *huart, const void *data, size_t len)
+{
+    sim_uart_t *u = uart_state(huart);
+    const uint8_t *bytes = data;
+    uint64_t char_ns = uart_char_ns(huart);
+    uint64_t t = sim_now_ns();
+
+    if (u->wire_end > t) {
+        t = u->wire_end;
+    }
+    if (u->wire_count + len > u->wire_size) {
+        // Grow and unwrap the ring
+        size_t size = (u->wire_count + len) * 2 + 64;
+        sim_wire_byte_t *wire = malloc(size * sizeof(*wire));
+        if (wire == NULL) {
+            abort();
+        }
+        for (size_t i = 0; i < u->wire_count; i++) {
+            wire[i] = u->wire[(u->wire_head + i) % u->wire_size];
+        }
+        free(u->wire);
+        u->wire = wire;
+        u->wire_head = 0;
+        u->wire_size = size;
+    }
+    for (size_t i = 0; i < len; i++) {
+        t += char_ns;
+        u->wire[(u->wire_head + u->wire_count) % u->wire_size] = (sim_wire_byte_t){ t, bytes[i] };
+        u->wire_count++;
+    }
+    u->wire_end = t;
+    return t;
+}
+
+size_t sim_uart_rx_pending(UART_HandleTypeDef *huart)
+{
+    return uart_state(huart)->wire_count;
+}
+
+uint32_t sim_uart_rx_overruns(UART_HandleTypeDef *huart)
+{
+    return uart_state(huart)->overruns;
+}
+
+uint32_t sim_uart_rx_isrs(UART_HandleTypeDef *huart)
+{
+    return uart_state(huart)->rx_isrs;
+}
+
+size_t sim_uart_tx_read(UART_HandleTypeDef *huart, void *buf, size_t max)
+{
+    sim_uart_t *u = uart_state(huart);
+    size_t n = (u->peer_len < max) ? u->peer_len : max;
+
+    if (buf != NULL) {
+        memcpy(buf, u->peer, n);
+    }
+    memmove(u->peer, u->peer + n, u->peer_len - n);
+    u->peer_len -= n;
+
+    // Then whatever of the transfer in flight has shifted out so far
+    if (u->tx_end != 0 && n < max && u->peer_len == 0) {
+        uint64_t char_ns = uart_char_ns(huart);
+        uint64_t start = u->tx_end - u->tx_len * char_ns;
+        uint64_t shifted = (sim_now_ns() - start) / char_ns;
+        size_t take = (shifted < u->tx_len ? (size_t)shifted : u->tx_len) - u->tx_taken;
+
+        take = (take < max - n) ? take : max - n;
+        if (buf != NULL) {
+            memcpy((uint8_t *)buf + n, &u->tx_data[u->tx_taken], take);
+        }
+        u->tx_taken = (uint16_t)(u->tx_taken + take);
+        n += take;
+    }
+    return n;
+}
+
+void sim_uart_set_sink(UART_HandleTypeDef *huart, int fd)
+{
+    uart_state(huart)->sink_fd = fd;
+}
+
+void sim_uart_set_tx_hook(sim_uart_tx_hook_t hook)
+{
+    uart_tx_hook = hook;
+}
+
+/** Transfer in flight has shifted out */
+static void uart_tx_done(sim_uart_t *u)
+{
+    UART_HandleTypeDef *huart = u->handle;
+
+    huart->gState = HAL_UART_STATE_READY;
+    u->tx_end = 0;
+    uart_peer_append(u, &u->tx_data[u->tx_taken], u->tx_len - u->tx_taken);
+    uart_output(u, u->tx_data, u->tx_len);
+    HAL_UART_TxCpltCallback(huart);
+}
+
+/** Next byte on the wire has arrived */
+static void uart_rx_byte(sim_uart_t *u)
+{
+    UART_HandleTypeDef *huart = u->handle;
+    sim_wire_byte_t byte = u->wire[u->wire_head];
+
+    u->wire_head = (u->wire_head + 1) % u->wire_size;
+    u->wire_count--;
+    u->idle_ns = byte.ns + uart_char_ns(huart);
+
+    if (u->rx_mode == 2) {
+        DMA_Stream_TypeDef *stream = huart->hdmarx->Instance;
+        if (!(stream->CR & DMA_SxCR_EN) || stream->NDTR == 0) {
+            u->overruns++;
+            return;
+        }
+        u->rx_buf[u->rx_size - stream->NDTR] = byte.byte;
+        stream->NDTR--;
+        if (stream->NDTR == u->rx_size / 2U && (stream->CR & DMA_SxCR_HTIE)) {
+            u->rx_isrs++;
+            HAL_UARTEx_RxEventCallback(huart, (uint16_t)(u->rx_size / 2U));
+        }
+        if (stream->NDTR == 0) {
+            if (stream->CR & DMA_SxCR_CIRC) {
+                stream->NDTR = u->rx_size;
+            } else {
+                stream->CR &= ~DMA_SxCR_EN;
+                u->rx_mode = 0;
+                huart->RxState = HAL_UART_STATE_READY;
+            }
+            if (stream->CR & DMA_SxCR_TCIE) {
+                u->rx_isrs++;
+                HAL_UARTEx_RxEventCallback(huart, u->rx_size);
+            }
+        }
+    } else if (u->rx_mode == 1 && u->rx_count != 0) {
+        u->rx_buf[u->rx_size - u->rx_count] = byte.byte;
+        if (--u->rx_count == 0) {
+            u->rx_mode = 0;
+            huart->RxState = HAL_UART_STATE_READY;
+            u->rx_isrs++;
+            HAL_UART_RxCpltCallback(huart);
+        }
+    } else {
+        u->overruns++;      // Not armed: the byte is overwritten (ORE)
+    }
+}
+
+/** Line idle for one character after the last byte */
+static void uart_rx_idle(sim_uart_t *u)
+{
+    UART_HandleTypeDef *huart = u->handle;
+
+    u->idle_ns = 0;
+    if (u->rx_mode == 2) {
+        uint32_t remaining = huart->hdmarx->Instance->NDTR;
+        if (remaining > 0 && remaining < u->rx_size) {
+            u->rx_isrs++;
+            HAL_UARTEx_RxEventCallback(huart, (uint16_t)(u->rx_size - remaining));
+        }
+    }
+}
+
+/*============================================================================
+ * Flash
+ *===========================================================================*/
+
+__attribute__((constructor)) static void flash_map(void)
+{
+    void *base = mmap((void *)SIM_FLASH_CONFIG_BASE, SIM_FLASH_CONFIG_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (base != (void *)SIM_FLASH_CONFIG_BASE) {
+        fprintf(stderr, "hal_sim: cannot map the config flash sectors at 0x%08lx\n",
+                (unsigned long)SIM_FLASH_CONFIG_BASE);
+        abort();
+    }
+    sim_flash_erase_all();
+}
+
+void sim_flash_erase_all(void)
+{
+    memset((void *)SIM_FLASH_CONFIG_BASE, 0xFF, SIM_FLASH_CONFIG_SIZE);
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+    if (TypeProgram != FLASH_TYPEPROGRAM_WORD || (Address & 3U) != 0
+            || Address < SIM_FLASH_CONFIG_BASE || Address >= SIM_FLASH_CONFIG_BASE + SIM_FLASH_CONFIG_SIZE) {
+        return HAL_ERROR;
+    }
+    *(volatile uint32_t *)(uintptr_t)Address &= (uint32_t)Data;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError)
+{
+    for (uint32_t s = pEraseInit->Sector; s < pEraseInit->Sector + pEraseInit->NbSectors; s++) {
+        if (s != FLASH_SECTOR_10 && s != FLASH_SECTOR_11) {
+            *SectorError = s;
+            return HAL_ERROR;
+        }
+        memset((void *)(uintptr_t)(SIM_FLASH_CONFIG_BASE + (s - FLASH_SECTOR_10) * SIM_FLASH_SECTOR_SIZE),
+               0xFF, SIM_FLASH_SECTOR_SIZE);
+    }
+    *SectorError = 0xFFFFFFFFU;
+    return HAL_OK;
+}
+
+/*============================================================================
+ * IWDG, RCC, PWR
+ *===========================================================================*/
+
+/** Apply the last key written to IWDG->KR */
+static void iwdg_poll(void)
+{
+    uint32_t key = iwdg_regs.KR;
+
+    if (key == SIM_IWDG_KEY_START) {
+        iwdg_running = 1;
+    }
+    if (key == SIM_IWDG_KEY_START || (key == SIM_IWDG_KEY_REFRESH && iwdg_running)) {
+        uint64_t ticks = (iwdg_regs.RLR & 0xFFFU) + 1ULL;
+        iwdg_deadline = sim_now_ns() + ticks * (4ULL << (iwdg_regs.PR & 7U)) * 1000000000ULL / SIM_LSI_HZ;
+    }
+    iwdg_regs.KR = 0;
+}
+
+IWDG_TypeDef *sim_iwdg(void)
+{
+    iwdg_poll();
+    return &iwdg_regs;
+}
+
+uint32_t sim_iwdg_expiries(void)
+{
+    return iwdg_expiries;
+}
+
+uint32_t sim_rcc_get_flag(uint32_t flag)
+{
+    return (reset_flag == flag) ? 1U : 0U;
+}
+
+void sim_rcc_clear_reset_flags(void)
+{
+    reset_flag = 0;
+}
+
+void sim_rcc_set_reset_flag(uint32_t flag)
+{
+    reset_flag = flag;
+}
+
+void HAL_PWR_EnableBkUpAccess(void)
+{
+}
+
+/*============================================================================
+ * Interrupt Engine
+ *===========================================================================*/
+
+/** Earliest pending event and its source */
+static uint64_t next_event(event_kind_t *kind, uint8_t *index)
+{
+    uint64_t best = UINT64_MAX;
+
+    *kind = EVENT_NONE;
+    iwdg_poll();
+
+    for (uint8_t i = 0; i < SIM_TIM_COUNT; i++) {
+        tim_catch_up(&tims[i]);
+        if (tim_listened(&tims[i]) && tims[i].next_update < best) {
+            best = tims[i].next_update;
+            *kind = EVENT_TIM;
+            *index = i;
+        }
+    }
+    for (uint8_t i = 0; i < SIM_UART_COUNT; i++) {
+        sim_uart_t *u = &uarts[i];
+        if (u->handle == NULL) {
+            continue;
+        }
+        if (u->handle->gState == HAL_UART_STATE_BUSY_TX && u->tx_end < best) {
+            best = u->tx_end;
+            *kind = EVENT_UART_TX;
+            *index = i;
+        }
+        if (u->wire_count != 0 && u->wire[u->wire_head].ns < best) {
+            best = u->wire[u->wire_head].ns;
+            *kind = EVENT_UART_RX_BYTE;
+            *index = i;
+        }
+        if (u->idle_ns != 0 && u->idle_ns < best
+                && (u->wire_count == 0 || u->wire[u->wire_head].ns > u->idle_ns)) {
+            best = u->idle_ns;
+            *kind = EVENT_UART_RX_IDLE;
+            *index = i;
+        }
+    }
+    if (iwdg_running && iwdg_deadline < best) {
+        best = iwdg_deadline;
+        *kind = EVENT_IWDG;
+    }
+    return best;
+}
+
+uint64_t sim_hal_next_event_ns(void)
+{
+    event_kind_t kind;
+    uint8_t index = 0;
+
+    return next_event(&kind, &index);
+}
+
+uint32_t sim_hal_run_due(void)
+{
+    uint32_t fired = 0;
+    event_kind_t kind;
+    uint8_t index = 0;
+
+    while (next_event(&kind, &index) <= sim_now_ns()) {
+        switch (kind) {
+            case EVENT_TIM:
+                tim_update(&tims[index]);
+                break;
+            case EVENT_UART_TX:
+                uart_tx_done(&uarts[index]);
+                break;
+            case EVENT_UART_RX_BYTE:
+                uart_rx_byte(&uarts[index]);
+                break;
+            case EVENT_UART_RX_IDLE:
+                uart_rx_idle(&uarts[index]);
+                break;
+            case EVENT_IWDG:
+                // The target resets here; the simulation counts it and goes on
+                iwdg_expiries++;
+                fprintf(stderr, "hal_sim: IWDG expired at %llu ms\n",
+                        (unsigned long long)(iwdg_deadline / SIM_NS_PER_MS));
+                iwdg_regs.KR = SIM_IWDG_KEY_REFRESH;
+                iwdg_poll();
+                break;
+            default:
+                return fired;
+        }
+        fired++;
+    }
+    return fired;
+}
+
+uint32_t sim_tim_updates(TIM_HandleTypeDef *htim)
+{
+    return tim_state(htim->Instance)->updates;
+}
@@ -0,0 +1,83 @@
+/**
+ ******************************************************************************
+ * @file           : FreeRTOSConfig.h
+ * @brief          : FreeRTOS Configuration for the Host Simulation Build
+ ******************************************************************************
+ * @description
+ * Mirrors includes/FreeRTOSConfig.h (tick rate, priorities, hooks, run-time
+ * stats on the DWT counter) for the Linux build in sim/. Differences:
+ * - configUSE_TICKLESS_IDLE 0: low_power.c (RTC, STOP mode) is not built
+ * - configASSERT reports the file and line and aborts the process
+ * - No Cortex-M interrupt priority settings
+ *
+ * Used by both kernels of the host build: the in-tree simulation kernel
+ * (sim/kernel) and the FreeRTOS POSIX port (FREERTOS_KERNEL_PATH).
+ ******************************************************************************
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <stdint.h>
+extern uint32_t SystemCoreClock;
+void runtime_stats_timer_init(void);
+uint32_t runtime_stats_counter(void);
+void sim_assert_failed(const char *file, int line);
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_IDLE_HOOK                     1
+#define configUSE_TICK_HOOK                     0
+#define configCPU_CLOCK_HZ                      ( SystemCoreClock )
+#define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
+#define configMAX_PRIORITIES                    ( 5 )
+#define configMINIMAL_STACK_SIZE                ( ( unsigned short ) 130 )
+#define configTOTAL_HEAP_SIZE                   ( ( size_t ) ( 50 * 1024 ) )
+#define configMAX_TASK_NAME_LEN                 ( 16 )
+#define configUSE_TRACE_FACILITY                1
+#define configUSE_16_BIT_TICKS                  0
+#define configIDLE_SHOULD_YIELD                 1
+#define configUSE_MUTEXES                       1
+#define configQUEUE_REGISTRY_SIZE               8
+#define configCHECK_FOR_STACK_OVERFLOW          0
+#define configUSE_RECURSIVE_MUTEXES             1
+#define configUSE_MALLOC_FAILED_HOOK            1
+#define configUSE_APPLICATION_TASK_TAG          0
+#define configUSE_COUNTING_SEMAPHORES           1
+#define configSUPPORT_STATIC_ALLOCATION         0
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+#define configGENERATE_RUN_TIME_STATS           1
+
+/* Run time stats clock: the shim's DWT counter (simulated 168 MHz) */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    runtime_stats_timer_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()            runtime_stats_counter()
+
+/* No tickless idle on the host (low_power.c is target only) */
+#define configUSE_TICKLESS_IDLE                 0
+
+/* Co-routine definitions. */
+#define configUSE_CO_ROUTINES                   0
+#define configMAX_CO_ROUTINE_PRIORITIES         ( 2 )
+
+/* Software timer definitions. */
+#define configUSE_TIMERS                        1
+#define configTIMER_TASK_PRIORITY               ( 2 )
+#define configTIMER_QUEUE_LENGTH                10
+#define configTIMER_TASK_STACK_DEPTH            ( configMINIMAL_STACK_SIZE * 2 )
+
+#define INCLUDE_vTaskPrioritySet                1
+#define INCLUDE_uxTaskPriorityGet               1
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskCleanUpResources           1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_vTaskDelayUntil                 1
+#define INCLUDE_xTaskDelayUntil                 1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_xTaskGetIdleTaskHandle          1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+#define INCLUDE_pxTaskGetStackStart             1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+
+/* Reports the failed expression's location and aborts (ctest sees the crash) */
+#define configASSERT( x ) if( ( x ) == 0 ) { sim_assert_failed( __FILE__, __LINE__ ); }
+
+#endif /* FREERTOS_CONFIG_H */
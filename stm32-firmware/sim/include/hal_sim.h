@@ -0,0 +1,233 @@
+/**
+ ******************************************************************************
+ * @file           : hal_sim.h
+ * @brief          : HAL Shim Control - Clock, Interrupts, UART Peers, Pin Log
+ ******************************************************************************
+ * @description
+ * What a test or led_sim uses to drive the simulated board (hal_sim.c).
+ *
+ * Clock:
+ * Nanoseconds since boot. Manual by default: the simulation kernel moves
+ * it to the next deadline while every task is blocked. With the FreeRTOS
+ * POSIX port it follows CLOCK_MONOTONIC instead (sim_clock_use_realtime).
+ *
+ * Interrupts:
+ * Peripheral events (timer updates, UART bytes, IDLE, DMA half/complete,
+ * TX complete) are queued with their due time. The kernel asks for the
+ * next one and fires whatever is due (sim_hal_run_due), which calls the
+ * HAL callbacks exactly as the IRQ handlers would.
+ *
+ * UART Peers:
+ * sim_uart_rx() puts bytes on the wire towards the MCU; they arrive one
+ * character time apart (10 bits at Init.BaudRate, 115200 if unset). What
+ * the MCU transmits can be read back with sim_uart_tx_read() byte by byte
+ * as it shifts out; a file descriptor or the TX hook gets each transfer
+ * when it completes.
+ *
+ * Pin Log:
+ * Each level change of a GPIO output or a TIM4 PWM channel (PD12-PD15)
+ * is appended with its time; PWM entries carry the compare value, GPIO
+ * entries 0 / 1.
+ ******************************************************************************
+ */
+
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+#include "stm32f4xx_hal.h"
+#include <stdio.h>
+
+/*============================================================================
+ * Clock
+ *===========================================================================*/
+
+#define SIM_NS_PER_MS       1000000ULL
+#define SIM_NS_PER_US       1000ULL
+
+/** APB1 timer clock (TIM4, TIM7) */
+#define SIM_TIM_CLOCK_HZ    84000000ULL
+
+/**
+ * @brief  Current simulated time
+ * @retval Nanoseconds since boot
+ */
+uint64_t sim_now_ns(void);
+
+/**
+ * @brief  Move the manual clock forward (never backwards)
+ * @param  ns: New time
+ * @retval None
+ */
+void sim_clock_advance_to(uint64_t ns);
+
+/**
+ * @brief  Follow CLOCK_MONOTONIC from now on (FreeRTOS POSIX port)
+ * @retval None
+ */
+void sim_clock_use_realtime(void);
+
+/**
+ * @brief  Count DWT->CYCCNT on the host's CLOCK_MONOTONIC from now on
+ * @retval None
+ * @note   The simulated clock stands still while task code runs, so cycle
+ *         counts taken around code (ESP8266_COMM_PROFILE) read 0 on it;
+ *         on the host clock they show what the code costs on this machine,
+ *         scaled to SystemCoreClock
+ */
+void sim_dwt_use_host_clock(void);
+
+/*============================================================================
+ * Interrupt Engine
+ *===========================================================================*/
+
+/**
+ * @brief  Time of the earliest pending peripheral event
+ * @retval Nanoseconds, or UINT64_MAX if nothing is pending
+ */
+uint64_t sim_hal_next_event_ns(void);
+
+/**
+ * @brief  Fire every peripheral event due at sim_now_ns(), in time order
+ * @retval Number of events fired
+ * @note   Runs the HAL callbacks (interrupt context for the firmware)
+ */
+uint32_t sim_hal_run_due(void);
+
+/**
+ * @brief  Update interrupts a timer has delivered since boot
+ * @param  htim: Timer handle
+ * @retval Count (HAL_TIM_PeriodElapsedCallback calls)
+ */
+uint32_t sim_tim_updates(TIM_HandleTypeDef *htim);
+
+/*============================================================================
+ * UART Peers
+ *===========================================================================*/
+
+/**
+ * @brief  Send bytes to the MCU (they follow any bytes still on the wire)
+ * @param  huart: Receiving UART
+ * @param  data: Bytes
+ * @param  len: Number of bytes
+ * @retval Time the last byte's stop bit ends (ns)
+ */
+uint64_t sim_uart_rx(UART_HandleTypeDef *huart, const void *data, size_t len);
+
+/**
+ * @brief  Bytes sent to the MCU that are still on the wire
+ * @param  huart: Receiving UART
+ * @retval Byte count
+ */
+size_t sim_uart_rx_pending(UART_HandleTypeDef *huart);
+
+/**
+ * @brief  Bytes the MCU dropped because reception was not armed (overrun)
+ * @param  huart: Receiving UART
+ * @retval Byte count since boot
+ */
+uint32_t sim_uart_rx_overruns(UART_HandleTypeDef *huart);
+
+/**
+ * @brief  RX interrupts that reached the HAL callbacks: IDLE line and DMA
+ *         half/complete events in DMA mode, one per byte in IT mode
+ * @param  huart: Receiving UART
+ * @retval Count since boot
+ */
+uint32_t sim_uart_rx_isrs(UART_HandleTypeDef *huart);
+
+/**
+ * @brief  Take bytes the MCU has transmitted so far (a transfer in flight
+ *         is read byte by byte as it shifts out)
+ * @param  huart: Transmitting UART
+ * @param  buf: Destination (NULL to discard)
+ * @param  max: Destination size
+ * @retval Bytes copied
+ */
+size_t sim_uart_tx_read(UART_HandleTypeDef *huart, void *buf, size_t max);
+
+/**
+ * @brief  Also write finished TX bytes to a file descriptor (PTY, stdout)
+ * @param  huart: Transmitting UART
+ * @param  fd: Descriptor, -1 to stop
+ * @retval None
+ */
+void sim_uart_set_sink(UART_HandleTypeDef *huart, int fd);
+
+/** Hook called for every finished transfer (e.g. to timestamp ACKs) */
+typedef void (*sim_uart_tx_hook_t)(UART_HandleTypeDef *huart, const uint8_t *data, size_t len);
+
+/**
+ * @brief  Set the TX hook (NULL to remove)
+ * @param  hook: Called with the bytes as the transfer completes
+ * @retval None
+ */
+void sim_uart_set_tx_hook(sim_uart_tx_hook_t hook);
+
+/*============================================================================
+ * Pin Log
+ *===========================================================================*/
+
+/** One output level change */
+typedef struct {
+    uint64_t ns;                /**< Time of the change */
+    char port;                  /**< 'A'..'H' */
+    uint8_t pin;                /**< 0..15 */
+    uint16_t value;             /**< GPIO: 0 / 1, PWM: compare value */
+} sim_pin_event_t;
+
+/**
+ * @brief  Number of logged level changes
+ * @retval Count
+ */
+size_t sim_pin_log_count(void);
+
+/**
+ * @brief  One logged level change
+ * @param  index: 0 .. sim_pin_log_count() - 1
+ * @retval Event
+ */
+const sim_pin_event_t *sim_pin_log_get(size_t index);
+
+/**
+ * @brief  Forget the logged changes (levels are kept)
+ * @retval None
+ */
+void sim_pin_log_clear(void);
+
+/**
+ * @brief  Also print each change as "<ns> P<port><pin> <value>" to a file
+ * @param  file: Output, NULL to stop
+ * @retval None
+ */
+void sim_pin_log_set_sink(FILE *file);
+
+/**
+ * @brief  Current level of an output
+ * @retval GPIO: 0 / 1, PWM: compare value
+ */
+uint16_t sim_pin_level(char port, uint8_t pin);
+
+/*============================================================================
+ * Reset State
+ *===========================================================================*/
+
+/**
+ * @brief  Set the RCC reset flags seen by the next boot
+ * @param  flag: RCC_FLAG_xxx that caused the reset (0 = power-on)
+ * @retval None
+ */
+void sim_rcc_set_reset_flag(uint32_t flag);
+
+/**
+ * @brief  IWDG expiries since boot (the target would have reset)
+ * @retval Count
+ */
+uint32_t sim_iwdg_expiries(void);
+
+/**
+ * @brief  Erase the simulated config sectors (blank flash)
+ * @retval None
+ */
+void sim_flash_erase_all(void);
+
+#endif /* HAL_SIM_H */
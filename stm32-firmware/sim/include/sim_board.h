@@ -0,0 +1,33 @@
+/**
+ ******************************************************************************
+ * @file           : sim_board.h
+ * @brief          : Simulated Discovery Board - Handles and Boot Sequence
+ ******************************************************************************
+ * @description
+ * The parts of main.c and stm32f4xx_hal_msp.c that the host build needs:
+ * UART handles with their DMA streams linked, the HAL callbacks that fan
+ * out to the modules, the FreeRTOS hooks, and main()'s init sequence up
+ * to (not including) the endless scheduler run.
+ ******************************************************************************
+ */
+
+#ifndef SIM_BOARD_H
+#define SIM_BOARD_H
+
+#include "main.h"
+
+extern UART_HandleTypeDef huart2;      /**< ESP8266 link */
+extern UART_HandleTypeDef huart3;      /**< Debug log */
+
+/**
+ * @brief  Run main()'s init sequence, up to vTaskStartScheduler()
+ * @retval None
+ * @note   Same order as main.c (config store, LED effects + restore,
+ *         print task + log level, ESP8266 comm, watchdog) without the
+ *         LED blink test and low_power_init(). The caller starts the
+ *         scheduler: with the simulation kernel it returns at once and
+ *         tasks run in sim_kernel_run_until().
+ */
+void sim_board_boot(void);
+
+#endif /* SIM_BOARD_H */
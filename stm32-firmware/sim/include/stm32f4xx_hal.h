@@ -0,0 +1,448 @@
+/**
+ ******************************************************************************
+ * @file           : stm32f4xx_hal.h
+ * @brief          : HAL Shim for the Host Simulation Build
+ ******************************************************************************
+ * @description
+ * Replaces the CubeMX HAL and CMSIS headers for the Linux build in sim/.
+ * Declares the subset of types, registers, macros and functions that the
+ * firmware modules use, with the HAL's names, so src/ compiles unchanged.
+ * hal_sim.c implements them on a simulated clock (hal_sim.h).
+ *
+ * Peripherals:
+ * ┌──────────────┬──────────────────────────────────────────────────────┐
+ * │ Peripheral   │ Simulation                                           │
+ * ├──────────────┼──────────────────────────────────────────────────────┤
+ * │ USART2/3     │ TX bytes reach the peer one character time apart     │
+ * │              │ (capture buffer, optional file descriptor); RX by    │
+ * │              │ sim_uart_rx() through circular DMA + IDLE or per-byte│
+ * │              │ interrupts                                           │
+ * │ TIM4, TIM7   │ Counters derived from the clock, update events, UIF, │
+ * │              │ one-pulse mode, TIM4 CC1 DMA bursts into CCR1-4      │
+ * │ GPIO, CCRx   │ Every level change logged with a timestamp           │
+ * │ Flash        │ Sectors 10-11 mapped at their real addresses: program│
+ * │              │ clears bits, erase sets them                         │
+ * │ IWDG, RTC    │ IWDG expiry counted; backup registers kept in RAM    │
+ * │ DWT          │ CYCCNT = simulated time at 168 MHz                   │
+ * └──────────────┴──────────────────────────────────────────────────────┘
+ *
+ * Register writes with a side effect in time (TIM enable, counter, compare)
+ * go through the __HAL_TIM_xxx macros, which call into hal_sim.c. Plain
+ * register accesses to DWT and IWDG go through an accessor so the shim can
+ * refresh / observe them.
+ ******************************************************************************
+ */
+
+#ifndef __STM32F4xx_HAL_H
+#define __STM32F4xx_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*============================================================================
+ * Core
+ *===========================================================================*/
+
+#define __IO volatile
+
+typedef enum {
+    HAL_OK       = 0x00U,
+    HAL_ERROR    = 0x01U,
+    HAL_BUSY     = 0x02U,
+    HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum {
+    RESET = 0U,
+    SET = !RESET
+} FlagStatus, ITStatus;
+
+#define HAL_MAX_DELAY      0xFFFFFFFFU
+
+extern uint32_t SystemCoreClock;
+
+/** Debug cycle counter (DWT), counting at SystemCoreClock on the simulated clock */
+typedef struct {
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+DWT_Type *sim_dwt(void);
+extern CoreDebug_Type sim_core_debug;
+
+#define DWT                         (sim_dwt())
+#define CoreDebug                   (&sim_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+void __disable_irq(void);
+void __enable_irq(void);
+
+void HAL_Delay(uint32_t Delay);
+uint32_t HAL_GetTick(void);
+
+void Error_Handler(void);
+
+/*============================================================================
+ * Flash
+ *===========================================================================*/
+
+/*
+ * FLASH_BASE..FLASH_END bound the process image's code and constants, which
+ * is where string literals live (in flash on the target): print_task.c
+ * queues such strings by pointer. The config store sectors (10, 11) are
+ * mapped separately at 0x080C0000 / 0x080E0000 (hal_sim.c).
+ */
+extern const char __executable_start[];
+extern const char __data_start[];
+#define FLASH_BASE      ((uintptr_t)__executable_start)
+#define FLASH_END       ((uintptr_t)__data_start - 1U)
+
+typedef struct {
+    uint32_t TypeErase;
+    uint32_t Banks;
+    uint32_t Sector;
+    uint32_t NbSectors;
+    uint32_t VoltageRange;
+} FLASH_EraseInitTypeDef;
+
+#define FLASH_TYPEERASE_SECTORS     0x00U
+#define FLASH_TYPEPROGRAM_BYTE      0x00U
+#define FLASH_TYPEPROGRAM_HALFWORD  0x01U
+#define FLASH_TYPEPROGRAM_WORD      0x02U
+#define FLASH_TYPEPROGRAM_DOUBLEWORD 0x03U
+#define FLASH_VOLTAGE_RANGE_3       0x02U
+#define FLASH_SECTOR_10             10U
+#define FLASH_SECTOR_11             11U
+
+#define FLASH_FLAG_EOP              0x01U
+#define FLASH_FLAG_OPERR            0x02U
+#define FLASH_FLAG_WRPERR           0x10U
+#define FLASH_FLAG_PGAERR           0x20U
+#define FLASH_FLAG_PGPERR           0x40U
+#define FLASH_FLAG_PGSERR           0x80U
+#define __HAL_FLASH_CLEAR_FLAG(flag) ((void)(flag))
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError);
+
+/*============================================================================
+ * GPIO
+ *===========================================================================*/
+
+typedef struct {
+    __IO uint32_t ODR;
+    char name;                  /**< 'A'.. for the pin log */
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+extern GPIO_TypeDef sim_gpio[8];
+#define GPIOA   (&sim_gpio[0])
+#define GPIOB   (&sim_gpio[1])
+#define GPIOC   (&sim_gpio[2])
+#define GPIOD   (&sim_gpio[3])
+#define GPIOE   (&sim_gpio[4])
+#define GPIOH   (&sim_gpio[7])
+
+#define GPIO_PIN_0      ((uint16_t)0x0001)
+#define GPIO_PIN_1      ((uint16_t)0x0002)
+#define GPIO_PIN_2      ((uint16_t)0x0004)
+#define GPIO_PIN_3      ((uint16_t)0x0008)
+#define GPIO_PIN_4      ((uint16_t)0x0010)
+#define GPIO_PIN_5      ((uint16_t)0x0020)
+#define GPIO_PIN_6      ((uint16_t)0x0040)
+#define GPIO_PIN_7      ((uint16_t)0x0080)
+#define GPIO_PIN_8      ((uint16_t)0x0100)
+#define GPIO_PIN_9      ((uint16_t)0x0200)
+#define GPIO_PIN_10     ((uint16_t)0x0400)
+#define GPIO_PIN_11     ((uint16_t)0x0800)
+#define GPIO_PIN_12     ((uint16_t)0x1000)
+#define GPIO_PIN_13     ((uint16_t)0x2000)
+#define GPIO_PIN_14     ((uint16_t)0x4000)
+#define GPIO_PIN_15     ((uint16_t)0x8000)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+/*============================================================================
+ * DMA
+ *===========================================================================*/
+
+/** Address registers are pointer-wide here: they hold host addresses */
+typedef struct {
+    __IO uint32_t CR;
+    __IO uint32_t NDTR;
+    __IO uintptr_t PAR;
+    __IO uintptr_t M0AR;
+    uint32_t length;            /**< NDTR as programmed (circular reload), shim only */
+} DMA_Stream_TypeDef;
+
+#define DMA_SxCR_EN         (1UL << 0)
+#define DMA_SxCR_HTIE       (1UL << 3)
+#define DMA_SxCR_TCIE       (1UL << 4)
+#define DMA_SxCR_CIRC       (1UL << 8)
+#define DMA_IT_TC           DMA_SxCR_TCIE
+#define DMA_IT_HT           DMA_SxCR_HTIE
+#define DMA_NORMAL          0x00000000U
+#define DMA_CIRCULAR        DMA_SxCR_CIRC
+
+typedef struct {
+    uint32_t Mode;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef {
+    DMA_Stream_TypeDef *Instance;
+    DMA_InitTypeDef Init;
+    void *Parent;
+    void (*XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+    void (*XferHalfCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+} DMA_HandleTypeDef;
+
+#define __HAL_DMA_GET_COUNTER(h)        ((h)->Instance->NDTR)
+#define __HAL_DMA_ENABLE_IT(h, it)      ((h)->Instance->CR |= (it))
+#define __HAL_DMA_DISABLE_IT(h, it)     ((h)->Instance->CR &= ~(it))
+
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uintptr_t SrcAddress,
+                                   uintptr_t DstAddress, uint32_t DataLength);
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+
+/*============================================================================
+ * UART
+ *===========================================================================*/
+
+typedef struct {
+    __IO uint32_t SR;
+    __IO uint32_t DR;
+} USART_TypeDef;
+
+extern USART_TypeDef sim_usart2;
+extern USART_TypeDef sim_usart3;
+#define USART2  (&sim_usart2)
+#define USART3  (&sim_usart3)
+
+typedef struct {
+    uint32_t BaudRate;
+} UART_InitTypeDef;
+
+typedef uint32_t HAL_UART_StateTypeDef;
+#define HAL_UART_STATE_RESET        0x00U
+#define HAL_UART_STATE_READY        0x20U
+#define HAL_UART_STATE_BUSY_TX      0x21U
+#define HAL_UART_STATE_BUSY_RX      0x22U
+#define HAL_UART_STATE_BUSY         0x24U
+
+typedef struct __UART_HandleTypeDef {
+    USART_TypeDef *Instance;
+    UART_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    __IO HAL_UART_StateTypeDef gState;
+    __IO HAL_UART_StateTypeDef RxState;
+} UART_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData,
+                                    uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+
+/* Weak callbacks (the application overrides them) */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
+
+/*============================================================================
+ * Timers
+ *===========================================================================*/
+
+typedef struct {
+    __IO uint32_t CR1;
+    __IO uint32_t CR2;
+    __IO uint32_t SMCR;
+    __IO uint32_t DIER;
+    __IO uint32_t SR;
+    __IO uint32_t EGR;
+    __IO uint32_t CCMR1;
+    __IO uint32_t CCMR2;
+    __IO uint32_t CCER;
+    __IO uint32_t CNT;
+    __IO uint32_t PSC;
+    __IO uint32_t ARR;
+    __IO uint32_t RCR;
+    __IO uint32_t CCR1;
+    __IO uint32_t CCR2;
+    __IO uint32_t CCR3;
+    __IO uint32_t CCR4;
+    __IO uint32_t BDTR;
+    __IO uint32_t DCR;
+    __IO uint32_t DMAR;
+} TIM_TypeDef;
+
+extern TIM_TypeDef sim_tim4;
+extern TIM_TypeDef sim_tim6;
+extern TIM_TypeDef sim_tim7;
+#define TIM4    (&sim_tim4)
+#define TIM6    (&sim_tim6)
+#define TIM7    (&sim_tim7)
+
+#define TIM_CR1_CEN             (1UL << 0)
+#define TIM_CR1_OPM             (1UL << 3)
+#define TIM_CR1_ARPE            (1UL << 7)
+#define TIM_CR2_CCDS            (1UL << 3)
+#define TIM_DCR_DBL_Pos         8U
+#define TIM_SR_UIF              (1UL << 0)
+#define TIM_DIER_UIE            (1UL << 0)
+#define TIM_DIER_CC1DE          (1UL << 9)
+
+#define TIM_FLAG_UPDATE         TIM_SR_UIF
+#define TIM_IT_UPDATE           TIM_DIER_UIE
+#define TIM_DMA_CC1             TIM_DIER_CC1DE
+
+#define TIM_CHANNEL_1           0x00000000U
+#define TIM_CHANNEL_2           0x00000004U
+#define TIM_CHANNEL_3           0x00000008U
+#define TIM_CHANNEL_4           0x0000000CU
+
+#define TIM_DMA_ID_UPDATE       ((uint16_t)0x0000)
+#define TIM_DMA_ID_CC1          ((uint16_t)0x0001)
+#define TIM_DMA_ID_CC2          ((uint16_t)0x0002)
+#define TIM_DMA_ID_CC3          ((uint16_t)0x0003)
+#define TIM_DMA_ID_CC4          ((uint16_t)0x0004)
+#define TIM_DMA_ID_COMMUTATION  ((uint16_t)0x0005)
+#define TIM_DMA_ID_TRIGGER      ((uint16_t)0x0006)
+
+#define TIM_COUNTERMODE_UP              0x00000000U
+#define TIM_CLOCKDIVISION_DIV1          0x00000000U
+#define TIM_AUTORELOAD_PRELOAD_DISABLE  0x00000000U
+#define TIM_AUTORELOAD_PRELOAD_ENABLE   TIM_CR1_ARPE
+#define TIM_OCMODE_PWM1                 0x00000060U
+#define TIM_OCPOLARITY_HIGH             0x00000000U
+#define TIM_OCFAST_DISABLE              0x00000000U
+
+typedef struct {
+    uint32_t Prescaler;
+    uint32_t CounterMode;
+    uint32_t Period;
+    uint32_t ClockDivision;
+    uint32_t RepetitionCounter;
+    uint32_t AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct {
+    uint32_t OCMode;
+    uint32_t Pulse;
+    uint32_t OCPolarity;
+    uint32_t OCNPolarity;
+    uint32_t OCFastMode;
+    uint32_t OCIdleState;
+    uint32_t OCNIdleState;
+} TIM_OC_InitTypeDef;
+
+typedef struct {
+    TIM_TypeDef *Instance;
+    TIM_Base_InitTypeDef Init;
+    DMA_HandleTypeDef *hdma[7];
+} TIM_HandleTypeDef;
+
+/* Register accesses that start, stop or re-time a counter */
+void sim_tim_enable(TIM_TypeDef *tim);
+void sim_tim_disable(TIM_TypeDef *tim);
+void sim_tim_set_counter(TIM_TypeDef *tim, uint32_t value);
+uint32_t sim_tim_get_counter(TIM_TypeDef *tim);
+void sim_tim_set_autoreload(TIM_TypeDef *tim, uint32_t value);
+uint32_t sim_tim_get_flags(TIM_TypeDef *tim);
+void sim_tim_set_compare(TIM_TypeDef *tim, uint32_t channel, uint32_t value);
+
+#define __HAL_TIM_ENABLE(h)                 sim_tim_enable((h)->Instance)
+#define __HAL_TIM_DISABLE(h)                sim_tim_disable((h)->Instance)
+#define __HAL_TIM_SET_COUNTER(h, v)         sim_tim_set_counter((h)->Instance, (v))
+#define __HAL_TIM_GET_COUNTER(h)            sim_tim_get_counter((h)->Instance)
+#define __HAL_TIM_SET_AUTORELOAD(h, v)      sim_tim_set_autoreload((h)->Instance, (v))
+#define __HAL_TIM_GET_AUTORELOAD(h)         ((h)->Instance->ARR)
+#define __HAL_TIM_GET_FLAG(h, f)            ((sim_tim_get_flags((h)->Instance) & (f)) == (f))
+#define __HAL_TIM_CLEAR_FLAG(h, f)          ((h)->Instance->SR = ~(uint32_t)(f))
+#define __HAL_TIM_ENABLE_IT(h, it)          ((h)->Instance->DIER |= (it))
+#define __HAL_TIM_DISABLE_IT(h, it)         ((h)->Instance->DIER &= ~(it))
+#define __HAL_TIM_ENABLE_DMA(h, d)          ((h)->Instance->DIER |= (d))
+#define __HAL_TIM_DISABLE_DMA(h, d)         ((h)->Instance->DIER &= ~(d))
+#define __HAL_TIM_SET_COMPARE(h, ch, v)     sim_tim_set_compare((h)->Instance, (ch), (v))
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim, TIM_OC_InitTypeDef *sConfig,
+                                            uint32_t Channel);
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel);
+void HAL_TIM_IRQHandler(TIM_HandleTypeDef *htim);
+
+/* Weak MSP hooks, called by the Init functions (sim_board.c links the DMA) */
+void HAL_TIM_Base_MspInit(TIM_HandleTypeDef *htim);
+void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+/*============================================================================
+ * IWDG, RTC backup registers, RCC, PWR
+ *===========================================================================*/
+
+typedef struct {
+    __IO uint32_t KR;
+    __IO uint32_t PR;
+    __IO uint32_t RLR;
+    __IO uint32_t SR;
+} IWDG_TypeDef;
+
+typedef struct {
+    __IO uint32_t BKP0R;
+    __IO uint32_t BKP1R;
+    __IO uint32_t BKP2R;
+    __IO uint32_t BKP3R;
+    __IO uint32_t BKP4R;
+    __IO uint32_t BKP5R;
+    __IO uint32_t BKP6R;
+    __IO uint32_t BKP7R;
+} RTC_TypeDef;
+
+IWDG_TypeDef *sim_iwdg(void);
+extern RTC_TypeDef sim_rtc;
+#define IWDG    (sim_iwdg())
+#define RTC     (&sim_rtc)
+
+#define RCC_FLAG_PINRST     0x7AU
+#define RCC_FLAG_PORRST     0x7BU
+#define RCC_FLAG_SFTRST     0x7CU
+#define RCC_FLAG_IWDGRST    0x7DU
+#define RCC_FLAG_WWDGRST    0x7EU
+
+uint32_t sim_rcc_get_flag(uint32_t flag);
+void sim_rcc_clear_reset_flags(void);
+
+#define __HAL_RCC_GET_FLAG(flag)        sim_rcc_get_flag(flag)
+#define __HAL_RCC_CLEAR_RESET_FLAGS()   sim_rcc_clear_reset_flags()
+#define __HAL_RCC_PWR_CLK_ENABLE()      ((void)0)
+#define __HAL_DBGMCU_FREEZE_IWDG()      ((void)0)
+
+void HAL_PWR_EnableBkUpAccess(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32F4xx_HAL_H */
@@ -0,0 +1,58 @@
+/**
+ ******************************************************************************
+ * @file           : FreeRTOS.h
+ * @brief          : Simulation Kernel - Base Types and Configuration
+ ******************************************************************************
+ * @description
+ * Deterministic stand-in for the FreeRTOS kernel, used by the host tests
+ * and by led_sim when no FreeRTOS-Kernel checkout is given (see
+ * sim_kernel.c). Provides the subset of the FreeRTOS API the firmware
+ * modules use, with the same names, types and semantics.
+ ******************************************************************************
+ */
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FreeRTOSConfig.h"
+
+/** Tells sim/ code which kernel it is built against */
+#define SIM_KERNEL              1
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE                 ( ( BaseType_t ) 0 )
+#define pdTRUE                  ( ( BaseType_t ) 1 )
+#define pdPASS                  ( pdTRUE )
+#define pdFAIL                  ( pdFALSE )
+
+#define portMAX_DELAY           ( ( TickType_t ) 0xFFFFFFFFUL )
+#define portTICK_PERIOD_MS      ( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+
+#define pdMS_TO_TICKS( xTimeInMs ) \
+    ( ( TickType_t ) ( ( ( uint64_t ) ( xTimeInMs ) * ( uint64_t ) configTICK_RATE_HZ ) / ( uint64_t ) 1000U ) )
+#define pdTICKS_TO_MS( xTimeInTicks ) \
+    ( ( TickType_t ) ( ( ( uint64_t ) ( xTimeInTicks ) * ( uint64_t ) 1000U ) / ( uint64_t ) configTICK_RATE_HZ ) )
+
+/* Interrupts only fire between task steps (sim_kernel.c), so masking them
+ * is bookkeeping: nesting is tracked to catch blocking inside a section. */
+void sim_kernel_enter_critical(void);
+void sim_kernel_exit_critical(void);
+void sim_kernel_yield_from_isr(BaseType_t woken);
+
+#define portYIELD_FROM_ISR( x )         sim_kernel_yield_from_isr( x )
+#define portEND_SWITCHING_ISR( x )      sim_kernel_yield_from_isr( x )
+#define portDISABLE_INTERRUPTS()        sim_kernel_enter_critical()
+#define portENABLE_INTERRUPTS()         sim_kernel_exit_critical()
+
+void *pvPortMalloc(size_t xWantedSize);
+void vPortFree(void *pv);
+size_t xPortGetFreeHeapSize(void);
+size_t xPortGetMinimumEverFreeHeapSize(void);
+
+#endif /* INC_FREERTOS_H */
@@ -0,0 +1,892 @@
+/**
+ ******************************************************************************
+ * @file           : sim_kernel.c
+ * @brief          : Simulation Kernel - Deterministic FreeRTOS Subset
+ ******************************************************************************
+ * @description
+ * Implements the FreeRTOS API declared in FreeRTOS.h, task.h and
+ * stream_buffer.h for the host build (see sim_kernel.h for the model).
+ *
+ * Scheduler:
+ * Each task runs on its own ucontext stack; the scheduler loop in
+ * sim_kernel_run_until() is the only place that switches:
+ * 1. Fire due peripheral events (sim_hal_run_due, interrupt context)
+ * 2. Wake tasks whose timeout has passed
+ * 3. Resume the highest-priority ready task until it blocks or yields
+ *    (ties: longest ready first)
+ * 4. Nothing ready: call the idle hook, let the clock jump to the next
+ *    timeout or peripheral event (idle wait)
+ *
+ * Differences from the target kernel:
+ * - Task code takes no simulated time: the IDLE task is charged every
+ *   idle wait, the other tasks' run-time counters stay 0 (runtime_stats.h)
+ * - usStackHighWaterMark reports the configured depth: host frames say
+ *   nothing about the Cortex-M stack use
+ * - The heap is accounted against configTOTAL_HEAP_SIZE (heap_4 block
+ *   rounding) but served by malloc()
+ ******************************************************************************
+ */
+
+#define _GNU_SOURCE
+#include "sim_kernel.h"
+#include "task.h"
+#include "hal_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+/*============================================================================
+ * Private Definitions
+ *===========================================================================*/
+
+/** Host stack per task (x86-64 frames, printf) */
+#define SIM_TASK_STACK_BYTES    (256U * 1024U)
+
+/** Heap cost of a task control block on the target */
+#define SIM_TCB_BYTES           96U
+
+/** heap_4 block header and alignment */
+#define SIM_HEAP_HEADER_BYTES   8U
+#define SIM_HEAP_ALIGN          8U
+
+#define SIM_NO_TIMEOUT          UINT64_MAX
+
+typedef enum {
+    WAIT_NONE = 0,
+    WAIT_DELAY,
+    WAIT_NOTIFY,
+    WAIT_STREAM
+} wait_reason_t;
+
+typedef enum {
+    NOTIFY_NONE = 0,
+    NOTIFY_WAITING,
+    NOTIFY_RECEIVED
+} notify_state_t;
+
+/*============================================================================
+ * Private Types
+ *===========================================================================*/
+
+struct sim_task {
+    ucontext_t ctx;
+    void *stack;
+    TaskFunction_t code;
+    void *params;
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t priority;
+    UBaseType_t number;
+    uint16_t stack_depth;
+    uint32_t run_time;              // Run-time stats counter units
+    eTaskState state;
+    uint64_t ready_seq;             // Order among equal priorities
+    wait_reason_t wait;
+    uint64_t wake_ns;               // Timeout (SIM_NO_TIMEOUT: none)
+    uint32_t notify_value;
+    notify_state_t notify_state;
+    struct sim_task *next;
+};
+
+struct sim_stream_buffer {
+    uint8_t *data;
+    size_t size;
+    size_t head;
+    size_t count;
+    size_t trigger;
+    struct sim_task *rx_waiter;
+    struct sim_task *tx_waiter;
+};
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+static struct sim_task *tasks = NULL;
+static struct sim_task idle_task = { .name = "IDLE", .state = eReady };
+static struct sim_task *current = NULL;
+static ucontext_t scheduler_ctx;
+static UBaseType_t task_count = 0;
+static uint64_t ready_seq = 0;
+
+static int started = 0;
+static int in_isr = 0;
+static UBaseType_t critical_nesting = 0;
+static UBaseType_t suspended = 0;
+static int yield_pending = 0;
+
+static size_t heap_used = 0;
+static size_t heap_min_free = configTOTAL_HEAP_SIZE;
+
+static sim_kernel_stats_t stats;
+static void (*idle_wait)(uint64_t deadline_ns) = sim_clock_advance_to;
+
+/** Application hooks (FreeRTOSConfig.h) */
+extern void vApplicationIdleHook(void);
+extern void vApplicationMallocFailedHook(void);
+
+/*============================================================================
+ * Heap
+ *===========================================================================*/
+
+static size_t heap_block(size_t size)
+{
+    return (size + SIM_HEAP_HEADER_BYTES + SIM_HEAP_ALIGN - 1U) & ~(size_t)(SIM_HEAP_ALIGN - 1U);
+}
+
+static int heap_take(size_t size)
+{
+    size_t block = heap_block(size);
+
+    if (size == 0 || heap_used + block > configTOTAL_HEAP_SIZE) {
+        vApplicationMallocFailedHook();
+        return 0;
+    }
+    heap_used += block;
+    if (configTOTAL_HEAP_SIZE - heap_used < heap_min_free) {
+        heap_min_free = configTOTAL_HEAP_SIZE - heap_used;
+    }
+    return 1;
+}
+
+static void heap_give(size_t size)
+{
+    heap_used -= heap_block(size);
+}
+
+void *pvPortMalloc(size_t xWantedSize)
+{
+    size_t *block;
+
+    if (!heap_take(xWantedSize)) {
+        return NULL;
+    }
+    block = malloc(sizeof(size_t) * 2 + xWantedSize);
+    if (block == NULL) {
+        abort();
+    }
+    block[0] = xWantedSize;
+    return &block[2];
+}
+
+void vPortFree(void *pv)
+{
+    if (pv != NULL) {
+        size_t *block = (size_t *)pv - 2;
+        heap_give(block[0]);
+        free(block);
+    }
+}
+
+size_t xPortGetFreeHeapSize(void)
+{
+    return configTOTAL_HEAP_SIZE - heap_used;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void)
+{
+    return heap_min_free;
+}
+
+/*============================================================================
+ * Scheduling Core
+ *===========================================================================*/
+
+static uint64_t tick_now(void)
+{
+    return sim_now_ns() / SIM_NS_PER_MS;
+}
+
+static uint64_t timeout_ns(TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY) {
+        return SIM_NO_TIMEOUT;
+    }
+    return (tick_now() + ticks) * SIM_NS_PER_MS;
+}
+
+static void make_ready(struct sim_task *task)
+{
+    task->state = eReady;
+    task->wait = WAIT_NONE;
+    task->wake_ns = SIM_NO_TIMEOUT;
+    task->ready_seq = ++ready_seq;
+}
+
+/** Back to the scheduler loop; returns when this task is resumed */
+static void switch_out(void)
+{
+    struct sim_task *self = current;
+
+    configASSERT(self != NULL && self != &idle_task);
+    current = NULL;
+    swapcontext(&self->ctx, &scheduler_ctx);
+    current = self;
+}
+
+/** Block the running task until woken or timed out */
+static void block(wait_reason_t reason, uint64_t wake_ns)
+{
+    configASSERT(started && current != NULL && !in_isr);
+    configASSERT(critical_nesting == 0 && suspended == 0);
+
+    current->state = eBlocked;
+    current->wait = reason;
+    current->wake_ns = wake_ns;
+    switch_out();
+}
+
+/** Switch away now if a higher-priority task became ready */
+static void preempt_if_needed(void)
+{
+    if (in_isr || current == NULL || !yield_pending) {
+        return;
+    }
+    if (critical_nesting != 0 || suspended != 0) {
+        return;     // Deferred to taskEXIT_CRITICAL / xTaskResumeAll
+    }
+    yield_pending = 0;
+    stats.preemptions++;
+    switch_out();
+}
+
+/** A task was readied by an API call: does it outrank the running one? */
+static BaseType_t woke(struct sim_task *task)
+{
+    if (in_isr || current == NULL) {
+        return pdTRUE;      // Scheduler picks after the interrupt anyway
+    }
+    if (task->priority > current->priority) {
+        yield_pending = 1;
+        return pdTRUE;
+    }
+    return pdFALSE;
+}
+
+static struct sim_task *pick_ready(void)
+{
+    struct sim_task *best = NULL;
+
+    for (struct sim_task *t = tasks; t != NULL; t = t->next) {
+        if (t->state != eReady) {
+            continue;
+        }
+        if (best == NULL || t->priority > best->priority
+                || (t->priority == best->priority && t->ready_seq < best->ready_seq)) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+static uint64_t earliest_timeout(void)
+{
+    uint64_t earliest = SIM_NO_TIMEOUT;
+
+    for (struct sim_task *t = tasks; t != NULL; t = t->next) {
+        if (t->state == eBlocked && t->wake_ns < earliest) {
+            earliest = t->wake_ns;
+        }
+    }
+    return earliest;
+}
+
+static void wake_timed_out(void)
+{
+    uint64_t now = sim_now_ns();
+
+    for (struct sim_task *t = tasks; t != NULL; t = t->next) {
+        if (t->state == eBlocked && t->wake_ns <= now) {
+            make_ready(t);
+        }
+    }
+}
+
+static void task_entry(void)
+{
+    current->code(current->params);
+    vTaskDelete(NULL);     // Returning from a task function: treat as deleted
+}
+
+void sim_kernel_run_until(uint64_t end_ns)
+{
+    int idle = 0;
+
+    configASSERT(started && current == NULL);
+
+    for (;;) {
+        in_isr = 1;
+        (void)sim_hal_run_due();
+        in_isr = 0;
+        wake_timed_out();
+
+        struct sim_task *next = pick_ready();
+        if (next != NULL) {
+            idle = 0;
+            yield_pending = 0;
+            current = next;
+            stats.context_switches++;
+            swapcontext(&scheduler_ctx, &next->ctx);
+            current = NULL;
+            if (next->state == eDeleted && next->stack != NULL) {
+                free(next->stack);
+                next->stack = NULL;
+            }
+            continue;
+        }
+
+        if (sim_now_ns() >= end_ns) {
+            break;
+        }
+        if (!idle) {
+            idle = 1;
+            current = &idle_task;
+            vApplicationIdleHook();
+            current = NULL;
+        }
+
+        uint64_t deadline = end_ns;
+        uint64_t t = earliest_timeout();
+        if (t < deadline) {
+            deadline = t;
+        }
+        t = sim_hal_next_event_ns();
+        if (t < deadline) {
+            deadline = t;
+        }
+        uint32_t idle_start = portGET_RUN_TIME_COUNTER_VALUE();
+        idle_wait(deadline);
+        idle_task.run_time += portGET_RUN_TIME_COUNTER_VALUE() - idle_start;
+    }
+}
+
+void sim_kernel_run_ms(uint32_t ms)
+{
+    sim_kernel_run_until(sim_now_ns() + (uint64_t)ms * SIM_NS_PER_MS);
+}
+
+void sim_kernel_set_idle_wait(void (*wait)(uint64_t deadline_ns))
+{
+    idle_wait = (wait != NULL) ? wait : sim_clock_advance_to;
+}
+
+const sim_kernel_stats_t *sim_kernel_stats(void)
+{
+    return &stats;
+}
+
+/*============================================================================
+ * Critical Sections
+ *===========================================================================*/
+
+void sim_kernel_enter_critical(void)
+{
+    critical_nesting++;
+}
+
+void sim_kernel_exit_critical(void)
+{
+    configASSERT(critical_nesting > 0);
+    critical_nesting--;
+    preempt_if_needed();
+}
+
+void sim_kernel_yield_from_isr(BaseType_t woken)
+{
+    (void)woken;    // The scheduler loop runs next after every interrupt
+}
+
+void vTaskSuspendAll(void)
+{
+    suspended++;
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+    int pending;
+
+    configASSERT(suspended > 0);
+    suspended--;
+    pending = yield_pending && suspended == 0 && critical_nesting == 0;
+    preempt_if_needed();
+    return pending ? pdTRUE : pdFALSE;
+}
+
+/*============================================================================
+ * Tasks
+ *===========================================================================*/
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName, uint16_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+    struct sim_task *task;
+
+    if (!heap_take(SIM_TCB_BYTES + (size_t)usStackDepth * sizeof(StackType_t))) {
+        return pdFAIL;
+    }
+    task = calloc(1, sizeof(*task));
+    if (task == NULL) {
+        abort();
+    }
+    task->stack = malloc(SIM_TASK_STACK_BYTES);
+    if (task->stack == NULL) {
+        abort();
+    }
+
+    getcontext(&task->ctx);
+    task->ctx.uc_stack.ss_sp = task->stack;
+    task->ctx.uc_stack.ss_size = SIM_TASK_STACK_BYTES;
+    task->ctx.uc_link = NULL;
+    makecontext(&task->ctx, task_entry, 0);
+
+    task->code = pxTaskCode;
+    task->params = pvParameters;
+    strncpy(task->name, pcName, sizeof(task->name) - 1U);
+    task->priority = (uxPriority < configMAX_PRIORITIES) ? uxPriority : configMAX_PRIORITIES - 1U;
+    task->number = ++task_count;
+    task->stack_depth = usStackDepth;
+    task->notify_state = NOTIFY_NONE;
+    make_ready(task);
+
+    // Append: uxTaskGetSystemState lists tasks in creation order
+    struct sim_task **tail = &tasks;
+    while (*tail != NULL) {
+        tail = &(*tail)->next;
+    }
+    *tail = task;
+
+    if (pxCreatedTask != NULL) {
+        *pxCreatedTask = task;
+    }
+    (void)woke(task);
+    preempt_if_needed();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    struct sim_task *task = (xTaskToDelete != NULL) ? xTaskToDelete : current;
+
+    configASSERT(task != NULL && task != &idle_task);
+    if (task->state == eDeleted) {
+        return;
+    }
+    task->state = eDeleted;
+    task->wake_ns = SIM_NO_TIMEOUT;
+    heap_give(SIM_TCB_BYTES + (size_t)task->stack_depth * sizeof(StackType_t));
+
+    if (task == current) {
+        configASSERT(critical_nesting == 0 && suspended == 0);
+        switch_out();   // Never resumed; the scheduler frees the stack
+    }
+}
+
+void vTaskStartScheduler(void)
+{
+    // The idle task's TCB and stack come from the heap, as on the target
+    (void)heap_take(SIM_TCB_BYTES + configMINIMAL_STACK_SIZE * sizeof(StackType_t));
+    idle_task.number = ++task_count;
+    idle_task.priority = tskIDLE_PRIORITY;
+    idle_task.stack_depth = configMINIMAL_STACK_SIZE;
+
+    portCONFIGURE_TIMER_FOR_RUN_TIME_STATS();
+    started = 1;
+    // Returns at once: tasks run inside sim_kernel_run_until()
+}
+
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+    configASSERT(current != NULL);
+
+    if (xTicksToDelay == 0) {
+        // Yield: back of the ready list for this priority
+        configASSERT(critical_nesting == 0 && suspended == 0);
+        make_ready(current);
+        switch_out();
+        return;
+    }
+    block(WAIT_DELAY, timeout_ns(xTicksToDelay));
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement)
+{
+    const TickType_t now = (TickType_t)tick_now();
+    const TickType_t wake = *pxPreviousWakeTime + xTimeIncrement;
+    BaseType_t should_delay = pdFALSE;
+
+    // Same overflow handling as tasks.c
+    if (now < *pxPreviousWakeTime) {
+        if (wake < *pxPreviousWakeTime && wake > now) {
+            should_delay = pdTRUE;
+        }
+    } else if (wake < *pxPreviousWakeTime || wake > now) {
+        should_delay = pdTRUE;
+    }
+    *pxPreviousWakeTime = wake;
+
+    if (should_delay) {
+        block(WAIT_DELAY, (tick_now() + (TickType_t)(wake - now)) * SIM_NS_PER_MS);
+    } else {
+        vTaskDelay(0);
+    }
+    return should_delay;
+}
+
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement)
+{
+    (void)xTaskDelayUntil(pxPreviousWakeTime, xTimeIncrement);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)tick_now();
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+    return (TickType_t)tick_now();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current;
+}
+
+TaskHandle_t xTaskGetIdleTaskHandle(void)
+{
+    return &idle_task;
+}
+
+char *pcTaskGetName(TaskHandle_t xTaskToQuery)
+{
+    struct sim_task *task = (xTaskToQuery != NULL) ? xTaskToQuery : current;
+
+    configASSERT(task != NULL);
+    return task->name;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+    UBaseType_t count = started ? 1U : 0U;
+
+    for (struct sim_task *t = tasks; t != NULL; t = t->next) {
+        if (t->state != eDeleted) {
+            count++;
+        }
+    }
+    return count;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask)
+{
+    struct sim_task *task = (xTask != NULL) ? xTask : current;
+
+    configASSERT(task != NULL);
+    return task->stack_depth;
+}
+
+static void fill_status(TaskStatus_t *status, struct sim_task *task)
+{
+    status->xHandle = task;
+    status->pcTaskName = task->name;
+    status->xTaskNumber = task->number;
+    status->eCurrentState = (task == current) ? eRunning : task->state;
+    status->uxCurrentPriority = task->priority;
+    status->uxBasePriority = task->priority;
+    status->ulRunTimeCounter = task->run_time;
+    status->pxStackBase = NULL;
+    status->usStackHighWaterMark = task->stack_depth;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *pxTaskStatusArray, UBaseType_t uxArraySize,
+                                 uint32_t *pulTotalRunTime)
+{
+    UBaseType_t count = 0;
+
+    if (uxArraySize < uxTaskGetNumberOfTasks()) {
+        return 0;
+    }
+    for (struct sim_task *t = tasks; t != NULL; t = t->next) {
+        if (t->state != eDeleted) {
+            fill_status(&pxTaskStatusArray[count++], t);
+        }
+    }
+    if (started) {
+        fill_status(&pxTaskStatusArray[count++], &idle_task);
+    }
+    if (pulTotalRunTime != NULL) {
+        *pulTotalRunTime = portGET_RUN_TIME_COUNTER_VALUE();
+    }
+    return count;
+}
+
+/*============================================================================
+ * Task Notifications
+ *===========================================================================*/
+
+static BaseType_t notify(struct sim_task *task, uint32_t value, eNotifyAction action,
+                         BaseType_t *woken)
+{
+    notify_state_t previous = task->notify_state;
+
+    configASSERT(task != NULL);
+    switch (action) {
+        case eSetBits:
+            task->notify_value |= value;
+            break;
+        case eIncrement:
+            task->notify_value++;
+            break;
+        case eSetValueWithOverwrite:
+            task->notify_value = value;
+            break;
+        case eSetValueWithoutOverwrite:
+            if (previous == NOTIFY_RECEIVED) {
+                return pdFAIL;
+            }
+            task->notify_value = value;
+            break;
+        case eNoAction:
+        default:
+            break;
+    }
+    task->notify_state = NOTIFY_RECEIVED;
+
+    if (previous == NOTIFY_WAITING && task->state == eBlocked && task->wait == WAIT_NOTIFY) {
+        make_ready(task);
+        if (woke(task) && woken != NULL && in_isr) {
+            *woken = pdTRUE;
+        }
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction)
+{
+    BaseType_t result = notify(xTaskToNotify, ulValue, eAction, NULL);
+
+    preempt_if_needed();
+    return result;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t xTaskToNotify, uint32_t ulValue, eNotifyAction eAction,
+                              BaseType_t *pxHigherPriorityTaskWoken)
+{
+    return notify(xTaskToNotify, ulValue, eAction, pxHigherPriorityTaskWoken);
+}
+
+BaseType_t xTaskNotifyWait(uint32_t ulBitsToClearOnEntry, uint32_t ulBitsToClearOnExit,
+                           uint32_t *pulNotificationValue, TickType_t xTicksToWait)
+{
+    BaseType_t result;
+
+    configASSERT(current != NULL);
+    if (current->notify_state != NOTIFY_RECEIVED) {
+        current->notify_value &= ~ulBitsToClearOnEntry;
+        current->notify_state = NOTIFY_WAITING;
+        if (xTicksToWait > 0) {
+            block(WAIT_NOTIFY, timeout_ns(xTicksToWait));
+        }
+    }
+
+    if (pulNotificationValue != NULL) {
+        *pulNotificationValue = current->notify_value;
+    }
+    if (current->notify_state != NOTIFY_RECEIVED) {
+        result = pdFALSE;
+    } else {
+        current->notify_value &= ~ulBitsToClearOnExit;
+        result = pdTRUE;
+    }
+    current->notify_state = NOTIFY_NONE;
+    return result;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    uint32_t value;
+
+    configASSERT(current != NULL);
+    if (current->notify_value == 0) {
+        current->notify_state = NOTIFY_WAITING;
+        if (xTicksToWait > 0) {
+            block(WAIT_NOTIFY, timeout_ns(xTicksToWait));
+        }
+    }
+
+    value = current->notify_value;
+    if (value != 0) {
+        current->notify_value = xClearCountOnExit ? 0 : value - 1U;
+    }
+    current->notify_state = NOTIFY_NONE;
+    return value;
+}
+
+/*============================================================================
+ * Stream Buffers
+ *===========================================================================*/
+
+StreamBufferHandle_t xStreamBufferCreate(size_t xBufferSizeBytes, size_t xTriggerLevelBytes)
+{
+    struct sim_stream_buffer *sb;
+
+    // Storage + control block from the heap in one allocation, as on the target
+    sb = pvPortMalloc(sizeof(*sb) + xBufferSizeBytes + 1U);
+    if (sb == NULL) {
+        return NULL;
+    }
+    memset(sb, 0, sizeof(*sb));
+    sb->data = (uint8_t *)(sb + 1);
+    sb->size = xBufferSizeBytes;
+    sb->trigger = (xTriggerLevelBytes == 0) ? 1U : xTriggerLevelBytes;
+    return sb;
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t xStreamBuffer)
+{
+    vPortFree(xStreamBuffer);
+}
+
+static size_t stream_write(struct sim_stream_buffer *sb, const void *data, size_t len)
+{
+    size_t space = sb->size - sb->count;
+    size_t n = (len < space) ? len : space;
+    const uint8_t *bytes = data;
+
+    for (size_t i = 0; i < n; i++) {
+        sb->data[(sb->head + sb->count + i) % sb->size] = bytes[i];
+    }
+    sb->count += n;
+    stats.stream_dropped += (uint32_t)(len - n);
+    if (sb->count > stats.stream_peak) {
+        stats.stream_peak = sb->count;
+    }
+    return n;
+}
+
+static size_t stream_read(struct sim_stream_buffer *sb, void *data, size_t len)
+{
+    size_t n = (len < sb->count) ? len : sb->count;
+    uint8_t *bytes = data;
+
+    for (size_t i = 0; i < n; i++) {
+        bytes[i] = sb->data[(sb->head + i) % sb->size];
+    }
+    sb->head = (sb->head + n) % sb->size;
+    sb->count -= n;
+    return n;
+}
+
+/** Wake the reader once the trigger level is reached */
+static BaseType_t stream_wake_reader(struct sim_stream_buffer *sb)
+{
+    struct sim_task *task = sb->rx_waiter;
+
+    if (task == NULL || sb->count < sb->trigger) {
+        return pdFALSE;
+    }
+    sb->rx_waiter = NULL;
+    if (task->state == eBlocked && task->wait == WAIT_STREAM) {
+        make_ready(task);
+        return woke(task);
+    }
+    return pdFALSE;
+}
+
+static BaseType_t stream_wake_writer(struct sim_stream_buffer *sb)
+{
+    struct sim_task *task = sb->tx_waiter;
+
+    if (task == NULL || sb->count == sb->size) {
+        return pdFALSE;
+    }
+    sb->tx_waiter = NULL;
+    if (task->state == eBlocked && task->wait == WAIT_STREAM) {
+        make_ready(task);
+        return woke(task);
+    }
+    return pdFALSE;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t xStreamBuffer, const void *pvTxData,
+                         size_t xDataLengthBytes, TickType_t xTicksToWait)
+{
+    struct sim_stream_buffer *sb = xStreamBuffer;
+    size_t sent;
+
+    if (sb->size - sb->count < xDataLengthBytes && xTicksToWait > 0) {
+        sb->tx_waiter = current;
+        block(WAIT_STREAM, timeout_ns(xTicksToWait));
+        sb->tx_waiter = NULL;
+    }
+    sent = stream_write(sb, pvTxData, xDataLengthBytes);
+    (void)stream_wake_reader(sb);
+    preempt_if_needed();
+    return sent;
+}
+
+size_t xStreamBufferSendFromISR(StreamBufferHandle_t xStreamBuffer, const void *pvTxData,
+                                size_t xDataLengthBytes, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    struct sim_stream_buffer *sb = xStreamBuffer;
+    size_t sent = stream_write(sb, pvTxData, xDataLengthBytes);
+
+    if (stream_wake_reader(sb) && pxHigherPriorityTaskWoken != NULL) {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+    return sent;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t xStreamBuffer, void *pvRxData,
+                            size_t xBufferLengthBytes, TickType_t xTicksToWait)
+{
+    struct sim_stream_buffer *sb = xStreamBuffer;
+    size_t received;
+
+    if (sb->count == 0 && xTicksToWait > 0) {
+        sb->rx_waiter = current;
+        block(WAIT_STREAM, timeout_ns(xTicksToWait));
+        sb->rx_waiter = NULL;
+    }
+    received = stream_read(sb, pvRxData, xBufferLengthBytes);
+    (void)stream_wake_writer(sb);
+    preempt_if_needed();
+    return received;
+}
+
+size_t xStreamBufferReceiveFromISR(StreamBufferHandle_t xStreamBuffer, void *pvRxData,
+                                   size_t xBufferLengthBytes, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    struct sim_stream_buffer *sb = xStreamBuffer;
+    size_t received = stream_read(sb, pvRxData, xBufferLengthBytes);
+
+    if (stream_wake_writer(sb) && pxHigherPriorityTaskWoken != NULL) {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+    return received;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t xStreamBuffer)
+{
+    return xStreamBuffer->count;
+}
+
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t xStreamBuffer)
+{
+    return xStreamBuffer->size - xStreamBuffer->count;
+}
+
+BaseType_t xStreamBufferIsEmpty(StreamBufferHandle_t xStreamBuffer)
+{
+    return (xStreamBuffer->count == 0) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t xStreamBuffer)
+{
+    if (xStreamBuffer->rx_waiter != NULL || xStreamBuffer->tx_waiter != NULL) {
+        return pdFAIL;
+    }
+    xStreamBuffer->head = 0;
+    xStreamBuffer->count = 0;
+    return pdPASS;
+}
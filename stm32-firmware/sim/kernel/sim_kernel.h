@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ * @file           : sim_kernel.h
+ * @brief          : Simulation Kernel - Run Control for Tests and led_sim
+ ******************************************************************************
+ * @description
+ * The simulation kernel runs every task in one Linux thread, switching
+ * between them with ucontext. Time is the shim's simulated clock
+ * (hal_sim.h): it only moves while every task is blocked, and then jumps
+ * straight to the next tick deadline or hardware event. Code therefore
+ * runs in zero simulated time and every run is reproducible.
+ *
+ * Scheduling follows FreeRTOS: the highest-priority ready task runs, a
+ * task that readies a higher-priority one is preempted at that API call
+ * (or when it leaves its critical section / resumes the scheduler), and
+ * interrupts (hal_sim.c events) fire between task steps, never inside one.
+ *
+ * Usage (tests):
+ *     sim_board_boot();           // main.c init sequence, tasks created
+ *     vTaskStartScheduler();      // returns at once
+ *     sim_kernel_run_ms(100);     // tasks run, clock at +100 ms
+ *     sim_uart_rx(&huart2, ...);  // ESP8266 sends a line
+ *     sim_kernel_run_ms(10);
+ ******************************************************************************
+ */
+
+#ifndef SIM_KERNEL_H
+#define SIM_KERNEL_H
+
+#include "FreeRTOS.h"
+#include "stream_buffer.h"
+
+/** Kernel counters (since start) */
+typedef struct {
+    uint32_t context_switches;      /**< Task resumptions by the scheduler */
+    uint32_t preemptions;           /**< Switches forced by a higher-priority wakeup */
+    uint32_t stream_dropped;        /**< Bytes a full stream buffer refused (all buffers) */
+    size_t stream_peak;             /**< Highest stream buffer fill level (bytes) */
+} sim_kernel_stats_t;
+
+/**
+ * @brief  Run the scheduler until the clock reaches a time and no task is ready
+ * @param  end_ns: Simulated time to stop at (sim_now_ns())
+ * @retval None
+ * @note   Call from the test's main(), outside any task
+ */
+void sim_kernel_run_until(uint64_t end_ns);
+
+/**
+ * @brief  Run the scheduler for a simulated duration
+ * @param  ms: Milliseconds from now
+ * @retval None
+ */
+void sim_kernel_run_ms(uint32_t ms);
+
+/**
+ * @brief  Replace the idle wait (default: jump the clock to the deadline)
+ * @param  wait: Called with the next deadline while no task is ready; it
+ *         must advance the clock to at most that time (led_sim sleeps
+ *         until then or until the PTY has data)
+ * @retval None
+ */
+void sim_kernel_set_idle_wait(void (*wait)(uint64_t deadline_ns));
+
+/**
+ * @brief  Kernel counters
+ * @retval Pointer to the live counters
+ */
+const sim_kernel_stats_t *sim_kernel_stats(void);
+
+#endif /* SIM_KERNEL_H */
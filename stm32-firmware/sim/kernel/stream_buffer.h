@@ -0,0 +1,32 @@
+/**
+ ******************************************************************************
+ * @file           : stream_buffer.h
+ * @brief          : Simulation Kernel - Stream Buffer API
+ ******************************************************************************
+ */
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include "FreeRTOS.h"
+
+typedef struct sim_stream_buffer *StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate(size_t xBufferSizeBytes, size_t xTriggerLevelBytes);
+void vStreamBufferDelete(StreamBufferHandle_t xStreamBuffer);
+
+size_t xStreamBufferSend(StreamBufferHandle_t xStreamBuffer, const void *pvTxData,
+                         size_t xDataLengthBytes, TickType_t xTicksToWait);
+size_t xStreamBufferSendFromISR(StreamBufferHandle_t xStreamBuffer, const void *pvTxData,
+                                size_t xDataLengthBytes, BaseType_t *pxHigherPriorityTaskWoken);
+size_t xStreamBufferReceive(StreamBufferHandle_t xStreamBuffer, void *pvRxData,
+                            size_t xBufferLengthBytes, TickType_t xTicksToWait);
+size_t xStreamBufferReceiveFromISR(StreamBufferHandle_t xStreamBuffer, void *pvRxData,
+                                   size_t xBufferLengthBytes, BaseType_t *pxHigherPriorityTaskWoken);
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t xStreamBuffer);
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t xStreamBuffer);
+BaseType_t xStreamBufferIsEmpty(StreamBufferHandle_t xStreamBuffer);
+BaseType_t xStreamBufferReset(StreamBufferHandle_t xStreamBuffer);
+
+#endif /* STREAM_BUFFER_H */
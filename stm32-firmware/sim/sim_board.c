@@ -0,0 +1,189 @@
+/**
+ ******************************************************************************
+ * @file           : sim_board.c
+ * @brief          : Simulated Discovery Board - main.c / MSP Counterpart
+ ******************************************************************************
+ * @description
+ * Host build replacement for main.c and stm32f4xx_hal_msp.c (sim_board.h).
+ * Keep sim_board_boot() in step with main(): tests rely on the same
+ * module init order as the target.
+ ******************************************************************************
+ */
+
+#include "sim_board.h"
+#include "hal_sim.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "led_effects.h"
+#include "esp8266_comm_task.h"
+#include "print_task.h"
+#include "watchdog.h"
+#include "config_store.h"
+#include "telemetry.h"
+#include "low_power.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*============================================================================
+ * Private Definitions
+ *===========================================================================*/
+
+/* Boot messages straight to UART3, as main.c does */
+#define BOOT_LOG(msg) \
+    HAL_UART_Transmit(&huart3, (const uint8_t *)(msg), sizeof(msg) - 1, 1000)
+
+/*============================================================================
+ * Board Handles
+ *===========================================================================*/
+
+UART_HandleTypeDef huart2;
+UART_HandleTypeDef huart3;
+
+/* DMA streams as assigned in stm32f4xx_hal_msp.c */
+static DMA_Stream_TypeDef dma1_stream0;    // TIM4_CH1 (LED frames)
+static DMA_Stream_TypeDef dma1_stream3;    // USART3_TX
+static DMA_Stream_TypeDef dma1_stream5;    // USART2_RX
+static DMA_Stream_TypeDef dma1_stream6;    // USART2_TX
+
+static DMA_HandleTypeDef hdma_tim4_ch1 = { &dma1_stream0, { DMA_CIRCULAR }, NULL, NULL, NULL };
+static DMA_HandleTypeDef hdma_usart3_tx = { &dma1_stream3, { DMA_NORMAL }, NULL, NULL, NULL };
+static DMA_HandleTypeDef hdma_usart2_rx = { &dma1_stream5, { DMA_CIRCULAR }, NULL, NULL, NULL };
+static DMA_HandleTypeDef hdma_usart2_tx = { &dma1_stream6, { DMA_NORMAL }, NULL, NULL, NULL };
+
+/**
+ * @brief  MX_USARTx_UART_Init + HAL_UART_MspInit
+ */
+static void uart_init(UART_HandleTypeDef *huart, USART_TypeDef *instance,
+                      DMA_HandleTypeDef *hdmatx, DMA_HandleTypeDef *hdmarx)
+{
+    huart->Instance = instance;
+    huart->Init.BaudRate = 115200;
+    huart->gState = HAL_UART_STATE_READY;
+    huart->RxState = HAL_UART_STATE_READY;
+    huart->hdmatx = hdmatx;
+    huart->hdmarx = hdmarx;
+    if (hdmatx != NULL) {
+        hdmatx->Parent = huart;
+    }
+    if (hdmarx != NULL) {
+        hdmarx->Parent = huart;
+    }
+}
+
+/**
+ * @brief  TIM4 PWM MSP: link the CC1 frame DMA (stm32f4xx_hal_msp.c)
+ */
+void HAL_TIM_PWM_MspInit(TIM_HandleTypeDef *htim)
+{
+    if (htim->Instance == TIM4) {
+        htim->hdma[TIM_DMA_ID_CC1] = &hdma_tim4_ch1;
+        hdma_tim4_ch1.Parent = htim;
+    }
+}
+
+/*============================================================================
+ * HAL Callbacks (main.c)
+ *===========================================================================*/
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    esp8266_comm_uart_tx_complete(huart);   // UART2: ESP8266 replies
+    print_task_uart_tx_complete(huart);     // UART3: debug log
+}
+
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+{
+    led_effects_tick(htim);                 // TIM7: LED sequencer
+}
+
+void Error_Handler(void)
+{
+    fprintf(stderr, "sim_board: Error_Handler() called\n");
+    abort();
+}
+
+void sim_assert_failed(const char *file, int line)
+{
+    fprintf(stderr, "sim_board: configASSERT failed at %s:%d\n", file, line);
+    abort();
+}
+
+/*============================================================================
+ * FreeRTOS Hooks (main.c)
+ *===========================================================================*/
+
+void vApplicationIdleHook(void)
+{
+    // No WFI on the host: the kernel jumps the clock while idle
+}
+
+void vApplicationMallocFailedHook(void)
+{
+    telemetry_malloc_failed();
+}
+
+/*============================================================================
+ * Low-Power Idle (low_power.c is target only)
+ *===========================================================================*/
+
+void low_power_init(void)
+{
+}
+
+void low_power_suppress_ticks_and_sleep(TickType_t expected_idle_ticks)
+{
+    (void)expected_idle_ticks;
+}
+
+void low_power_rtc_wakeup_irq(void)
+{
+}
+
+void low_power_uart_wakeup_irq(void)
+{
+}
+
+int low_power_format(char *buf, size_t size)
+{
+    int len = snprintf(buf, size, "PWR:ms=0,sleep=0/0,stop=0/0,uart=0");
+
+    return (len < 0 || (size_t)len >= size) ? 0 : len;
+}
+
+/*============================================================================
+ * Boot
+ *===========================================================================*/
+
+void sim_board_boot(void)
+{
+    BaseType_t status;
+    uint32_t stored;
+
+    uart_init(&huart2, USART2, &hdma_usart2_tx, &hdma_usart2_rx);
+    uart_init(&huart3, USART3, &hdma_usart3_tx, NULL);
+
+    BOOT_LOG("STM32F407 LED Controller Boot Test (host simulation)\r\n");
+
+    config_store_init();
+    BOOT_LOG("[BOOT] Config store mounted\r\n");
+
+    led_effects_init();
+    BOOT_LOG("[BOOT] LED effects initialized\r\n");
+    if (led_effects_restore()) {
+        BOOT_LOG("[BOOT] Last LED pattern restored\r\n");
+    }
+
+    print_task_init();
+    if (config_store_get(CONFIG_KEY_LOG_LEVEL, &stored) == 0) {
+        print_set_log_level((log_level_t)stored);
+    }
+    BOOT_LOG("[BOOT] Print task initialized\r\n");
+
+    esp8266_comm_task_init();
+    status = xTaskCreate(esp8266_comm_task_handler, "ESP8266_Comm", 256, NULL, 2, NULL);
+    configASSERT(status == pdPASS);
+    BOOT_LOG("[BOOT] ESP8266_Comm task created\r\n");
+
+    watchdog_init();
+    BOOT_LOG("[BOOT] Watchdog initialized\r\n");
+}
@@ -0,0 +1,250 @@
+/**
+ ******************************************************************************
+ * @file           : sim_main.c
+ * @brief          : led_sim - The Firmware as a Linux Process
+ ******************************************************************************
+ * @description
+ * Boots the firmware on the simulated board and connects it to the host:
+ * ┌──────────────┬──────────────────────────────────────────────────────┐
+ * │ Board        │ Host                                                 │
+ * ├──────────────┼──────────────────────────────────────────────────────┤
+ * │ USART2       │ PTY (raw); its path is printed at start. Point the   │
+ * │ (ESP8266)    │ ESP8266-side tooling or a terminal at it             │
+ * │ USART3 (log) │ stdout                                               │
+ * │ PD12-PD15    │ --pin-log FILE: "<ns> PD<pin> <compare>" per change  │
+ * └──────────────┴──────────────────────────────────────────────────────┘
+ *
+ * Simulated time follows the wall clock. With the simulation kernel the
+ * idle wait sleeps in poll() on the PTY until the next deadline; with the
+ * FreeRTOS POSIX port (FREERTOS_KERNEL_PATH) a reader thread queues PTY
+ * bytes and a top-priority task feeds them in every tick.
+ *
+ * Usage:
+ *     ./led_sim [--pin-log pins.txt]
+ ******************************************************************************
+ */
+
+#define _GNU_SOURCE
+#include "hal_sim.h"
+#include "sim_board.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef SIM_KERNEL
+#include "sim_kernel.h"
+#else
+#include <pthread.h>
+#endif
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+static int pty_master = -1;
+static int pty_slave = -1;     // Kept open: reads on the master fail with no slave
+
+/*============================================================================
+ * PTY
+ *===========================================================================*/
+
+/**
+ * @brief  Create the PTY that stands in for the ESP8266 link
+ * @retval 0 on success
+ */
+static int pty_open(void)
+{
+    struct termios tio;
+    const char *name;
+
+    pty_master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (pty_master < 0 || grantpt(pty_master) != 0 || unlockpt(pty_master) != 0) {
+        return -1;
+    }
+    name = ptsname(pty_master);
+    pty_slave = (name != NULL) ? open(name, O_RDWR | O_NOCTTY) : -1;
+    if (pty_slave < 0 || tcgetattr(pty_slave, &tio) != 0) {
+        return -1;
+    }
+
+    // Raw: no echo, no line editing, CR / LF passed through
+    cfmakeraw(&tio);
+    if (tcsetattr(pty_slave, TCSANOW, &tio) != 0) {
+        return -1;
+    }
+
+    fprintf(stderr, "led_sim: ESP8266 link (USART2) on %s\n", name);
+    return 0;
+}
+
+static uint64_t wall_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#ifdef SIM_KERNEL
+
+/*============================================================================
+ * Simulation Kernel: Paced Idle Wait
+ *===========================================================================*/
+
+static uint64_t wall_origin;
+
+/**
+ * @brief  Idle until the next deadline in wall time, or until PTY data
+ *         arrives (injected on the wire at the time it was read)
+ */
+static void idle_wait(uint64_t deadline_ns)
+{
+    uint8_t buf[256];
+    uint64_t now = wall_ns() - wall_origin;
+
+    if (now < deadline_ns) {
+        uint64_t wait_ms = (deadline_ns - now + SIM_NS_PER_MS - 1U) / SIM_NS_PER_MS;
+        struct pollfd pfd = { pty_master, POLLIN, 0 };
+
+        if (poll(&pfd, 1, (wait_ms > 1000U) ? 1000 : (int)wait_ms) > 0 && (pfd.revents & POLLIN)) {
+            ssize_t n = read(pty_master, buf, sizeof(buf));
+            now = wall_ns() - wall_origin;
+            sim_clock_advance_to((now < deadline_ns) ? now : deadline_ns);
+            if (n > 0) {
+                (void)sim_uart_rx(&huart2, buf, (size_t)n);
+            }
+            return;
+        }
+        now = wall_ns() - wall_origin;
+    }
+    sim_clock_advance_to((now < deadline_ns) ? now : deadline_ns);
+}
+
+static void run(void)
+{
+    wall_origin = wall_ns() - sim_now_ns();
+    sim_kernel_set_idle_wait(idle_wait);
+    vTaskStartScheduler();
+    for (;;) {
+        sim_kernel_run_until(UINT64_MAX);
+    }
+}
+
+#else
+
+/*============================================================================
+ * FreeRTOS POSIX Port: Reader Thread + Interrupt Task
+ *===========================================================================*/
+
+static pthread_mutex_t rx_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t rx_queue[4096];
+static size_t rx_count = 0;
+
+/** Reader thread: PTY bytes into rx_queue (dropped if the task lags) */
+static void *pty_reader(void *arg)
+{
+    uint8_t buf[256];
+
+    (void)arg;
+    for (;;) {
+        ssize_t n = read(pty_master, buf, sizeof(buf));
+        if (n <= 0) {
+            if (n < 0 && errno != EINTR && errno != EAGAIN) {
+                usleep(1000);
+            }
+            continue;
+        }
+        pthread_mutex_lock(&rx_lock);
+        size_t take = ((size_t)n < sizeof(rx_queue) - rx_count) ? (size_t)n : sizeof(rx_queue) - rx_count;
+        memcpy(&rx_queue[rx_count], buf, take);
+        rx_count += take;
+        pthread_mutex_unlock(&rx_lock);
+    }
+    return NULL;
+}
+
+/** Stands in for the NVIC: feeds RX bytes and fires due events each tick */
+static void sim_irq_task(void *parameters)
+{
+    uint8_t buf[sizeof(rx_queue)];
+
+    (void)parameters;
+    for (;;) {
+        vTaskDelay(1);
+
+        pthread_mutex_lock(&rx_lock);
+        size_t n = rx_count;
+        memcpy(buf, rx_queue, n);
+        rx_count = 0;
+        pthread_mutex_unlock(&rx_lock);
+
+        if (n > 0) {
+            (void)sim_uart_rx(&huart2, buf, n);
+        }
+        (void)sim_hal_run_due();
+    }
+}
+
+static void run(void)
+{
+    pthread_t reader;
+
+    sim_clock_use_realtime();
+    if (xTaskCreate(sim_irq_task, "SIM_IRQ", configMINIMAL_STACK_SIZE * 4, NULL,
+                    configMAX_PRIORITIES - 1, NULL) != pdPASS
+            || pthread_create(&reader, NULL, pty_reader, NULL) != 0) {
+        fprintf(stderr, "led_sim: cannot start the interrupt task\n");
+        exit(1);
+    }
+    vTaskStartScheduler();
+}
+
+#endif /* SIM_KERNEL */
+
+/*============================================================================
+ * Main
+ *===========================================================================*/
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--pin-log") == 0 && i + 1 < argc) {
+            FILE *pins = fopen(argv[++i], "w");
+            if (pins == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+            setvbuf(pins, NULL, _IOLBF, 0);
+            sim_pin_log_set_sink(pins);
+        } else {
+            fprintf(stderr, "usage: %s [--pin-log FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (pty_open() != 0) {
+        perror("led_sim: PTY");
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    sim_board_boot();
+
+    // Boot log so far, then everything live
+    char boot_log[1024];
+    size_t n;
+    while ((n = sim_uart_tx_read(&huart3, boot_log, sizeof(boot_log))) > 0) {
+        fwrite(boot_log, 1, n, stdout);
+    }
+    sim_uart_set_sink(&huart2, pty_master);
+    sim_uart_set_sink(&huart3, STDOUT_FILENO);
+    run();
+    return 0;
+}
@@ -0,0 +1,132 @@
+/**
+ ******************************************************************************
+ * @file           : command_dispatch.c
+ * @brief          : Table-Driven ASCII Command Dispatcher Implementation
+ ******************************************************************************
+ * @description
+ * Keywords are hashed with FNV-1a into an open-addressing index (linear
+ * probing). The line's keyword is hashed in the same pass that finds the
+ * argument separator, then confirmed with a single string compare.
+ *
+ ******************************************************************************
+ */
+
+#include "command_dispatch.h"
+#include <string.h>
+
+/*============================================================================
+ * Private Definitions
+ *===========================================================================*/
+
+#define SLOT_EMPTY      0xFF
+#define SLOT_MASK       (COMMAND_HASH_SLOTS - 1)
+
+#define FNV_OFFSET      2166136261UL
+#define FNV_PRIME       16777619UL
+
+/*============================================================================
+ * Private Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Hash a keyword up to the separator or end of string
+ * @param  text: Keyword (or full line)
+ * @param  len: [OUT] Keyword length
+ * @retval FNV-1a hash of the keyword
+ */
+static uint32_t keyword_hash(const char *text, size_t *len)
+{
+    uint32_t hash = FNV_OFFSET;
+    size_t i = 0;
+
+    while (text[i] != '\0' && text[i] != COMMAND_ARG_SEPARATOR) {
+        hash ^= (uint8_t)text[i];
+        hash *= FNV_PRIME;
+        i++;
+    }
+
+    *len = i;
+    return hash;
+}
+
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Build the hash index for a command table
+ */
+int command_dispatcher_init(command_dispatcher_t *d, const command_entry_t *table, uint8_t count)
+{
+    memset(d->slots, SLOT_EMPTY, sizeof(d->slots));
+    d->table = table;
+    d->count = 0;
+
+    if (count >= COMMAND_HASH_SLOTS) {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        size_t len;
+        const char *args;
+        uint32_t slot = keyword_hash(table[i].keyword, &len) & SLOT_MASK;
+
+        // Reject duplicates (second entry would never be reachable)
+        if (command_lookup(d, table[i].keyword, &args) != NULL) {
+            return -1;
+        }
+
+        while (d->slots[slot] != SLOT_EMPTY) {
+            slot = (slot + 1) & SLOT_MASK;
+        }
+        d->slots[slot] = i;
+        d->count++;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief  Find the table entry for a line's keyword
+ */
+const command_entry_t *command_lookup(const command_dispatcher_t *d, const char *line, const char **args)
+{
+    size_t len;
+    uint32_t slot = keyword_hash(line, &len) & SLOT_MASK;
+
+    if (args != NULL) {
+        *args = (line[len] == COMMAND_ARG_SEPARATOR) ? &line[len + 1] : &line[len];
+    }
+
+    // Probe until an empty slot; at most count + 1 probes
+    while (d->slots[slot] != SLOT_EMPTY) {
+        const command_entry_t *entry = &d->table[d->slots[slot]];
+        if (strncmp(entry->keyword, line, len) == 0 && entry->keyword[len] == '\0') {
+            return entry;
+        }
+        slot = (slot + 1) & SLOT_MASK;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief  Look up a line's keyword and call its handler
+ */
+command_result_t command_dispatch(const command_dispatcher_t *d, const char *line)
+{
+    const char *args;
+    const command_entry_t *entry;
+
+    if (line == NULL || line[0] == '\0') {
+        return COMMAND_EMPTY;
+    }
+
+    entry = command_lookup(d, line, &args);
+    if (entry == NULL) {
+        return COMMAND_UNKNOWN;
+    }
+
+    entry->handler(args);
+    return COMMAND_DISPATCHED;
+}
@@ -0,0 +1,461 @@
+/**
+ ******************************************************************************
+ * @file           : config_store.c
+ * @brief          : Flash-Backed Key/Value Store Implementation
+ ******************************************************************************
+ * @description
+ * Append-only record log over two flash banks (see config_store.h).
+ *
+ * Mount (config_store_init):
+ * 1. Active bank = the one with a valid header and the newer generation
+ *    (neither valid: bank A is formatted as generation 1)
+ * 2. Records are replayed into the RAM cache up to the first blank slot;
+ *    torn records (bad CRC) are skipped
+ * 3. The idle bank is erased unless it already is
+ *
+ * Retiring a Bank:
+ * Before a bank is erased, its header magic is programmed to 0. Erasing
+ * only sets bits, so a bank whose erase was cut short by a power loss can
+ * never look committed again and outvote the active bank.
+ *
+ ******************************************************************************
+ */
+
+#include "config_store.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "led_frame.h"
+#define LOG_MODULE_LEVEL CONFIG_STORE_LOG_LEVEL
+#include "print_task.h"
+
+/*============================================================================
+ * Private Definitions
+ *===========================================================================*/
+
+#define CONFIG_MAGIC        0x31474643UL   // "CFG1"
+#define CONFIG_ERASED       0xFFFFFFFFUL
+#define CONFIG_SLOT_SIZE    8U             // [value][key | crc << 16]
+#define CONFIG_SLOTS        (CONFIG_STORE_BANK_SIZE / CONFIG_SLOT_SIZE)
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+/** Latest value per key and which keys have one */
+static uint32_t cache[CONFIG_KEY_COUNT];
+static uint32_t cache_present = 0;  // Bit per key
+
+_Static_assert(CONFIG_KEY_COUNT <= 32, "cache_present holds one bit per key");
+
+/** Active bank (0 = A, 1 = B), its generation and next free slot */
+static uint8_t active_bank = 0;
+static uint32_t active_generation = 0;
+static uint32_t next_slot = 1;
+
+/** Idle bank is known to be erased (compaction needs no erase) */
+static BaseType_t idle_erased = pdFALSE;
+
+/** config_store_service() is erasing the idle bank */
+static BaseType_t erase_busy = pdFALSE;
+
+/** Active bank full while the idle one was dirty: the cache holds sets
+ *  that config_store_service() compacts into flash after its erase */
+static BaseType_t compact_pending = pdFALSE;
+
+static const uint32_t bank_addr[2] = { CONFIG_STORE_BANK_A, CONFIG_STORE_BANK_B };
+static const uint32_t bank_sector[2] = { CONFIG_STORE_SECTOR_A, CONFIG_STORE_SECTOR_B };
+
+/*============================================================================
+ * Flash Access
+ *===========================================================================*/
+
+static uint32_t hal_read_word(uint32_t addr)
+{
+    return *(volatile const uint32_t *)(uintptr_t)addr;
+}
+
+static int hal_program_word(uint32_t addr, uint32_t value)
+{
+    HAL_StatusTypeDef status;
+
+    HAL_FLASH_Unlock();
+    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr, value);
+    HAL_FLASH_Lock();
+    return (status == HAL_OK) ? 0 : -1;
+}
+
+static int hal_erase_bank(uint32_t addr, uint32_t sector)
+{
+    FLASH_EraseInitTypeDef erase = {0};
+    uint32_t sector_error = 0;
+    HAL_StatusTypeDef status;
+
+    (void)addr;
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Sector = sector;
+    erase.NbSectors = 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;  // 2.7-3.6 V, 32-bit parallelism
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+    status = HAL_FLASHEx_Erase(&erase, &sector_error);
+    HAL_FLASH_Lock();
+    return (status == HAL_OK) ? 0 : -1;
+}
+
+static const config_store_flash_ops_t hal_flash_ops = {
+    hal_read_word,
+    hal_program_word,
+    hal_erase_bank,
+};
+
+static const config_store_flash_ops_t *flash = &hal_flash_ops;
+
+static uint32_t flash_read_word(uint32_t addr)
+{
+    return flash->read_word(addr);
+}
+
+static int flash_program_word(uint32_t addr, uint32_t value)
+{
+    return flash->program_word(addr, value);
+}
+
+static int flash_erase_bank(uint8_t bank)
+{
+    return flash->erase_bank(bank_addr[bank], bank_sector[bank]);
+}
+
+/*============================================================================
+ * Private Helpers
+ *===========================================================================*/
+
+/**
+ * @brief  Record check word: CRC16 (led_frame.h polynomial) over key and value
+ * @retval Check value
+ */
+static uint16_t record_crc(uint16_t key, uint32_t value)
+{
+    uint16_t crc = 0xFFFF;
+
+    crc = led_frame_crc16_update(crc, (uint8_t)key);
+    crc = led_frame_crc16_update(crc, (uint8_t)(key >> 8));
+    for (uint8_t i = 0; i < 4; i++) {
+        crc = led_frame_crc16_update(crc, (uint8_t)(value >> (8 * i)));
+    }
+    return crc;
+}
+
+/**
+ * @brief  Address of a slot in a bank
+ */
+static uint32_t slot_addr(uint8_t bank, uint32_t slot)
+{
+    return bank_addr[bank] + slot * CONFIG_SLOT_SIZE;
+}
+
+/**
+ * @brief  Check that a bank reads as erased
+ * @retval pdTRUE if every word is 0xFFFFFFFF
+ */
+static BaseType_t bank_is_erased(uint8_t bank)
+{
+    for (uint32_t offset = 0; offset < CONFIG_STORE_BANK_SIZE; offset += 4) {
+        if (flash_read_word(bank_addr[bank] + offset) != CONFIG_ERASED) {
+            return pdFALSE;
+        }
+    }
+    return pdTRUE;
+}
+
+/**
+ * @brief  Read a bank header
+ * @param  generation: [OUT] Generation if valid
+ * @retval pdTRUE if the header's magic is committed
+ */
+static BaseType_t bank_header(uint8_t bank, uint32_t *generation)
+{
+    uint32_t addr = slot_addr(bank, 0);
+
+    if (flash_read_word(addr + 4) != CONFIG_MAGIC) {
+        return pdFALSE;
+    }
+    *generation = flash_read_word(addr);
+    return pdTRUE;
+}
+
+/**
+ * @brief  Commit a bank header (generation first, magic last)
+ * @retval 0 on success, -1 on flash error
+ */
+static int bank_commit(uint8_t bank, uint32_t generation)
+{
+    uint32_t addr = slot_addr(bank, 0);
+
+    if (flash_program_word(addr, generation) != 0) {
+        return -1;
+    }
+    return flash_program_word(addr + 4, CONFIG_MAGIC);
+}
+
+/**
+ * @brief  Append one record to a bank (value first, key/CRC word last)
+ * @retval 0 on success, -1 on flash error
+ */
+static int record_write(uint8_t bank, uint32_t slot, uint16_t key, uint32_t value)
+{
+    uint32_t addr = slot_addr(bank, slot);
+
+    if (flash_program_word(addr, value) != 0) {
+        return -1;
+    }
+    return flash_program_word(addr + 4, (uint32_t)key | ((uint32_t)record_crc(key, value) << 16));
+}
+
+/**
+ * @brief  Replay the active bank's records into the cache
+ * @retval None
+ */
+static void bank_replay(void)
+{
+    uint32_t slot;
+
+    cache_present = 0;
+    for (slot = 1; slot < CONFIG_SLOTS; slot++) {
+        uint32_t addr = slot_addr(active_bank, slot);
+        uint32_t value = flash_read_word(addr);
+        uint32_t header = flash_read_word(addr + 4);
+        uint16_t key = (uint16_t)header;
+
+        if (value == CONFIG_ERASED && header == CONFIG_ERASED) {
+            break;  // Records are appended in order: the rest is free
+        }
+        if (key == 0 || key >= CONFIG_KEY_COUNT || (uint16_t)(header >> 16) != record_crc(key, value)) {
+            continue;  // Torn by a power cut (or unknown key)
+        }
+        cache[key] = value;
+        cache_present |= 1UL << key;
+    }
+    next_slot = slot;
+}
+
+/**
+ * @brief  Invalidate a bank's header, then erase the bank
+ * @retval 0 on success, -1 on flash error
+ * @note   Stalls the CPU for the sector erase (~1-2 s)
+ */
+static int bank_retire(uint8_t bank)
+{
+    uint32_t generation;
+
+    if (bank_header(bank, &generation) && flash_program_word(slot_addr(bank, 0) + 4, 0) != 0) {
+        return -1;
+    }
+    return flash_erase_bank(bank);
+}
+
+/**
+ * @brief  Move the latest value of every key to the idle bank and switch
+ * @retval 0 on success, -1 on flash error or if the idle bank is not
+ *         erased yet (the old bank stays active)
+ * @note   Runs with the scheduler suspended, so it neither logs nor erases
+ */
+static int bank_compact(void)
+{
+    uint8_t target = active_bank ^ 1U;
+    uint32_t slot = 1;
+
+    if (!idle_erased || erase_busy) {
+        return -1;
+    }
+    idle_erased = pdFALSE;
+
+    for (uint16_t key = 1; key < CONFIG_KEY_COUNT; key++) {
+        if ((cache_present & (1UL << key)) != 0) {
+            if (record_write(target, slot++, key, cache[key]) != 0) {
+                return -1;
+            }
+        }
+    }
+    if (bank_commit(target, active_generation + 1) != 0) {
+        return -1;
+    }
+
+    active_bank = target;
+    active_generation++;
+    next_slot = slot;
+    return 0;
+}
+
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Replace the flash access (see config_store.h)
+ * @param  ops: Flash operations, NULL for the HAL driver
+ * @retval None
+ */
+void config_store_set_flash_ops(const config_store_flash_ops_t *ops)
+{
+    flash = (ops != NULL) ? ops : &hal_flash_ops;
+}
+
+/**
+ * @brief  Mount the store (see config_store.h)
+ * @retval None
+ */
+void config_store_init(void)
+{
+    uint32_t gen_a = 0;
+    uint32_t gen_b = 0;
+    BaseType_t valid_a = bank_header(0, &gen_a);
+    BaseType_t valid_b = bank_header(1, &gen_b);
+
+    if (valid_a && valid_b) {
+        // Both committed: compaction finished but the old bank was not yet
+        // erased. The newer generation wins (wrap-safe compare).
+        active_bank = ((int32_t)(gen_b - gen_a) > 0) ? 1 : 0;
+    } else if (valid_a || valid_b) {
+        active_bank = valid_b ? 1 : 0;
+    } else {
+        // Blank or unreadable: format bank A
+        active_bank = 0;
+        if (!bank_is_erased(0)) {
+            flash_erase_bank(0);
+        }
+        bank_commit(0, 1);
+        gen_a = 1;
+    }
+    active_generation = (active_bank == 0) ? gen_a : gen_b;
+
+    bank_replay();
+    compact_pending = pdFALSE;
+
+    // Erase the idle bank now, while a CPU stall costs nothing
+    uint8_t idle = active_bank ^ 1U;
+    idle_erased = bank_is_erased(idle) || bank_retire(idle) == 0;
+}
+
+/**
+ * @brief  Read a stored setting
+ * @param  key: Setting
+ * @param  value: [OUT] Stored value
+ * @retval 0 if stored, -1 otherwise
+ */
+int config_store_get(config_key_t key, uint32_t *value)
+{
+    if (key == 0 || key >= CONFIG_KEY_COUNT || (cache_present & (1UL << key)) == 0) {
+        return -1;
+    }
+    *value = cache[key];
+    return 0;
+}
+
+/**
+ * @brief  Store a setting
+ * @param  key: Setting
+ * @param  value: New value
+ * @retval 0 on success (or deferred), -1 on an invalid key or flash error
+ */
+int config_store_set(config_key_t key, uint32_t value)
+{
+    int result = 0;
+    BaseType_t compacted = pdFALSE;
+    BaseType_t deferred = pdFALSE;
+
+    if (key == 0 || key >= CONFIG_KEY_COUNT) {
+        return -1;
+    }
+
+    vTaskSuspendAll();
+    if ((cache_present & (1UL << key)) == 0 || cache[key] != value) {
+        if (next_slot >= CONFIG_SLOTS && (!idle_erased || erase_busy)) {
+            // A full bank whose successor is still dirty (16383 writes since
+            // the last compaction, within one monitor period): the erase is
+            // the monitor's, so keep the value in the cache until then
+            deferred = pdTRUE;
+            compact_pending = pdTRUE;
+        } else if (next_slot >= CONFIG_SLOTS) {
+            compacted = pdTRUE;
+            result = bank_compact();
+        }
+        if (result == 0 && !deferred) {
+            // A failed record is skipped by the replay; never reuse its slot
+            result = record_write(active_bank, next_slot++, (uint16_t)key, value);
+        }
+        if (result == 0) {
+            cache[key] = value;
+            cache_present |= 1UL << key;
+        }
+    }
+    xTaskResumeAll();
+
+    if (deferred) {
+        LOG_WARN("[CONFIG] Bank %c full: key %u kept in RAM until the idle bank is erased\r\n",
+                 'A' + active_bank, (unsigned int)key);
+    }
+    if (compacted) {
+        LOG_INFO("[CONFIG] Compacted into bank %c (generation %lu)\r\n",
+                 'A' + active_bank, active_generation);
+    }
+    if (result != 0) {
+        LOG_ERROR("[CONFIG] ERROR: Flash write failed (key %u)\r\n", (unsigned int)key);
+    }
+    return result;
+}
+
+/**
+ * @brief  Erase the bank retired by the last compaction, if any, then
+ *         compact sets deferred while the active bank was full
+ * @retval pdTRUE if a sector was erased
+ */
+BaseType_t config_store_service(void)
+{
+    BaseType_t claimed = pdFALSE;
+    uint8_t idle;
+    int result;
+    int compact_result = 0;
+    BaseType_t compacted = pdFALSE;
+
+    vTaskSuspendAll();
+    if (!idle_erased && !erase_busy) {
+        erase_busy = pdTRUE;
+        claimed = pdTRUE;
+    }
+    idle = active_bank ^ 1U;
+    xTaskResumeAll();
+
+    if (!claimed) {
+        return pdFALSE;
+    }
+
+    // Scheduler running: only the flash stall itself holds things up
+    result = bank_retire(idle);
+
+    vTaskSuspendAll();
+    idle_erased = (result == 0) ? pdTRUE : pdFALSE;
+    erase_busy = pdFALSE;
+    if (result == 0 && compact_pending) {
+        // Sets deferred on a full bank reach flash with the compaction;
+        // if it fails, the next call erases and compacts again
+        compacted = pdTRUE;
+        compact_result = bank_compact();
+        compact_pending = (compact_result == 0) ? pdFALSE : pdTRUE;
+    }
+    xTaskResumeAll();
+
+    if (result == 0) {
+        LOG_INFO("[CONFIG] Bank %c erased\r\n", 'A' + idle);
+    } else {
+        LOG_ERROR("[CONFIG] ERROR: Erase of bank %c failed\r\n", 'A' + idle);
+    }
+    if (compacted && compact_result == 0) {
+        LOG_INFO("[CONFIG] Compacted into bank %c (generation %lu)\r\n",
+                 'A' + active_bank, active_generation);
+    } else if (compacted) {
+        LOG_ERROR("[CONFIG] ERROR: Compaction into bank %c failed\r\n", 'A' + idle);
+    }
+    return pdTRUE;
+}
@@ -5,7 +5,8 @@
  ******************************************************************************
  * @description
  * Manages UART2 for ESP8266 communication using FreeRTOS Stream Buffers.
- * Parses LED_CMD: prefix messages and controls LED patterns.
+ * Parses LED_CMD: prefix messages (table-driven, see command_dispatch.h)
+ * and controls LED patterns.
  * Responds to ECHO_PING for connection monitoring.
  *
  * IMPORTANT: UART Allocation
@@ -18,13 +19,31 @@
  * │  (ISR)      │     │ (xStreamBuf) │     │    (Blocked)     │
  * └─────────────┘     └──────────────┘     └──────────────────┘
  *
+ * RX Modes (UART_RX_USE_DMA in esp8266_comm_task.h):
+ * - DMA (default): DMA1 Stream5 fills a circular buffer; the ISR only runs on
+ *   IDLE line or buffer wrap and forwards the whole burst in one call
+ *   (an 11-byte "LED_CMD:2\r\n" costs 1 ISR instead of 11)
+ * - IT: HAL_UART_Receive_IT re-armed for every byte (one ISR per character)
+ *
  * Protocol:
  * - Receives: LED_CMD:X (where X = 1, 2, 3, or 4)
+ * - Receives: LED_SET:mask,period_ms,duty_pct,phase_ms (blink any LEDs)
+ * - Receives: LED_SCENE:set;set... (several LED_SET groups, one ACK)
+ * - Receives: LED_SYNC:mask,period_ms,mode (LEDs locked to one time base)
+ * - Receives: TIME:ms (shared clock of the coordinated boards)
+ * - Receives: LED_AT:due_ms@<LED command> (apply at a shared-clock time)
  * - Receives: PING (connection test from ESP8266)
+ * - Receives: PING_INTERVAL:ms[,jitter_ms] (STM32_PING period, persisted)
  * - Receives: STM32_PONG (response to STM32_PING)
- * - Sends: OK:PatternX (acknowledgment)
+ * - Receives: MEM (stack/heap telemetry request)
+ * - Receives: STATS (CPU share per task/ISR since the last STATS)
+ * - Sends: OK:PatternX / OK:LedSet / OK:LedScene / OK:LedSync (acknowledgment)
+ * - Sends: ERROR:ScheduleFull / ERROR:BadTime (LED_AT rejected)
  * - Sends: PONG (connection test response)
  * - Sends: STM32_PING (connection test to ESP8266)
+ * - Sends: MEM:heap=..,min=..,fail=..;task=words,... (reply to MEM)
+ * - Sends: STATS:ms=..,idle=..,sleep=..,isr=..;task=permille,... (reply to STATS)
+ * - Sends: WDT_RESET:<task> (after a reset by the IWDG, once at startup)
  *
  * LED Commands:
  * - LED_CMD:1 → Pattern 1 (All LEDs ON)
@@ -43,9 +62,18 @@
 #include "esp8266_comm_task.h"
 #include "led_effects.h"
 #include "watchdog.h"
+#define LOG_MODULE_LEVEL ESP8266_LOG_LEVEL
 #include "print_task.h"
+#include "led_frame.h"
+#include "command_dispatch.h"
+#include "config_store.h"
+#include "telemetry.h"
+#include "runtime_stats.h"
+#include "trace.h"
+#include "low_power.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 /* External UART handle */
 extern UART_HandleTypeDef huart2;
@@ -53,22 +81,79 @@ extern UART_HandleTypeDef huart2;
 /* FreeRTOS Stream Buffer for ISR-to-Task communication */
 static StreamBufferHandle_t uart_stream_buffer = NULL;
 
+#if UART_RX_USE_DMA
+/* Circular DMA target for UART2 RX (written by DMA1 Stream5) */
+static uint8_t uart_dma_rx_buffer[UART_DMA_RX_BUFFER_SIZE];
+
+/* Index of the first DMA byte not yet forwarded to the stream buffer */
+static uint16_t uart_dma_rx_tail = 0;
+#else
 /* Single-byte buffer for interrupt reception */
 static uint8_t uart_rx_byte;
+#endif
+
+/* Tick of the last RX callback (STOP mode waits for a quiet link) */
+static volatile TickType_t uart_last_rx_tick = 0;
+
+/* Chunk drained from the stream buffer in one receive call */
+static uint8_t rx_chunk[UART_RX_CHUNK_SIZE];
 
 /* Command line buffer */
 static char rx_buffer[UART_RX_BUFFER_SIZE];
 static uint16_t rx_index = 0;
+static BaseType_t rx_discarding = pdFALSE;  // Dropping an over-long line until its terminator
+
+#if ESP8266_COMM_PROFILE
+/* RX path profiling counters (reset after each summary) */
+static uint32_t profile_wakeups = 0;
+static uint32_t profile_lines = 0;
+static uint32_t profile_cycles = 0;   // Receive + scan cycles, command handling excluded
+static uint32_t profile_start = 0;
+#define PROFILE_MARK()     (profile_start = DWT->CYCCNT)
+#define PROFILE_ACCUM()    (profile_cycles += DWT->CYCCNT - profile_start)
+#else
+#define PROFILE_MARK()     do { } while (0)
+#define PROFILE_ACCUM()    do { } while (0)
+#endif
+
+/* UART2 TX queue: task enqueues, DMA/IT completion callback drains */
+static uint8_t uart_tx_ring[UART_TX_BUFFER_SIZE];
+static volatile uint16_t uart_tx_head = 0;      // Next free byte (task)
+static volatile uint16_t uart_tx_tail = 0;      // Next byte to send (ISR)
+static volatile uint16_t uart_tx_inflight = 0;  // Bytes handed to HAL, 0 = idle
+
+/* Binary framing (led_frame.h): parser state and negotiated TX format */
+static led_frame_parser_t frame_parser;
+static BaseType_t link_binary = pdFALSE;  // Send unsolicited STM32_PING as frame
+
+/* Shared clock: shared ms = xTaskGetTickCount() + shared_clock_offset
+ * (both wrap at 2^32, so the difference stays valid across wraps) */
+static uint32_t shared_clock_offset = 0;
+static BaseType_t shared_clock_valid = pdFALSE;
+
+/* Set while the inner command of an LED_AT runs: LED changes are queued
+ * for cmd_due_tick instead of applied now, or refused with cmd_due_status
+ * (LED_FRAME_ACK_BAD_TIME) when the due time could not be converted */
+static BaseType_t cmd_scheduled = pdFALSE;
+static TickType_t cmd_due_tick = 0;
+static uint8_t cmd_due_status = LED_FRAME_ACK_OK;
 
 /* UART connection monitoring */
-#define STM32_PING_INTERVAL_MS  10000  // STM32 pings every 10 seconds (base interval)
-#define STM32_PING_JITTER_MS    2000   // Random jitter: 0-2000ms uniform distribution to avoid collision
+#define STM32_PING_INTERVAL_MS  10000  // Default: STM32 pings every 10 seconds (base interval)
+#define STM32_PING_JITTER_MS    2000   // Default random jitter: 0-2000ms uniform distribution to avoid collision
+#define STM32_PING_INTERVAL_MIN_MS  1000    // PING_INTERVAL limits
+#define STM32_PING_INTERVAL_MAX_MS  600000
 #define STM32_PING_TIMEOUT_MS   1000   // 1 second timeout for response
+#define STM32_PING_RETRY_MS     100    // Retry a STM32_PING that could not be queued
+#define ESP8266_COMM_WDT_TIMEOUT_MS  5000  // watchdog_register() timeout
+#define ESP8266_COMM_FEED_MS    (ESP8266_COMM_WDT_TIMEOUT_MS / 2)  // Longest block without data
 static TickType_t last_ping_sent = 0;
 static TickType_t last_pong_received = 0;
 static BaseType_t waiting_for_pong = pdFALSE;
 static BaseType_t uart_connection_ok = pdTRUE;
 static uint32_t ping_random_seed = 0;
+static uint32_t ping_interval_ms = STM32_PING_INTERVAL_MS;  // Restored from config_store
+static uint32_t ping_jitter_ms = STM32_PING_JITTER_MS;
 
 /**
  * @brief  Simple pseudo-random number generator for jitter
@@ -80,110 +165,1007 @@ static uint32_t get_random_jitter(uint32_t max)
     // Simple Linear Congruential Generator (LCG)
     // Using constants from Numerical Recipes
     ping_random_seed = (ping_random_seed * 1664525UL + 1013904223UL);
-    return (ping_random_seed % max);
+    return (max != 0) ? (ping_random_seed % max) : 0;
 }
 
 /**
- * @brief  Parse and execute LED command, PING, or PONG response
- * @param  line: Received line to parse
+ * @brief  Start transmitting the next contiguous run of queued bytes
  * @retval None
+ *
+ * Called with UART2 interrupts masked (task critical section) or from the
+ * TX complete callback. Does nothing while a transfer is in flight.
  */
-static void process_led_command(char *line)
+static void uart_tx_kick(void)
+{
+    uint16_t head = uart_tx_head;
+    uint16_t tail = uart_tx_tail;
+    uint16_t len;
+
+    if (uart_tx_inflight != 0 || head == tail) {
+        return;
+    }
+
+    // Send up to the write position or the end of the ring, whichever first
+    len = (head > tail) ? (head - tail) : (UART_TX_BUFFER_SIZE - tail);
+    uart_tx_inflight = len;
+#if UART_TX_USE_DMA
+    if (HAL_UART_Transmit_DMA(&huart2, &uart_tx_ring[tail], len) != HAL_OK) {
+#else
+    if (HAL_UART_Transmit_IT(&huart2, &uart_tx_ring[tail], len) != HAL_OK) {
+#endif
+        uart_tx_inflight = 0;  // Retried on the next enqueue
+    }
+}
+
+/**
+ * @brief  Queue bytes for transmission on UART2 (non-blocking)
+ * @param  data: Bytes to send (copied)
+ * @param  len: Number of bytes
+ * @retval HAL_OK if queued, HAL_BUSY if the TX queue is full
+ *
+ * Returns immediately; the bytes are shifted out by DMA (or TXE interrupt)
+ * while the task goes back to draining the RX stream buffer. A message is
+ * queued completely or not at all.
+ */
+static HAL_StatusTypeDef uart2_send(const uint8_t *data, uint16_t len)
 {
-    // Debug: Log all received lines via print_task
-    char debug_msg[128];
-    snprintf(debug_msg, sizeof(debug_msg), "[ESP8266] ← Received: '%s'\r\n", line);
-    print_message(debug_msg);
-
-    // Check for PING message (UART connection test from ESP8266)
-    if (strncmp(line, "PING", 4) == 0) {
-        // Respond immediately to prove UART connection is alive
-        // Retry up to 3 times if UART busy
-        HAL_StatusTypeDef status;
-        for (int retry = 0; retry < 3; retry++) {
-            status = HAL_UART_Transmit(&huart2, (uint8_t*)"PONG\r\n", 6, 100);
-            if (status == HAL_OK) break;
-            vTaskDelay(pdMS_TO_TICKS(10)); // Wait 10ms before retry
+    HAL_StatusTypeDef status = HAL_OK;
+
+    taskENTER_CRITICAL();
+    uint16_t head = uart_tx_head;
+    uint16_t used = (uint16_t)((head - uart_tx_tail + UART_TX_BUFFER_SIZE) % UART_TX_BUFFER_SIZE);
+
+    // One byte stays free to tell a full ring from an empty one
+    if (len > (UART_TX_BUFFER_SIZE - 1) - used) {
+        status = HAL_BUSY;  // Caller logs the failed reply
+    } else {
+        uint16_t first = UART_TX_BUFFER_SIZE - head;
+        if (first > len) {
+            first = len;
         }
-        if (status == HAL_OK) {
-            print_message("[ESP8266] ← PING received, sent PONG\r\n");
-        } else {
-            print_message("[ESP8266] ERROR: Failed to send PONG\r\n");
+        memcpy(&uart_tx_ring[head], data, first);
+        memcpy(&uart_tx_ring[0], data + first, len - first);
+        uart_tx_head = (uint16_t)((head + len) % UART_TX_BUFFER_SIZE);
+        uart_tx_kick();
+    }
+    taskEXIT_CRITICAL();
+
+    return status;
+}
+
+/**
+ * @brief  Free space in the UART2 TX queue
+ * @retval Bytes uart2_send() accepts now (only grows until this task sends)
+ */
+static uint16_t uart2_tx_free(void)
+{
+    uint16_t used = (uint16_t)((uart_tx_head - uart_tx_tail + UART_TX_BUFFER_SIZE) % UART_TX_BUFFER_SIZE);
+
+    return (uint16_t)((UART_TX_BUFFER_SIZE - 1) - used);
+}
+
+/**
+ * @brief  Encode and transmit a binary frame on UART2
+ * @param  type: Frame type (led_frame_type_t)
+ * @param  payload: Payload bytes (NULL if len == 0)
+ * @param  len: Payload length
+ * @retval HAL_OK if sent
+ */
+static HAL_StatusTypeDef uart2_send_frame(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    uint8_t frame[LED_FRAME_MAX_SIZE];
+    size_t size = led_frame_encode(type, payload, len, frame, sizeof(frame));
+    if (size == 0) {
+        return HAL_ERROR;
+    }
+    return uart2_send(frame, (uint16_t)size);
+}
+
+/**
+ * @brief  Answer a PING from the ESP8266
+ * @param  binary: pdTRUE to reply with a PONG frame, pdFALSE for "PONG\r\n"
+ * @retval None
+ */
+static void handle_ping(BaseType_t binary)
+{
+    // Respond immediately to prove UART connection is alive
+    HAL_StatusTypeDef status = binary ? uart2_send_frame(LED_FRAME_PONG, NULL, 0)
+                                      : uart2_send((const uint8_t*)"PONG\r\n", 6);
+    if (status == HAL_OK) {
+        LOG_DEBUG("[ESP8266] ← PING received, sent PONG\r\n");
+    } else {
+        LOG_ERROR("[ESP8266] ERROR: Failed to send PONG\r\n");
+    }
+}
+
+/**
+ * @brief  Record an STM32_PONG (ESP8266 reply to our STM32_PING)
+ * @retval None
+ */
+static void handle_stm32_pong(void)
+{
+    // ESP8266 is alive and responding
+    if (!uart_connection_ok) {
+        // Connection restored
+        LOG_INFO("[ESP8266] ✓ UART connection restored!\r\n");
+        uart_connection_ok = pdTRUE;
+    }
+    waiting_for_pong = pdFALSE;
+    last_pong_received = xTaskGetTickCount();
+    LOG_DEBUG("[ESP8266] ← STM32_PONG received\r\n");
+}
+
+/**
+ * @brief  Acknowledge an LED command in the format it arrived in
+ * @param  ack_msg: ASCII ACK text ("OK:Pattern2", "ERROR:...")
+ * @param  ack_status: Binary ACK status (led_frame_status_code_t)
+ * @param  ack_id: Binary ACK pattern byte (1..4, or LED_ACK_LED_SET)
+ * @param  seq: Sequence number to echo, or LED_CMD_NO_SEQ
+ * @param  binary: pdTRUE to acknowledge with an ACK frame, pdFALSE for ASCII
+ * @retval None
+ *
+ * The sequence number (if any) is echoed so the ESP8266 can match ACKs
+ * to commands it has pipelined.
+ */
+static void send_led_ack(const char *ack_msg, uint8_t ack_status, uint8_t ack_id,
+                         int32_t seq, BaseType_t binary)
+{
+    HAL_StatusTypeDef status;
+
+    if (binary) {
+        uint8_t ack[3] = { ack_status, ack_id, (uint8_t)seq };
+        status = uart2_send_frame(LED_FRAME_ACK, ack, (seq == LED_CMD_NO_SEQ) ? 2 : 3);
+    } else {
+        char ack_line[32];
+        int len = (seq == LED_CMD_NO_SEQ)
+                ? snprintf(ack_line, sizeof(ack_line), "%s\r\n", ack_msg)
+                : snprintf(ack_line, sizeof(ack_line), "%s%c%u\r\n", ack_msg,
+                           LED_CMD_SEQ_SEPARATOR, (unsigned int)seq);
+        status = uart2_send((const uint8_t*)ack_line, (uint16_t)len);
+    }
+    TRACE_COMMIT(seq);
+    if (status != HAL_OK) {
+        LOG_ERROR("[LED] ERROR: Failed to send ACK to ESP8266\r\n");
+    }
+}
+
+/**
+ * @brief  ASCII ACK text for a refused LED_AT
+ * @param  status: LED_FRAME_ACK_SCHEDULE_FULL or LED_FRAME_ACK_BAD_TIME
+ * @retval ACK text
+ */
+static const char *schedule_error_text(uint8_t status)
+{
+    return (status == LED_FRAME_ACK_SCHEDULE_FULL) ? "ERROR:ScheduleFull" : "ERROR:BadTime";
+}
+
+/**
+ * @brief  Switch pattern now, or at cmd_due_tick inside an LED_AT
+ * @param  pattern: Desired pattern
+ * @retval LED_FRAME_ACK_OK, LED_FRAME_ACK_SCHEDULE_FULL or LED_FRAME_ACK_BAD_TIME
+ */
+static uint8_t start_pattern(LED_Pattern_t pattern)
+{
+    uint8_t status;
+
+    if (!cmd_scheduled) {
+        led_effects_set_pattern(pattern);
+        status = LED_FRAME_ACK_OK;
+    } else if (cmd_due_status != LED_FRAME_ACK_OK) {
+        return cmd_due_status;
+    } else {
+        status = (led_effects_set_pattern_at(pattern, cmd_due_tick) == 0) ? LED_FRAME_ACK_OK
+                                                                          : LED_FRAME_ACK_SCHEDULE_FULL;
+    }
+    TRACE_MARK(TRACE_APPLIED);
+    return status;
+}
+
+/**
+ * @brief  Apply an LED pattern command and acknowledge it
+ * @param  cmd: Pattern selector ('1'..'4')
+ * @param  seq: Sequence number to echo in the ACK, or LED_CMD_NO_SEQ
+ * @param  binary: pdTRUE to acknowledge with an ACK frame, pdFALSE for ASCII
+ * @retval None
+ */
+static void handle_led_command(char cmd, int32_t seq, BaseType_t binary)
+{
+    const char *ack_msg = NULL;
+    const char *log_msg = NULL;
+    log_level_t log_level = LOG_LEVEL_INFO;
+    uint8_t ack_status = LED_FRAME_ACK_OK;
+    LED_Pattern_t pattern = LED_PATTERN_NONE;
+
+    switch(cmd) {
+        case '1':
+            pattern = LED_PATTERN_1;
+            ack_msg = "OK:Pattern1";
+            log_msg = "[LED] Pattern 1: All LEDs ON\r\n";
+            break;
+
+        case '2':
+            pattern = LED_PATTERN_2;
+            ack_msg = "OK:Pattern2";
+            log_msg = "[LED] Pattern 2: Different Frequency Blink\r\n";
+            break;
+
+        case '3':
+            pattern = LED_PATTERN_3;
+            ack_msg = "OK:Pattern3";
+            log_msg = "[LED] Pattern 3: Same Frequency Blink\r\n";
+            break;
+
+        case '4':
+            pattern = LED_PATTERN_NONE;
+            ack_msg = "OK:AllOFF";
+            log_msg = "[LED] Pattern 4: All LEDs OFF\r\n";
+            break;
+
+        default:
+            ack_msg = "ERROR:InvalidPattern";
+            log_msg = "[LED] ERROR: Invalid pattern command\r\n";
+            log_level = LOG_LEVEL_WARN;
+            ack_status = LED_FRAME_ACK_INVALID_PATTERN;
+            break;
+    }
+
+    if (ack_status == LED_FRAME_ACK_OK) {
+        ack_status = start_pattern(pattern);
+        if (ack_status != LED_FRAME_ACK_OK) {
+            ack_msg = schedule_error_text(ack_status);
+            log_msg = "[LED] ERROR: Scheduled pattern refused\r\n";
+            log_level = LOG_LEVEL_WARN;
         }
+    }
+
+    send_led_ack(ack_msg, ack_status, (uint8_t)(cmd - '0'), seq, binary);
+
+    // Log to UART3
+    if (log_msg != NULL) {
+        LOG_AT(log_level, log_msg);
+    }
+}
+
+/**
+ * @brief  Start LED_SET groups together in the effects engine
+ * @param  groups: Validated groups
+ * @param  count: Number of groups (1..LED_SCENE_MAX_GROUPS)
+ * @retval LED_FRAME_ACK_OK, LED_FRAME_ACK_INVALID_PARAMS if the engine
+ *         rejected them, or (inside an LED_AT) LED_FRAME_ACK_SCHEDULE_FULL /
+ *         LED_FRAME_ACK_BAD_TIME
+ */
+static uint8_t apply_led_groups(const led_set_params_t *groups, uint8_t count)
+{
+    led_blink_t blinks[LED_SCENE_MAX_GROUPS];
+    uint8_t status;
+
+    for (uint8_t i = 0; i < count; i++) {
+        blinks[i].mask = groups[i].mask;
+        blinks[i].level = LED_LEVEL_MAX;
+        blinks[i].period_ms = groups[i].period_ms;
+        blinks[i].on_ms = (uint16_t)(((uint32_t)groups[i].period_ms * groups[i].duty) / LED_SET_DUTY_MAX);
+        blinks[i].phase_ms = groups[i].phase_ms;
+        blinks[i].breathe = 0;
+    }
+    if (!cmd_scheduled) {
+        status = (led_effects_blink(blinks, count) == 0) ? LED_FRAME_ACK_OK : LED_FRAME_ACK_INVALID_PARAMS;
+    } else if (cmd_due_status != LED_FRAME_ACK_OK) {
+        return cmd_due_status;
+    } else {
+        // Groups are validated by the parser, so a refusal means the queue is full
+        status = (led_effects_blink_at(blinks, count, cmd_due_tick) == 0) ? LED_FRAME_ACK_OK
+                                                                         : LED_FRAME_ACK_SCHEDULE_FULL;
+    }
+    TRACE_MARK(TRACE_APPLIED);
+    return status;
+}
+
+/**
+ * @brief  Acknowledge LED groups refused by the LED_AT schedule
+ * @param  status: LED_FRAME_ACK_SCHEDULE_FULL or LED_FRAME_ACK_BAD_TIME
+ * @param  ack_id: Binary ACK pattern byte (LED_ACK_LED_SET / LED_ACK_LED_SCENE)
+ * @param  seq: Sequence number to echo in the ACK, or LED_CMD_NO_SEQ
+ * @param  binary: pdTRUE to acknowledge with an ACK frame, pdFALSE for ASCII
+ * @retval None
+ */
+static void send_schedule_error(uint8_t status, uint8_t ack_id, int32_t seq, BaseType_t binary)
+{
+    send_led_ack(schedule_error_text(status), status, ack_id, seq, binary);
+    LOG_WARN("[LED] ERROR: Scheduled LED groups refused\r\n");
+}
+
+/**
+ * @brief  Apply an LED_SET (parameterized blink) command and acknowledge it
+ * @param  params: Parsed parameters, or NULL if parsing/validation failed
+ * @param  seq: Sequence number to echo in the ACK, or LED_CMD_NO_SEQ
+ * @param  binary: pdTRUE to acknowledge with an ACK frame, pdFALSE for ASCII
+ * @retval None
+ */
+static void handle_led_set(const led_set_params_t *params, int32_t seq, BaseType_t binary)
+{
+    uint8_t status = (params != NULL) ? apply_led_groups(params, 1) : LED_FRAME_ACK_INVALID_PARAMS;
+
+    if (status != LED_FRAME_ACK_OK && status != LED_FRAME_ACK_INVALID_PARAMS) {
+        send_schedule_error(status, LED_ACK_LED_SET, seq, binary);
+        return;
+    }
+    if (status == LED_FRAME_ACK_INVALID_PARAMS) {
+        send_led_ack("ERROR:InvalidLedSet", LED_FRAME_ACK_INVALID_PARAMS, LED_ACK_LED_SET, seq, binary);
+        LOG_WARN("[LED] ERROR: Invalid LED_SET parameters\r\n");
+        return;
+    }
+
+    send_led_ack("OK:LedSet", LED_FRAME_ACK_OK, LED_ACK_LED_SET, seq, binary);
+    LOG_INFO("[LED] LED_SET mask=0x%X period=%ums duty=%u%% phase=%ums\r\n",
+             params->mask, params->period_ms, params->duty, params->phase_ms);
+}
+
+/**
+ * @brief  Apply an LED_SCENE (all groups at once) and acknowledge it once
+ * @param  scene: Parsed scene, or NULL if parsing/validation failed
+ * @param  seq: Sequence number to echo in the ACK, or LED_CMD_NO_SEQ
+ * @param  binary: pdTRUE to acknowledge with an ACK frame, pdFALSE for ASCII
+ * @retval None
+ *
+ * The whole scene is one led_effects_blink() call: one schedule swap, one
+ * ACK and one log line instead of one of each per LED.
+ */
+static void handle_led_scene(const led_scene_t *scene, int32_t seq, BaseType_t binary)
+{
+    uint8_t status = (scene != NULL) ? apply_led_groups(scene->group, scene->count)
+                                     : LED_FRAME_ACK_INVALID_PARAMS;
+
+    if (status != LED_FRAME_ACK_OK && status != LED_FRAME_ACK_INVALID_PARAMS) {
+        send_schedule_error(status, LED_ACK_LED_SCENE, seq, binary);
+        return;
+    }
+    if (status == LED_FRAME_ACK_INVALID_PARAMS) {
+        send_led_ack("ERROR:InvalidLedScene", LED_FRAME_ACK_INVALID_PARAMS, LED_ACK_LED_SCENE, seq, binary);
+        LOG_WARN("[LED] ERROR: Invalid LED_SCENE\r\n");
         return;
     }
 
-    // Check for STM32_PONG response (reply to our STM32_PING)
-    if (strncmp(line, "STM32_PONG", 10) == 0) {
-        // ESP8266 is alive and responding
-        if (!uart_connection_ok) {
-            // Connection restored
-            print_message("[ESP8266] ✓ UART connection restored!\r\n");
-            uart_connection_ok = pdTRUE;
+    send_led_ack("OK:LedScene", LED_FRAME_ACK_OK, LED_ACK_LED_SCENE, seq, binary);
+    LOG_INFO("[LED] LED_SCENE: %u groups\r\n", scene->count);
+}
+
+/** LED_SYNC mode numbers are led_sync_mode_t values */
+_Static_assert(LED_SYNC_BREATHE + 1 == LED_SYNC_MODE_COUNT, "LED_SYNC modes differ from led_sync_mode_t");
+
+/**
+ * @brief  Apply an LED_SYNC (synchronized LED group) and acknowledge it
+ * @param  params: Parsed parameters, or NULL if parsing/validation failed
+ * @param  seq: Sequence number to echo in the ACK, or LED_CMD_NO_SEQ
+ * @param  binary: pdTRUE to acknowledge with an ACK frame, pdFALSE for ASCII
+ * @retval None
+ */
+static void handle_led_sync(const led_sync_params_t *params, int32_t seq, BaseType_t binary)
+{
+    uint8_t status = LED_FRAME_ACK_INVALID_PARAMS;
+
+    if (params != NULL) {
+        led_sync_mode_t mode = (led_sync_mode_t)params->mode;
+
+        if (!cmd_scheduled) {
+            status = (led_effects_sync(params->mask, params->period_ms, LED_LEVEL_MAX, mode) == 0)
+                   ? LED_FRAME_ACK_OK : LED_FRAME_ACK_INVALID_PARAMS;
+        } else if (cmd_due_status != LED_FRAME_ACK_OK) {
+            status = cmd_due_status;
+        } else {
+            // Validated by the parser, so a refusal means the queue is full
+            status = (led_effects_sync_at(params->mask, params->period_ms, LED_LEVEL_MAX,
+                                          mode, cmd_due_tick) == 0)
+                   ? LED_FRAME_ACK_OK : LED_FRAME_ACK_SCHEDULE_FULL;
         }
-        waiting_for_pong = pdFALSE;
-        last_pong_received = xTaskGetTickCount();
-        print_message("[ESP8266] ← STM32_PONG received\r\n");
+        TRACE_MARK(TRACE_APPLIED);
+    }
+
+    if (status != LED_FRAME_ACK_OK && status != LED_FRAME_ACK_INVALID_PARAMS) {
+        send_schedule_error(status, LED_ACK_LED_SYNC, seq, binary);
+        return;
+    }
+    if (status == LED_FRAME_ACK_INVALID_PARAMS) {
+        send_led_ack("ERROR:InvalidLedSync", LED_FRAME_ACK_INVALID_PARAMS, LED_ACK_LED_SYNC, seq, binary);
+        LOG_WARN("[LED] ERROR: Invalid LED_SYNC parameters\r\n");
+        return;
+    }
+
+    send_led_ack("OK:LedSync", LED_FRAME_ACK_OK, LED_ACK_LED_SYNC, seq, binary);
+    LOG_INFO("[LED] LED_SYNC mask=0x%X period=%ums mode=%u\r\n",
+             params->mask, params->period_ms, params->mode);
+}
+
+/**
+ * @brief  Adopt the ESP8266's shared clock
+ * @param  shared_ms: Shared clock reading (ms) at the time of reception
+ * @retval None
+ *
+ * The offset is simply replaced: UART latency (< 1 ms per frame at 115200
+ * baud) is the same on every board, so it cancels out between them.
+ */
+static void handle_time(uint32_t shared_ms)
+{
+    BaseType_t first = !shared_clock_valid;
+
+    shared_clock_offset = shared_ms - (uint32_t)xTaskGetTickCount();
+    shared_clock_valid = pdTRUE;
+    if (first) {
+        LOG_INFO("[ESP8266] Shared clock synced (offset %lu ms)\r\n", (unsigned long)shared_clock_offset);
+    }
+}
+
+/**
+ * @brief  Enter LED_AT mode for the inner command that follows
+ * @param  due_ms: Shared clock due time
+ * @retval None
+ *
+ * A due time in the past runs at once (the engine treats a passed tick as
+ * now); one more than LED_AT_MAX_AHEAD_MS ahead, or any due time before
+ * the first TIME, makes the inner command answer ERROR:BadTime.
+ */
+static void schedule_begin(uint32_t due_ms)
+{
+    uint32_t now_ms = (uint32_t)xTaskGetTickCount() + shared_clock_offset;
+
+    cmd_scheduled = pdTRUE;
+    cmd_due_tick = (TickType_t)(due_ms - shared_clock_offset);
+    cmd_due_status = (shared_clock_valid && (int32_t)(due_ms - now_ms) <= (int32_t)LED_AT_MAX_AHEAD_MS)
+                   ? LED_FRAME_ACK_OK : LED_FRAME_ACK_BAD_TIME;
+}
+
+/**
+ * @brief  Leave LED_AT mode
+ * @retval None
+ */
+static void schedule_end(void)
+{
+    cmd_scheduled = pdFALSE;
+}
+
+/*============================================================================
+ * ASCII Command Dispatch
+ *===========================================================================*/
+
+static void cmd_ping(const char *args)
+{
+    (void)args;
+    handle_ping(pdFALSE);
+}
+
+static void cmd_stm32_pong(const char *args)
+{
+    (void)args;
+    handle_stm32_pong();
+}
+
+static void cmd_led(const char *args)
+{
+    // "LED_CMD:x" or "LED_CMD:x#seq"
+    const char *seq_text = strchr(args, LED_CMD_SEQ_SEPARATOR);
+    int32_t seq = LED_CMD_NO_SEQ;
+
+    if (seq_text != NULL) {
+        seq = (int32_t)(strtoul(seq_text + 1, NULL, 10) & 0xFF);
+    }
+    handle_led_command(args[0], seq, pdFALSE);
+}
+
+static void cmd_led_set(const char *args)
+{
+    // "LED_SET:mask,period,duty,phase" or "...#seq"
+    const char *seq_text = strchr(args, LED_CMD_SEQ_SEPARATOR);
+    int32_t seq = LED_CMD_NO_SEQ;
+    led_set_params_t params;
+
+    if (seq_text != NULL) {
+        seq = (int32_t)(strtoul(seq_text + 1, NULL, 10) & 0xFF);
+    }
+    handle_led_set((led_set_parse(args, &params) == 0) ? &params : NULL, seq, pdFALSE);
+}
+
+static void cmd_led_scene(const char *args)
+{
+    // "LED_SCENE:group;group..." or "...#seq"
+    const char *seq_text = strchr(args, LED_CMD_SEQ_SEPARATOR);
+    int32_t seq = LED_CMD_NO_SEQ;
+    led_scene_t scene;
+
+    if (seq_text != NULL) {
+        seq = (int32_t)(strtoul(seq_text + 1, NULL, 10) & 0xFF);
+    }
+    handle_led_scene((led_scene_parse(args, &scene) == 0) ? &scene : NULL, seq, pdFALSE);
+}
+
+static void cmd_led_sync(const char *args)
+{
+    // "LED_SYNC:mask,period,mode" or "...#seq"
+    const char *seq_text = strchr(args, LED_CMD_SEQ_SEPARATOR);
+    int32_t seq = LED_CMD_NO_SEQ;
+    led_sync_params_t params;
+
+    if (seq_text != NULL) {
+        seq = (int32_t)(strtoul(seq_text + 1, NULL, 10) & 0xFF);
+    }
+    handle_led_sync((led_sync_parse(args, &params) == 0) ? &params : NULL, seq, pdFALSE);
+}
+
+static void cmd_time(const char *args)
+{
+    // "TIME:ms" - shared clock of the coordinated boards
+    uint32_t shared_ms;
+
+    if (led_frame_parse_u32(&args, &shared_ms) == 0 && *args == '\0') {
+        handle_time(shared_ms);
+    }
+}
+
+static void cmd_led_at(const char *args);
+
+static void cmd_proto(const char *args)
+{
+    // Binary protocol negotiation request ("PROTO:BIN")
+    if (strcmp(args, "BIN") != 0) {
+        return;
+    }
+    link_binary = pdTRUE;
+    uart2_send((const uint8_t*)LED_FRAME_NEGOTIATE_ACK "\r\n", sizeof(LED_FRAME_NEGOTIATE_ACK "\r\n") - 1);
+    LOG_INFO("[ESP8266] Binary framing negotiated\r\n");
+}
+
+static void cmd_log_level(const char *args)
+{
+    // "LOG_LEVEL:n" - run-time log threshold, 0 (none) .. 5 (trace)
+    char reply[24];
+    int len;
+
+    if (args[0] >= '0' && args[0] <= '9' && args[1] == '\0'
+            && print_set_log_level((log_level_t)(args[0] - '0')) == pdPASS) {
+        config_store_set(CONFIG_KEY_LOG_LEVEL, (uint32_t)(args[0] - '0'));
+        len = snprintf(reply, sizeof(reply), "OK:LogLevel%c\r\n", args[0]);
+        LOG_INFO("[ESP8266] Log level set to %u\r\n", print_get_log_level());
+    } else {
+        len = snprintf(reply, sizeof(reply), "ERROR:InvalidLogLevel\r\n");
+    }
+    uart2_send((const uint8_t*)reply, (uint16_t)len);
+}
+
+static void cmd_ping_interval(const char *args)
+{
+    // "PING_INTERVAL:ms" or "PING_INTERVAL:ms,jitter_ms" - persisted
+    uint32_t interval = 0;
+    uint32_t jitter = ping_jitter_ms;
+    int rc = led_frame_parse_u32(&args, &interval);
+
+    if (rc == 0 && *args == ',') {
+        args++;
+        rc = led_frame_parse_u32(&args, &jitter);
+    }
+    if (rc != 0 || *args != '\0'
+            || interval < STM32_PING_INTERVAL_MIN_MS || interval > STM32_PING_INTERVAL_MAX_MS
+            || jitter > interval) {
+        uart2_send((const uint8_t*)"ERROR:InvalidPingInterval\r\n", 27);
         return;
     }
 
-    // Check for LED_CMD: prefix
-    if (strncmp(line, "LED_CMD:", 8) == 0) {
-        // Extract command character after "LED_CMD:"
-        char cmd = line[8];
-        HAL_StatusTypeDef status;
-        const char *ack_msg = NULL;
-        const char *log_msg = NULL;
-
-        switch(cmd) {
-            case '1':
-                led_effects_set_pattern(LED_PATTERN_1);
-                ack_msg = "OK:Pattern1\r\n";
-                log_msg = "[LED] Pattern 1: All LEDs ON\r\n";
-                break;
-
-            case '2':
-                led_effects_set_pattern(LED_PATTERN_2);
-                ack_msg = "OK:Pattern2\r\n";
-                log_msg = "[LED] Pattern 2: Different Frequency Blink\r\n";
-                break;
-
-            case '3':
-                led_effects_set_pattern(LED_PATTERN_3);
-                ack_msg = "OK:Pattern3\r\n";
-                log_msg = "[LED] Pattern 3: Same Frequency Blink\r\n";
-                break;
-
-            case '4':
-                led_effects_set_pattern(LED_PATTERN_NONE);
-                ack_msg = "OK:AllOFF\r\n";
-                log_msg = "[LED] Pattern 4: All LEDs OFF\r\n";
-                break;
-
-            default:
-                ack_msg = "ERROR:InvalidPattern\r\n";
-                log_msg = "[LED] ERROR: Invalid pattern command\r\n";
-                break;
+    ping_interval_ms = interval;
+    ping_jitter_ms = jitter;
+    config_store_set(CONFIG_KEY_PING_INTERVAL_MS, interval);
+    config_store_set(CONFIG_KEY_PING_JITTER_MS, jitter);
+    uart2_send((const uint8_t*)"OK:PingInterval\r\n", 17);
+    LOG_INFO("[ESP8266] STM32_PING every %lu ms + 0-%lu ms\r\n", ping_interval_ms, ping_jitter_ms);
+}
+
+static void cmd_mem(const char *args)
+{
+    // "MEM" - latest stack/heap telemetry sample (see telemetry.h)
+    char reply[UART_RX_BUFFER_SIZE];
+    int len;
+
+    if (args[0] != '\0') {
+        return;
+    }
+    len = telemetry_format(reply, sizeof(reply) - 2);
+    if (len == 0) {
+        len = snprintf(reply, sizeof(reply), "MEM:");  // No sample yet (first second)
+    }
+    reply[len++] = '\r';
+    reply[len++] = '\n';
+    if (uart2_send((const uint8_t*)reply, (uint16_t)len) != HAL_OK) {
+        LOG_ERROR("[ESP8266] ERROR: Failed to send MEM reply\r\n");
+    }
+}
+
+static void cmd_stats(const char *args)
+{
+    // "STATS" - CPU share since the previous STATS (see runtime_stats.h)
+    char reply[UART_RX_BUFFER_SIZE];
+    int len;
+
+    if (args[0] != '\0') {
+        return;
+    }
+    len = runtime_stats_format(reply, sizeof(reply) - 2);
+    reply[len++] = '\r';
+    reply[len++] = '\n';
+    if (uart2_send((const uint8_t*)reply, (uint16_t)len) != HAL_OK) {
+        LOG_ERROR("[ESP8266] ERROR: Failed to send STATS reply\r\n");
+    }
+}
+
+static void cmd_power(const char *args)
+{
+    // "POWER" - sleep/STOP residency since the previous POWER (see low_power.h)
+    char reply[UART_RX_BUFFER_SIZE];
+    int len;
+
+    if (args[0] != '\0') {
+        return;
+    }
+    len = low_power_format(reply, sizeof(reply) - 2);
+    reply[len++] = '\r';
+    reply[len++] = '\n';
+    if (uart2_send((const uint8_t*)reply, (uint16_t)len) != HAL_OK) {
+        LOG_ERROR("[ESP8266] ERROR: Failed to send POWER reply\r\n");
+    }
+}
+
+static void cmd_trace(const char *args)
+{
+    // "TRACE" - oldest latency records, then TR:END (see trace.h)
+    char reply[UART_RX_BUFFER_SIZE];
+    int len;
+
+    if (args[0] != '\0') {
+        return;
+    }
+    // Only as many records as the TX queue takes now, END line included:
+    // the rest stay in the trace ring for the next TRACE (TR:END says how
+    // many), so the task never waits for UART2 to drain
+    for (uint8_t i = 0; i < TRACE_DUMP_BATCH; i++) {
+        if (uart2_tx_free() < TRACE_LINE_MAX + TRACE_END_LINE_MAX) {
+            break;
+        }
+        len = trace_format(reply, sizeof(reply) - 2);
+        if (len == 0) {
+            break;
         }
+        reply[len++] = '\r';
+        reply[len++] = '\n';
+        if (uart2_send((const uint8_t*)reply, (uint16_t)len) != HAL_OK) {
+            LOG_ERROR("[ESP8266] ERROR: Failed to send TRACE record\r\n");
+        }
+    }
+    len = snprintf(reply, sizeof(reply), "TR:END,%u,%lu\r\n",
+                   (unsigned int)trace_pending(), (unsigned long)SystemCoreClock);
+    if (uart2_send((const uint8_t*)reply, (uint16_t)len) != HAL_OK) {
+        LOG_ERROR("[ESP8266] ERROR: Failed to send TRACE reply\r\n");
+    }
+}
 
-        // Send ACK with retry logic
-        if (ack_msg != NULL) {
-            for (int retry = 0; retry < 3; retry++) {
-                status = HAL_UART_Transmit(&huart2, (uint8_t*)ack_msg, strlen(ack_msg), 100);
-                if (status == HAL_OK) break;
-                vTaskDelay(pdMS_TO_TICKS(10)); // Wait 10ms before retry
-            }
-            if (status != HAL_OK) {
-                print_message("[LED] ERROR: Failed to send ACK to ESP8266\r\n");
+/** Command keyword → handler (add new ASCII commands here) */
+static const command_entry_t esp8266_commands[] = {
+    { "PING",       cmd_ping },        // Connection test from ESP8266
+    { "STM32_PONG", cmd_stm32_pong },  // Reply to our STM32_PING
+    { "LED_CMD",    cmd_led },         // LED_CMD:x pattern selection
+    { "LED_SET",    cmd_led_set },     // LED_SET:mask,period,duty,phase blink
+    { "LED_SCENE",  cmd_led_scene },   // LED_SCENE:group;group... (one ACK)
+    { "LED_SYNC",   cmd_led_sync },    // LED_SYNC:mask,period,mode locked group
+    { "PROTO",      cmd_proto },       // PROTO:BIN framing negotiation
+    { "LOG_LEVEL",  cmd_log_level },   // LOG_LEVEL:n run-time log threshold
+    { "PING_INTERVAL", cmd_ping_interval },  // PING_INTERVAL:ms[,jitter] (persisted)
+    { "TIME",       cmd_time },        // TIME:ms shared clock
+    { "LED_AT",     cmd_led_at },      // LED_AT:due_ms@<LED command>
+    { "MEM",        cmd_mem },         // MEM stack/heap telemetry
+    { "STATS",      cmd_stats },       // STATS run-time CPU statistics
+    { "POWER",      cmd_power },       // POWER sleep/STOP residency
+    { "TRACE",      cmd_trace },       // TRACE command latency records
+};
+COMMAND_TABLE_CHECK(esp8266_commands);
+
+static command_dispatcher_t command_dispatcher;
+
+static void cmd_led_at(const char *args)
+{
+    // "LED_AT:due_ms@LED_SCENE:..." - the inner command ACKs as usual
+    const command_entry_t *inner;
+    uint32_t due_ms;
+
+    if (led_frame_parse_u32(&args, &due_ms) != 0 || *args != LED_AT_SEPARATOR
+            || (inner = command_lookup(&command_dispatcher, args + 1, NULL)) == NULL
+            || (inner->handler != cmd_led && inner->handler != cmd_led_set
+                && inner->handler != cmd_led_scene && inner->handler != cmd_led_sync)) {
+        uart2_send((const uint8_t*)"ERROR:InvalidLedAt\r\n", 20);
+        LOG_WARN("[ESP8266] ERROR: Invalid LED_AT\r\n");
+        return;
+    }
+
+    schedule_begin(due_ms);
+    command_dispatch(&command_dispatcher, args + 1);
+    schedule_end();
+}
+
+/**
+ * @brief  Parse and execute LED command, PING, or PONG response
+ * @param  line: Received line to parse
+ * @retval None
+ */
+static void process_led_command(char *line)
+{
+#if ESP8266_LOG_LEVEL >= LOG_LEVEL_TRACE
+    // Trace: Log all received lines via print_task (line is reused, so copy)
+    if (LOG_ENABLED(LOG_LEVEL_TRACE)) {
+        char debug_msg[128];
+        snprintf(debug_msg, sizeof(debug_msg), "[ESP8266] ← Received: '%s'\r\n", line);
+        print_message(debug_msg);
+    }
+#endif
+
+    TRACE_MARK(TRACE_DISPATCH);
+    if (command_dispatch(&command_dispatcher, line) == COMMAND_UNKNOWN) {
+        LOG_WARN("[ESP8266] Unknown command ignored\r\n");
+    }
+}
+
+/*============================================================================
+ * Binary Frame Dispatch
+ *===========================================================================*/
+
+/** Frame handler signature (frame is valid and CRC-checked) */
+typedef void (*frame_handler_t)(const led_frame_parser_t *frame);
+
+static void frame_ping(const led_frame_parser_t *frame)
+{
+    (void)frame;
+    handle_ping(pdTRUE);
+}
+
+static void frame_stm32_pong(const led_frame_parser_t *frame)
+{
+    (void)frame;
+    handle_stm32_pong();
+}
+
+static void frame_led_cmd(const led_frame_parser_t *frame)
+{
+    // [pattern] or [pattern][seq]
+    if (frame->len != 1 && frame->len != 2) {
+        uint8_t ack[2] = { LED_FRAME_ACK_BAD_LENGTH, 0 };
+        uart2_send_frame(LED_FRAME_ACK, ack, sizeof(ack));
+        LOG_ERROR("[ESP8266] ERROR: Bad LED_CMD frame length\r\n");
+        return;
+    }
+    handle_led_command((char)('0' + frame->payload[0]),
+                       (frame->len == 2) ? frame->payload[1] : LED_CMD_NO_SEQ, pdTRUE);
+}
+
+static void frame_led_set(const led_frame_parser_t *frame)
+{
+    // [mask][period LE16][duty][phase LE16] or ... [seq]
+    led_set_params_t params;
+    int32_t seq = (frame->len == LED_SET_PAYLOAD_SIZE + 1)
+                ? frame->payload[LED_SET_PAYLOAD_SIZE] : LED_CMD_NO_SEQ;
+
+    handle_led_set((led_set_decode(frame->payload, frame->len, &params) == 0) ? &params : NULL,
+                   seq, pdTRUE);
+}
+
+static void frame_led_scene(const led_frame_parser_t *frame)
+{
+    // n × [mask][period LE16][duty][phase LE16], optionally + [seq]
+    led_scene_t scene;
+    int32_t seq = (frame->len % LED_SET_PAYLOAD_SIZE == 1)
+                ? frame->payload[frame->len - 1] : LED_CMD_NO_SEQ;
+
+    handle_led_scene((led_scene_decode(frame->payload, frame->len, &scene) == 0) ? &scene : NULL,
+                     seq, pdTRUE);
+}
+
+static void frame_led_sync(const led_frame_parser_t *frame)
+{
+    // [mask][period LE16][mode] or ... [seq]
+    led_sync_params_t params;
+    int32_t seq = (frame->len == LED_SYNC_PAYLOAD_SIZE + 1)
+                ? frame->payload[LED_SYNC_PAYLOAD_SIZE] : LED_CMD_NO_SEQ;
+
+    handle_led_sync((led_sync_decode(frame->payload, frame->len, &params) == 0) ? &params : NULL,
+                    seq, pdTRUE);
+}
+
+static void frame_time(const led_frame_parser_t *frame)
+{
+    // [shared ms LE32]
+    if (frame->len == 4) {
+        handle_time(led_frame_get_le32(frame->payload));
+    }
+}
+
+static void frame_led_at(const led_frame_parser_t *frame);
+
+/** Frame type → handler (unlisted types are ignored) */
+static const frame_handler_t frame_handlers[LED_FRAME_TYPE_COUNT] = {
+    [LED_FRAME_PING]       = frame_ping,
+    [LED_FRAME_STM32_PONG] = frame_stm32_pong,
+    [LED_FRAME_LED_CMD]    = frame_led_cmd,
+    [LED_FRAME_LED_SET]    = frame_led_set,
+    [LED_FRAME_LED_SCENE]  = frame_led_scene,
+    [LED_FRAME_LED_SYNC]   = frame_led_sync,
+    [LED_FRAME_TIME]       = frame_time,
+    [LED_FRAME_LED_AT]     = frame_led_at,
+};
+
+static void frame_led_at(const led_frame_parser_t *frame)
+{
+    // [due LE32][inner type][inner payload], inner = LED_CMD / LED_SET / LED_SCENE / LED_SYNC
+    static led_frame_parser_t inner;  // Task-local, keeps ~40 bytes off the stack
+    uint8_t type = (frame->len > LED_AT_HEADER_SIZE) ? frame->payload[4] : 0;
+
+    if (type != LED_FRAME_LED_CMD && type != LED_FRAME_LED_SET && type != LED_FRAME_LED_SCENE
+            && type != LED_FRAME_LED_SYNC) {
+        uint8_t ack[2] = { LED_FRAME_ACK_BAD_LENGTH, 0 };
+        uart2_send_frame(LED_FRAME_ACK, ack, sizeof(ack));
+        LOG_ERROR("[ESP8266] ERROR: Bad LED_AT frame\r\n");
+        return;
+    }
+
+    inner.type = type;
+    inner.len = (uint8_t)(frame->len - LED_AT_HEADER_SIZE);
+    memcpy(inner.payload, &frame->payload[LED_AT_HEADER_SIZE], inner.len);
+
+    schedule_begin(led_frame_get_le32(frame->payload));
+    frame_handlers[type](&inner);
+    schedule_end();
+}
+
+/**
+ * @brief  Feed one byte to the frame parser and dispatch completed frames
+ * @param  byte: Received byte
+ * @retval None
+ */
+static void process_frame_byte(uint8_t byte)
+{
+    switch (led_frame_parse_byte(&frame_parser, byte)) {
+        case LED_FRAME_COMPLETE:
+            // Any valid frame proves the ESP8266 speaks the binary protocol
+            link_binary = pdTRUE;
+            TRACE_MARK(TRACE_DISPATCH);
+            if (frame_parser.type < LED_FRAME_TYPE_COUNT && frame_handlers[frame_parser.type] != NULL) {
+                frame_handlers[frame_parser.type](&frame_parser);
             }
+            break;
+
+        case LED_FRAME_CRC_ERROR:
+        case LED_FRAME_LENGTH_ERROR:
+            LOG_ERROR("[ESP8266] ERROR: Corrupted frame dropped\r\n");
+            break;
+
+        default:
+            break;
+    }
+}
+
+#if ESP8266_COMM_PROFILE
+/**
+ * @brief  Log and reset RX profiling counters
+ * @retval None
+ */
+static void profile_report(void)
+{
+    print_deferred("[ESP8266] RX profile: %lu lines, %lu wakeups, %lu cycles/line\r\n",
+                   profile_lines, profile_wakeups, profile_cycles / profile_lines);
+    profile_wakeups = 0;
+    profile_lines = 0;
+    profile_cycles = 0;
+}
+#endif
+
+/**
+ * @brief  Append a line fragment to the command line buffer
+ * @param  data: Fragment start (no line terminators)
+ * @param  len: Fragment length
+ * @retval None
+ *
+ * A line longer than the buffer is reported once and then discarded up to
+ * its terminator, so its tail is not mistaken for a new command.
+ */
+static void rx_line_append(const uint8_t *data, size_t len)
+{
+    if (len == 0 || rx_discarding) {
+        return;
+    }
+
+    if (rx_index + len > (UART_RX_BUFFER_SIZE - 1)) {
+        // Buffer full - discard and reset
+        rx_index = 0;
+        rx_discarding = pdTRUE;
+        uart2_send((const uint8_t*)"ERROR:BufferOverflow\r\n", 22);
+        LOG_ERROR("[ESP8266] ERROR: RX buffer overflow!\r\n");
+        return;
+    }
+
+    memcpy(&rx_buffer[rx_index], data, len);
+    rx_index += len;
+}
+
+/**
+ * @brief  Scan a received chunk for line terminators and dispatch lines
+ * @param  data: Bytes drained from the stream buffer
+ * @param  len: Number of bytes
+ * @retval None
+ *
+ * Copies whole runs between terminators instead of handling one byte per
+ * call. Partial lines are kept in rx_buffer until the next chunk.
+ * A SYNC byte at a line boundary switches to the binary frame parser
+ * until the frame ends, then ASCII scanning resumes.
+ */
+static void process_rx_chunk(const uint8_t *data, size_t len)
+{
+    size_t start = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        // Binary frame: SYNC at a line boundary, or continuation of a frame
+        if (led_frame_parser_busy(&frame_parser) ||
+            (data[i] == LED_FRAME_SYNC && i == start && rx_index == 0)) {
+            PROFILE_ACCUM();
+            process_frame_byte(data[i]);
+            PROFILE_MARK();
+            start = i + 1;
+            continue;
         }
 
-        // Log to UART3
-        if (log_msg != NULL) {
-            print_message(log_msg);
+        // Wake preamble (led_frame.h) that arrived while awake: drop it
+        if (data[i] == LED_LINK_WAKE_BYTE) {
+            rx_line_append(&data[start], i - start);
+            start = i + 1;
+            continue;
         }
-        return;
+
+        if (data[i] != '\n' && data[i] != '\r') {
+            continue;
+        }
+
+        rx_line_append(&data[start], i - start);
+        start = i + 1;
+
+        if (rx_index > 0) {
+            // Null-terminate the string
+            rx_buffer[rx_index] = '\0';
+
+            // Process the command (not counted as RX path cycles)
+            PROFILE_ACCUM();
+            process_led_command(rx_buffer);
+            PROFILE_MARK();
+#if ESP8266_COMM_PROFILE
+            profile_lines++;
+#endif
+
+            // Reset buffer
+            rx_index = 0;
+        }
+        rx_discarding = pdFALSE;
     }
+
+    rx_line_append(&data[start], len - start);
+}
+
+/**
+ * @brief  Start (or restart) UART2 reception in the configured RX mode
+ * @retval None
+ *
+ * DMA mode: circular transfer into uart_dma_rx_buffer. HAL raises
+ * HAL_UARTEx_RxEventCallback on IDLE line and on buffer wrap (TC). The
+ * half-transfer event is disabled since IDLE/TC already cover every burst.
+ *
+ * IT mode: single-byte reception, re-armed from HAL_UART_RxCpltCallback.
+ */
+static void uart_rx_start(void)
+{
+#if UART_RX_USE_DMA
+    uart_dma_rx_tail = 0;
+    HAL_UARTEx_ReceiveToIdle_DMA(&huart2, uart_dma_rx_buffer, UART_DMA_RX_BUFFER_SIZE);
+    __HAL_DMA_DISABLE_IT(huart2.hdmarx, DMA_IT_HT);
+#else
+    HAL_UART_Receive_IT(&huart2, &uart_rx_byte, 1);
+#endif
 }
 
 /**
@@ -193,7 +1175,7 @@ static void process_led_command(char *line)
  *
  * Setup:
  * 1. Create stream buffer for ISR-to-Task communication
- * 2. Start first interrupt-driven UART2 reception
+ * 2. Start UART2 reception (circular DMA or per-byte interrupt)
  *
  * The stream buffer allows the ISR to deposit bytes and the task to
  * retrieve them in a thread-safe, lock-free manner.
@@ -205,11 +1187,86 @@ void esp8266_comm_task_init(void)
     uart_stream_buffer = xStreamBufferCreate(UART_STREAM_BUFFER_SIZE, 1);
     configASSERT(uart_stream_buffer != NULL);
 
-    // Start first interrupt-based reception
-    // HAL will call HAL_UART_RxCpltCallback when byte arrives
-    HAL_UART_Receive_IT(&huart2, &uart_rx_byte, 1);
+    // Binary frames may arrive at any time (ESP8266 decides after negotiation)
+    led_frame_parser_reset(&frame_parser);
+
+    // Persisted STM32_PING period (config_store_init() already ran)
+    uint32_t value;
+    if (config_store_get(CONFIG_KEY_PING_INTERVAL_MS, &value) == 0
+            && value >= STM32_PING_INTERVAL_MIN_MS && value <= STM32_PING_INTERVAL_MAX_MS) {
+        ping_interval_ms = value;
+    }
+    if (config_store_get(CONFIG_KEY_PING_JITTER_MS, &value) == 0 && value <= ping_interval_ms) {
+        ping_jitter_ms = value;
+    }
+
+    // Build keyword index for ASCII command lines
+    int rc = command_dispatcher_init(&command_dispatcher, esp8266_commands,
+                                     COMMAND_TABLE_SIZE(esp8266_commands));
+    configASSERT(rc == 0);
+    (void)rc;
+
+#if ESP8266_COMM_PROFILE
+    // Enable DWT cycle counter (trace must be enabled without a debugger)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    // Start reception
+    // DMA mode: HAL calls HAL_UARTEx_RxEventCallback once per burst
+    // IT mode:  HAL calls HAL_UART_RxCpltCallback once per byte
+    uart_rx_start();
 }
 
+#if UART_RX_USE_DMA
+/**
+ * @brief  UART RX Event Callback - DMA IDLE line / buffer wrap (ISR context)
+ * @param  huart: UART handle
+ * @param  Size: DMA write position in uart_dma_rx_buffer (1..UART_DMA_RX_BUFFER_SIZE)
+ * @retval None
+ *
+ * ISR Operation:
+ * 1. Called by HAL when the line goes idle after a burst, or when DMA wraps
+ * 2. Forward bytes between last tail and current DMA position to stream buffer
+ * 3. Split the copy in two if the burst wrapped around the circular buffer
+ * 4. DMA keeps running in circular mode - nothing to re-arm
+ */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    if (huart == &huart2) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        uint16_t head = Size;
+
+        TRACE_RX_ISR();
+        uart_last_rx_tick = xTaskGetTickCountFromISR();
+
+        if (head > uart_dma_rx_tail) {
+            // Linear region: [tail, head)
+            xStreamBufferSendFromISR(uart_stream_buffer,
+                                     &uart_dma_rx_buffer[uart_dma_rx_tail],
+                                     head - uart_dma_rx_tail,
+                                     &xHigherPriorityTaskWoken);
+        } else if (head < uart_dma_rx_tail) {
+            // Wrapped: [tail, end) followed by [0, head)
+            xStreamBufferSendFromISR(uart_stream_buffer,
+                                     &uart_dma_rx_buffer[uart_dma_rx_tail],
+                                     UART_DMA_RX_BUFFER_SIZE - uart_dma_rx_tail,
+                                     &xHigherPriorityTaskWoken);
+            xStreamBufferSendFromISR(uart_stream_buffer,
+                                     uart_dma_rx_buffer,
+                                     head,
+                                     &xHigherPriorityTaskWoken);
+        }
+
+        // DMA restarts at index 0 after transfer complete
+        uart_dma_rx_tail = (head >= UART_DMA_RX_BUFFER_SIZE) ? 0 : head;
+
+        // Yield to higher priority task if woken
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+#else
+
 /**
  * @brief  UART RX Complete Callback (called from ISR context)
  * @param  huart: UART handle
@@ -230,6 +1287,9 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
     if (huart == &huart2) {
         BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
+        TRACE_RX_ISR();
+        uart_last_rx_tick = xTaskGetTickCountFromISR();
+
         // Send byte to stream buffer (ISR-safe, lock-free)
         // If task is blocked reading, it will be woken immediately
         xStreamBufferSendFromISR(uart_stream_buffer,
@@ -244,6 +1304,107 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
         portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
     }
 }
+#endif /* UART_RX_USE_DMA */
+
+/**
+ * @brief  UART Error Callback (called from ISR context)
+ * @param  huart: UART handle
+ * @retval None
+ *
+ * Overrun, framing or noise errors abort the ongoing HAL reception.
+ * Restart it so a single line glitch does not silence UART2 permanently.
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart == &huart2) {
+        uart_rx_start();
+
+        if (LOG_ENABLED(LOG_LEVEL_WARN)) {
+            print_message_from_isr("[ESP8266] UART2 error, RX restarted\r\n");
+        }
+
+        // A DMA error aborts the transmission too: drop it and carry on
+        if (uart_tx_inflight != 0 && huart->gState == HAL_UART_STATE_READY) {
+            esp8266_comm_uart_tx_complete(huart);
+        }
+    }
+}
+
+/**
+ * @brief  UART2 TX complete hook (DMA or interrupt), called from
+ *         HAL_UART_TxCpltCallback in main.c
+ * @param  huart: UART handle
+ * @retval None
+ *
+ * Releases the bytes just sent and starts the next queued run, so replies
+ * go out back-to-back without the task's involvement.
+ */
+void esp8266_comm_uart_tx_complete(UART_HandleTypeDef *huart)
+{
+    if (huart == &huart2) {
+        uart_tx_tail = (uint16_t)((uart_tx_tail + uart_tx_inflight) % UART_TX_BUFFER_SIZE);
+        uart_tx_inflight = 0;
+        uart_tx_kick();
+    }
+}
+
+/**
+ * @brief  Check that UART2 can be stopped (STOP mode)
+ * @retval pdTRUE if the link is quiet
+ * @note   Interrupts masked (low_power). USART2 and its DMA stop in STOP:
+ *         a reply still queued would be cut off, and bytes the DMA has
+ *         written but the IDLE callback has not forwarded yet would wait
+ *         for the next wakeup.
+ */
+BaseType_t esp8266_comm_link_quiet(void)
+{
+    if (uart_tx_inflight != 0 || uart_tx_head != uart_tx_tail) {
+        return pdFALSE;
+    }
+#if UART_RX_USE_DMA
+    if (UART_DMA_RX_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(huart2.hdmarx) != uart_dma_rx_tail) {
+        return pdFALSE;
+    }
+#endif
+    if ((xTaskGetTickCount() - uart_last_rx_tick) < pdMS_TO_TICKS(LED_LINK_STOP_QUIET_MS)) {
+        return pdFALSE;
+    }
+    return pdTRUE;
+}
+
+/**
+ * @brief  Ticks until the next STM32_PING deadline or watchdog check-in
+ * @param  now: Tick count at the top of the loop
+ * @param  ping_period: Ticks between STM32_PINGs (interval + jitter)
+ * @retval Block time for xStreamBufferReceive()
+ *
+ * The task only wakes for data or a deadline, so tickless idle can sleep
+ * through the gaps instead of waking every 100 ms to poll.
+ */
+static TickType_t next_wakeup_ticks(TickType_t now, TickType_t ping_period)
+{
+    TickType_t wait = pdMS_TO_TICKS(ESP8266_COMM_FEED_MS);
+    TickType_t since_ping = now - last_ping_sent;
+    TickType_t until;
+
+    // Next STM32_PING (or a retry if the last one could not be queued)
+    until = (since_ping < ping_period) ? ping_period - since_ping
+                                       : pdMS_TO_TICKS(STM32_PING_RETRY_MS);
+    if (until < wait) {
+        wait = until;
+    }
+
+    // STM32_PONG timeout
+    if (waiting_for_pong) {
+        TickType_t timeout = pdMS_TO_TICKS(STM32_PING_TIMEOUT_MS);
+        until = (since_ping < timeout) ? timeout - since_ping : 0;
+        if (until < wait) {
+            wait = until;
+        }
+    }
+
+    return wait;
+}
 
 /**
  * @brief  ESP8266 communication task
@@ -252,34 +1413,43 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
  *
  * Task Operation:
  * 1. Register with watchdog monitor
- * 2. Read characters from stream buffer (finite 2s timeout)
+ * 2. Drain up to UART_RX_CHUNK_SIZE bytes from stream buffer, blocking until
+ *    the next STM32_PING / STM32_PONG deadline or watchdog check-in
  * 3. Feed watchdog on every iteration
- * 4. Buffer until newline (\n or \r)
+ * 4. Scan the chunk and buffer until newline (\n or \r)
  * 5. Parse LED_CMD: and ECHO_PING messages
  * 6. Execute LED pattern changes or respond to ping
  * 7. Send acknowledgment back to ESP8266 via UART2
  *
  * Efficiency:
  * - Task enters BLOCKED state when no data (yields CPU to other tasks)
- * - Woken immediately by ISR when byte arrives OR on 2s timeout
- * - Zero CPU waste (no polling loop)
- * - Watchdog monitored (5s timeout, feeds every 2s)
+ * - Woken immediately by ISR when data arrives OR at the next deadline
+ * - One wakeup per burst: a whole "LED_CMD:x\r\n" is handled in one pass
+ * - Zero CPU waste (no polling loop): an idle link wakes the task once per
+ *   STM32_PING (plus its STM32_PONG check), so tickless idle sleeps between
+ * - Watchdog monitored (5s timeout, fed at least every 2.5s)
  */
 void esp8266_comm_task_handler(void *parameters)
 {
-    uint8_t received_char;
-
     // Send startup message to ESP8266
     const char *startup = "\r\nSTM32 LED Controller Ready (Stream Buffer Mode)\r\n";
-    HAL_UART_Transmit(&huart2, (uint8_t*)startup, strlen(startup), 1000);
+    uart2_send((const uint8_t*)startup, (uint16_t)strlen(startup));
+
+    // Report a watchdog reset so the ESP8266 log shows which task hung
+    const char *culprit = watchdog_get_reset_culprit();
+    if (culprit != NULL) {
+        char line[32];
+        int len = snprintf(line, sizeof(line), "WDT_RESET:%s\r\n", culprit);
+        uart2_send((const uint8_t*)line, (uint16_t)len);
+    }
 
     // Initialize random seed for ping jitter using current tick count
     ping_random_seed = xTaskGetTickCount();
 
-    // Register with watchdog (5 second timeout = 2.5× the 2s blocking period)
-    watchdog_id_t wd_id = watchdog_register("ESP8266_Comm", 5000);
+    // Register with watchdog (5 second timeout = 2x the longest block)
+    watchdog_id_t wd_id = watchdog_register("ESP8266_Comm", ESP8266_COMM_WDT_TIMEOUT_MS);
     if (wd_id == WATCHDOG_INVALID_ID) {
-        print_message("[ESP8266] Failed to register with watchdog!\r\n");
+        LOG_ERROR("[ESP8266] Failed to register with watchdog!\r\n");
     }
 
     while (1) {
@@ -291,27 +1461,26 @@ void esp8266_comm_task_handler(void *parameters)
         static uint32_t next_ping_jitter = 0;
         if (last_ping_sent == 0) {
             // First ping - generate initial jitter
-            next_ping_jitter = get_random_jitter(STM32_PING_JITTER_MS);
+            next_ping_jitter = get_random_jitter(ping_jitter_ms);
         }
 
-        uint32_t ping_interval_with_jitter = STM32_PING_INTERVAL_MS + next_ping_jitter;
-        if ((now - last_ping_sent) >= pdMS_TO_TICKS(ping_interval_with_jitter)) {
-            // Send STM32_PING to ESP8266 with retry logic
-            HAL_StatusTypeDef status;
-            for (int retry = 0; retry < 3; retry++) {
-                status = HAL_UART_Transmit(&huart2, (uint8_t*)"STM32_PING\r\n", 12, 100);
-                if (status == HAL_OK) break;
-                vTaskDelay(pdMS_TO_TICKS(10)); // Wait 10ms before retry
-            }
+        uint32_t ping_interval_with_jitter = ping_interval_ms + next_ping_jitter;
+        TickType_t ping_period = pdMS_TO_TICKS(ping_interval_with_jitter);
+        if ((now - last_ping_sent) >= ping_period) {
+            // Send STM32_PING to ESP8266 with retry logic (frame once negotiated)
+            HAL_StatusTypeDef status = link_binary
+                ? uart2_send_frame(LED_FRAME_STM32_PING, NULL, 0)
+                : uart2_send((const uint8_t*)"STM32_PING\r\n", 12);
 
             if (status == HAL_OK) {
                 last_ping_sent = now;
                 waiting_for_pong = pdTRUE;
-                print_message("[ESP8266] → Sending STM32_PING...\r\n");
+                LOG_DEBUG("[ESP8266] → Sending STM32_PING...\r\n");
                 // Generate new jitter for next ping
-                next_ping_jitter = get_random_jitter(STM32_PING_JITTER_MS);
+                next_ping_jitter = get_random_jitter(ping_jitter_ms);
+                ping_period = pdMS_TO_TICKS(ping_interval_ms + next_ping_jitter);
             } else {
-                print_message("[ESP8266] ERROR: Failed to send STM32_PING\r\n");
+                LOG_ERROR("[ESP8266] ERROR: Failed to send STM32_PING\r\n");
             }
         }
 
@@ -320,24 +1489,23 @@ void esp8266_comm_task_handler(void *parameters)
             if (uart_connection_ok) {
                 // Connection appears broken (first time)
                 uart_connection_ok = pdFALSE;
-                print_message("[ESP8266] ✗ ALERT: No STM32_PONG response!\r\n");
-                print_message("[ESP8266] UART connection may be broken\r\n");
+                LOG_WARN("[ESP8266] ✗ ALERT: No STM32_PONG response!\r\n");
+                LOG_WARN("[ESP8266] UART connection may be broken\r\n");
             }
             // Reset waiting flag so we can detect the next ping timeout
             waiting_for_pong = pdFALSE;
         }
 
-        // Read one byte from stream buffer with finite timeout
-        // When data is available, returns immediately (doesn't wait full timeout)
-        // When buffer empty, timeout allows periodic watchdog feeding and ping checking
-        // Short timeout (100ms) ensures responsive ping detection
+        // Drain everything available (up to one chunk)
+        // When data is available, returns immediately
+        // When buffer empty, blocks until the next ping / pong / watchdog deadline
         size_t received = xStreamBufferReceive(uart_stream_buffer,
-                                               &received_char,
-                                               1,
-                                               pdMS_TO_TICKS(100));
+                                               rx_chunk,
+                                               sizeof(rx_chunk),
+                                               next_wakeup_ticks(now, ping_period));
 
         // Feed watchdog to prove task is alive
-        // Fed on every iteration (whether data received or timeout)
+        // Fed once per wakeup (data or deadline, at most ESP8266_COMM_FEED_MS apart)
         if (wd_id != WATCHDOG_INVALID_ID) {
             watchdog_feed(wd_id);
         }
@@ -347,43 +1515,31 @@ void esp8266_comm_task_handler(void *parameters)
             continue;
         }
 
+        TRACE_CHUNK();
+        PROFILE_MARK();
+#if ESP8266_COMM_PROFILE
+        profile_wakeups++;
+#endif
+
         // Data received - check how much is still in buffer for diagnostics
         size_t bytes_available = xStreamBufferBytesAvailable(uart_stream_buffer);
         if (bytes_available > 64) {
             // Buffer filling up - log warning once
             static BaseType_t buffer_warning_shown = pdFALSE;
             if (!buffer_warning_shown) {
-                print_message("[ESP8266] WARNING: Stream buffer filling up, ESP8266 sending too fast!\r\n");
+                LOG_WARN("[ESP8266] WARNING: Stream buffer filling up, ESP8266 sending too fast!\r\n");
                 buffer_warning_shown = pdTRUE;
             }
         }
 
-        // Data received - process the character
-        {
-            // Check for line endings
-            if (received_char == '\n' || received_char == '\r') {
-                if (rx_index > 0) {
-                    // Null-terminate the string
-                    rx_buffer[rx_index] = '\0';
-
-                    // Process the command
-                    process_led_command(rx_buffer);
+        // Data received - scan the chunk for complete lines
+        process_rx_chunk(rx_chunk, received);
+        PROFILE_ACCUM();
 
-                    // Reset buffer
-                    rx_index = 0;
-                }
-            }
-            // Buffer overflow protection
-            else if (rx_index >= (UART_RX_BUFFER_SIZE - 1)) {
-                // Buffer full - discard and reset
-                rx_index = 0;
-                HAL_UART_Transmit(&huart2, (uint8_t*)"ERROR:BufferOverflow\r\n", 22, 100);
-                print_message("[ESP8266] ERROR: RX buffer overflow!\r\n");
-            }
-            // Normal character - add to buffer
-            else {
-                rx_buffer[rx_index++] = received_char;
-            }
+#if ESP8266_COMM_PROFILE
+        if (profile_lines >= ESP8266_COMM_PROFILE_LINES) {
+            profile_report();
         }
+#endif
     }
 }
@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @file           : led_curve.c
+ * @brief          : LED Brightness Curves Implementation
+ ******************************************************************************
+ * @description
+ * Integer-only math; the gamma curve is a 256-entry table in flash
+ * (round((i / 255)^2.2 × LED_CURVE_DUTY_MAX)).
+ ******************************************************************************
+ */
+
+#include "led_curve.h"
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+/** Gamma 2.2 correction: level → duty */
+static const uint16_t gamma_table[LED_LEVEL_MAX + 1] = {
+       0,    0,    0,    0,    0,    1,    1,    1,    2,    3,    3,    4,
+       5,    6,    7,    8,    9,   10,   12,   13,   15,   16,   18,   20,
+      22,   24,   26,   29,   31,   33,   36,   39,   42,   45,   48,   51,
+      54,   57,   61,   64,   68,   72,   76,   80,   84,   88,   92,   97,
+     101,  106,  111,  116,  121,  126,  132,  137,  142,  148,  154,  160,
+     166,  172,  178,  185,  191,  198,  204,  211,  218,  225,  233,  240,
+     248,  255,  263,  271,  279,  287,  295,  304,  312,  321,  330,  339,
+     348,  357,  366,  376,  385,  395,  405,  415,  425,  435,  445,  456,
+     466,  477,  488,  499,  510,  521,  533,  544,  556,  568,  580,  592,
+     604,  617,  629,  642,  655,  667,  681,  694,  707,  721,  734,  748,
+     762,  776,  790,  804,  819,  833,  848,  863,  878,  893,  909,  924,
+     940,  955,  971,  987, 1003, 1020, 1036, 1053, 1069, 1086, 1103, 1120,
+    1138, 1155, 1173, 1191, 1209, 1227, 1245, 1263, 1282, 1300, 1319, 1338,
+    1357, 1376, 1395, 1415, 1435, 1454, 1474, 1494, 1515, 1535, 1556, 1576,
+    1597, 1618, 1639, 1661, 1682, 1704, 1725, 1747, 1769, 1791, 1814, 1836,
+    1859, 1882, 1905, 1928, 1951, 1974, 1998, 2022, 2046, 2070, 2094, 2118,
+    2143, 2167, 2192, 2217, 2242, 2267, 2293, 2318, 2344, 2370, 2396, 2422,
+    2448, 2475, 2501, 2528, 2555, 2582, 2609, 2637, 2664, 2692, 2720, 2748,
+    2776, 2805, 2833, 2862, 2891, 2920, 2949, 2978, 3008, 3037, 3067, 3097,
+    3127, 3157, 3188, 3218, 3249, 3280, 3311, 3342, 3373, 3405, 3437, 3469,
+    3501, 3533, 3565, 3598, 3630, 3663, 3696, 3729, 3762, 3796, 3829, 3863,
+    3897, 3931, 3966, 4000
+};
+
+#if LED_CURVE_DUTY_MAX != 4000
+#error "gamma_table is generated for LED_CURVE_DUTY_MAX = 4000"
+#endif
+
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Convert a brightness level to a PWM duty
+ */
+uint16_t led_curve_duty(uint8_t level, led_curve_t curve)
+{
+    if (curve == LED_CURVE_GAMMA) {
+        return gamma_table[level];
+    }
+    return (uint16_t)(((uint32_t)level * LED_CURVE_DUTY_MAX + LED_LEVEL_MAX / 2) / LED_LEVEL_MAX);
+}
+
+/**
+ * @brief  Level at a point of a fade
+ */
+uint8_t led_curve_fade(uint8_t from, uint8_t to, uint32_t elapsed_ms, uint32_t duration_ms)
+{
+    if (elapsed_ms >= duration_ms) {
+        return to;
+    }
+
+    int32_t delta = (int32_t)to - (int32_t)from;
+    return (uint8_t)(from + (delta * (int32_t)elapsed_ms) / (int32_t)duration_ms);
+}
+
+/**
+ * @brief  Level at a point of a breathing cycle (0 → peak → 0)
+ */
+uint8_t led_curve_breathe(uint8_t peak, uint32_t t_ms, uint32_t period_ms)
+{
+    uint32_t half = period_ms / 2;
+
+    if (half == 0) {
+        return peak;
+    }
+
+    uint32_t phase = t_ms % period_ms;
+    if (phase < half) {
+        return (uint8_t)((peak * phase) / half);                     // Inhale
+    }
+    return (uint8_t)((peak * (period_ms - phase)) / (period_ms - half));   // Exhale
+}
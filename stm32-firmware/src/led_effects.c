@@ -1,196 +1,953 @@
 /**
  ******************************************************************************
  * @file           : led_effects.c
- * @brief          : LED Pattern Control Using FreeRTOS Software Timers
+ * @brief          : LED Pattern Control Using Keyframe Sequences
  ******************************************************************************
  * @description
- * This module implements various LED blinking patterns using FreeRTOS software
- * timers. It provides a clean interface for pattern selection without blocking
- * any tasks.
+ * This module plays LED patterns described as const keyframe tables.
+ * Adding a pattern means adding a table below and an entry in
+ * pattern_table[]; there is no per-pattern timer code.
  *
  * Available Patterns:
  * ┌──────────┬────────────────────────────────────────────┐
  * │ Pattern  │ Description                                │
  * ├──────────┼────────────────────────────────────────────┤
- * │ NONE     │ Both LEDs OFF (timers stopped)             │
- * │ 1        │ Both LEDs always ON (static, no timers)    │
+ * │ NONE     │ All LEDs OFF (tick stopped)                │
+ * │ 1        │ Both LEDs always ON (static, no tick)      │
  * │ 2        │ Green: 100ms, Orange: 1000ms (async blink) │
  * │ 3        │ Both: 100ms (synchronized blink)           │
  * └──────────┴────────────────────────────────────────────┘
  *
  * Implementation:
- * - Uses 2 auto-reload software timers (one per LED)
- * - Timers run in Timer Service Task (separate from app tasks)
- * - Timer callbacks toggle GPIO pins directly
- * - Periods are dynamically changed using xTimerChangePeriod()
+ * - One scheduler for all tracks on TIM7 in one-pulse mode; it replaces
+ *   the two FreeRTOS software timers and their command queue
+ * - Each track keeps the absolute time of its next edge (a phase
+ *   accumulator: next_edge += duration), so edges never drift with
+ *   interrupt latency
+ * - TIM7 is armed for the earliest next edge only; there is no periodic
+ *   tick, and nothing is armed while every track is holding
+ * - led_effects_play() builds the new schedule in the idle half of a
+ *   double buffer and swaps it in with one critical section
+ * - Tracks with a phase offset start part-way into their loop; all tracks
+ *   share the sequencer time, so phase-locked groups stay locked
  *
  * Hardware:
- * - LED_GREEN (LD4) on GPIO PD12
- * - LED_ORANGE (LD3) on GPIO PD13
- *
- * @note Software timers execute in timer service task context
- *       GPIO operations in callbacks are safe (ISR-safe HAL functions)
+ * - LEDs on TIM4 CH1-CH4 (led_pwm.c)
+ * - Tick on TIM7 (basic timer, no pins)
  ******************************************************************************
  */
 
 #include "led_effects.h"
 #include "FreeRTOS.h"
-#include "timers.h"
+#include "task.h"
+#include "config_store.h"
+#include <string.h>
+#if LED_SYNC_PROFILE
+#include "print_task.h"
+#include <stdio.h>
+#endif
 
-/* Software timer handles */
-static TimerHandle_t led_timer1 = NULL;  // Controls LED_GREEN (LD4)
-static TimerHandle_t led_timer2 = NULL;  // Controls LED_ORANGE (LD3)
+/*============================================================================
+ * Pattern Tables
+ *===========================================================================*/
 
-/* Current active pattern */
-static LED_Pattern_t current_pattern = LED_PATTERN_NONE;
+#define LED_MASK_GO     (LED_MASK(LED_GREEN) | LED_MASK(LED_ORANGE))
 
-void led_effects_init(void)
-{
-    // Create software timers for LED control
-    // Timer 1: for LED1 (Green - LD4)
-    led_timer1 = xTimerCreate("LED_Timer1",
-                              pdMS_TO_TICKS(100),
-                              pdTRUE,  // Auto-reload
-                              (void *)0,
-                              led_timer1_callback);
+/* NONE: everything off, held */
+LED_TRACK(all_off,
+    LED_KEY(LED_MASK_ALL, 0, 0));
+LED_SEQUENCE(pattern_none, LED_TRACK_REF(all_off));
+
+/* 1: Green + Orange on, held */
+LED_TRACK(both_on,
+    LED_KEY(LED_MASK_GO, LED_LEVEL_MAX, 0));
+LED_SEQUENCE(pattern_1, LED_TRACK_REF(both_on));
+
+/* 2: Green toggles every 100ms, Orange every 1000ms (start OFF) */
+LED_TRACK(green_fast,
+    LED_KEY(LED_MASK(LED_GREEN), 0,             100),
+    LED_KEY(LED_MASK(LED_GREEN), LED_LEVEL_MAX, 100));
+LED_TRACK(orange_slow,
+    LED_KEY(LED_MASK(LED_ORANGE), 0,             1000),
+    LED_KEY(LED_MASK(LED_ORANGE), LED_LEVEL_MAX, 1000));
+LED_SEQUENCE(pattern_2, LED_TRACK_REF(green_fast), LED_TRACK_REF(orange_slow));
+
+/* 3: Green + Orange toggle together every 100ms (one track, one phase) */
+LED_TRACK(both_fast,
+    LED_KEY(LED_MASK_GO, 0,             100),
+    LED_KEY(LED_MASK_GO, LED_LEVEL_MAX, 100));
+LED_SEQUENCE(pattern_3, LED_TRACK_REF(both_fast));
+
+/** LED_Pattern_t → sequence */
+static const led_sequence_t *const pattern_table[LED_PATTERN_COUNT] = {
+    [LED_PATTERN_NONE] = &pattern_none,
+    [LED_PATTERN_1]    = &pattern_1,
+    [LED_PATTERN_2]    = &pattern_2,
+    [LED_PATTERN_3]    = &pattern_3,
+};
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+TIM_HandleTypeDef htim7;
+
+/* Per-track scheduler state */
+typedef struct {
+    uint8_t index;          // Current keyframe
+    uint8_t holding;        // 1 = no further edges (duration 0 or single key)
+    uint32_t next_edge;     // Sequencer time (ms) of the next keyframe
+} led_track_state_t;
+
+/* One complete schedule; only the active one is touched by the ISR */
+typedef struct {
+    const led_sequence_t *sequence;
+    TickType_t origin;      // RTOS tick at which sequencer time 0 began
+    uint32_t now;           // Sequencer time (ms) at the last wakeup
+    uint32_t armed_ms;      // Length of the shot TIM7 is running, 0 = idle
+    led_track_state_t track[LED_SEQ_MAX_TRACKS];
+} led_schedule_t;
+
+static led_schedule_t schedule[2];
+static volatile uint8_t active_schedule = 0;
+
+/* Storage for a run-time scene built by led_effects_blink() */
+typedef struct {
+    led_keyframe_t frames[LED_SEQ_MAX_TRACKS][2];
+    led_track_t tracks[LED_SEQ_MAX_TRACKS];
+    led_sequence_t sequence;
+    uint8_t members;                    // LED_MASK() bits of leds[] in use
+    led_blink_t leds[LED_COUNT];        // Per-LED parameters (led_effects_save)
+} led_blink_group_t;
+
+/* Sequence slot: scheduled sequences wait here until their due tick, and
+ * run-time scenes keep their keyframes here while they play */
+typedef enum {
+    SLOT_FREE = 0,
+    SLOT_BUILDING,          // Owned by the task filling it
+    SLOT_PENDING,           // In pending_order[], waiting for its due tick
+    SLOT_PLAYING            // Referenced by the active schedule
+} led_slot_state_t;
+
+typedef struct {
+    led_slot_state_t state;
+    TickType_t due;
+    const led_sequence_t *sequence;     // Table pattern or &group.sequence
+    led_blink_group_t group;
+} led_slot_t;
+
+#define LED_SEQ_SLOTS   (LED_SEQ_PENDING_MAX + 2)   // + playing + building
+#define LED_SEQ_NO_SLOT 0xFF
 
-    // Timer 2: for LED2 (Orange - LD3)
-    led_timer2 = xTimerCreate("LED_Timer2",
-                              pdMS_TO_TICKS(100),
-                              pdTRUE,  // Auto-reload
-                              (void *)0,
-                              led_timer2_callback);
+static led_slot_t slots[LED_SEQ_SLOTS];
+static uint8_t playing_slot = LED_SEQ_NO_SLOT;
 
-    // Ensure both LEDs start OFF
-    HAL_GPIO_WritePin(GPIOD, LED_GREEN_PIN, GPIO_PIN_RESET);
-    HAL_GPIO_WritePin(GPIOD, LED_ORANGE_PIN, GPIO_PIN_RESET);
+/* Pending slots ordered by due tick (earliest first) */
+static uint8_t pending_order[LED_SEQ_PENDING_MAX];
+static uint8_t pending_count = 0;
+
+/* Sequences started so far, and the count led_effects_save() last stored */
+static volatile uint32_t start_count = 0;
+static uint32_t saved_count = 0;
+
+#if LED_SYNC_PROFILE
+/* Worst spread of LED updates within one wakeup (DWT cycles) */
+static uint32_t profile_max_skew = 0;
+static uint32_t profile_group_edges = 0;   // Wakeups that changed >1 LED
+static uint32_t profile_leds = 0;          // LEDs updated in this wakeup
+static uint32_t profile_last = 0;          // CYCCNT after the last update
+#endif
+
+/*============================================================================
+ * Private Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Drive the LEDs of one keyframe
+ * @param  kf: Keyframe
+ * @param  from_isr: pdTRUE in the TIM7 interrupt
+ */
+static void apply_keyframe(const led_keyframe_t *kf, BaseType_t from_isr)
+{
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        if ((kf->mask & LED_MASK(led)) == 0) {
+            continue;
+        }
+
+        uint16_t fade_ms = (kf->fade == LED_KEY_MODE_FADE) ? kf->duration_ms : 0;
+        if (kf->fade == LED_KEY_MODE_BREATHE) {
+            if (from_isr) {
+                led_pwm_breathe_from_isr((led_id_t)led, kf->level, kf->duration_ms);
+            } else {
+                led_pwm_breathe((led_id_t)led, kf->level, kf->duration_ms);
+            }
+        } else if (from_isr) {
+            led_pwm_fade_from_isr((led_id_t)led, kf->level, fade_ms, LED_PWM_DEFAULT_CURVE);
+        } else {
+            led_pwm_fade((led_id_t)led, kf->level, fade_ms, LED_PWM_DEFAULT_CURVE);
+        }
+#if LED_SYNC_PROFILE
+        profile_leds++;
+        profile_last = DWT->CYCCNT;
+#endif
+    }
 }
 
 /**
- * @brief  Set LED pattern - Main control function
- * @param  pattern: Desired LED pattern (LED_PATTERN_NONE, 1, 2, or 3)
- * @retval None
- *
- * Pattern Implementation Details:
+ * @brief  Position a track at its phase offset
+ * @param  track: Track
+ * @param  st: State to fill (index, holding, next_edge)
  *
- * PATTERN_NONE (0):
- * - Stop both timers
- * - Turn OFF both LEDs
- * - No CPU overhead (timers inactive)
+ * Tracks containing a hold keyframe (duration 0) ignore the offset.
+ */
+static void track_seek(const led_track_t *track, led_track_state_t *st)
+{
+    uint32_t loop_ms = 0;
+    uint32_t offset;
+
+    st->index = 0;
+    for (uint8_t i = 0; i < track->count; i++) {
+        if (track->frames[i].duration_ms == 0) {
+            loop_ms = 0;
+            break;
+        }
+        loop_ms += track->frames[i].duration_ms;
+    }
+
+    offset = (loop_ms != 0) ? track->phase_ms % loop_ms : 0;
+    while (loop_ms != 0 && offset >= track->frames[st->index].duration_ms) {
+        offset -= track->frames[st->index].duration_ms;
+        st->index++;
+    }
+
+    st->next_edge = track->frames[st->index].duration_ms - offset;
+    st->holding = (track->count < 2 || track->frames[st->index].duration_ms == 0);
+}
+
+#if LED_SYNC_PROFILE
+/**
+ * @brief  Log the worst group skew since the last report, then reset
+ */
+static void profile_report(void)
+{
+    char msg[80];
+
+    if (profile_group_edges == 0) {
+        return;
+    }
+    snprintf(msg, sizeof(msg), "[LED] sync: max skew %lu cycles over %lu group edges\r\n",
+             (unsigned long)profile_max_skew, (unsigned long)profile_group_edges);
+    profile_max_skew = 0;
+    profile_group_edges = 0;
+    print_message(msg);
+}
+#endif
+
+/**
+ * @brief  Stop TIM7 and drop a pending update
+ */
+static void timer_disarm(void)
+{
+    __HAL_TIM_DISABLE(&htim7);
+    __HAL_TIM_CLEAR_FLAG(&htim7, TIM_FLAG_UPDATE);
+}
+
+/**
+ * @brief  Arm TIM7 for the earliest next edge or scheduled sequence
+ * @param  sch: Schedule (sch->now is the current sequencer time)
  *
- * PATTERN_1 (Always ON):
- * - Stop both timers (not needed)
- * - Set both LEDs HIGH
- * - Static state, no periodic activity
+ * Leaves TIM7 stopped (armed_ms = 0) when every track is holding and
+ * nothing is scheduled. Waits longer than LED_SEQ_MAX_SHOT_MS are split
+ * into several shots.
+ */
+static void timer_arm_next(led_schedule_t *sch)
+{
+    uint32_t wait = UINT32_MAX;
+
+    for (uint8_t t = 0; t < sch->sequence->num_tracks; t++) {
+        const led_track_state_t *st = &sch->track[t];
+        if (!st->holding && st->next_edge - sch->now < wait) {
+            wait = st->next_edge - sch->now;
+        }
+    }
+
+    // Earliest scheduled sequence (pending_order[] is sorted)
+    if (pending_count != 0) {
+        int32_t until = (int32_t)(slots[pending_order[0]].due - (sch->origin + sch->now));
+        uint32_t due_wait = (until > 0) ? (uint32_t)until : 0;
+        if (due_wait < wait) {
+            wait = due_wait;
+        }
+    }
+
+    if (wait == UINT32_MAX) {
+        sch->armed_ms = 0;
+        return;
+    }
+    if (wait == 0) {
+        wait = 1;               // Edge already due: fire on the next count
+    }
+    if (wait > LED_SEQ_MAX_SHOT_MS) {
+        wait = LED_SEQ_MAX_SHOT_MS;
+    }
+
+    sch->armed_ms = wait;
+    __HAL_TIM_SET_AUTORELOAD(&htim7, wait * (LED_SEQ_TIMER_HZ / 1000U) - 1U);
+    __HAL_TIM_SET_COUNTER(&htim7, 0);
+    __HAL_TIM_ENABLE(&htim7);   // One-pulse mode clears CEN at the update
+}
+
+/**
+ * @brief  Bring sch->now up to date and stop TIM7 before re-arming
+ * @param  sch: Active schedule
+ * @note   Interrupts masked. Running tracks lose at most one timer count
+ *         (0.5 ms) of phase.
+ */
+static void clock_resync(led_schedule_t *sch)
+{
+    uint32_t elapsed;
+
+    __HAL_TIM_DISABLE(&htim7);
+    if (sch->armed_ms == 0) {
+        elapsed = (uint32_t)(xTaskGetTickCount() - sch->origin) - sch->now;   // Idle: RTOS time
+    } else if (__HAL_TIM_GET_FLAG(&htim7, TIM_FLAG_UPDATE)) {
+        elapsed = sch->armed_ms;                // Shot expired, ISR not run yet
+    } else {
+        elapsed = __HAL_TIM_GET_COUNTER(&htim7) / (LED_SEQ_TIMER_HZ / 1000U);
+    }
+    __HAL_TIM_CLEAR_FLAG(&htim7, TIM_FLAG_UPDATE);
+
+    sch->now += elapsed;
+    sch->armed_ms = 0;
+}
+
+/**
+ * @brief  Start a sequence from its first keyframes (interrupts masked)
+ * @param  sequence: Sequence to play
+ * @param  slot: Slot holding it, or LED_SEQ_NO_SLOT for a table pattern
+ * @param  origin: RTOS tick that becomes sequencer time 0
+ * @param  from_isr: pdTRUE in the TIM7 interrupt
  *
- * PATTERN_2 (Different Frequencies):
- * - Timer1: 100ms period (Green LED toggles every 100ms)
- * - Timer2: 1000ms period (Orange LED toggles every 1 second)
- * - Creates visually distinct blinking pattern
+ * Builds the idle schedule, swaps it in and re-arms TIM7. The slot of the
+ * sequence that was playing is released.
+ */
+static void sequence_start(const led_sequence_t *sequence, uint8_t slot,
+                           TickType_t origin, BaseType_t from_isr)
+{
+    led_schedule_t *next = &schedule[active_schedule ^ 1U];
+    uint8_t driven = 0;
+
+    next->sequence = sequence;
+    next->origin = origin;
+    next->now = 0;
+    next->armed_ms = 0;
+
+    for (uint8_t t = 0; t < sequence->num_tracks; t++) {
+        const led_track_t *track = &sequence->tracks[t];
+        led_track_state_t *st = &next->track[t];
+
+        st->index = 0;
+        st->holding = 1;
+        st->next_edge = 0;
+        if (track->count == 0) {
+            continue;
+        }
+
+        track_seek(track, st);
+        driven |= track->frames[st->index].mask;
+    }
+
+    timer_disarm();
+    active_schedule ^= 1U;
+    start_count++;
+
+    if (playing_slot != LED_SEQ_NO_SLOT) {
+        slots[playing_slot].state = SLOT_FREE;
+    }
+    playing_slot = slot;
+    if (slot != LED_SEQ_NO_SLOT) {
+        slots[slot].state = SLOT_PLAYING;
+    }
+
+    for (uint8_t t = 0; t < sequence->num_tracks; t++) {
+        if (sequence->tracks[t].count != 0) {
+            apply_keyframe(&sequence->tracks[t].frames[next->track[t].index], from_isr);
+        }
+    }
+
+    // LEDs no track drives are off
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        if ((driven & LED_MASK(led)) == 0) {
+            if (from_isr) {
+                led_pwm_set_from_isr((led_id_t)led, 0);
+            } else {
+                led_pwm_set((led_id_t)led, 0);
+            }
+        }
+    }
+
+    timer_arm_next(next);
+}
+
+/**
+ * @brief  Claim a free sequence slot
+ * @retval Slot index (state SLOT_BUILDING), or LED_SEQ_NO_SLOT if none
+ */
+static uint8_t slot_alloc(void)
+{
+    uint8_t found = LED_SEQ_NO_SLOT;
+
+    taskENTER_CRITICAL();
+    for (uint8_t i = 0; i < LED_SEQ_SLOTS; i++) {
+        if (slots[i].state == SLOT_FREE) {
+            slots[i].state = SLOT_BUILDING;
+            found = i;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return found;
+}
+
+/**
+ * @brief  Play a sequence now or queue it for a due tick
+ * @param  sequence: Sequence to play
+ * @param  slot: Slot holding it (required when scheduled), or LED_SEQ_NO_SLOT
+ * @param  scheduled: pdFALSE = now, pdTRUE = at due
+ * @param  due: RTOS tick to start at
+ * @retval 0 on success, -1 if the pending queue is full (slot released)
  *
- * PATTERN_3 (Same Frequency):
- * - Both timers: 100ms period
- * - LEDs blink in sync (can start out of phase)
- * - Creates fast synchronized blinking
+ * A due tick that has already passed starts the sequence immediately.
+ */
+static int sequence_submit(const led_sequence_t *sequence, uint8_t slot,
+                           BaseType_t scheduled, TickType_t due)
+{
+    int result = 0;
+
+    taskENTER_CRITICAL();
+    TickType_t now = xTaskGetTickCount();
+
+    if (!scheduled || (int32_t)(now - due) >= 0) {
+        sequence_start(sequence, slot, now, pdFALSE);
+    } else if (pending_count >= LED_SEQ_PENDING_MAX) {
+        slots[slot].state = SLOT_FREE;
+        result = -1;
+    } else {
+        // Insert by due tick; equal ticks keep arrival order
+        uint8_t pos = pending_count;
+        while (pos > 0 && (int32_t)(slots[pending_order[pos - 1]].due - due) > 0) {
+            pending_order[pos] = pending_order[pos - 1];
+            pos--;
+        }
+        slots[slot].sequence = sequence;
+        slots[slot].due = due;
+        slots[slot].state = SLOT_PENDING;
+        pending_order[pos] = slot;
+        pending_count++;
+
+        // The new entry may be due before the current wakeup
+        led_schedule_t *sch = &schedule[active_schedule];
+        clock_resync(sch);
+        timer_arm_next(sch);
+    }
+    taskEXIT_CRITICAL();
+
+    return result;
+}
+
+/**
+ * @brief  Fill a slot's blink group from led_blink_t entries
+ * @param  group: Group storage (slot owned by the caller)
+ * @param  blinks: Blink groups
+ * @param  count: Number of groups
+ * @retval 0 on success, -1 on invalid arguments
  *
- * @note Always stops existing timers first to prevent glitches
- * @note xTimerChangePeriod() also starts the timer if stopped
+ * One track per LED. A track's loop starts with the on keyframe, so an
+ * on-edge delayed by phase_ms means starting (period - phase_ms) into
+ * the loop.
  */
-void led_effects_set_pattern(LED_Pattern_t pattern)
+static int blink_build(led_blink_group_t *group, const led_blink_t *blinks, uint8_t count)
 {
-    // Safety: Stop all running timers before pattern change
-    // This prevents orphaned timers from previous pattern
-    if (led_timer1 != NULL) {
-        xTimerStop(led_timer1, 0);  // 0 = don't block if timer queue full
+    uint8_t used = 0;
+    uint8_t n = 0;
+
+    group->members = 0;
+    for (uint8_t b = 0; b < count; b++) {
+        const led_blink_t *blink = &blinks[b];
+
+        if (blink->period_ms == 0 || blink->phase_ms >= blink->period_ms
+                || (blink->mask & ~LED_MASK_ALL) != 0 || (blink->mask & used) != 0) {
+            return -1;
+        }
+        used |= blink->mask;
+
+        for (uint8_t led = 0; led < LED_COUNT; led++) {
+            if ((blink->mask & LED_MASK(led)) == 0) {
+                continue;
+            }
+
+            led_keyframe_t *kf = group->frames[n];
+            led_track_t *track = &group->tracks[n];
+            track->frames = kf;
+            track->phase_ms = 0;
+
+            group->leds[led] = *blink;
+            group->leds[led].mask = (uint8_t)LED_MASK(led);
+            group->members |= (uint8_t)LED_MASK(led);
+
+            if (blink->breathe) {
+                // The PWM engine loops the breath: one held keyframe
+                kf[0] = (led_keyframe_t)LED_KEY_BREATHE(LED_MASK(led), blink->level, blink->period_ms);
+                track->count = 1;
+            } else if (blink->on_ms == 0 || blink->on_ms >= blink->period_ms) {
+                // Solid off / solid on: one held keyframe, no wakeups
+                kf[0] = (led_keyframe_t)LED_KEY(LED_MASK(led), blink->on_ms ? blink->level : 0, 0);
+                track->count = 1;
+            } else {
+                kf[0] = (led_keyframe_t)LED_KEY(LED_MASK(led), blink->level, blink->on_ms);
+                kf[1] = (led_keyframe_t)LED_KEY(LED_MASK(led), 0, blink->period_ms - blink->on_ms);
+                track->count = 2;
+                track->phase_ms = (uint16_t)((blink->period_ms - blink->phase_ms) % blink->period_ms);
+            }
+            n++;
+        }
     }
-    if (led_timer2 != NULL) {
-        xTimerStop(led_timer2, 0);
+
+    if (n == 0) {
+        return -1;
     }
 
-    // Update pattern state
-    current_pattern = pattern;
+    group->sequence.tracks = group->tracks;
+    group->sequence.num_tracks = n;
+    return 0;
+}
 
-    // Configure LEDs and timers based on selected pattern
-    switch (pattern) {
-        case LED_PATTERN_1:
-            // Pattern 1: Always ON 2 LEDs
-            HAL_GPIO_WritePin(GPIOD, LED_GREEN_PIN, GPIO_PIN_SET);
-            HAL_GPIO_WritePin(GPIOD, LED_ORANGE_PIN, GPIO_PIN_SET);
-            break;
+/**
+ * @brief  Build a blink scene in a fresh slot and submit it
+ * @retval 0 on success, -1 on invalid arguments or no free slot
+ */
+static int blink_submit(const led_blink_t *blinks, uint8_t count,
+                        BaseType_t scheduled, TickType_t due)
+{
+    uint8_t slot = slot_alloc();
 
-        case LED_PATTERN_2:
-            // Pattern 2: Different frequency blinking
-            // Creates visual contrast - one fast, one slow
-            HAL_GPIO_WritePin(GPIOD, LED_GREEN_PIN, GPIO_PIN_RESET);
-            HAL_GPIO_WritePin(GPIOD, LED_ORANGE_PIN, GPIO_PIN_RESET);
+    if (slot == LED_SEQ_NO_SLOT) {
+        return -1;
+    }
+    if (blink_build(&slots[slot].group, blinks, count) != 0) {
+        slots[slot].state = SLOT_FREE;          // Nothing else touches BUILDING
+        return -1;
+    }
+    return sequence_submit(&slots[slot].group.sequence, slot, scheduled, due);
+}
 
-            // Configure periods: Green=100ms, Orange=1000ms (10:1 ratio)
-            xTimerChangePeriod(led_timer1, pdMS_TO_TICKS(100), 0);
-            xTimerChangePeriod(led_timer2, pdMS_TO_TICKS(1000), 0);
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
 
-            // Start both timers (xTimerChangePeriod also starts, but explicit for clarity)
-            xTimerStart(led_timer1, 0);
-            xTimerStart(led_timer2, 0);
-            break;
+void led_effects_init(void)
+{
+    // Hand PD12-PD15 to TIM4 PWM (all LEDs off)
+    led_pwm_init();
 
-        case LED_PATTERN_3:
-            // Pattern 3: Synchronized fast blinking
-            // Both LEDs toggle at same rate (may be out of phase initially)
-            HAL_GPIO_WritePin(GPIOD, LED_GREEN_PIN, GPIO_PIN_RESET);
-            HAL_GPIO_WritePin(GPIOD, LED_ORANGE_PIN, GPIO_PIN_RESET);
+    // TIM7: 2 kHz count, one-pulse mode, ARR set per shot
+    htim7.Instance = TIM7;
+    htim7.Init.Prescaler = LED_SEQ_TIM_PRESCALER;
+    htim7.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim7.Init.Period = 0xFFFF;
+    htim7.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_Base_Init(&htim7) != HAL_OK) {
+        Error_Handler();
+    }
+#if LED_SYNC_PROFILE
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    htim7.Instance->CR1 |= TIM_CR1_OPM;
+    timer_disarm();                                 // Init sets UIF via UG
+    __HAL_TIM_ENABLE_IT(&htim7, TIM_IT_UPDATE);
 
-            // Both timers: 100ms period (fast blink)
-            xTimerChangePeriod(led_timer1, pdMS_TO_TICKS(100), 0);
-            xTimerChangePeriod(led_timer2, pdMS_TO_TICKS(100), 0);
+    // Ensure all LEDs start OFF
+    led_effects_play(&pattern_none);
+}
 
-            // Start both timers
-            xTimerStart(led_timer1, 0);
-            xTimerStart(led_timer2, 0);
-            break;
+/**
+ * @brief  Set LED pattern - looks up the pattern's keyframe table
+ * @param  pattern: Desired LED pattern (LED_PATTERN_NONE, 1, 2, or 3)
+ * @retval None
+ */
+void led_effects_set_pattern(LED_Pattern_t pattern)
+{
+    if ((unsigned)pattern >= LED_PATTERN_COUNT) {
+        pattern = LED_PATTERN_NONE;
+    }
+    led_effects_play(pattern_table[pattern]);
+}
 
-        default:
-            // PATTERN_NONE or invalid: Turn off all LEDs
-            // Timers already stopped at function entry
-            HAL_GPIO_WritePin(GPIOD, LED_GREEN_PIN, GPIO_PIN_RESET);
-            HAL_GPIO_WritePin(GPIOD, LED_ORANGE_PIN, GPIO_PIN_RESET);
-            break;
+/**
+ * @brief  Switch to a pattern at a given RTOS tick
+ * @param  pattern: Desired LED pattern
+ * @param  due_tick: Tick to switch at (already passed = now)
+ * @retval 0 on success, -1 if the pattern is unknown or the queue is full
+ */
+int led_effects_set_pattern_at(LED_Pattern_t pattern, TickType_t due_tick)
+{
+    uint8_t slot;
+
+    if ((unsigned)pattern >= LED_PATTERN_COUNT || (slot = slot_alloc()) == LED_SEQ_NO_SLOT) {
+        return -1;
     }
+    return sequence_submit(pattern_table[pattern], slot, pdTRUE, due_tick);
 }
 
 /**
- * @brief  Timer 1 Callback - Controls Green LED (LD4)
- * @param  xTimer: Timer handle (unused but required by FreeRTOS API)
+ * @brief  Play a keyframe sequence from its first keyframes
+ * @param  sequence: Sequence to play
  * @retval None
  *
- * Execution Context:
- * - Runs in Timer Service Task context (NOT interrupt!)
- * - Priority determined by configTIMER_TASK_PRIORITY
- * - Can safely call FreeRTOS APIs (non-ISR versions)
+ * The new schedule is built, swapped in and re-armed in one critical
+ * section (TIM7 runs below configMAX_SYSCALL_INTERRUPT_PRIORITY), so the
+ * interrupt sees either the old pattern or the new one, never a mix.
+ * Scheduled sequences still pending are not affected.
+ */
+void led_effects_play(const led_sequence_t *sequence)
+{
+    if (sequence == NULL || sequence->num_tracks > LED_SEQ_MAX_TRACKS) {
+        return;
+    }
+
+#if LED_SYNC_PROFILE
+    profile_report();
+#endif
+
+    (void)sequence_submit(sequence, LED_SEQ_NO_SLOT, pdFALSE, 0);
+}
+
+/**
+ * @brief  Play a run-time blink scene
+ * @param  blinks: Blink groups (copied, may be on the stack)
+ * @param  count: Number of groups
+ * @retval 0 on success, -1 on invalid arguments (nothing changes)
+ */
+int led_effects_blink(const led_blink_t *blinks, uint8_t count)
+{
+#if LED_SYNC_PROFILE
+    profile_report();
+#endif
+    return blink_submit(blinks, count, pdFALSE, 0);
+}
+
+/**
+ * @brief  Play a run-time blink scene at a given RTOS tick
+ * @param  blinks: Blink groups (copied)
+ * @param  count: Number of groups
+ * @param  due_tick: Tick to start at (already passed = now)
+ * @retval 0 on success, -1 on invalid arguments or full queue
+ */
+int led_effects_blink_at(const led_blink_t *blinks, uint8_t count, TickType_t due_tick)
+{
+    return blink_submit(blinks, count, pdTRUE, due_tick);
+}
+
+/**
+ * @brief  Expand a synchronized group into one led_blink_t per LED
+ * @param  mask: LED_MASK() bits of the group
+ * @param  period_ms: Blink period
+ * @param  level: On brightness
+ * @param  mode: LED_SYNC_IN_PHASE, LED_SYNC_ANTI_PHASE, LED_SYNC_CHASE
+ *         or LED_SYNC_BREATHE
+ * @param  blinks: LED_COUNT entries
+ * @retval Number of entries filled, 0 on invalid arguments
  *
- * @note This is an auto-reload timer - callback executes periodically
- * @note HAL_GPIO_TogglePin() is atomic and ISR-safe
+ * Same period for every LED, on-edge delayed per mode. Played as one
+ * blink scene, the group shares the sequencer time base and stays locked
+ * for as long as it plays.
+ */
+static uint8_t sync_expand(uint8_t mask, uint16_t period_ms, uint8_t level,
+                           led_sync_mode_t mode, led_blink_t *blinks)
+{
+    uint8_t members = 0;
+    uint16_t on_ms;
+
+    mask &= LED_MASK_ALL;
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        if (mask & LED_MASK(led)) {
+            members++;
+        }
+    }
+
+    if (members == 0 || period_ms < 2) {
+        return 0;
+    }
+
+    on_ms = period_ms / 2;
+    if (mode == LED_SYNC_CHASE && members > 1) {
+        on_ms = period_ms / members;
+        if (on_ms == 0) {
+            return 0;
+        }
+    }
+
+    uint8_t n = 0;
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        if ((mask & LED_MASK(led)) == 0) {
+            continue;
+        }
+
+        uint16_t phase = 0;
+        if (mode == LED_SYNC_ANTI_PHASE) {
+            phase = (n & 1U) ? period_ms / 2 : 0;
+        } else if (mode == LED_SYNC_CHASE) {
+            phase = (uint16_t)(n * on_ms);      // LED n lights n slots after LED 0
+        }
+
+        blinks[n].mask = (uint8_t)LED_MASK(led);
+        blinks[n].level = level;
+        blinks[n].period_ms = period_ms;
+        blinks[n].on_ms = on_ms;
+        blinks[n].phase_ms = phase;
+        blinks[n].breathe = (mode == LED_SYNC_BREATHE) ? 1U : 0U;
+        n++;
+    }
+
+    return n;
+}
+
+/**
+ * @brief  Blink a group of LEDs on one shared time base
+ * @param  mask: LED_MASK() bits of the group
+ * @param  period_ms: Blink period
+ * @param  level: On brightness
+ * @param  mode: LED_SYNC_IN_PHASE, LED_SYNC_ANTI_PHASE, LED_SYNC_CHASE
+ *         or LED_SYNC_BREATHE
+ * @retval 0 on success, -1 on invalid arguments
+ */
+int led_effects_sync(uint8_t mask, uint16_t period_ms, uint8_t level, led_sync_mode_t mode)
+{
+    led_blink_t blinks[LED_COUNT];
+    uint8_t n = sync_expand(mask, period_ms, level, mode, blinks);
+
+    return (n != 0) ? led_effects_blink(blinks, n) : -1;
+}
+
+/**
+ * @brief  led_effects_sync() at a given RTOS tick
+ * @param  mask: LED_MASK() bits of the group
+ * @param  period_ms: Blink period
+ * @param  level: On brightness
+ * @param  mode: LED_SYNC_IN_PHASE, LED_SYNC_ANTI_PHASE, LED_SYNC_CHASE
+ *         or LED_SYNC_BREATHE
+ * @param  due_tick: xTaskGetTickCount() value to start at
+ * @retval 0 if queued (or applied), -1 on invalid arguments or full queue
  */
-void led_timer1_callback(TimerHandle_t xTimer)
+int led_effects_sync_at(uint8_t mask, uint16_t period_ms, uint8_t level,
+                        led_sync_mode_t mode, TickType_t due_tick)
 {
-    // Toggle Green LED state (ON->OFF or OFF->ON)
-    HAL_GPIO_TogglePin(GPIOD, LED_GREEN_PIN);
+    led_blink_t blinks[LED_COUNT];
+    uint8_t n = sync_expand(mask, period_ms, level, mode, blinks);
+
+    return (n != 0) ? led_effects_blink_at(blinks, n, due_tick) : -1;
 }
 
 /**
- * @brief  Timer 2 Callback - Controls Orange LED (LD3)
- * @param  xTimer: Timer handle (unused but required by FreeRTOS API)
+ * @brief  Store what is playing if it changed since the last call
  * @retval None
  *
- * Execution Context:
- * - Runs in Timer Service Task context (NOT interrupt!)
- * - Priority determined by configTIMER_TASK_PRIORITY
- * - Can safely call FreeRTOS APIs (non-ISR versions)
- *
- * @note This is an auto-reload timer - callback executes periodically
- * @note HAL_GPIO_TogglePin() is atomic and ISR-safe
+ * A scene is stored LED by LED (CONFIG_KEY_SCENE_*) before
+ * CONFIG_KEY_PATTERN switches to CONFIG_PATTERN_SCENE; unchanged keys cost
+ * no flash write.
+ */
+void led_effects_save(void)
+{
+    led_blink_t leds[LED_COUNT];
+    uint8_t members = 0;
+    LED_Pattern_t pattern;
+    uint32_t count;
+
+    // Snapshot: the TIM7 interrupt may start a scheduled sequence any time
+    taskENTER_CRITICAL();
+    count = start_count;
+    pattern = led_effects_get_pattern();
+    if (pattern == LED_PATTERN_COUNT && playing_slot != LED_SEQ_NO_SLOT
+            && schedule[active_schedule].sequence == &slots[playing_slot].group.sequence) {
+        members = slots[playing_slot].group.members;
+        memcpy(leds, slots[playing_slot].group.leds, sizeof(leds));
+    }
+    taskEXIT_CRITICAL();
+
+    if (count == saved_count) {
+        return;
+    }
+    saved_count = count;
+
+    if (pattern != LED_PATTERN_COUNT) {
+        config_store_set(CONFIG_KEY_PATTERN, (uint32_t)pattern);
+        return;
+    }
+    if (members == 0) {
+        return;                 // led_effects_play() sequence: not kept
+    }
+
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        if (members & LED_MASK(led)) {
+            config_store_set((config_key_t)(CONFIG_KEY_SCENE_TIMING + led),
+                             ((uint32_t)leds[led].period_ms << 16) | leds[led].phase_ms);
+            config_store_set((config_key_t)(CONFIG_KEY_SCENE_SHAPE + led),
+                             ((uint32_t)leds[led].on_ms << 16)
+                             | ((uint32_t)leds[led].breathe << 8) | leds[led].level);
+        } else {
+            config_store_set((config_key_t)(CONFIG_KEY_SCENE_SHAPE + led), 0);
+        }
+    }
+    config_store_set(CONFIG_KEY_PATTERN, CONFIG_PATTERN_SCENE);
+}
+
+/**
+ * @brief  Play the pattern or scene stored by led_effects_save()
+ * @retval pdTRUE if something was restored
+ */
+BaseType_t led_effects_restore(void)
+{
+    led_blink_t blinks[LED_COUNT];
+    uint8_t n = 0;
+    uint32_t stored;
+    BaseType_t restored = pdFALSE;
+
+    if (config_store_get(CONFIG_KEY_PATTERN, &stored) != 0) {
+        return pdFALSE;
+    }
+
+    if (stored < LED_PATTERN_COUNT) {
+        led_effects_set_pattern((LED_Pattern_t)stored);
+        restored = pdTRUE;
+    } else if (stored == CONFIG_PATTERN_SCENE) {
+        for (uint8_t led = 0; led < LED_COUNT; led++) {
+            uint32_t timing;
+            uint32_t shape;
+
+            if (config_store_get((config_key_t)(CONFIG_KEY_SCENE_TIMING + led), &timing) != 0
+                    || config_store_get((config_key_t)(CONFIG_KEY_SCENE_SHAPE + led), &shape) != 0
+                    || (shape >> 16) == 0) {
+                continue;       // Off in the stored scene
+            }
+            blinks[n].mask = (uint8_t)LED_MASK(led);
+            blinks[n].level = (uint8_t)shape;
+            blinks[n].period_ms = (uint16_t)(timing >> 16);
+            blinks[n].on_ms = (uint16_t)(shape >> 16);
+            blinks[n].phase_ms = (uint16_t)timing;
+            blinks[n].breathe = (uint8_t)((shape >> 8) & 1U);
+            n++;
+        }
+        if (n == 0) {
+            led_effects_set_pattern(LED_PATTERN_NONE);
+            restored = pdTRUE;
+        } else {
+            restored = (led_effects_blink(blinks, n) == 0) ? pdTRUE : pdFALSE;
+        }
+    }
+
+    saved_count = start_count;  // Already stored
+    return restored;
+}
+
+/**
+ * @brief  Scheduler wakeup (TIM7 update interrupt at the next edge)
+ * @param  htim: Timer that elapsed
+ * @retval None
+ */
+void led_effects_tick(TIM_HandleTypeDef *htim)
+{
+    if (htim->Instance != TIM7) {
+        return;
+    }
+
+    led_schedule_t *sch = &schedule[active_schedule];
+    if (sch->sequence == NULL || sch->armed_ms == 0) {
+        return;
+    }
+
+    sch->now += sch->armed_ms;
+
+    // A scheduled sequence is due: it replaces the current one. If several
+    // are due (long stall), only the latest is started.
+    if (pending_count != 0
+            && (int32_t)((sch->origin + sch->now) - slots[pending_order[0]].due) >= 0) {
+        uint8_t slot = LED_SEQ_NO_SLOT;
+        while (pending_count != 0
+                && (int32_t)((sch->origin + sch->now) - slots[pending_order[0]].due) >= 0) {
+            if (slot != LED_SEQ_NO_SLOT) {
+                slots[slot].state = SLOT_FREE;  // Superseded
+            }
+            slot = pending_order[0];
+            pending_count--;
+            for (uint8_t i = 0; i < pending_count; i++) {
+                pending_order[i] = pending_order[i + 1];
+            }
+        }
+        sequence_start(slots[slot].sequence, slot, sch->origin + sch->now, pdTRUE);
+        return;
+    }
+
+#if LED_SYNC_PROFILE
+    uint32_t profile_first = DWT->CYCCNT;
+    profile_leds = 0;
+#endif
+
+    for (uint8_t t = 0; t < sch->sequence->num_tracks; t++) {
+        const led_track_t *track = &sch->sequence->tracks[t];
+        led_track_state_t *st = &sch->track[t];
+
+        // Every edge that is due (more than one only after a long stall)
+        while (!st->holding && (int32_t)(sch->now - st->next_edge) >= 0) {
+            st->index = (uint8_t)((st->index + 1) % track->count);
+            apply_keyframe(&track->frames[st->index], pdTRUE);
+
+            uint16_t duration = track->frames[st->index].duration_ms;
+            if (duration == 0) {
+                st->holding = 1;
+            } else {
+                st->next_edge += duration;
+            }
+        }
+    }
+
+#if LED_SYNC_PROFILE
+    if (profile_leds > 1) {
+        profile_group_edges++;
+        if (profile_last - profile_first > profile_max_skew) {
+            profile_max_skew = profile_last - profile_first;
+        }
+    }
+#endif
+
+    timer_arm_next(sch);
+}
+
+/**
+ * @brief  Check that the LEDs need no timer until the next command
+ * @retval pdTRUE if TIM7 is stopped and the PWM outputs are steady
  */
-void led_timer2_callback(TimerHandle_t xTimer)
+BaseType_t led_effects_is_idle(void)
 {
-    // Toggle Orange LED state (ON->OFF or OFF->ON)
-    HAL_GPIO_TogglePin(GPIOD, LED_ORANGE_PIN);
+    if (schedule[active_schedule].armed_ms != 0) {
+        return pdFALSE;
+    }
+    return led_pwm_is_steady();
+}
+
+/**
+ * @brief  Pattern that is playing
+ * @retval LED_PATTERN_xxx, or LED_PATTERN_COUNT for a run-time scene
+ */
+LED_Pattern_t led_effects_get_pattern(void)
+{
+    const led_sequence_t *playing = schedule[active_schedule].sequence;
+
+    for (uint8_t p = 0; p < LED_PATTERN_COUNT; p++) {
+        if (pattern_table[p] == playing) {
+            return (LED_Pattern_t)p;
+        }
+    }
+    return LED_PATTERN_COUNT;
 }
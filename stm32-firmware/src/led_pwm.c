@@ -0,0 +1,451 @@
+/**
+ ******************************************************************************
+ * @file           : led_pwm.c
+ * @brief          : TIM4 Hardware PWM Engine for the Four Discovery LEDs
+ ******************************************************************************
+ * @description
+ * Each LED channel holds a small effect state (static, fade or breathe).
+ * Static levels go straight to the CCR registers. Effects are rendered
+ * into a circular frame buffer that DMA copies into CCR1-4 on every TIM4
+ * update event (TIM4->DMAR burst), so a 1 ms duty step costs no CPU time;
+ * the CPU only refills half the buffer every LED_PWM_DMA_FRAMES / 2 ms.
+ *
+ * Concurrency:
+ * - Setters update channel state in a critical section (masks the DMA
+ *   interrupt); _from_isr variants serve the LED sequencer tick
+ * - The DMA half/complete callbacks render the idle half and stop the
+ *   stream once two consecutive halves contain only static levels
+ ******************************************************************************
+ */
+
+#include "led_pwm.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stddef.h>
+
+/*============================================================================
+ * Private Definitions
+ *===========================================================================*/
+
+/** Channel effect modes */
+#define LED_PWM_MODE_STATIC     0
+#define LED_PWM_MODE_FADE       1
+#define LED_PWM_MODE_BREATHE    2
+
+/** DMA burst: LED_COUNT transfers per request, starting at CCR1 */
+#define LED_PWM_DCR  ((uint32_t)((LED_COUNT - 1) << TIM_DCR_DBL_Pos) | \
+                      (uint32_t)(offsetof(TIM_TypeDef, CCR1) / sizeof(uint32_t)))
+
+#if (LED_PWM_DMA_FRAMES % 2) != 0
+#error "LED_PWM_DMA_FRAMES must be even (refilled in halves)"
+#endif
+
+/*============================================================================
+ * Private Types
+ *===========================================================================*/
+
+typedef struct {
+    uint8_t mode;           // LED_PWM_MODE_xxx
+    uint8_t level;          // Level of the last frame rendered
+    uint8_t from;           // Fade start level / breathe peak
+    uint8_t to;             // Fade end level
+    uint8_t curve;          // led_curve_t
+    uint16_t duration;      // Fade time or breath period (ms = frames)
+    uint32_t elapsed;       // Frames rendered since the effect started
+} led_pwm_channel_t;
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+TIM_HandleTypeDef htim4;
+
+static led_pwm_channel_t channels[LED_COUNT];
+
+/* DMA frame buffer: one CCR1..CCR4 set per PWM period */
+static uint16_t frames[LED_PWM_DMA_FRAMES][LED_COUNT];
+
+static volatile BaseType_t dma_running = pdFALSE;
+static uint8_t static_halves = 0;   // Consecutive halves with no effect running
+static uint8_t refill_half = 0;     // Half the next DMA callback refills
+
+static const uint32_t tim_channels[LED_COUNT] = {
+    TIM_CHANNEL_1, TIM_CHANNEL_2, TIM_CHANNEL_3, TIM_CHANNEL_4
+};
+
+/*============================================================================
+ * Private Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Advance a channel by one frame
+ * @param  ch: Channel state
+ * @retval Level for this frame
+ */
+static uint8_t channel_step(led_pwm_channel_t *ch)
+{
+    switch (ch->mode) {
+        case LED_PWM_MODE_FADE:
+            ch->level = led_curve_fade(ch->from, ch->to, ch->elapsed, ch->duration);
+            if (++ch->elapsed > ch->duration) {
+                ch->mode = LED_PWM_MODE_STATIC;
+            }
+            break;
+
+        case LED_PWM_MODE_BREATHE:
+            ch->level = led_curve_breathe(ch->from, ch->elapsed, ch->duration);
+            ch->elapsed = (ch->elapsed + 1) % ch->duration;
+            break;
+
+        default:
+            break;
+    }
+    return ch->level;
+}
+
+/**
+ * @brief  Render one half of the DMA frame buffer
+ * @param  half: 0 = first half, 1 = second half
+ * @retval pdTRUE if any channel still has an effect running
+ */
+static BaseType_t render_half(uint8_t half)
+{
+    BaseType_t dynamic = pdFALSE;
+    uint16_t first = (uint16_t)(half * (LED_PWM_DMA_FRAMES / 2));
+
+    for (uint16_t f = first; f < first + LED_PWM_DMA_FRAMES / 2; f++) {
+        for (uint8_t led = 0; led < LED_COUNT; led++) {
+            frames[f][led] = led_curve_duty(channel_step(&channels[led]),
+                                            (led_curve_t)channels[led].curve);
+        }
+    }
+
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        if (channels[led].mode != LED_PWM_MODE_STATIC) {
+            dynamic = pdTRUE;
+        }
+    }
+    return dynamic;
+}
+
+/**
+ * @brief  Write one channel's static level to its CCR register
+ */
+static void write_static(led_id_t led)
+{
+    __HAL_TIM_SET_COMPARE(&htim4, tim_channels[led],
+                          led_curve_duty(channels[led].level, (led_curve_t)channels[led].curve));
+}
+
+/**
+ * @brief  Start streaming frames (caller holds the critical section)
+ */
+static void dma_start(void)
+{
+    DMA_HandleTypeDef *hdma = htim4.hdma[TIM_DMA_ID_CC1];
+
+    static_halves = 0;
+    refill_half = 0;
+    (void)render_half(0);
+    (void)render_half(1);
+
+    if (HAL_DMA_Start_IT(hdma, (uintptr_t)frames, (uintptr_t)&htim4.Instance->DMAR,
+                         LED_PWM_DMA_FRAMES * LED_COUNT) != HAL_OK) {
+        return;
+    }
+    htim4.Instance->DCR = LED_PWM_DCR;
+    __HAL_TIM_ENABLE_DMA(&htim4, TIM_DMA_CC1);
+    dma_running = pdTRUE;
+}
+
+/**
+ * @brief  Stop streaming and hand the final levels to the CCR registers
+ */
+static void dma_stop(void)
+{
+    __HAL_TIM_DISABLE_DMA(&htim4, TIM_DMA_CC1);
+    (void)HAL_DMA_Abort(htim4.hdma[TIM_DMA_ID_CC1]);
+    dma_running = pdFALSE;
+
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        write_static((led_id_t)led);
+    }
+}
+
+/**
+ * @brief  Refill the half the DMA just finished (ISR context)
+ * @param  half: Half to refill
+ */
+static void dma_refill(uint8_t half)
+{
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+
+    refill_half = half ^ 1U;
+    if (render_half(half)) {
+        static_halves = 0;
+    } else if (++static_halves >= 2) {
+        // Both halves now hold the same static levels: CCRs can take over
+        dma_stop();
+    }
+
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+static void dma_half_complete(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    dma_refill(0);
+}
+
+static void dma_complete(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    dma_refill(1);
+}
+
+/**
+ * @brief  Re-render one channel over the frames still queued (DMA running)
+ * @param  led: Channel whose effect just (re)started
+ *
+ * Frames from the next one the DMA sends up to where the next refill
+ * continues, so an effect starts on the next PWM period and LEDs started
+ * in the same critical section step together. If the DMA has crossed into
+ * the other half but its callback is still masked, the queued frames end
+ * with the current half: the pending refill renders the next one.
+ */
+static void channel_render_queued(led_id_t led)
+{
+    led_pwm_channel_t *ch = &channels[led];
+    uint32_t sent = LED_PWM_DMA_FRAMES * LED_COUNT
+                  - __HAL_DMA_GET_COUNTER(htim4.hdma[TIM_DMA_ID_CC1]);
+    uint16_t next = (uint16_t)(((sent + LED_COUNT - 1U) / LED_COUNT) % LED_PWM_DMA_FRAMES);
+    uint16_t into_half = next % (LED_PWM_DMA_FRAMES / 2);
+    uint16_t count = (next / (LED_PWM_DMA_FRAMES / 2) == refill_half)
+                   ? (uint16_t)(LED_PWM_DMA_FRAMES - into_half)
+                   : (uint16_t)(LED_PWM_DMA_FRAMES / 2 - into_half);
+
+    for (uint16_t i = 0; i < count; i++) {
+        frames[(next + i) % LED_PWM_DMA_FRAMES][led] =
+            led_curve_duty(channel_step(ch), (led_curve_t)ch->curve);
+    }
+}
+
+/**
+ * @brief  Start an effect on a channel (caller holds the critical section)
+ */
+static void channel_start(led_id_t led, uint8_t mode, uint8_t from, uint8_t to,
+                          uint16_t duration, led_curve_t curve)
+{
+    led_pwm_channel_t *ch = &channels[led];
+
+    ch->mode = mode;
+    ch->from = from;
+    ch->to = to;
+    ch->duration = duration;
+    ch->curve = (uint8_t)curve;
+    ch->elapsed = 0;
+
+    if (!dma_running) {
+        dma_start();
+    } else {
+        channel_render_queued(led);
+    }
+}
+
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Configure TIM4 for 4-channel PWM and start it with all LEDs off
+ */
+void led_pwm_init(void)
+{
+    TIM_OC_InitTypeDef sConfigOC = {0};
+
+    htim4.Instance = TIM4;
+    htim4.Init.Prescaler = LED_PWM_PRESCALER;
+    htim4.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim4.Init.Period = LED_CURVE_DUTY_MAX - 1;
+    htim4.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim4.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if (HAL_TIM_PWM_Init(&htim4) != HAL_OK) {
+        Error_Handler();
+    }
+
+    // PWM mode 1, preloaded CCRs: new duty takes effect at the next period
+    sConfigOC.OCMode = TIM_OCMODE_PWM1;
+    sConfigOC.Pulse = 0;
+    sConfigOC.OCPolarity = TIM_OCPOLARITY_HIGH;
+    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        channels[led].mode = LED_PWM_MODE_STATIC;
+        channels[led].level = 0;
+        channels[led].curve = (uint8_t)LED_PWM_DEFAULT_CURVE;
+
+        if (HAL_TIM_PWM_ConfigChannel(&htim4, &sConfigOC, tim_channels[led]) != HAL_OK) {
+            Error_Handler();
+        }
+    }
+
+    // Frame DMA: CC1 request on the update event, refilled in halves
+    htim4.Instance->CR2 |= TIM_CR2_CCDS;
+    htim4.hdma[TIM_DMA_ID_CC1]->XferHalfCpltCallback = dma_half_complete;
+    htim4.hdma[TIM_DMA_ID_CC1]->XferCpltCallback = dma_complete;
+
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        HAL_TIM_PWM_Start(&htim4, tim_channels[led]);
+    }
+}
+
+/**
+ * @brief  Set a static level (caller holds the critical section)
+ */
+static void set_locked(led_id_t led, uint8_t level)
+{
+    channels[led].mode = LED_PWM_MODE_STATIC;
+    channels[led].level = level;
+    channels[led].curve = (uint8_t)LED_PWM_DEFAULT_CURVE;
+    if (dma_running) {
+        // Overwrite queued frames too, so the change shows on the next period
+        uint16_t duty = led_curve_duty(level, LED_PWM_DEFAULT_CURVE);
+        for (uint16_t f = 0; f < LED_PWM_DMA_FRAMES; f++) {
+            frames[f][led] = duty;
+        }
+    } else {
+        write_static(led);
+    }
+}
+
+/**
+ * @brief  Start a fade (caller holds the critical section)
+ */
+static void fade_locked(led_id_t led, uint8_t level, uint16_t duration_ms, led_curve_t curve)
+{
+    if (duration_ms == 0) {
+        set_locked(led, level);
+        return;
+    }
+    channel_start(led, LED_PWM_MODE_FADE, channels[led].level, level, duration_ms, curve);
+}
+
+/**
+ * @brief  Set an LED to a fixed brightness (cancels any running effect)
+ */
+void led_pwm_set(led_id_t led, uint8_t level)
+{
+    if (led >= LED_COUNT) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    set_locked(led, level);
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief  led_pwm_set() for interrupt context
+ */
+void led_pwm_set_from_isr(led_id_t led, uint8_t level)
+{
+    if (led >= LED_COUNT) {
+        return;
+    }
+
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    set_locked(led, level);
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+/**
+ * @brief  Fade an LED from its current level to a target level
+ */
+void led_pwm_fade(led_id_t led, uint8_t level, uint16_t duration_ms, led_curve_t curve)
+{
+    if (led >= LED_COUNT) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    fade_locked(led, level, duration_ms, curve);
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief  led_pwm_fade() for interrupt context
+ */
+void led_pwm_fade_from_isr(led_id_t led, uint8_t level, uint16_t duration_ms, led_curve_t curve)
+{
+    if (led >= LED_COUNT) {
+        return;
+    }
+
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    fade_locked(led, level, duration_ms, curve);
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+/**
+ * @brief  Breathe an LED (0 → peak → 0) until the next set/fade
+ */
+void led_pwm_breathe(led_id_t led, uint8_t peak, uint16_t period_ms)
+{
+    if (led >= LED_COUNT) {
+        return;
+    }
+    if (period_ms < 2) {
+        led_pwm_set(led, peak);
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    channel_start(led, LED_PWM_MODE_BREATHE, peak, 0, period_ms, LED_CURVE_GAMMA);
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief  led_pwm_breathe() for interrupt context
+ */
+void led_pwm_breathe_from_isr(led_id_t led, uint8_t peak, uint16_t period_ms)
+{
+    if (led >= LED_COUNT) {
+        return;
+    }
+    if (period_ms < 2) {
+        led_pwm_set_from_isr(led, peak);
+        return;
+    }
+
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    channel_start(led, LED_PWM_MODE_BREATHE, peak, 0, period_ms, LED_CURVE_GAMMA);
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+/**
+ * @brief  Current brightness level of an LED
+ */
+uint8_t led_pwm_get(led_id_t led)
+{
+    if (led >= LED_COUNT) {
+        return 0;
+    }
+    return channels[led].level;
+}
+
+/**
+ * @brief  Check that every output is a constant level
+ */
+BaseType_t led_pwm_is_steady(void)
+{
+    if (dma_running) {
+        return pdFALSE;
+    }
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        uint16_t duty = led_curve_duty(channels[led].level, (led_curve_t)channels[led].curve);
+        if (channels[led].mode != LED_PWM_MODE_STATIC || (duty != 0 && duty != LED_CURVE_DUTY_MAX)) {
+            return pdFALSE;
+        }
+    }
+    return pdTRUE;
+}
@@ -0,0 +1,505 @@
+/**
+ ******************************************************************************
+ * @file           : low_power.c
+ * @brief          : Tickless Idle with RTC Wakeup and STOP Mode Implementation
+ ******************************************************************************
+ * @description
+ * RTC and EXTI set up at register level, like the watchdog's IWDG (there is
+ * no RTC handle in the CubeMX project). The tick compensation follows the
+ * FreeRTOS Cortex-M port: the time already spent in the current tick plus
+ * the time asleep gives the complete ticks to step over, and SysTick is
+ * reloaded once with the rest of the tick in progress.
+ *
+ * Time Base While Asleep:
+ * - SLEEP: DWT CYCCNT keeps counting
+ * - STOP:  CYCCNT stops; the RTC sub-second counter (LSI / 1, PREDIV_A = 0)
+ *          gives the STOP time in LSI periods, converted with the measured
+ *          LSI frequency
+ *
+ ******************************************************************************
+ */
+
+#include "low_power.h"
+#include "task.h"
+#include "led_effects.h"
+#include "esp8266_comm_task.h"
+#include "print_task.h"
+#include "runtime_stats.h"
+#include "led_frame.h"
+#include <stdio.h>
+#include <string.h>
+
+/*============================================================================
+ * Private Defines
+ *===========================================================================*/
+
+/** RTC write protection keys (RM0090 26.3.7) */
+#define RTC_KEY_1            0xCAU
+#define RTC_KEY_2            0x53U
+#define RTC_KEY_LOCK         0xFFU
+
+/** Calendar: ck_apre = LSI (PREDIV_A = 0), 1 "second" = 32768 LSI periods */
+#define RTC_PREDIV_S         0x7FFFU
+#define RTC_UNITS_PER_SEC    (RTC_PREDIV_S + 1U)
+#define RTC_UNITS_PER_HOUR   (3600U * RTC_UNITS_PER_SEC)
+
+/** Wakeup timer clock = LSI / 2 (WUCKSEL = 011): ~62 us steps, ~4 s max */
+#define RTC_WUT_DIV          2U
+#define RTC_WUT_MAX          0x10000U
+
+/** RCC_BDCR.RTCSEL value for the LSI */
+#define RTC_SOURCE_LSI       RCC_BDCR_RTCSEL_1
+
+/** Shortest SysTick reload (cycles) after a sleep */
+#define SYSTICK_MIN_RELOAD   256U
+
+/** LED states in the POWER reply: the patterns, then run-time scenes */
+#define LOW_POWER_STATES     (LED_PATTERN_COUNT + 1)
+
+/*============================================================================
+ * Private Types
+ *===========================================================================*/
+
+/** Counters of one POWER window (cycles at SystemCoreClock) */
+typedef struct {
+    uint64_t sleep_cycles;                      // Tickless SLEEP
+    uint64_t stop_cycles;                       // STOP
+    uint32_t sleep_entries;
+    uint32_t stop_entries;
+    uint32_t uart_wakes;                        // STOP exits by EXTI3
+    uint64_t state_cycles[LOW_POWER_STATES];    // Time per LED state
+    uint64_t state_stop[LOW_POWER_STATES];      // STOP time per LED state
+} low_power_window_t;
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+/** RTC running from the LSI with the wakeup timer configured */
+static BaseType_t rtc_ready = pdFALSE;
+
+/** Measured LSI frequency (Hz) and the longest sleep the WUT can time */
+static uint32_t lsi_hz = 32000;
+static TickType_t max_idle_ticks = 0;
+
+/** Tick of the last STOP exit by UART2 RX */
+static TickType_t uart_wake_tick = 0;
+
+/** POWER window and CYCCNT at the last residency update */
+static low_power_window_t window;
+static uint32_t residency_mark = 0;
+
+/** POWER names of the LED states (LED_Pattern_t order, then scenes) */
+static const char *const state_names[LOW_POWER_STATES] = {
+    "off", "p1", "p2", "p3", "scene",
+};
+
+/*============================================================================
+ * Private Functions
+ *===========================================================================*/
+
+/**
+ * @brief  RTC time in LSI periods since the top of the hour
+ * @retval 0 .. RTC_UNITS_PER_HOUR - 1
+ * @note   BYPSHAD = 1: SSR is read twice so TR belongs to the same LSI period
+ */
+static uint32_t rtc_units(void)
+{
+    uint32_t ssr;
+    uint32_t tr;
+
+    do {
+        ssr = RTC->SSR;
+        tr = RTC->TR;
+    } while (ssr != RTC->SSR);
+
+    uint32_t minutes = ((tr & RTC_TR_MNT) >> RTC_TR_MNT_Pos) * 10U + ((tr & RTC_TR_MNU) >> RTC_TR_MNU_Pos);
+    uint32_t seconds = ((tr & RTC_TR_ST) >> RTC_TR_ST_Pos) * 10U + ((tr & RTC_TR_SU) >> RTC_TR_SU_Pos);
+
+    return (minutes * 60U + seconds) * RTC_UNITS_PER_SEC + (RTC_PREDIV_S - (ssr & RTC_PREDIV_S));
+}
+
+/**
+ * @brief  LSI periods between two rtc_units() readings
+ */
+static uint32_t rtc_elapsed(uint32_t from, uint32_t to)
+{
+    return (to + RTC_UNITS_PER_HOUR - from) % RTC_UNITS_PER_HOUR;
+}
+
+/**
+ * @brief  Measure the LSI against the CPU clock (busy wait)
+ * @retval LSI frequency in Hz
+ */
+static uint32_t lsi_calibrate(void)
+{
+    uint32_t span = (SystemCoreClock / 1000U) * LOW_POWER_LSI_CAL_MS;
+    uint32_t units_start = rtc_units();
+    uint32_t cycles_start = DWT->CYCCNT;
+
+    while (DWT->CYCCNT - cycles_start < span) {
+    }
+
+    uint32_t units = rtc_elapsed(units_start, rtc_units());
+    uint32_t cycles = DWT->CYCCNT - cycles_start;
+    return (uint32_t)(((uint64_t)units * SystemCoreClock) / cycles);
+}
+
+/**
+ * @brief  Start the RTC calendar on the LSI with PREDIV_A = 0
+ * @retval pdTRUE if the RTC can be used
+ */
+static BaseType_t rtc_start(void)
+{
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+
+    RCC->CSR |= RCC_CSR_LSION;
+    while ((RCC->CSR & RCC_CSR_LSIRDY) == 0) {
+    }
+
+    // RTCSEL can only be changed by a backup domain reset
+    if ((RCC->BDCR & RCC_BDCR_RTCSEL) == 0) {
+        RCC->BDCR |= RTC_SOURCE_LSI;
+    }
+    if ((RCC->BDCR & RCC_BDCR_RTCSEL) != RTC_SOURCE_LSI) {
+        return pdFALSE;
+    }
+    RCC->BDCR |= RCC_BDCR_RTCEN;
+
+    RTC->WPR = RTC_KEY_1;
+    RTC->WPR = RTC_KEY_2;
+
+    // Prescalers: synchronous first, then asynchronous (two writes, RM0090)
+    RTC->ISR |= RTC_ISR_INIT;
+    while ((RTC->ISR & RTC_ISR_INITF) == 0) {
+    }
+    RTC->PRER = RTC_PREDIV_S;
+    RTC->PRER = RTC_PREDIV_S | (0U << RTC_PRER_PREDIV_A_Pos);
+    RTC->CR |= RTC_CR_BYPSHAD;
+    RTC->ISR &= ~RTC_ISR_INIT;
+
+    // Wakeup timer clock, timer off
+    RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+    while ((RTC->ISR & RTC_ISR_WUTWF) == 0) {
+    }
+    RTC->CR = (RTC->CR & ~RTC_CR_WUCKSEL) | RTC_CR_WUCKSEL_0 | RTC_CR_WUCKSEL_1;
+
+    RTC->WPR = RTC_KEY_LOCK;
+    return pdTRUE;
+}
+
+/**
+ * @brief  Run the wakeup timer for a number of WUT periods
+ * @param  count: 1 .. RTC_WUT_MAX
+ */
+static void wakeup_timer_arm(uint32_t count)
+{
+    RTC->WPR = RTC_KEY_1;
+    RTC->WPR = RTC_KEY_2;
+    RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+    while ((RTC->ISR & RTC_ISR_WUTWF) == 0) {
+        // Up to 2 RTC clocks, and only if the timer was stopped just now
+    }
+    RTC->WUTR = count - 1U;
+    RTC->CR |= RTC_CR_WUTE | RTC_CR_WUTIE;
+    RTC->WPR = RTC_KEY_LOCK;
+}
+
+/**
+ * @brief  Stop the wakeup timer and clear its event
+ * @retval pdTRUE if the timer had expired
+ */
+static BaseType_t wakeup_timer_disarm(void)
+{
+    BaseType_t expired = (RTC->ISR & RTC_ISR_WUTF) ? pdTRUE : pdFALSE;
+
+    RTC->WPR = RTC_KEY_1;
+    RTC->WPR = RTC_KEY_2;
+    RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+    RTC->WPR = RTC_KEY_LOCK;
+
+    low_power_rtc_wakeup_irq();
+    NVIC_ClearPendingIRQ(RTC_WKUP_IRQn);
+    return expired;
+}
+
+/**
+ * @brief  Restore the PLL system clock after STOP (the core wakes on HSI)
+ */
+static void clock_restore(void)
+{
+    RCC->CR |= RCC_CR_PLLON;
+    while ((RCC->CR & RCC_CR_PLLRDY) == 0) {
+    }
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_PLL;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL) {
+    }
+}
+
+/**
+ * @brief  Check every condition for STOP (interrupts masked)
+ * @param  expected_idle_ticks: Ticks until the next task is due
+ * @retval pdTRUE if STOP may be entered
+ */
+static BaseType_t stop_allowed(TickType_t expected_idle_ticks)
+{
+#if LOW_POWER_USE_STOP
+    if (expected_idle_ticks < LOW_POWER_STOP_MIN_TICKS) {
+        return pdFALSE;
+    }
+    // Wake preamble: the rest of the exchange follows without one
+    if ((xTaskGetTickCount() - uart_wake_tick) < pdMS_TO_TICKS(LED_LINK_STOP_QUIET_MS)) {
+        return pdFALSE;
+    }
+    return led_effects_is_idle() && esp8266_comm_link_quiet() && print_task_tx_idle();
+#else
+    (void)expected_idle_ticks;
+    return pdFALSE;
+#endif
+}
+
+/**
+ * @brief  Charge the time since the last update to the pattern playing
+ * @param  stop_cycles: STOP time in that span (CYCCNT did not count it)
+ */
+static void residency_update(uint32_t stop_cycles)
+{
+    uint32_t now = DWT->CYCCNT;
+    uint8_t state = (uint8_t)led_effects_get_pattern();
+
+    window.state_cycles[state] += (uint32_t)(now - residency_mark) + (uint64_t)stop_cycles;
+    window.state_stop[state] += stop_cycles;
+    residency_mark = now;
+}
+
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Start the RTC on the LSI, calibrate it and set up the wakeup lines
+ * @retval None
+ */
+void low_power_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    residency_mark = DWT->CYCCNT;
+
+    if (rtc_start() != pdTRUE) {
+        return;
+    }
+
+    lsi_hz = lsi_calibrate();
+    max_idle_ticks = (TickType_t)(((uint64_t)RTC_WUT_MAX * RTC_WUT_DIV * configTICK_RATE_HZ) / lsi_hz) - 1U;
+
+    // RTC wakeup: EXTI line 22, rising edge
+    EXTI->IMR |= EXTI_IMR_MR22;
+    EXTI->RTSR |= EXTI_RTSR_TR22;
+    HAL_NVIC_SetPriority(RTC_WKUP_IRQn, LOW_POWER_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(RTC_WKUP_IRQn);
+
+    // UART2 RX (PA3) on EXTI line 3; the edge is only enabled around STOP
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    SYSCFG->EXTICR[0] = (SYSCFG->EXTICR[0] & ~SYSCFG_EXTICR1_EXTI3) | SYSCFG_EXTICR1_EXTI3_PA;
+    HAL_NVIC_SetPriority(EXTI3_IRQn, LOW_POWER_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(EXTI3_IRQn);
+
+    rtc_ready = pdTRUE;
+}
+
+/**
+ * @brief  Sleep with the tick suppressed (portSUPPRESS_TICKS_AND_SLEEP)
+ * @param  expected_idle_ticks: Ticks until the next task is due
+ * @retval None
+ *
+ * Runs with interrupts masked from the check to the restart of SysTick;
+ * WFI still wakes on a pending interrupt, which is then taken after
+ * __enable_irq().
+ */
+void low_power_suppress_ticks_and_sleep(TickType_t expected_idle_ticks)
+{
+    const uint32_t cycles_per_tick = SystemCoreClock / configTICK_RATE_HZ;
+    uint32_t stop_cycles = 0;
+    BaseType_t uart_woke = pdFALSE;
+
+    __disable_irq();
+    __DSB();
+    __ISB();
+
+    if (eTaskConfirmSleepModeStatus() == eAbortSleep) {
+        __enable_irq();
+        return;
+    }
+
+    if (!rtc_ready) {
+        // No wakeup timer: plain WFI with the tick running
+        uint32_t sleep_start = DWT->CYCCNT;
+        HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+        runtime_stats_add_sleep(DWT->CYCCNT - sleep_start);
+        __enable_irq();
+        return;
+    }
+
+    if (expected_idle_ticks > max_idle_ticks) {
+        expected_idle_ticks = max_idle_ticks;
+    }
+
+    // Stop the tick; if it fell due meanwhile, let it be handled first
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        __enable_irq();
+        return;
+    }
+    uint32_t start = DWT->CYCCNT;
+    uint32_t into_tick = (cycles_per_tick - 1U) - SysTick->VAL;
+
+    HAL_SuspendTick();
+
+    // Wake at the tick the next task is due on
+    uint64_t wut = ((uint64_t)(expected_idle_ticks * cycles_per_tick - into_tick) * (lsi_hz / RTC_WUT_DIV))
+                   / SystemCoreClock;
+    wakeup_timer_arm((wut == 0) ? 1U : (wut > RTC_WUT_MAX) ? RTC_WUT_MAX : (uint32_t)wut);
+
+    if (stop_allowed(expected_idle_ticks)) {
+        EXTI->PR = EXTI_PR_PR3;
+        EXTI->FTSR |= EXTI_FTSR_TR3;
+        EXTI->IMR |= EXTI_IMR_MR3;
+        uint32_t rtc_start = rtc_units();
+
+        HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+        clock_restore();
+
+        uint32_t units = rtc_elapsed(rtc_start, rtc_units());
+        EXTI->IMR &= ~EXTI_IMR_MR3;
+        EXTI->FTSR &= ~EXTI_FTSR_TR3;
+        uart_woke = (EXTI->PR & EXTI_PR_PR3) ? pdTRUE : pdFALSE;
+        low_power_uart_wakeup_irq();
+        NVIC_ClearPendingIRQ(EXTI3_IRQn);
+
+        stop_cycles = (uint32_t)(((uint64_t)units * SystemCoreClock) / lsi_hz);
+    } else {
+        HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+    }
+    (void)wakeup_timer_disarm();
+
+    // Whole ticks slept; the wakeup timer's tick itself is left to SysTick
+    // so the kernel unblocks the task from the tick interrupt
+    uint32_t slept = (DWT->CYCCNT - start) + stop_cycles;
+    uint32_t position = into_tick + slept;
+    uint32_t complete = position / cycles_per_tick;
+    uint32_t reload;
+    if (complete >= expected_idle_ticks) {
+        complete = expected_idle_ticks - 1U;
+        reload = SYSTICK_MIN_RELOAD;
+    } else {
+        reload = cycles_per_tick - (position % cycles_per_tick);
+        if (reload < SYSTICK_MIN_RELOAD) {
+            reload = SYSTICK_MIN_RELOAD;
+        }
+    }
+
+    // Rest of the current tick, then normal periods (FreeRTOS port sequence)
+    SysTick->LOAD = reload - 1U;
+    SysTick->VAL = 0U;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = cycles_per_tick - 1U;
+    if (complete > 0) {
+        vTaskStepTick(complete);
+    }
+    HAL_ResumeTick();
+
+    if (stop_cycles != 0) {
+        window.stop_cycles += stop_cycles;
+        window.stop_entries++;
+        runtime_stats_add_stop(stop_cycles);
+        if (uart_woke) {
+            window.uart_wakes++;
+            uart_wake_tick = xTaskGetTickCount();
+        }
+    } else {
+        window.sleep_cycles += slept;
+        window.sleep_entries++;
+        runtime_stats_add_sleep(slept);
+    }
+    residency_update(stop_cycles);
+
+    __enable_irq();
+}
+
+/**
+ * @brief  RTC wakeup interrupt: clear the WUT event (RTC_ISR and EXTI 22)
+ * @retval None
+ */
+void low_power_rtc_wakeup_irq(void)
+{
+    // WUTF is not write protected; writing INIT back unchanged keeps it
+    RTC->ISR = ~(RTC_ISR_WUTF | RTC_ISR_INIT) | (RTC->ISR & RTC_ISR_INIT);
+    EXTI->PR = EXTI_PR_PR22;
+}
+
+/**
+ * @brief  UART2 RX wakeup interrupt: clear EXTI 3
+ * @retval None
+ */
+void low_power_uart_wakeup_irq(void)
+{
+    EXTI->PR = EXTI_PR_PR3;
+}
+
+/**
+ * @brief  Format the window since the previous call as a POWER reply line
+ * @param  buf: Output buffer
+ * @param  size: Buffer size
+ * @retval Length written
+ */
+int low_power_format(char *buf, size_t size)
+{
+    low_power_window_t w;
+    uint64_t total = 0;
+    uint32_t cycles_per_ms = SystemCoreClock / 1000U;
+    int len;
+
+    // Close the window (the idle task updates it with interrupts masked)
+    taskENTER_CRITICAL();
+    residency_update(0);
+    w = window;
+    memset(&window, 0, sizeof(window));
+    taskEXIT_CRITICAL();
+
+    for (uint8_t i = 0; i < LOW_POWER_STATES; i++) {
+        total += w.state_cycles[i];
+    }
+
+    len = snprintf(buf, size, "PWR:ms=%lu,sleep=%lu/%lu,stop=%lu/%lu,uart=%lu",
+                   (unsigned long)(total / cycles_per_ms),
+                   (unsigned long)runtime_stats_permille(w.sleep_cycles, total),
+                   (unsigned long)w.sleep_entries,
+                   (unsigned long)runtime_stats_permille(w.stop_cycles, total),
+                   (unsigned long)w.stop_entries,
+                   (unsigned long)w.uart_wakes);
+    if (len < 0 || (size_t)len >= size) {
+        return 0;  // Buffer too small for even the summary
+    }
+
+    // Patterns that played in the window
+    char separator = ';';
+    for (uint8_t i = 0; i < LOW_POWER_STATES; i++) {
+        if (w.state_cycles[i] == 0) {
+            continue;
+        }
+        int n = snprintf(&buf[len], size - (size_t)len, "%c%s=%lu/%lu", separator, state_names[i],
+                         (unsigned long)runtime_stats_permille(w.state_stop[i], w.state_cycles[i]),
+                         (unsigned long)(w.state_cycles[i] / cycles_per_ms));
+        if (n < 0 || (size_t)(len + n) >= size) {
+            buf[len] = '\0';
+            break;
+        }
+        len += n;
+        separator = ',';
+    }
+
+    return len;
+}
@@ -12,7 +12,7 @@
  * - Efficient interrupt-driven UART (HAL_UART_Receive_IT + Stream Buffer)
  * - TRUE task blocking (task yields CPU when idle)
  * - Simple UART protocol (115200 baud, 8N1)
- * - LED patterns controlled by software timers
+ * - LED patterns played from keyframe tables (TIM7 wakeups, TIM4 PWM)
  * - Minimal task overhead (single UART task)
  * - Idle hook for low-power sleep mode
  *
@@ -51,6 +51,10 @@
 #include "esp8266_comm_task.h"
 #include "print_task.h"
 #include "watchdog.h"
+#include "config_store.h"
+#include "telemetry.h"
+#include "runtime_stats.h"
+#include "low_power.h"
 #include <string.h>
 /* USER CODE END Includes */
 
@@ -62,11 +66,25 @@
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
 
+/* Compile-time log level for boot messages (LOG_LEVEL_xxx, print_task.h) */
+#ifndef BOOT_LOG_LEVEL
+#define BOOT_LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
 /* USER CODE BEGIN PM */
 
+/* Boot messages go straight to UART3 (the print task is not running yet).
+ * Levels above BOOT_LOG_LEVEL are compiled out. */
+#define BOOT_LOG(level, msg) \
+	do { \
+		if ((level) <= BOOT_LOG_LEVEL) { \
+			HAL_UART_Transmit(&huart3, (uint8_t*)(msg), sizeof(msg) - 1, 1000); \
+		} \
+	} while (0)
+
 /* USER CODE END PM */
 
 /* Private variables ---------------------------------------------------------*/
@@ -101,6 +119,7 @@ int main(void)
 
   /* USER CODE BEGIN 1 */
 	BaseType_t status;
+	uint32_t stored;  // config_store value being restored
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
@@ -140,72 +159,69 @@ int main(void)
 	// These messages should appear BEFORE FreeRTOS starts
 	// If you don't see these, check UART3 wiring and serial terminal settings
 
-	const char *test1 = "\r\n\r\n========================================\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)test1, strlen(test1), 1000);
-
-	const char *test2 = "STM32F407 LED Controller Boot Test\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)test2, strlen(test2), 1000);
-
-	const char *test3 = "========================================\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)test3, strlen(test3), 1000);
-
-	const char *test4 = "[BOOT] UART3 hardware: OK\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)test4, strlen(test4), 1000);
-
-	const char *test5 = "[BOOT] System clock: 168 MHz\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)test5, strlen(test5), 1000);
-
-	const char *test6 = "[BOOT] UART2 (ESP8266): 115200 baud\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)test6, strlen(test6), 1000);
-
-	const char *test7 = "[BOOT] UART3 (Debug): 115200 baud\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)test7, strlen(test7), 1000);
+	BOOT_LOG(LOG_LEVEL_INFO, "\r\n\r\n========================================\r\n");
+	BOOT_LOG(LOG_LEVEL_INFO, "STM32F407 LED Controller Boot Test\r\n");
+	BOOT_LOG(LOG_LEVEL_INFO, "========================================\r\n");
+	BOOT_LOG(LOG_LEVEL_INFO, "[BOOT] UART3 hardware: OK\r\n");
+	BOOT_LOG(LOG_LEVEL_DEBUG, "[BOOT] System clock: 168 MHz\r\n");
+	BOOT_LOG(LOG_LEVEL_DEBUG, "[BOOT] UART2 (ESP8266): 115200 baud\r\n");
+	BOOT_LOG(LOG_LEVEL_DEBUG, "[BOOT] UART3 (Debug): 115200 baud\r\n");
 
 	// Enable cycle counter for runtime statistics (optional)
 	DWT_CTRL |= ( 1 << 0);
 
-	const char *test8 = "[BOOT] Starting FreeRTOS initialization...\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)test8, strlen(test8), 1000);
+	// Step 0: Mount the persistent settings (flash sectors 10-11)
+	// May erase the idle sector (~1-2 s) - harmless before the scheduler runs
+	config_store_init();
+	BOOT_LOG(LOG_LEVEL_INFO, "[BOOT] Config store mounted\r\n");
+
+	BOOT_LOG(LOG_LEVEL_DEBUG, "[BOOT] Starting FreeRTOS initialization...\r\n");
 
 	// Step 1: Initialize LED effects subsystem
-	// Creates software timers for LED pattern control
+	// Starts TIM4 PWM and configures the TIM7 sequencer wakeup timer
 	led_effects_init();
-	const char *msg1 = "[BOOT] LED effects initialized\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)msg1, strlen(msg1), 1000);
+	BOOT_LOG(LOG_LEVEL_INFO, "[BOOT] LED effects initialized\r\n");
+
+	// Restore the last applied pattern or scene (reset, watchdog event)
+	if (led_effects_restore()) {
+		BOOT_LOG(LOG_LEVEL_INFO, "[BOOT] Last LED pattern restored\r\n");
+	}
 
 	// Step 2: Initialize print task for debug logging (UART3)
 	// Creates message queue and print task for serial terminal output
 	print_task_init();
-	const char *msg2 = "[BOOT] Print task initialized\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)msg2, strlen(msg2), 1000);
+	if (config_store_get(CONFIG_KEY_LOG_LEVEL, &stored) == 0) {
+		print_set_log_level((log_level_t)stored);
+	}
+	BOOT_LOG(LOG_LEVEL_INFO, "[BOOT] Print task initialized\r\n");
 
 	// Step 3: Initialize ESP8266 communication subsystem (UART2)
 	// Creates stream buffer and starts interrupt-driven UART2 reception
 	esp8266_comm_task_init();
-	const char *msg3 = "[BOOT] ESP8266 comm initialized (stream buffer created)\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)msg3, strlen(msg3), 1000);
+	BOOT_LOG(LOG_LEVEL_INFO, "[BOOT] ESP8266 comm initialized (stream buffer created)\r\n");
 
 	// Step 4: Create ESP8266 communication task
 	// Receives LED_CMD: and ECHO_PING messages from ESP8266 via stream buffer
 	// Stack size: 256 words, Priority: 2
 	status = xTaskCreate(esp8266_comm_task_handler, "ESP8266_Comm", 256, NULL, 2, NULL);
 	configASSERT(status == pdPASS);
-	const char *msg4 = "[BOOT] ESP8266_Comm task created\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)msg4, strlen(msg4), 1000);
+	BOOT_LOG(LOG_LEVEL_INFO, "[BOOT] ESP8266_Comm task created\r\n");
 
 	// Step 5: Initialize watchdog monitor
 	// Creates watchdog task (priority 4) to detect hung/deadlocked tasks
 	// Watchdog output goes to UART3 via print_task
 	watchdog_init();
-	const char *msg5 = "[BOOT] Watchdog initialized\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)msg5, strlen(msg5), 1000);
+	BOOT_LOG(LOG_LEVEL_INFO, "[BOOT] Watchdog initialized\r\n");
 
-	// Step 6: Start the FreeRTOS scheduler
+	// Step 6: Start the RTC wakeup timer for tickless idle (low_power.h)
+	// Calibrates the LSI against the CPU clock (~50 ms busy wait)
+	low_power_init();
+	BOOT_LOG(LOG_LEVEL_INFO, "[BOOT] Low-power idle initialized\r\n");
+
+	// Step 7: Start the FreeRTOS scheduler
 	// After this point, tasks begin executing and main() never returns
-	const char *msg6 = "[BOOT] Starting FreeRTOS scheduler NOW...\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)msg6, strlen(msg6), 1000);
-	const char *msg7 = "========================================\r\n\r\n";
-	HAL_UART_Transmit(&huart3, (uint8_t*)msg7, strlen(msg7), 1000);
+	BOOT_LOG(LOG_LEVEL_INFO, "[BOOT] Starting FreeRTOS scheduler NOW...\r\n");
+	BOOT_LOG(LOG_LEVEL_INFO, "========================================\r\n\r\n");
 
 	vTaskStartScheduler();
 
@@ -498,12 +514,55 @@ static void MX_GPIO_Init(void)
  * - Reduces power consumption during idle periods
  * - No impact on responsiveness (wake-up is instant)
  * - All peripherals remain functional
+ *
+ * Sleep Accounting:
+ * WFI runs with interrupts masked (it still wakes on a pending interrupt),
+ * so the cycles measured around it are pure sleep; the waking ISR runs
+ * after __enable_irq(). DWT CYCCNT keeps counting in Sleep mode (FCLK).
+ *
+ * Tickless Idle (configUSE_TICKLESS_IDLE):
+ * The idle task sleeps in portSUPPRESS_TICKS_AND_SLEEP instead (low_power.c,
+ * SLEEP or STOP with the tick stopped). The hook runs first on every idle
+ * loop, so a WFI here would sleep until the next 1 ms tick before each
+ * tickless sleep; it is left out. Idle gaps shorter than
+ * configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks then run without sleeping.
  */
 void vApplicationIdleHook(void)
 {
+#if (configUSE_TICKLESS_IDLE == 0)
+	__disable_irq();
+	uint32_t sleep_start = DWT->CYCCNT;
+
 	// Enter SLEEP mode - CPU stops, peripherals run
 	// Wake-up time: ~1 CPU cycle (instant)
 	HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+
+	runtime_stats_add_sleep(DWT->CYCCNT - sleep_start);
+	__enable_irq();
+#endif
+}
+
+/**
+ * @brief  FreeRTOS malloc failed hook (configUSE_MALLOC_FAILED_HOOK)
+ * @retval None
+ * @note   Called by pvPortMalloc() with the scheduler suspended: only
+ *         counted here, reported in the MEM telemetry reply
+ */
+void vApplicationMallocFailedHook(void)
+{
+	telemetry_malloc_failed();
+}
+
+/**
+ * @brief  UART TX complete callback (DMA or interrupt transfers)
+ * @param  huart: UART handle that finished transmitting
+ * @retval None
+ * @note   Each module ignores UARTs it does not own
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+	esp8266_comm_uart_tx_complete(huart);   // UART2: ESP8266 replies
+	print_task_uart_tx_complete(huart);     // UART3: debug log
 }
 /* USER CODE END 4 */
 
@@ -525,6 +584,7 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
     HAL_IncTick();
   }
   /* USER CODE BEGIN Callback 1 */
+  led_effects_tick(htim);   // TIM7: LED sequencer
 
   /* USER CODE END Callback 1 */
 }
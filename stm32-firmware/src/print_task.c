@@ -12,7 +12,15 @@
  * - UART3: Debug logging and watchdog output (managed by print_task)
  *
  * Architecture Benefits:
- * - Eliminates priority inversion (queue is faster than mutex)
+ * - Eliminates priority inversion (lock-free consumer, short producer
+ *   critical section instead of a UART mutex)
+ * - Variable-length records: producers copy only the bytes they use, and
+ *   flash strings are queued by pointer
+ * - DMA double buffering: the CPU sleeps while log bytes shift out
+ * - Deferred formatting: print_deferred() queues format + raw arguments and
+ *   the print task (or the host decoder) does the formatting
+ * - Lossless accounting: producers never wait on a full ring; every dropped
+ *   message is counted per source and summarized by the print task
  * - Better separation of concerns (tasks don't need UART knowledge)
  * - Centralized debug output control
  * - Non-blocking for application tasks
@@ -23,9 +31,72 @@
 #include "watchdog.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 
-/* FreeRTOS Objects */
-QueueHandle_t print_queue = NULL;        // Message queue for print requests
+/*============================================================================
+ * Private Definitions
+ *===========================================================================*/
+
+/**
+ * Record header (uint16_t, stored in the ring before each record):
+ * - bits 0-13:  message length in bytes (argument count for DEFERRED)
+ * - bits 14-15: record type
+ *   TEXT:     [header][text bytes]
+ *   CONST:    [header][const char * to a flash string]
+ *   DEFERRED: [header][const char * format][uintptr_t args...]
+ */
+#define PRINT_RECORD_TEXT       0x0000U
+#define PRINT_RECORD_CONST      0x4000U
+#define PRINT_RECORD_DEFERRED   0x8000U
+#define PRINT_RECORD_TYPE_MASK  0xC000U
+#define PRINT_RECORD_LEN_MASK   0x3FFFU
+
+/** Flash strings outlive any record, so they can be queued by pointer */
+#define PRINT_IS_FLASH_ADDR(p)  ((uintptr_t)(p) >= FLASH_BASE && (uintptr_t)(p) <= FLASH_END)
+
+#if PRINT_TX_BUFFER_SIZE < PRINT_MESSAGE_MAX_SIZE
+#error "PRINT_TX_BUFFER_SIZE must hold the largest record (PRINT_MESSAGE_MAX_SIZE)"
+#endif
+
+/** Print task notification bits */
+#define PRINT_NOTIFY_DATA       0x01U   // Producer appended a record
+#define PRINT_NOTIFY_TX_DONE    0x02U   // UART3 DMA transfer finished
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+/* Log ring: producers append under a critical section, print task consumes */
+static uint8_t print_ring[PRINT_RING_SIZE];
+static volatile uint16_t print_ring_head = 0;   // Next free byte (producers)
+static volatile uint16_t print_ring_tail = 0;   // Oldest record (print task)
+
+static TaskHandle_t print_task_handle = NULL;   // Notified on every new record
+
+/* Dropped-message counters (updated inside the ring critical section) */
+typedef struct {
+    TaskHandle_t task;      // Producer task, NULL = free slot
+    uint32_t count;         // Drops not yet reported
+} print_drop_source_t;
+
+static print_drop_source_t print_drops[PRINT_DROP_SOURCES];
+static uint32_t print_drops_isr = 0;      // Drops from print_message_from_isr
+static uint32_t print_drops_other = 0;    // Drops from tasks without a slot
+static uint32_t print_drops_total = 0;    // All drops since boot
+static uint32_t print_drops_pending = 0;  // Drops not yet reported
+
+/* Run-time log threshold (LOG_xxx macros skip messages above it) */
+volatile log_level_t print_log_threshold = PRINT_LOG_LEVEL_RUNTIME;
+
+/* UART3 TX double buffer: one in flight, the other being filled */
+static uint8_t print_tx_buffer[2][PRINT_TX_BUFFER_SIZE];
+static volatile BaseType_t print_tx_busy = pdFALSE;
+
+#if PRINT_TASK_PROFILE
+/* Print task CPU time per KB logged (DWT cycle counter) */
+static uint32_t profile_cycles = 0;   // Cycles spent staging + starting transfers
+static uint32_t profile_bytes = 0;    // Bytes handed to UART3
+#endif
 
 /**
  * @brief  UART3 peripheral handle for debug logging
@@ -33,16 +104,356 @@ QueueHandle_t print_queue = NULL;        // Message queue for print requests
  */
 extern UART_HandleTypeDef huart3;
 
+/*============================================================================
+ * Private Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Copy bytes into the ring at a position, wrapping at the end
+ */
+static void ring_write(uint16_t pos, const void *src, uint16_t len)
+{
+    uint16_t first = PRINT_RING_SIZE - pos;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(&print_ring[pos], src, first);
+    memcpy(&print_ring[0], (const uint8_t*)src + first, len - first);
+}
+
+/**
+ * @brief  Copy bytes out of the ring at a position, wrapping at the end
+ */
+static void ring_read(uint16_t pos, void *dst, uint16_t len)
+{
+    uint16_t first = PRINT_RING_SIZE - pos;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(dst, &print_ring[pos], first);
+    memcpy((uint8_t*)dst + first, &print_ring[0], len - first);
+}
+
+/**
+ * @brief  Append one record to the log ring (caller holds the critical section)
+ * @param  header: Record header (type | length)
+ * @param  body: First body part (text, or pointer for CONST/DEFERRED)
+ * @param  body_len: Size of the first part
+ * @param  extra: Second body part (deferred arguments, may be NULL)
+ * @param  extra_len: Size of the second part
+ * @retval pdPASS if appended, pdFAIL if there is not enough room
+ */
+static BaseType_t ring_append(uint16_t header, const void *body, uint16_t body_len,
+                              const void *extra, uint16_t extra_len)
+{
+    uint16_t size = sizeof(header) + body_len + extra_len;
+    uint16_t head = print_ring_head;
+    uint16_t used = (uint16_t)((head - print_ring_tail + PRINT_RING_SIZE) % PRINT_RING_SIZE);
+
+    // One byte stays free to tell a full ring from an empty one
+    if (size > (PRINT_RING_SIZE - 1) - used) {
+        return pdFAIL;
+    }
+
+    ring_write(head, &header, sizeof(header));
+    head = (uint16_t)((head + sizeof(header)) % PRINT_RING_SIZE);
+    ring_write(head, body, body_len);
+    head = (uint16_t)((head + body_len) % PRINT_RING_SIZE);
+    ring_write(head, extra, extra_len);
+    print_ring_head = (uint16_t)((print_ring_head + size) % PRINT_RING_SIZE);
+    return pdPASS;
+}
+
+/**
+ * @brief  Count a dropped message (caller holds the critical section)
+ * @param  task: Producer task, NULL for an interrupt
+ * @retval None
+ */
+static void print_count_drop(TaskHandle_t task)
+{
+    print_drops_total++;
+    print_drops_pending++;
+
+    if (task == NULL) {
+        print_drops_isr++;
+        return;
+    }
+
+    for (uint8_t i = 0; i < PRINT_DROP_SOURCES; i++) {
+        if (print_drops[i].task == task || print_drops[i].task == NULL) {
+            print_drops[i].task = task;
+            print_drops[i].count++;
+            return;
+        }
+    }
+    print_drops_other++;
+}
+
+/**
+ * @brief  Append one record to the log ring from a task
+ * @param  header: Record header (type | length)
+ * @param  body: First body part (text, or pointer for CONST/DEFERRED)
+ * @param  body_len: Size of the first part
+ * @param  extra: Second body part (deferred arguments, may be NULL)
+ * @param  extra_len: Size of the second part
+ * @retval pdPASS if queued, pdFAIL if the ring was full (drop counted)
+ *
+ * Returns at once when the ring is full unless PRINT_ENQUEUE_BLOCKING = 1,
+ * in which case it waits up to PRINT_ENQUEUE_TIMEOUT_MS first.
+ */
+static BaseType_t print_enqueue(uint16_t header, const void *body, uint16_t body_len,
+                                const void *extra, uint16_t extra_len)
+{
+#if PRINT_ENQUEUE_BLOCKING
+    TickType_t start = xTaskGetTickCount();
+#endif
+
+    while (1) {
+        taskENTER_CRITICAL();
+        if (ring_append(header, body, body_len, extra, extra_len) == pdPASS) {
+            taskEXIT_CRITICAL();
+            xTaskNotify(print_task_handle, PRINT_NOTIFY_DATA, eSetBits);
+            return pdPASS;
+        }
+#if PRINT_ENQUEUE_BLOCKING
+        taskEXIT_CRITICAL();
+
+        // Ring full: wait for the print task to drain it
+        if ((xTaskGetTickCount() - start) < pdMS_TO_TICKS(PRINT_ENQUEUE_TIMEOUT_MS)) {
+            vTaskDelay(1);
+            continue;
+        }
+        taskENTER_CRITICAL();
+#endif
+        print_count_drop(xTaskGetCurrentTaskHandle());
+        taskEXIT_CRITICAL();
+        return pdFAIL;
+    }
+}
+
+/**
+ * @brief  Queue "N messages dropped" summaries for all sources with drops
+ * @retval pdTRUE if at least one summary was queued
+ *
+ * Runs in the print task. A summary that does not fit either stays counted
+ * and is retried on the next report. Summaries are formatted here and
+ * queued as TEXT: task names live in the TCBs (RAM), which a deferred %s
+ * could only pass by address.
+ */
+static BaseType_t print_report_drops(void)
+{
+    uint32_t *counters[PRINT_DROP_SOURCES + 2];
+    const char *names[PRINT_DROP_SOURCES + 2];
+    uint8_t n = 0;
+    BaseType_t any = pdFALSE;
+
+    for (uint8_t i = 0; i < PRINT_DROP_SOURCES && print_drops[i].task != NULL; i++) {
+        counters[n] = &print_drops[i].count;
+        names[n++] = pcTaskGetName(print_drops[i].task);
+    }
+    counters[n] = &print_drops_other;
+    names[n++] = "other";
+    counters[n] = &print_drops_isr;
+    names[n++] = "ISR";
+
+    for (uint8_t i = 0; i < n; i++) {
+        char text[64];
+        uint32_t count = *counters[i];
+        BaseType_t queued;
+
+        if (count == 0) {
+            continue;
+        }
+        int len = snprintf(text, sizeof(text), "[PRINT_TASK] %lu messages dropped (%s)\r\n",
+                           (unsigned long)count, names[i]);
+        if (len < 0) {
+            continue;
+        }
+        if (len >= (int)sizeof(text)) {
+            len = sizeof(text) - 1;
+        }
+
+        // Producers may have dropped more since count was read
+        taskENTER_CRITICAL();
+        queued = ring_append((uint16_t)(len | PRINT_RECORD_TEXT), text, (uint16_t)len, NULL, 0);
+        if (queued == pdPASS) {
+            print_drops_pending -= count;
+            *counters[i] -= count;
+            any = pdTRUE;
+        }
+        taskEXIT_CRITICAL();
+    }
+    return any;
+}
+
 /**
- * @brief  Initialize print task and message queue
+ * @brief  Render a deferred record into a TX buffer
+ * @param  pos: Ring position of the record body (format pointer)
+ * @param  nargs: Number of uintptr_t arguments
+ * @param  out: Destination in the TX buffer
+ * @param  room: Bytes available at out
+ * @param  empty: pdTRUE if out is the start of an empty buffer
+ * @retval Bytes written, 0 if the record must wait for the next buffer
+ *
+ * Text mode formats on the print task's stack instead of the caller's.
+ * Binary mode (PRINT_DEFERRED_BINARY) ships the format address and raw
+ * arguments; tools/log_decode.py expands them on the host from the ELF.
+ */
+static uint16_t print_stage_deferred(uint16_t pos, uint16_t nargs, uint8_t *out,
+                                     uint16_t room, BaseType_t empty)
+{
+    const char *fmt;
+    uintptr_t args[PRINT_DEFERRED_MAX_ARGS] = { 0 };
+
+    ring_read(pos, &fmt, sizeof(fmt));
+    ring_read((uint16_t)((pos + sizeof(fmt)) % PRINT_RING_SIZE), args, nargs * sizeof(uintptr_t));
+
+#if PRINT_DEFERRED_BINARY
+    // [marker][format address LE][nargs][args LE...], address and argument
+    // width = pointer width (4 bytes on the target)
+    uint16_t size = (uint16_t)(2 + sizeof(fmt) + nargs * sizeof(uintptr_t));
+    (void)empty;
+    if (size > room) {
+        return 0;
+    }
+    out[0] = PRINT_DEFERRED_MARKER;
+    memcpy(&out[1], &fmt, sizeof(fmt));
+    out[1 + sizeof(fmt)] = (uint8_t)nargs;
+    memcpy(&out[2 + sizeof(fmt)], args, nargs * sizeof(uintptr_t));
+    return size;
+#else
+    // Unused trailing arguments are ignored by snprintf
+    int n = snprintf((char *)out, room, fmt, args[0], args[1], args[2], args[3]);
+    if (n < 0) {
+        return 0;
+    }
+    if (n >= room) {
+        if (!empty) {
+            return 0;           // Retry at the start of the next buffer
+        }
+        n = room - 1;           // Longer than a whole buffer: truncate
+    }
+    return (uint16_t)n;
+#endif
+}
+
+/**
+ * @brief  Move whole records from the log ring into a TX buffer
+ * @param  buffer: TX buffer (PRINT_TX_BUFFER_SIZE bytes)
+ * @param  used: Bytes already staged in the buffer
+ * @retval Bytes staged after this call
+ *
+ * Stops at the first record that does not fit; it is staged into the next
+ * buffer. Each record is released from the ring as soon as it is copied.
+ */
+static uint16_t print_stage_records(uint8_t *buffer, uint16_t used)
+{
+    while (print_ring_tail != print_ring_head) {
+        uint16_t tail = print_ring_tail;
+        uint16_t header;
+
+        ring_read(tail, &header, sizeof(header));
+        tail = (uint16_t)((tail + sizeof(header)) % PRINT_RING_SIZE);
+        uint16_t len = header & PRINT_RECORD_LEN_MASK;
+
+        if ((header & PRINT_RECORD_TYPE_MASK) == PRINT_RECORD_DEFERRED) {
+            uint16_t n = print_stage_deferred(tail, len, &buffer[used],
+                                              (uint16_t)(PRINT_TX_BUFFER_SIZE - used), used == 0);
+            if (n == 0) {
+                break;
+            }
+            used += n;
+            tail = (uint16_t)((tail + sizeof(const char *) + len * sizeof(uintptr_t)) % PRINT_RING_SIZE);
+            print_ring_tail = tail;
+            continue;
+        }
+
+        if (used + len > PRINT_TX_BUFFER_SIZE) {
+            break;
+        }
+
+        if ((header & PRINT_RECORD_TYPE_MASK) == PRINT_RECORD_CONST) {
+            const char *text;
+            ring_read(tail, &text, sizeof(text));
+            memcpy(&buffer[used], text, len);
+            tail = (uint16_t)((tail + sizeof(text)) % PRINT_RING_SIZE);
+        } else {
+            ring_read(tail, &buffer[used], len);
+            tail = (uint16_t)((tail + len) % PRINT_RING_SIZE);
+        }
+        used += len;
+
+        // Release the record; producers may reuse the space right away
+        print_ring_tail = tail;
+    }
+
+    return used;
+}
+
+/**
+ * @brief  Send a staged TX buffer on UART3
+ * @param  buffer: Staged buffer
+ * @param  len: Number of bytes
+ * @retval pdPASS if sent (or started), pdFAIL if UART3 refused it: the
+ *         buffer stays staged and is retried after PRINT_TX_RETRY_MS
+ *
+ * DMA mode returns at once; completion is signalled by PRINT_NOTIFY_TX_DONE.
+ */
+static BaseType_t print_tx_start(uint8_t *buffer, uint16_t len)
+{
+#if PRINT_TX_USE_DMA
+    print_tx_busy = pdTRUE;
+    if (HAL_UART_Transmit_DMA(&huart3, buffer, len) != HAL_OK) {
+        print_tx_busy = pdFALSE;
+        return pdFAIL;
+    }
+    return pdPASS;
+#else
+    return (HAL_UART_Transmit(&huart3, buffer, len, HAL_MAX_DELAY) == HAL_OK) ? pdPASS : pdFAIL;
+#endif
+}
+
+#if PRINT_TASK_PROFILE
+/**
+ * @brief  Log print task cycles per KB once enough output has been sent
+ * @retval None
+ */
+static void profile_report(void)
+{
+    char msg[80];
+
+    if (profile_bytes < 1024) {
+        return;
+    }
+    snprintf(msg, sizeof(msg), "[PRINT_TASK] %lu bytes, %lu cycles/KB\r\n",
+             (unsigned long)profile_bytes,
+             (unsigned long)(((uint64_t)profile_cycles * 1024) / profile_bytes));
+    profile_cycles = 0;
+    profile_bytes = 0;
+    print_message(msg);
+}
+#endif
+
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Initialize print task and log ring
  * @note   Must be called BEFORE starting the scheduler
  * @retval None
  */
 void print_task_init(void)
 {
-    // Create message queue for print requests
-    print_queue = xQueueCreate(PRINT_QUEUE_DEPTH, PRINT_MESSAGE_MAX_SIZE);
-    configASSERT(print_queue != NULL);
+    print_ring_head = 0;
+    print_ring_tail = 0;
+
+#if PRINT_TASK_PROFILE
+    // Enable DWT cycle counter for print task CPU time measurement
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
 
     // Create print task
     // Priority 3: Higher than user tasks to ensure responsive debug logging
@@ -51,19 +462,17 @@ void print_task_init(void)
                                     PRINT_TASK_STACK_SIZE,
                                     NULL,
                                     PRINT_TASK_PRIORITY,
-                                    NULL);
+                                    &print_task_handle);
     configASSERT(status == pdPASS);
 }
 
 /**
  * @brief  Send a message to the print queue
  * @param  message: Null-terminated string to print to serial terminal
- * @retval BaseType_t: pdPASS if queued successfully, pdFAIL if timeout
+ * @retval BaseType_t: pdPASS if queued successfully, pdFAIL if dropped
  */
 BaseType_t print_message(const char *message)
 {
-    char buffer[PRINT_MESSAGE_MAX_SIZE];
-
     // Validate input
     if (message == NULL) {
         return pdFAIL;
@@ -71,52 +480,145 @@ BaseType_t print_message(const char *message)
 
     // Safety check: If print_task not initialized, silently fail
     // This allows other tasks to call print_message even if print_task is disabled
-    if (print_queue == NULL) {
+    if (print_task_handle == NULL) {
         return pdFAIL;
     }
 
-    // Copy message to local buffer with size limit
-    strncpy(buffer, message, PRINT_MESSAGE_MAX_SIZE - 1);
-    buffer[PRINT_MESSAGE_MAX_SIZE - 1] = '\0';  // Ensure null termination
+    // Only the used bytes are queued (truncated to the old per-message limit)
+    size_t len = strnlen(message, PRINT_MESSAGE_MAX_SIZE - 1);
 
-    // Send to queue (copies buffer into queue storage)
-    BaseType_t result = xQueueSend(print_queue, buffer, pdMS_TO_TICKS(PRINT_ENQUEUE_TIMEOUT_MS));
+    if (PRINT_IS_FLASH_ADDR(message)) {
+        return print_enqueue((uint16_t)(len | PRINT_RECORD_CONST), &message, sizeof(message), NULL, 0);
+    }
+    return print_enqueue((uint16_t)(len | PRINT_RECORD_TEXT), message, (uint16_t)len, NULL, 0);
+}
 
-    return result;
+/**
+ * @brief  Send a message to the print queue from an interrupt
+ * @param  message: Null-terminated string to print to serial terminal
+ * @retval BaseType_t: pdPASS if queued successfully, pdFAIL if dropped
+ */
+BaseType_t print_message_from_isr(const char *message)
+{
+    BaseType_t woken = pdFALSE;
+    BaseType_t status;
+    UBaseType_t saved;
+
+    if (message == NULL || print_task_handle == NULL) {
+        return pdFAIL;
+    }
+
+    size_t len = strnlen(message, PRINT_MESSAGE_MAX_SIZE - 1);
+
+    saved = taskENTER_CRITICAL_FROM_ISR();
+    if (PRINT_IS_FLASH_ADDR(message)) {
+        status = ring_append((uint16_t)(len | PRINT_RECORD_CONST), &message, sizeof(message), NULL, 0);
+    } else {
+        status = ring_append((uint16_t)(len | PRINT_RECORD_TEXT), message, (uint16_t)len, NULL, 0);
+    }
+    if (status != pdPASS) {
+        print_count_drop(NULL);
+    }
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+
+    if (status == pdPASS) {
+        xTaskNotifyFromISR(print_task_handle, PRINT_NOTIFY_DATA, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+    return status;
+}
+
+/**
+ * @brief  Total number of dropped messages since boot
+ * @retval Count (all sources)
+ */
+uint32_t print_get_dropped(void)
+{
+    return print_drops_total;
 }
 
 /**
  * @brief  Send a single character to the print queue
  * @param  c: Character to print to serial terminal
- * @retval BaseType_t: pdPASS if queued successfully, pdFAIL if timeout
+ * @retval BaseType_t: pdPASS if queued successfully, pdFAIL if dropped
  */
 BaseType_t print_char(char c)
 {
-    char buffer[2];
-
     // Safety check: If print_task not initialized, silently fail
-    if (print_queue == NULL) {
+    if (print_task_handle == NULL) {
         return pdFAIL;
     }
 
-    // Create 2-byte message: character + null terminator
-    buffer[0] = c;
-    buffer[1] = '\0';
+    return print_enqueue(1 | PRINT_RECORD_TEXT, &c, 1, NULL, 0);
+}
 
-    // Send to queue
-    BaseType_t result = xQueueSend(print_queue, buffer, pdMS_TO_TICKS(PRINT_ENQUEUE_TIMEOUT_MS));
+/**
+ * @brief  Queue a format string and raw arguments for deferred formatting
+ * @param  fmt: printf-style format in flash
+ * @param  nargs: Number of arguments (<= PRINT_DEFERRED_MAX_ARGS)
+ * @retval BaseType_t: pdPASS if queued successfully, pdFAIL if dropped
+ */
+BaseType_t print_deferred_args(const char *fmt, uint8_t nargs, ...)
+{
+    uintptr_t args[PRINT_DEFERRED_MAX_ARGS];
+    va_list ap;
 
-    return result;
+    if (fmt == NULL || print_task_handle == NULL) {
+        return pdFAIL;
+    }
+
+    // A RAM format could change before the print task expands it
+    configASSERT(PRINT_IS_FLASH_ADDR(fmt));
+    configASSERT(nargs <= PRINT_DEFERRED_MAX_ARGS);
+
+    // print_deferred() casts every argument to uintptr_t, so pointers keep
+    // their full width on a 64-bit host
+    va_start(ap, nargs);
+    for (uint8_t i = 0; i < nargs; i++) {
+        args[i] = va_arg(ap, uintptr_t);
+    }
+    va_end(ap);
+
+    return print_enqueue((uint16_t)(nargs | PRINT_RECORD_DEFERRED), &fmt, sizeof(fmt),
+                         args, (uint16_t)(nargs * sizeof(uintptr_t)));
+}
+
+/**
+ * @brief  Set the run-time log threshold
+ * @param  level: LOG_LEVEL_NONE .. LOG_LEVEL_TRACE
+ * @retval pdPASS, or pdFAIL if level is out of range
+ */
+BaseType_t print_set_log_level(log_level_t level)
+{
+    if (level > LOG_LEVEL_TRACE) {
+        return pdFAIL;
+    }
+    print_log_threshold = level;
+    return pdPASS;
 }
 
 /**
- * @brief  Print task main loop - processes messages from queue
+ * @brief  Get the run-time log threshold
+ * @retval Current level
+ */
+log_level_t print_get_log_level(void)
+{
+    return print_log_threshold;
+}
+
+/**
+ * @brief  Print task main loop - processes records from the log ring
  * @param  parameters: Task parameters (unused)
  * @retval None (task never returns)
  *
  * Task Behavior:
- * - Blocks waiting for messages in queue
- * - Transmits messages to UART3 (serial terminal)
+ * - Blocks on its task notification until a producer appends a record or
+ *   a UART3 transfer completes
+ * - Coalesces queued records into one of two TX buffers and ships it with
+ *   HAL_UART_Transmit_DMA, filling the other buffer while it is in flight
+ * - Keeps a buffer UART3 refused (HAL_BUSY) and retries it every
+ *   PRINT_TX_RETRY_MS, so a busy UART delays output instead of losing it
+ * - Summarizes dropped messages every PRINT_DROP_REPORT_MS (if any)
  * - Feeds watchdog periodically
  *
  * IMPORTANT: This task uses UART3 for debug output
@@ -124,7 +626,9 @@ BaseType_t print_char(char c)
  */
 void print_task_handler(void *parameters)
 {
-    char message_buffer[PRINT_MESSAGE_MAX_SIZE];
+    uint8_t active = 0;         // Buffer being filled
+    uint16_t staged = 0;        // Bytes staged in print_tx_buffer[active]
+    TickType_t last_drop_report = xTaskGetTickCount();
 
     // Register with watchdog (5 second timeout)
     watchdog_id_t wd_id = watchdog_register("Print_Task", 5000);
@@ -132,19 +636,49 @@ void print_task_handler(void *parameters)
         // Silently fail - can't use print_message here (would cause recursion)
     }
 
-    // Send startup message to serial terminal
+    // Send startup message to serial terminal (before any DMA transfer)
     const char *startup_msg = "\r\n[PRINT_TASK] Debug logging initialized on UART3\r\n";
     HAL_UART_Transmit(&huart3, (uint8_t*)startup_msg, strlen(startup_msg), HAL_MAX_DELAY);
 
     while (1) {
-        // Block waiting for message with finite timeout (2 seconds)
-        // Timeout allows periodic watchdog feeding even when no print activity
-        if (xQueueReceive(print_queue, message_buffer, pdMS_TO_TICKS(2000)) == pdPASS) {
-            // Message received - transmit to UART3 (serial terminal)
-            HAL_UART_Transmit(&huart3,
-                            (uint8_t *)message_buffer,
-                            strlen(message_buffer),
-                            HAL_MAX_DELAY);
+        // Block waiting for records or TX completion with finite timeout (2 seconds)
+        // Timeout allows periodic watchdog feeding even when no print activity;
+        // a buffer UART3 refused is retried sooner
+        BaseType_t retry = (staged != 0 && !print_tx_busy);
+        xTaskNotifyWait(0, PRINT_NOTIFY_DATA | PRINT_NOTIFY_TX_DONE, NULL,
+                        pdMS_TO_TICKS(retry ? PRINT_TX_RETRY_MS : 2000));
+
+#if PRINT_TASK_PROFILE
+        uint32_t start = DWT->CYCCNT;
+#endif
+        do {
+            // Fill the idle buffer, even while the other one is in flight
+            staged = print_stage_records(print_tx_buffer[active], staged);
+
+            if (print_tx_busy || staged == 0) {
+                break;
+            }
+            if (print_tx_start(print_tx_buffer[active], staged) != pdPASS) {
+                break;          // Keep it staged for the retry
+            }
+#if PRINT_TASK_PROFILE
+            profile_bytes += staged;
+#endif
+            active ^= 1;
+            staged = 0;
+        } while (print_ring_tail != print_ring_head);
+#if PRINT_TASK_PROFILE
+        profile_cycles += DWT->CYCCNT - start;
+        profile_report();
+#endif
+
+        // Summarize drops at most every PRINT_DROP_REPORT_MS
+        if (print_drops_pending != 0
+                && (xTaskGetTickCount() - last_drop_report) >= pdMS_TO_TICKS(PRINT_DROP_REPORT_MS)) {
+            last_drop_report = xTaskGetTickCount();
+            if (print_report_drops()) {
+                xTaskNotify(print_task_handle, PRINT_NOTIFY_DATA, eSetBits);
+            }
         }
 
         // Feed watchdog to prove task is alive
@@ -153,3 +687,30 @@ void print_task_handler(void *parameters)
         }
     }
 }
+
+/**
+ * @brief  UART3 TX complete hook, called from HAL_UART_TxCpltCallback
+ * @param  huart: UART handle that finished transmitting
+ * @retval None
+ */
+void print_task_uart_tx_complete(UART_HandleTypeDef *huart)
+{
+    BaseType_t woken = pdFALSE;
+
+    if (huart != &huart3) {
+        return;
+    }
+
+    print_tx_busy = pdFALSE;
+    xTaskNotifyFromISR(print_task_handle, PRINT_NOTIFY_TX_DONE, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief  Check that no UART3 transfer is in flight
+ * @retval pdTRUE if idle
+ */
+BaseType_t print_task_tx_idle(void)
+{
+    return print_tx_busy ? pdFALSE : pdTRUE;
+}
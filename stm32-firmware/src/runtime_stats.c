@@ -0,0 +1,219 @@
+/**
+ ******************************************************************************
+ * @file           : runtime_stats.c
+ * @brief          : Run-Time CPU Statistics Implementation
+ ******************************************************************************
+ * @description
+ * Extended DWT run-time clock, sleep and ISR cycle accumulators, and the
+ * STATS reply (see runtime_stats.h).
+ *
+ * ISR accumulators are free-running 32-bit cycle counts; like the FreeRTOS
+ * task counters they are only ever used as differences against the
+ * previous STATS window, so they may wrap (a handler would need 85 % of a
+ * 30 s window to wrap within it). The sleep accumulator is 64-bit: a
+ * mostly idle window sleeps longer than one 25.6 s wrap.
+ *
+ ******************************************************************************
+ */
+
+#include "runtime_stats.h"
+#include "task.h"
+#include <stdio.h>
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+/** Extended cycle count and CYCCNT at the last extension */
+static uint64_t cycles_total = 0;
+static uint32_t cycles_last = 0;
+
+/** Cycles spent asleep (idle hook WFI, tickless SLEEP and STOP); only
+ *  written by the idle task with interrupts masked, so a task never reads
+ *  it half-updated */
+static volatile uint64_t sleep_cycles = 0;
+
+/** Cycles and calls per instrumented ISR */
+static volatile uint32_t isr_cycles[RUNTIME_ISR_COUNT];
+static volatile uint32_t isr_calls[RUNTIME_ISR_COUNT];
+
+/** STATS names of the instrumented ISRs (order of runtime_isr_t) */
+static const char *const isr_names[RUNTIME_ISR_COUNT] = {
+    "usart2",
+    "usart3",
+};
+
+/** uxTaskGetSystemState() scratch */
+static TaskStatus_t task_status[RUNTIME_STATS_MAX_TASKS];
+
+/** Values at the start of the current STATS window */
+typedef struct {
+    UBaseType_t number;           // xTaskNumber
+    uint32_t counter;             // ulRunTimeCounter
+} task_base_t;
+
+static task_base_t base_tasks[RUNTIME_STATS_MAX_TASKS];
+static uint8_t base_task_count = 0;
+static uint32_t base_total = 0;
+static uint64_t base_sleep = 0;
+static uint32_t base_isr_cycles[RUNTIME_ISR_COUNT];
+static uint32_t base_isr_calls[RUNTIME_ISR_COUNT];
+
+/*============================================================================
+ * Private Helpers
+ *===========================================================================*/
+
+/**
+ * @brief  Run-time counter of a task at the start of the window
+ * @param  number: xTaskNumber
+ * @retval Counter, 0 for a task created during the window
+ */
+static uint32_t task_base_counter(UBaseType_t number)
+{
+    for (uint8_t i = 0; i < base_task_count; i++) {
+        if (base_tasks[i].number == number) {
+            return base_tasks[i].counter;
+        }
+    }
+    return 0;
+}
+
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Start the cycle counter
+ * @retval None
+ * @note   Called by vTaskStartScheduler()
+ */
+void runtime_stats_timer_init(void)
+{
+    // Enable DWT cycle counter (trace must be enabled without a debugger)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    cycles_last = DWT->CYCCNT;
+    cycles_total = 0;
+}
+
+/**
+ * @brief  Run-time clock
+ * @retval Extended cycle count >> RUNTIME_STATS_SHIFT
+ */
+uint32_t runtime_stats_counter(void)
+{
+    cycles_total = runtime_stats_extend(cycles_total, &cycles_last, DWT->CYCCNT);
+    return (uint32_t)(cycles_total >> RUNTIME_STATS_SHIFT);
+}
+
+/**
+ * @brief  Account the time the idle hook spent asleep
+ * @param  cycles: CPU cycles in WFI
+ * @retval None
+ */
+void runtime_stats_add_sleep(uint32_t cycles)
+{
+    sleep_cycles += cycles;
+}
+
+/**
+ * @brief  Account time spent in STOP mode
+ * @param  cycles: STOP time in CPU cycles
+ * @retval None
+ */
+void runtime_stats_add_stop(uint32_t cycles)
+{
+    cycles_total += cycles;
+    sleep_cycles += cycles;
+}
+
+/**
+ * @brief  Account one run of an instrumented ISR
+ * @param  isr: Handler
+ * @param  start: CYCCNT at handler entry
+ * @retval None
+ */
+void runtime_stats_isr_exit(runtime_isr_t isr, uint32_t start)
+{
+    isr_cycles[isr] += DWT->CYCCNT - start;
+    isr_calls[isr]++;
+}
+
+/**
+ * @brief  Format the window since the previous call as a STATS reply line
+ * @param  buf: Output buffer
+ * @param  size: Buffer size
+ * @retval Length written
+ */
+int runtime_stats_format(char *buf, size_t size)
+{
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(task_status, RUNTIME_STATS_MAX_TASKS, &total);
+    uint64_t sleep = sleep_cycles;
+    TaskHandle_t idle = xTaskGetIdleTaskHandle();
+    uint32_t window = total - base_total;
+    uint64_t window_cycles = (uint64_t)window << RUNTIME_STATS_SHIFT;
+    uint32_t idle_units = 0;
+    uint32_t isr_cycles_now[RUNTIME_ISR_COUNT];
+    uint32_t isr_calls_now[RUNTIME_ISR_COUNT];
+    int len;
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        if (task_status[i].xHandle == idle) {
+            idle_units = task_status[i].ulRunTimeCounter - task_base_counter(task_status[i].xTaskNumber);
+        }
+    }
+
+    len = snprintf(buf, size, "STATS:ms=%lu,idle=%lu,sleep=%lu",
+                   (unsigned long)(window_cycles / (SystemCoreClock / 1000U)),
+                   (unsigned long)runtime_stats_permille(idle_units, window),
+                   (unsigned long)runtime_stats_permille(sleep - base_sleep, window_cycles));
+
+    for (uint8_t i = 0; i < RUNTIME_ISR_COUNT; i++) {
+        isr_cycles_now[i] = isr_cycles[i];
+        isr_calls_now[i] = isr_calls[i];
+        if (len > 0 && (size_t)len < size) {
+            len += snprintf(&buf[len], size - (size_t)len, ",%s=%lu/%lu", isr_names[i],
+                            (unsigned long)runtime_stats_permille(isr_cycles_now[i] - base_isr_cycles[i],
+                                                                  window_cycles),
+                            (unsigned long)(isr_calls_now[i] - base_isr_calls[i]));
+        }
+    }
+    if (len < 0 || (size_t)len >= size) {
+        len = 0;  // Buffer too small for even the summary
+    }
+
+    // Per-task share (IDLE is reported as idle= above)
+    char separator = ';';
+    for (UBaseType_t i = 0; i < count && len > 0; i++) {
+        if (task_status[i].xHandle == idle) {
+            continue;
+        }
+        uint32_t units = task_status[i].ulRunTimeCounter - task_base_counter(task_status[i].xTaskNumber);
+        int n = snprintf(&buf[len], size - (size_t)len, "%c%s=%lu", separator,
+                         task_status[i].pcTaskName,
+                         (unsigned long)runtime_stats_permille(units, window));
+        if (n < 0 || (size_t)(len + n) >= size) {
+            buf[len] = '\0';  // Leave out tasks that do not fit
+            break;
+        }
+        len += n;
+        separator = ',';
+    }
+
+    // Next window starts now
+    for (UBaseType_t i = 0; i < count; i++) {
+        base_tasks[i].number = task_status[i].xTaskNumber;
+        base_tasks[i].counter = task_status[i].ulRunTimeCounter;
+    }
+    base_task_count = (uint8_t)count;
+    base_total = total;
+    base_sleep = sleep;
+    for (uint8_t i = 0; i < RUNTIME_ISR_COUNT; i++) {
+        base_isr_cycles[i] = isr_cycles_now[i];
+        base_isr_calls[i] = isr_calls_now[i];
+    }
+
+    return len;
+}
@@ -22,6 +22,10 @@
 #include "stm32f4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "esp8266_comm_task.h"
+#include "print_task.h"
+#include "runtime_stats.h"
+#include "low_power.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -60,6 +64,17 @@ extern UART_HandleTypeDef huart3;
 extern TIM_HandleTypeDef htim6;
 
 /* USER CODE BEGIN EV */
+#if UART_RX_USE_DMA
+extern DMA_HandleTypeDef hdma_usart2_rx;
+#endif
+#if UART_TX_USE_DMA
+extern DMA_HandleTypeDef hdma_usart2_tx;
+#endif
+#if PRINT_TX_USE_DMA
+extern DMA_HandleTypeDef hdma_usart3_tx;
+#endif
+extern DMA_HandleTypeDef hdma_tim4_ch1;
+extern TIM_HandleTypeDef htim7;
 
 /* USER CODE END EV */
 
@@ -167,11 +182,11 @@ void DebugMon_Handler(void)
 void USART2_IRQHandler(void)
 {
   /* USER CODE BEGIN USART2_IRQn 0 */
-
+  uint32_t isr_start = RUNTIME_STATS_ISR_ENTER();
   /* USER CODE END USART2_IRQn 0 */
   HAL_UART_IRQHandler(&huart2);
   /* USER CODE BEGIN USART2_IRQn 1 */
-
+  RUNTIME_STATS_ISR_EXIT(RUNTIME_ISR_USART2, isr_start);
   /* USER CODE END USART2_IRQn 1 */
 }
 
@@ -181,11 +196,11 @@ void USART2_IRQHandler(void)
 void USART3_IRQHandler(void)
 {
   /* USER CODE BEGIN USART3_IRQn 0 */
-
+  uint32_t isr_start = RUNTIME_STATS_ISR_ENTER();
   /* USER CODE END USART3_IRQn 0 */
   HAL_UART_IRQHandler(&huart3);
   /* USER CODE BEGIN USART3_IRQn 1 */
-
+  RUNTIME_STATS_ISR_EXIT(RUNTIME_ISR_USART3, isr_start);
   /* USER CODE END USART3_IRQn 1 */
 }
 
@@ -205,4 +220,66 @@ void TIM6_DAC_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+#if UART_RX_USE_DMA
+/**
+  * @brief This function handles DMA1 stream5 global interrupt (USART2_RX).
+  */
+void DMA1_Stream5_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_usart2_rx);
+}
+#endif
+
+#if PRINT_TX_USE_DMA
+/**
+  * @brief This function handles DMA1 stream3 global interrupt (USART3_TX).
+  */
+void DMA1_Stream3_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_usart3_tx);
+}
+#endif
+
+#if UART_TX_USE_DMA
+/**
+  * @brief This function handles DMA1 stream6 global interrupt (USART2_TX).
+  */
+void DMA1_Stream6_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_usart2_tx);
+}
+#endif
+
+/**
+  * @brief This function handles DMA1 stream0 global interrupt (TIM4_CH1, LED PWM).
+  */
+void DMA1_Stream0_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_tim4_ch1);
+}
+
+/**
+  * @brief This function handles TIM7 global interrupt (LED sequencer tick).
+  */
+void TIM7_IRQHandler(void)
+{
+  HAL_TIM_IRQHandler(&htim7);
+}
+
+/**
+  * @brief This function handles RTC wakeup interrupt through EXTI line 22 (tickless idle).
+  */
+void RTC_WKUP_IRQHandler(void)
+{
+  low_power_rtc_wakeup_irq();
+}
+
+/**
+  * @brief This function handles EXTI line 3 interrupt (UART2 RX wakeup from STOP).
+  */
+void EXTI3_IRQHandler(void)
+{
+  low_power_uart_wakeup_irq();
+}
+
 /* USER CODE END 1 */
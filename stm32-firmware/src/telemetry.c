@@ -0,0 +1,151 @@
+/**
+ ******************************************************************************
+ * @file           : telemetry.c
+ * @brief          : Stack High-Water Mark and Heap Telemetry Implementation
+ ******************************************************************************
+ * @description
+ * Keeps one sample (see telemetry.h). The watchdog task is the only writer
+ * and never blocks while updating it, so readers only need to keep it from
+ * running: telemetry_format() suspends the scheduler instead of copying.
+ *
+ ******************************************************************************
+ */
+
+#include "telemetry.h"
+#include "watchdog.h"
+#include <stdio.h>
+#define LOG_MODULE_LEVEL TELEMETRY_LOG_LEVEL
+#include "print_task.h"
+
+/*============================================================================
+ * Private Types
+ *===========================================================================*/
+
+/** One task of a sample */
+typedef struct {
+    const char *name;             // Task name (lives in the TCB)
+    UBaseType_t number;           // xTaskNumber, for alert latching
+    uint16_t stack_free_words;    // High-water mark: least unused stack ever
+} telemetry_task_t;
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+/** Latest sample */
+static telemetry_task_t sample_tasks[TELEMETRY_MAX_TASKS];
+static uint8_t sample_task_count = 0;
+static uint32_t sample_heap_free = 0;
+static uint32_t sample_heap_min = 0;
+static TickType_t sample_tick = 0;
+static BaseType_t sample_valid = pdFALSE;
+
+/** uxTaskGetSystemState() scratch (static: keeps it off the watchdog stack) */
+static TaskStatus_t task_status[TELEMETRY_MAX_TASKS];
+
+/** Failed pvPortMalloc() calls */
+static volatile uint32_t malloc_failures = 0;
+
+/** Alerts already raised: bit per xTaskNumber, and the heap */
+static uint32_t stack_alerted = 0;
+static BaseType_t heap_alerted = pdFALSE;
+
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Take a sample if TELEMETRY_SAMPLE_PERIOD_MS has elapsed
+ * @retval None
+ */
+void telemetry_sample(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    UBaseType_t count;
+
+    if (sample_valid && (now - sample_tick) < pdMS_TO_TICKS(TELEMETRY_SAMPLE_PERIOD_MS)) {
+        return;
+    }
+
+    // Returns 0 if there are more tasks than TELEMETRY_MAX_TASKS
+    count = uxTaskGetSystemState(task_status, TELEMETRY_MAX_TASKS, NULL);
+    if (count == 0) {
+        LOG_WARN("[TELEMETRY] More than %u tasks, raise TELEMETRY_MAX_TASKS\r\n",
+                 TELEMETRY_MAX_TASKS);
+    }
+
+    // Update the sample without blocking (see file header)
+    for (UBaseType_t i = 0; i < count; i++) {
+        sample_tasks[i].name = task_status[i].pcTaskName;
+        sample_tasks[i].number = task_status[i].xTaskNumber;
+        sample_tasks[i].stack_free_words = (uint16_t)task_status[i].usStackHighWaterMark;
+    }
+    sample_task_count = (uint8_t)count;
+    sample_heap_free = (uint32_t)xPortGetFreeHeapSize();
+    sample_heap_min = (uint32_t)xPortGetMinimumEverFreeHeapSize();
+    sample_tick = now;
+    sample_valid = pdTRUE;
+
+    // Alerts (may block in the logger, so after the update)
+    for (uint8_t i = 0; i < sample_task_count; i++) {
+        uint32_t bit = 1UL << (sample_tasks[i].number % 32U);
+
+        LOG_DEBUG("[TELEMETRY] %s: %u words unused\r\n",
+                  sample_tasks[i].name,
+                  sample_tasks[i].stack_free_words);
+        if (sample_tasks[i].stack_free_words < TELEMETRY_STACK_ALERT_WORDS
+                && (stack_alerted & bit) == 0) {
+            stack_alerted |= bit;
+            watchdog_raise_alert(sample_tasks[i].name, "Stack words unused",
+                                 sample_tasks[i].stack_free_words);
+        }
+    }
+    LOG_DEBUG("[TELEMETRY] Heap: %lu free, %lu min\r\n", sample_heap_free, sample_heap_min);
+    if (sample_heap_min < TELEMETRY_HEAP_ALERT_BYTES && !heap_alerted) {
+        heap_alerted = pdTRUE;
+        watchdog_raise_alert("Heap", "Min free bytes", sample_heap_min);
+    }
+}
+
+/**
+ * @brief  Format the latest sample as a MEM reply line
+ * @param  buf: Output buffer
+ * @param  size: Buffer size
+ * @retval Length written, 0 before the first sample
+ */
+int telemetry_format(char *buf, size_t size)
+{
+    int len = 0;
+
+    vTaskSuspendAll();
+    if (sample_valid) {
+        len = snprintf(buf, size, "MEM:heap=%lu,min=%lu,fail=%lu",
+                       (unsigned long)sample_heap_free, (unsigned long)sample_heap_min,
+                       (unsigned long)malloc_failures);
+        if (len < 0 || (size_t)len >= size) {
+            len = 0;  // Buffer too small for even the heap figures
+        }
+        for (uint8_t i = 0; i < sample_task_count && len > 0 && (size_t)len < size; i++) {
+            int n = snprintf(&buf[len], size - (size_t)len, "%c%s=%u",
+                             (i == 0) ? ';' : ',', sample_tasks[i].name,
+                             (unsigned int)sample_tasks[i].stack_free_words);
+            if (n < 0 || (size_t)(len + n) >= size) {
+                buf[len] = '\0';  // Leave out tasks that do not fit
+                break;
+            }
+            len += n;
+        }
+    }
+    xTaskResumeAll();
+
+    return len;
+}
+
+/**
+ * @brief  Count a failed pvPortMalloc()
+ * @retval None
+ */
+void telemetry_malloc_failed(void)
+{
+    malloc_failures++;
+}
@@ -0,0 +1,149 @@
+/**
+ ******************************************************************************
+ * @file           : trace.c
+ * @brief          : Command Latency Trace Implementation
+ ******************************************************************************
+ * @description
+ * One open record for the command being processed and a ring of finished
+ * records (see trace.h). Apart from the RX stamp, which the ISR writes and
+ * the task copies, everything runs in the comm task, so no locking is needed.
+ *
+ * A chunk can hold several commands: they all share its RX_ISR and
+ * TASK_WAKE stamps, and the later ones show their wait behind the earlier
+ * ones in the DISPATCH stage.
+ *
+ ******************************************************************************
+ */
+
+#include "trace.h"
+#include "led_frame.h"
+#include <stdio.h>
+#include <string.h>
+
+/*============================================================================
+ * Private Types
+ *===========================================================================*/
+
+/** One traced command */
+typedef struct {
+    uint8_t seq;                          // Command sequence number
+    uint32_t t[TRACE_STAGE_COUNT];        // CYCCNT per stage, 0 = not reached
+} trace_record_t;
+
+/*============================================================================
+ * Private Data
+ *===========================================================================*/
+
+/** CYCCNT at the last UART RX callback */
+static volatile uint32_t rx_isr_stamp = 0;
+
+/** Stamps of the chunk being processed */
+static uint32_t chunk_rx_isr = 0;
+static uint32_t chunk_wake = 0;
+
+/** Command being processed */
+static trace_record_t open_record;
+
+/** Finished records, oldest at ring_tail */
+static trace_record_t ring[TRACE_RING_SIZE];
+static uint8_t ring_tail = 0;
+static uint8_t ring_count = 0;
+
+/*============================================================================
+ * Public Functions
+ *===========================================================================*/
+
+/**
+ * @brief  Stamp a UART RX callback (ISR context)
+ * @retval None
+ */
+void trace_rx_isr(void)
+{
+    rx_isr_stamp = DWT->CYCCNT;
+}
+
+/**
+ * @brief  Stamp the comm task waking with a received chunk
+ * @retval None
+ */
+void trace_chunk(void)
+{
+    chunk_wake = DWT->CYCCNT;
+    chunk_rx_isr = rx_isr_stamp;
+}
+
+/**
+ * @brief  Stamp a stage of the command being processed
+ * @param  stage: TRACE_DISPATCH or TRACE_APPLIED
+ * @retval None
+ */
+void trace_mark(trace_stage_t stage)
+{
+    if (stage == TRACE_DISPATCH) {
+        memset(&open_record, 0, sizeof(open_record));
+        open_record.t[TRACE_RX_ISR] = chunk_rx_isr;
+        open_record.t[TRACE_TASK_WAKE] = chunk_wake;
+    }
+    open_record.t[stage] = DWT->CYCCNT;
+}
+
+/**
+ * @brief  Stamp the ACK and store the record in the ring
+ * @param  seq: Sequence number of the command
+ * @retval None
+ */
+void trace_commit(int32_t seq)
+{
+    if (seq == LED_CMD_NO_SEQ) {
+        return;
+    }
+
+    open_record.t[TRACE_ACK] = DWT->CYCCNT;
+    open_record.seq = (uint8_t)seq;
+
+    // Full: overwrite the oldest
+    ring[(ring_tail + ring_count) % TRACE_RING_SIZE] = open_record;
+    if (ring_count < TRACE_RING_SIZE) {
+        ring_count++;
+    } else {
+        ring_tail = (uint8_t)((ring_tail + 1) % TRACE_RING_SIZE);
+    }
+}
+
+/**
+ * @brief  Format and remove the oldest record as a TR: line
+ * @param  buf: Output buffer
+ * @param  size: Buffer size
+ * @retval Length written, 0 if the ring is empty
+ */
+int trace_format(char *buf, size_t size)
+{
+    const trace_record_t *rec;
+    int len;
+
+    if (ring_count == 0) {
+        return 0;
+    }
+
+    rec = &ring[ring_tail];
+    len = snprintf(buf, size, "TR:%u,%lu,%lu,%lu,%lu,%lu", (unsigned int)rec->seq,
+                   (unsigned long)rec->t[TRACE_RX_ISR], (unsigned long)rec->t[TRACE_TASK_WAKE],
+                   (unsigned long)rec->t[TRACE_DISPATCH], (unsigned long)rec->t[TRACE_APPLIED],
+                   (unsigned long)rec->t[TRACE_ACK]);
+    if (len < 0 || (size_t)len >= size) {
+        return 0;  // Buffer too small: keep the record
+    }
+
+    ring_tail = (uint8_t)((ring_tail + 1) % TRACE_RING_SIZE);
+    ring_count--;
+    return len;
+}
+
+/**
+ * @brief  Number of records waiting to be read
+ * @retval Count
+ */
+uint8_t trace_pending(void)
+{
+    return ring_count;
+}
@@ -11,17 +11,25 @@
  * - Tasks call watchdog_feed(id) periodically
  * - Watchdog task wakes every WATCHDOG_CHECK_PERIOD_MS
  * - Checks all tasks: if time_since_last_feed > timeout → ALERT!
+ * - Refreshes the IWDG only if no task is overdue; the first overdue task
+ *   is written to the backup registers and the IWDG resets the MCU
+ *   WATCHDOG_IWDG_TIMEOUT_MS later
+ * - Samples stack/heap telemetry (telemetry.h) and raises its alerts
  *
  ******************************************************************************
  */
 
 #include "watchdog.h"
+#include "telemetry.h"
+#include "config_store.h"
+#include "esp8266_comm_task.h"
+#include "led_effects.h"
 #include <string.h>
 #include <stdio.h>
 
 /* Use print task for all watchdog output (UART3 - debug logging) */
+#define LOG_MODULE_LEVEL WATCHDOG_LOG_LEVEL
 #include "print_task.h"
-#define WATCHDOG_PRINT(msg) print_message(msg)
 
 /*============================================================================
  * Private Types
@@ -51,11 +59,33 @@ static watchdog_callback_t timeout_callback = NULL;
 /** Watchdog task handle */
 static TaskHandle_t watchdog_task_handle = NULL;
 
+/** Culprit of the IWDG reset that started this boot (NULL: none) */
+static char reset_culprit_name[16];
+static const char *reset_culprit = NULL;
+
+#if WATCHDOG_USE_IWDG
+/** IWDG key register values (RM0090 21.4.1) */
+#define IWDG_KEY_REFRESH     0xAAAAU
+#define IWDG_KEY_UNLOCK      0x5555U
+#define IWDG_KEY_START       0xCCCCU
+#define IWDG_PRESCALER_64    4U         // PR = 4: LSI / 64 = 500 Hz
+#define IWDG_RELOAD          ((WATCHDOG_IWDG_TIMEOUT_MS * 32U) / 64U)
+
+/** A culprit has been recorded; the IWDG is no longer refreshed */
+static BaseType_t reset_pending = pdFALSE;
+#endif
+
 /*============================================================================
  * Private Function Prototypes
  *===========================================================================*/
 
 static void watchdog_task(void *parameters);
+static BaseType_t task_overdue(const watchdog_entry_t *entry, TickType_t now, uint32_t *elapsed_ms);
+static void reset_record_read(void);
+#if WATCHDOG_USE_IWDG
+static void reset_record_write(watchdog_id_t id, uint32_t elapsed_ms);
+static void iwdg_start(void);
+#endif
 
 /*============================================================================
  * Public Functions
@@ -71,6 +101,9 @@ void watchdog_init(void)
     num_registered = 0;
     timeout_callback = NULL;
 
+    // Report (and clear) the culprit of an IWDG reset
+    reset_record_read();
+
     // Create watchdog monitor task
     BaseType_t status = xTaskCreate(
         watchdog_task,
@@ -83,7 +116,11 @@ void watchdog_init(void)
 
     configASSERT(status == pdPASS);
 
-    WATCHDOG_PRINT("\r\n[WATCHDOG] Initialized\r\n");
+    LOG_INFO("\r\n[WATCHDOG] Initialized\r\n");
+    if (reset_culprit != NULL) {
+        LOG_ERROR("[WATCHDOG] Last reset by IWDG: '%s' stopped feeding\r\n",
+                  reset_culprit);
+    }
 }
 
 /**
@@ -93,7 +130,7 @@ watchdog_id_t watchdog_register(const char *task_name, uint32_t timeout_ms)
 {
     // Check if we have space
     if (num_registered >= WATCHDOG_MAX_TASKS) {
-        WATCHDOG_PRINT("[WATCHDOG] ERROR: Max tasks reached!\r\n");
+        LOG_ERROR("[WATCHDOG] ERROR: Max tasks reached!\r\n");
         return WATCHDOG_INVALID_ID;
     }
 
@@ -121,11 +158,9 @@ watchdog_id_t watchdog_register(const char *task_name, uint32_t timeout_ms)
     }
     taskEXIT_CRITICAL();
 
-    // Log registration
-    char msg[64];
-    snprintf(msg, sizeof(msg), "[WATCHDOG] Registered '%s' (ID=%u, timeout=%lums)\r\n",
-             task_name, id, timeout_ms);
-    WATCHDOG_PRINT(msg);
+    // Log registration (name copy is static, safe for deferred formatting)
+    LOG_INFO("[WATCHDOG] Registered '%s' (ID=%u, timeout=%lums)\r\n",
+             watchdog_tasks[id].task_name, id, timeout_ms);
 
     return id;
 }
@@ -177,10 +212,123 @@ BaseType_t watchdog_get_stats(watchdog_id_t id, uint32_t *last_feed_ms, uint32_t
     return pdTRUE;
 }
 
+/**
+ * @brief  Raise a non-timeout alert
+ * @param  task_name: Task or resource concerned
+ * @param  reason: What was measured (static string)
+ * @param  value: Measured value
+ * @retval None
+ */
+void watchdog_raise_alert(const char *task_name, const char *reason, uint32_t value)
+{
+    LOG_ERROR("\r\n*** WATCHDOG ALERT ***\r\n"
+              "Task: %s\r\n"
+              "%s: %lu\r\n\r\n",
+              task_name,
+              reason,
+              value);
+}
+
+/**
+ * @brief  Culprit of the IWDG reset that started this boot
+ */
+const char *watchdog_get_reset_culprit(void)
+{
+    return reset_culprit;
+}
+
 /*============================================================================
  * Private Functions
  *===========================================================================*/
 
+/**
+ * @brief  Decide whether a registered task has missed its deadline
+ * @param  entry: Registered task
+ * @param  now: Current tick
+ * @param  elapsed_ms: [OUT] Time since its last feed
+ * @retval pdTRUE if overdue
+ * @note   No kernel or HAL calls: the IWDG decision can be exercised on a
+ *         host build with a stub TickType_t
+ */
+static BaseType_t task_overdue(const watchdog_entry_t *entry, TickType_t now, uint32_t *elapsed_ms)
+{
+    *elapsed_ms = pdTICKS_TO_MS(now - entry->last_feed_tick);
+    return (*elapsed_ms > entry->timeout_ms) ? pdTRUE : pdFALSE;
+}
+
+/**
+ * @brief  Read and clear the reset record (called once at boot)
+ * @retval None
+ *
+ * The backup registers survive system resets (and power loss with VBAT),
+ * so a record is only trusted when the reset flags say IWDG.
+ */
+static void reset_record_read(void)
+{
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_IWDGRST)) {
+        if ((RTC->BKP0R & 0xFFFF0000UL) == WATCHDOG_BKP_MAGIC) {
+            const volatile uint32_t *words = &RTC->BKP2R;
+            for (uint8_t i = 0; i < sizeof(reset_culprit_name); i++) {
+                reset_culprit_name[i] = (char)(words[i / 4] >> (8 * (i % 4)));
+            }
+            reset_culprit_name[sizeof(reset_culprit_name) - 1] = '\0';
+        } else {
+            strcpy(reset_culprit_name, "Watchdog");  // Monitor or scheduler stopped
+        }
+        reset_culprit = reset_culprit_name;
+    }
+
+    RTC->BKP0R = 0;
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+}
+
+#if WATCHDOG_USE_IWDG
+/**
+ * @brief  Record the task that is about to cause an IWDG reset
+ * @param  id: Culprit
+ * @param  elapsed_ms: Time since its last feed
+ * @retval None
+ */
+static void reset_record_write(watchdog_id_t id, uint32_t elapsed_ms)
+{
+    const char *name = watchdog_tasks[id].task_name;
+    volatile uint32_t *words = &RTC->BKP2R;
+
+    for (uint8_t w = 0; w < 4; w++) {
+        uint32_t word = 0;
+        for (uint8_t b = 0; b < 4; b++) {
+            word |= (uint32_t)(uint8_t)name[w * 4 + b] << (8 * b);
+        }
+        words[w] = word;
+    }
+    RTC->BKP1R = elapsed_ms;
+    RTC->BKP0R = WATCHDOG_BKP_MAGIC | id;  // Written last: marks the record valid
+}
+
+/**
+ * @brief  Start the IWDG with WATCHDOG_IWDG_TIMEOUT_MS
+ * @retval None
+ * @note   Once started it cannot be stopped; frozen while the core is
+ *         halted by a debugger
+ */
+static void iwdg_start(void)
+{
+    __HAL_DBGMCU_FREEZE_IWDG();
+
+    IWDG->KR = IWDG_KEY_START;
+    IWDG->KR = IWDG_KEY_UNLOCK;
+    IWDG->PR = IWDG_PRESCALER_64;
+    IWDG->RLR = IWDG_RELOAD;
+    while (IWDG->SR != 0) {
+        // PR/RLR updates take a few LSI cycles
+    }
+    IWDG->KR = IWDG_KEY_REFRESH;
+}
+#endif
+
 /**
  * @brief  Watchdog monitor task
  * @param  parameters: Unused
@@ -197,7 +345,12 @@ static void watchdog_task(void *parameters)
 
     TickType_t last_wake = xTaskGetTickCount();
 
-    WATCHDOG_PRINT("[WATCHDOG] Monitor task started\r\n");
+#if WATCHDOG_USE_IWDG
+    // Started here, not in main(): boot-time flash erases may stall longer
+    iwdg_start();
+#endif
+
+    LOG_INFO("[WATCHDOG] Monitor task started\r\n");
 
     while (1) {
         // Sleep for check period
@@ -212,31 +365,33 @@ static void watchdog_task(void *parameters)
                 continue;  // Skip unregistered slots
             }
 
-            // Calculate time since last feed
-            TickType_t elapsed_ticks = now - watchdog_tasks[id].last_feed_tick;
-            uint32_t elapsed_ms = pdTICKS_TO_MS(elapsed_ticks);
-
             // Check if timeout exceeded
-            if (elapsed_ms > watchdog_tasks[id].timeout_ms) {
+            uint32_t elapsed_ms;
+            if (task_overdue(&watchdog_tasks[id], now, &elapsed_ms)) {
                 // TIMEOUT DETECTED!
+#if WATCHDOG_USE_IWDG
+                // First culprit wins; stop refreshing so the IWDG resets us
+                if (!reset_pending) {
+                    reset_record_write(id, elapsed_ms);
+                    reset_pending = pdTRUE;
+                    LOG_ERROR("[WATCHDOG] IWDG reset in %u ms\r\n", WATCHDOG_IWDG_TIMEOUT_MS);
+                }
+#endif
 
                 if (timeout_callback) {
                     // Call user callback
                     timeout_callback(id, watchdog_tasks[id].task_name, elapsed_ms);
                 } else {
-                    // Default: print warning
-                    char alert_msg[256];
-                    snprintf(alert_msg, sizeof(alert_msg),
-                             "\r\n*** WATCHDOG ALERT ***\r\n"
-                             "Task: %s (ID=%u)\r\n"
-                             "Last feed: %lu ms ago\r\n"
-                             "Timeout: %lu ms\r\n"
-                             "Status: HUNG or DEADLOCKED!\r\n\r\n",
-                             watchdog_tasks[id].task_name,
-                             id,
-                             elapsed_ms,
-                             watchdog_tasks[id].timeout_ms);
-                    WATCHDOG_PRINT(alert_msg);
+                    // Default: print warning (formatted by the print task)
+                    LOG_ERROR("\r\n*** WATCHDOG ALERT ***\r\n"
+                              "Task: %s (ID=%u)\r\n"
+                              "Last feed: %lu ms ago\r\n"
+                              "Timeout: %lu ms\r\n"
+                              "Status: HUNG or DEADLOCKED!\r\n\r\n",
+                              watchdog_tasks[id].task_name,
+                              id,
+                              elapsed_ms,
+                              watchdog_tasks[id].timeout_ms);
                 }
 
                 // Reset timer to avoid spam (task may be permanently hung)
@@ -244,5 +399,24 @@ static void watchdog_task(void *parameters)
                 watchdog_tasks[id].last_feed_tick = now;
             }
         }
+
+        // Stack and heap watermarks (rate-limited inside)
+        telemetry_sample();
+
+#if WATCHDOG_USE_IWDG
+        // Every registered task is healthy (and so are we and the scheduler)
+        if (!reset_pending) {
+            IWDG->KR = IWDG_KEY_REFRESH;
+        }
+#endif
+
+        // Keep the pattern/scene that is playing across resets (once applied)
+        led_effects_save();
+
+        // Erase a config bank retired by compaction: right after the refresh
+        // (the stall fits the IWDG timeout) and while UART2 is quiet
+        if (esp8266_comm_link_quiet()) {
+            config_store_service();
+        }
     }
 }
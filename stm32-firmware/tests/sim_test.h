@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ * @file           : sim_test.h
+ * @brief          : Host Test Helpers - Checks and ESP8266 Link Access
+ ******************************************************************************
+ * @description
+ * Shared by the host tests in this folder. Each test is one executable:
+ * CHECK() records a failure and carries on, main() returns
+ * SIM_TEST_RESULT() so ctest reports the test as failed.
+ *
+ * Link helpers play the ESP8266 side of UART2: esp_send() puts a line on
+ * the wire, esp_read_line() collects what the firmware has finished
+ * transmitting, one line at a time.
+ ******************************************************************************
+ */
+
+#ifndef SIM_TEST_H
+#define SIM_TEST_H
+
+#include "hal_sim.h"
+#include "sim_board.h"
+#include "sim_kernel.h"
+#include "task.h"
+#include <stdio.h>
+#include <string.h>
+
+static int sim_test_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            sim_test_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_STR(actual, expected) \
+    do { \
+        if (strcmp((actual), (expected)) != 0) { \
+            fprintf(stderr, "%s:%d: CHECK failed: \"%s\" != \"%s\"\n", \
+                    __FILE__, __LINE__, (actual), (expected)); \
+            sim_test_failures++; \
+        } \
+    } while (0)
+
+#define SIM_TEST_RESULT() \
+    (sim_test_failures == 0 ? (printf("PASS\n"), 0) : (printf("FAIL (%d)\n", sim_test_failures), 1))
+
+/** Bytes from the firmware not yet returned as a line */
+static char esp_rx[4096];
+static size_t esp_rx_len = 0;
+
+/**
+ * @brief  Boot the simulated board and let the tasks settle
+ * @retval None
+ */
+static inline void sim_test_boot(void)
+{
+    sim_board_boot();
+    vTaskStartScheduler();
+    sim_kernel_run_ms(50);
+    (void)sim_uart_tx_read(&huart2, NULL, SIZE_MAX);
+}
+
+/**
+ * @brief  Send a string to the firmware as the ESP8266 would
+ * @param  text: Bytes to send (include "\r\n" for a line)
+ * @retval Time the last byte has arrived (ns)
+ */
+static inline uint64_t esp_send(const char *text)
+{
+    return sim_uart_rx(&huart2, text, strlen(text));
+}
+
+/**
+ * @brief  Next line from the firmware (without "\r\n")
+ * @param  line: Output buffer
+ * @param  size: Buffer size
+ * @retval 1 if a complete line was available, 0 otherwise
+ */
+static inline int esp_read_line(char *line, size_t size)
+{
+    esp_rx_len += sim_uart_tx_read(&huart2, &esp_rx[esp_rx_len], sizeof(esp_rx) - esp_rx_len);
+
+    char *end = memchr(esp_rx, '\n', esp_rx_len);
+    if (end == NULL) {
+        return 0;
+    }
+    size_t len = (size_t)(end - esp_rx) + 1U;
+    size_t text = len;
+    while (text > 0 && (esp_rx[text - 1] == '\n' || esp_rx[text - 1] == '\r')) {
+        text--;
+    }
+    if (text >= size) {
+        text = size - 1U;
+    }
+    memcpy(line, esp_rx, text);
+    line[text] = '\0';
+    memmove(esp_rx, &esp_rx[len], esp_rx_len - len);
+    esp_rx_len -= len;
+    return 1;
+}
+
+/**
+ * @brief  Skip lines until one starts with a prefix
+ * @param  prefix: Expected start ("OK:", "PONG")
+ * @param  line: Output buffer for the matching line
+ * @param  size: Buffer size
+ * @retval 1 if found among the lines received so far
+ */
+static inline int esp_expect(const char *prefix, char *line, size_t size)
+{
+    while (esp_read_line(line, size)) {
+        if (strncmp(line, prefix, strlen(prefix)) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif /* SIM_TEST_H */
@@ -0,0 +1,258 @@
+/**
+ ******************************************************************************
+ * @file           : test_command_dispatch.c
+ * @brief          : Table-Driven Command Dispatcher
+ ******************************************************************************
+ * @description
+ * - Every keyword reaches its own handler, with and without arguments
+ * - Keywords that share a prefix are kept apart; near misses (prefix,
+ *   suffix, case) are unknown, an empty line is COMMAND_EMPTY
+ * - A full table (COMMAND_HASH_SLOTS - 1 entries, long probe chains) still
+ *   resolves every keyword; duplicates and oversized tables are refused
+ * - The firmware's own table: every ASCII command sent over UART2 gets
+ *   its documented reply (or none), unknown keywords are ignored
+ * - TRACE on a nearly full UART2 TX queue: only the END line is sent and
+ *   the records wait for the next TRACE instead of being lost
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include "command_dispatch.h"
+#include "led_frame.h"
+#include "trace.h"
+#include <stdlib.h>
+
+/*============================================================================
+ * Recording Handlers
+ *===========================================================================*/
+
+static int last_handler = -1;
+static char last_args[64];
+
+#define RECORDER(n) \
+    static void handler_##n(const char *args) \
+    { \
+        last_handler = (n); \
+        snprintf(last_args, sizeof(last_args), "%s", args); \
+    }
+
+RECORDER(0) RECORDER(1) RECORDER(2) RECORDER(3) RECORDER(4)
+
+static const command_entry_t commands[] = {
+    { "PING",      handler_0 },
+    { "LED",       handler_1 },
+    { "LED_CMD",   handler_2 },
+    { "LED_CMD_X", handler_3 },
+    { "TIME",      handler_4 },
+};
+COMMAND_TABLE_CHECK(commands);
+
+/**
+ * @brief  Dispatch a line and report which handler ran
+ * @retval Handler number, -1 if none
+ */
+static int dispatch(const command_dispatcher_t *d, const char *line)
+{
+    last_handler = -1;
+    last_args[0] = '\0';
+    (void)command_dispatch(d, line);
+    return last_handler;
+}
+
+static void handler_any(const char *args)
+{
+    last_handler = 0;
+    (void)args;
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void test_lookup(void)
+{
+    command_dispatcher_t d;
+
+    CHECK(command_dispatcher_init(&d, commands, COMMAND_TABLE_SIZE(commands)) == 0);
+
+    CHECK(dispatch(&d, "PING") == 0);
+    CHECK_STR(last_args, "");
+    CHECK(dispatch(&d, "LED:1") == 1);
+    CHECK_STR(last_args, "1");
+    CHECK(dispatch(&d, "LED_CMD:2#17") == 2);
+    CHECK_STR(last_args, "2#17");
+    CHECK(dispatch(&d, "LED_CMD_X") == 3);
+    CHECK(dispatch(&d, "TIME:1:2") == 4);
+    CHECK_STR(last_args, "1:2");           // Only the first ':' separates
+    CHECK(dispatch(&d, "LED_CMD:") == 2);
+    CHECK_STR(last_args, "");
+
+    static const char *const unknown[] = {
+        "PIN", "PINGS", "ping", "LED_", "LED_CMD_", "LED_CMD_XY", ":2", " PING", "PING ",
+    };
+    for (size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); i++) {
+        CHECK(command_dispatch(&d, unknown[i]) == COMMAND_UNKNOWN);
+    }
+    CHECK(command_dispatch(&d, "") == COMMAND_EMPTY);
+    CHECK(command_dispatch(&d, NULL) == COMMAND_EMPTY);
+    CHECK(command_dispatch(&d, "LED_CMD:3") == COMMAND_DISPATCHED);
+
+    const char *args = NULL;
+    CHECK(command_lookup(&d, "LED_CMD:4", &args) == &commands[2]);
+    CHECK_STR(args, "4");
+    CHECK(command_lookup(&d, "NOPE:4", NULL) == NULL);
+}
+
+static void test_table_limits(void)
+{
+    static char keywords[COMMAND_HASH_SLOTS][8];
+    static command_entry_t table[COMMAND_HASH_SLOTS];
+    static const command_entry_t duplicates[] = {
+        { "PING", handler_0 },
+        { "TIME", handler_1 },
+        { "PING", handler_2 },
+    };
+    command_dispatcher_t d;
+
+    for (int i = 0; i < COMMAND_HASH_SLOTS; i++) {
+        snprintf(keywords[i], sizeof(keywords[i]), "CMD%d", i);
+        table[i].keyword = keywords[i];
+        table[i].handler = handler_any;
+    }
+
+    // One free slot left: every probe chain still ends
+    CHECK(command_dispatcher_init(&d, table, COMMAND_HASH_SLOTS - 1) == 0);
+    for (int i = 0; i < COMMAND_HASH_SLOTS - 1; i++) {
+        const char *args;
+        char line[16];
+
+        snprintf(line, sizeof(line), "%s:%d", keywords[i], i);
+        CHECK(command_lookup(&d, line, &args) == &table[i]);
+        CHECK(atoi(args) == i);
+    }
+    CHECK(command_lookup(&d, keywords[COMMAND_HASH_SLOTS - 1], NULL) == NULL);
+
+    CHECK(command_dispatcher_init(&d, table, COMMAND_HASH_SLOTS) == -1);
+    CHECK(command_dispatcher_init(&d, duplicates, COMMAND_TABLE_SIZE(duplicates)) == -1);
+}
+
+static void test_firmware_table(void)
+{
+    // Every ASCII command with the start of its reply (NULL: none)
+    static const struct {
+        const char *line;
+        const char *reply;
+    } replies[] = {
+        { "PING",            "PONG" },
+        { "LED_CMD:1",       "OK:" },
+        { "LED_SET:1,500,50,0", "OK:LedSet" },
+        { "LED_SCENE:1,500,50,0;2,500,50,0", "OK:LedScene" },
+        { "LED_SYNC:15,400,2", "OK:LedSync" },
+        { "PROTO:BIN",       LED_FRAME_NEGOTIATE_ACK },
+        { "MEM",             "MEM:" },
+        { "STATS",           "STATS:" },
+        { "POWER",           "PWR:" },
+        { "TRACE",           "TR:END" },
+        { "LOG_LEVEL:3",     "OK:LogLevel3" },
+        { "PING_INTERVAL:5000,500", "OK:PingInterval" },
+        { "STM32_PONG",      NULL },
+        { "TIME:1000",       NULL },
+        { "LED_AT:1000@LED_CMD:2", "OK:Pattern2" },
+        { "LED_CMDX:1",      NULL },     // Unknown: ignored
+    };
+    char line[256];
+
+    sim_test_boot();
+    for (size_t i = 0; i < sizeof(replies) / sizeof(replies[0]); i++) {
+        char text[96];
+
+        snprintf(text, sizeof(text), "%s\r\n", replies[i].line);
+        esp_send(text);
+        sim_kernel_run_ms(20);
+        if (replies[i].reply == NULL) {
+            CHECK(!esp_read_line(line, sizeof(line)));
+            continue;
+        }
+        if (!esp_expect(replies[i].reply, line, sizeof(line))) {
+            fprintf(stderr, "no \"%s\" reply to %s\n", replies[i].reply, replies[i].line);
+            CHECK(0);
+        }
+        (void)sim_uart_tx_read(&huart2, NULL, SIZE_MAX);
+        esp_rx_len = 0;
+    }
+}
+
+/**
+ * @brief  Read a TRACE reply
+ * @param  left: [OUT] Records left (TR:END)
+ * @retval Record lines in the reply
+ */
+static unsigned int trace_reply(unsigned int *left)
+{
+    char line[128];
+    unsigned int records = 0;
+
+    *left = UINT32_MAX;
+    while (esp_read_line(line, sizeof(line))) {
+        if (sscanf(line, "TR:END,%u", left) == 1) {
+            continue;
+        }
+        if (strncmp(line, "TR:", 3) == 0) {
+            records++;
+        }
+    }
+    return records;
+}
+
+static void test_trace_backlog(void)
+{
+    char text[32];
+    unsigned int left;
+
+    // Sequenced commands leave one trace record each
+    esp_send("TRACE\r\n");
+    for (unsigned int seq = 1; seq <= 8U; seq++) {
+        snprintf(text, sizeof(text), "LED_CMD:%u#%u\r\n", 1U + seq % 4U, seq);
+        esp_send(text);
+        sim_kernel_run_ms(20);
+    }
+    (void)sim_uart_tx_read(&huart2, NULL, SIZE_MAX);
+    esp_rx_len = 0;
+
+    // UART2 held: PONGs fill the TX queue (204 of 255 bytes), no room for
+    // a record line but enough for the END line
+    huart2.gState = HAL_UART_STATE_BUSY;
+    for (int i = 0; i < 34; i++) {
+        esp_send("PING\r\n");
+        sim_kernel_run_ms(2);
+    }
+    esp_send("TRACE\r\n");
+    sim_kernel_run_ms(20);
+    huart2.gState = HAL_UART_STATE_READY;
+    esp_send("PING\r\n");      // Restarts the queue
+    sim_kernel_run_ms(100);
+    CHECK(trace_reply(&left) == 0);
+    CHECK(left == 8U);
+
+    // Room again: the records follow over the next requests
+    unsigned int total = 0;
+    for (int i = 0; i < 8 && left != 0; i++) {
+        esp_send("TRACE\r\n");
+        sim_kernel_run_ms(50);
+        unsigned int records = trace_reply(&left);
+
+        CHECK(records > 0 && records <= TRACE_DUMP_BATCH);
+        total += records;
+    }
+    CHECK(total == 8U && left == 0);
+}
+
+int main(void)
+{
+    test_lookup();
+    test_table_limits();
+    test_firmware_table();
+    test_trace_backlog();
+
+    return SIM_TEST_RESULT();
+}
@@ -0,0 +1,288 @@
+/**
+ ******************************************************************************
+ * @file           : test_config_store.c
+ * @brief          : Config Store - Power-Cut Replay
+ ******************************************************************************
+ * @description
+ * Runs the store on small RAM banks (64 slots) through a fixed sequence of
+ * sets, compactions and idle-bank erases, and cuts the power after every
+ * possible number of flash operations:
+ * ┌──────────────────┬─────────────────────────────────────────────────────┐
+ * │ Cut during       │ Effect on the simulated flash                       │
+ * ├──────────────────┼─────────────────────────────────────────────────────┤
+ * │ Program          │ Torn word: only the low half of its bits programmed │
+ * │ Erase            │ Only the first half of the bank erased              │
+ * │ Afterwards       │ Every operation fails, nothing changes              │
+ * └──────────────────┴─────────────────────────────────────────────────────┘
+ *
+ * After each cut the store is remounted with the power back on. Every set
+ * that returned 0 must survive; the set in flight may read as its old or
+ * its new value. The remounted store must then keep working across a
+ * second remount.
+ *
+ * A bank that fills again before config_store_service() has erased its
+ * successor must not be erased by set(): the values wait in the cache and
+ * reach flash with the service call.
+ ******************************************************************************
+ */
+
+#define CONFIG_STORE_BANK_SIZE  512UL
+#include "../src/config_store.c"
+
+#include "sim_test.h"
+#include <stdlib.h>
+
+/*============================================================================
+ * Simulated Flash
+ *===========================================================================*/
+
+#define SETS_PER_RUN        150U    // ~3 compactions
+#define SERVICE_EVERY       20U     // config_store_service() cadence
+
+static uint32_t ram_bank[2][CONFIG_STORE_BANK_SIZE / 4];
+
+/** Operations left before the power goes (-1 = no cut) */
+static long op_budget = -1;
+static int power_off = 0;
+
+/** Completed erases (set() must never erase) */
+static uint32_t erase_count = 0;
+
+static uint32_t *ram_word(uint32_t addr)
+{
+    uint8_t bank = (addr >= CONFIG_STORE_BANK_B) ? 1 : 0;
+    uint32_t offset = addr - bank_addr[bank];
+
+    if ((offset & 3U) != 0 || offset >= CONFIG_STORE_BANK_SIZE) {
+        fprintf(stderr, "flash access out of range: 0x%08lx\n", (unsigned long)addr);
+        abort();
+    }
+    return &ram_bank[bank][offset / 4];
+}
+
+/** Account one operation: 1 if it completes, 0 if the power goes now */
+static int ram_op(void)
+{
+    if (op_budget < 0) {
+        return 1;
+    }
+    if (op_budget == 0) {
+        power_off = 1;
+        return 0;
+    }
+    op_budget--;
+    return 1;
+}
+
+static uint32_t ram_read_word(uint32_t addr)
+{
+    return *ram_word(addr);
+}
+
+static int ram_program_word(uint32_t addr, uint32_t value)
+{
+    uint32_t *word = ram_word(addr);
+
+    if (power_off) {
+        return -1;
+    }
+    if (!ram_op()) {
+        *word &= value | 0xFFFF0000UL;
+        return -1;
+    }
+    *word &= value;
+    return 0;
+}
+
+static int ram_erase_bank(uint32_t addr, uint32_t sector)
+{
+    uint8_t bank = (addr == CONFIG_STORE_BANK_B) ? 1 : 0;
+
+    CHECK(sector == bank_sector[bank]);
+    if (power_off) {
+        return -1;
+    }
+    if (!ram_op()) {
+        memset(ram_bank[bank], 0xFF, sizeof(ram_bank[bank]) / 2);
+        return -1;
+    }
+    memset(ram_bank[bank], 0xFF, sizeof(ram_bank[bank]));
+    erase_count++;
+    return 0;
+}
+
+static const config_store_flash_ops_t ram_flash_ops = {
+    ram_read_word,
+    ram_program_word,
+    ram_erase_bank,
+};
+
+/*============================================================================
+ * Scenario
+ *===========================================================================*/
+
+/** Value each key must read back (present bit per key) */
+static uint32_t expected[CONFIG_KEY_COUNT];
+static uint32_t expected_present;
+
+/** Set cut by the power loss, if any */
+static int inflight_key;
+static uint32_t inflight_value;
+
+static config_key_t scenario_key(uint32_t i)
+{
+    return (config_key_t)(1U + (i * 7U) % (CONFIG_KEY_COUNT - 1U));
+}
+
+static uint32_t scenario_value(uint32_t i)
+{
+    return (i + 1U) * 2654435761UL;
+}
+
+/**
+ * @brief  Mount blank flash and run the sets until the power goes
+ * @retval 1 if the whole scenario ran without a cut
+ */
+static int scenario_run(long budget)
+{
+    memset(ram_bank, 0xFF, sizeof(ram_bank));
+    expected_present = 0;
+    inflight_key = 0;
+    power_off = 0;
+    op_budget = budget;
+
+    config_store_init();
+
+    for (uint32_t i = 0; i < SETS_PER_RUN && !power_off; i++) {
+        config_key_t key = scenario_key(i);
+        uint32_t value = scenario_value(i);
+
+        if (config_store_set(key, value) == 0) {
+            expected[key] = value;
+            expected_present |= 1UL << key;
+        } else {
+            CHECK(power_off);
+            inflight_key = key;
+            inflight_value = value;
+            break;
+        }
+        if ((i + 1U) % SERVICE_EVERY == 0) {
+            (void)config_store_service();
+        }
+    }
+    return !power_off;
+}
+
+/**
+ * @brief  Check the mounted store against the completed sets
+ * @retval None
+ */
+static void check_contents(long budget)
+{
+    for (int key = 1; key < CONFIG_KEY_COUNT; key++) {
+        uint32_t value = 0;
+        int stored = (config_store_get((config_key_t)key, &value) == 0);
+        int had = (expected_present & (1UL << key)) != 0;
+        int ok = (stored == had) && (!had || value == expected[key]);
+
+        if (key == inflight_key && stored && value == inflight_value) {
+            ok = 1;
+        }
+        if (!ok) {
+            fprintf(stderr, "cut after %ld ops: key %d reads %s0x%08lx\n", budget, key,
+                    stored ? "" : "(absent) ", (unsigned long)value);
+        }
+        CHECK(ok);
+    }
+}
+
+/**
+ * @brief  Sets made after the remount survive a second remount
+ * @retval None
+ */
+static void check_still_writable(long budget)
+{
+    for (uint32_t i = 0; i < 2U * (CONFIG_SLOTS + 2U); i++) {
+        config_key_t key = scenario_key(i);
+        uint32_t value = ~scenario_value(i + budget);
+
+        if (config_store_set(key, value) != 0) {
+            fprintf(stderr, "cut after %ld ops: set failed after remount\n", budget);
+            CHECK(0);
+            return;
+        }
+        expected[key] = value;
+        expected_present |= 1UL << key;
+        (void)config_store_service();
+    }
+    inflight_key = 0;
+    config_store_init();
+    check_contents(budget);
+}
+
+/**
+ * @brief  A bank that fills twice between two monitor passes: the second
+ *         time set() must not erase, and the sets reach flash once the
+ *         monitor's service call has erased and compacted
+ * @retval None
+ */
+static void test_full_bank_deferred(void)
+{
+    uint32_t i = 0;
+
+    memset(ram_bank, 0xFF, sizeof(ram_bank));
+    expected_present = 0;
+    inflight_key = 0;
+    config_store_init();
+    uint32_t generation = active_generation;
+    uint32_t erases = erase_count;
+
+    // No service call: the first compaction uses the idle bank erased at
+    // mount, the second finds it dirty
+    for (; active_generation == generation || next_slot < CONFIG_SLOTS; i++) {
+        CHECK(config_store_set(scenario_key(i), scenario_value(i)) == 0);
+        expected[scenario_key(i)] = scenario_value(i);
+        expected_present |= 1UL << scenario_key(i);
+    }
+    for (uint32_t n = 0; n < 3U; n++, i++) {
+        CHECK(config_store_set(scenario_key(i), scenario_value(i)) == 0);
+        expected[scenario_key(i)] = scenario_value(i);
+        expected_present |= 1UL << scenario_key(i);
+    }
+    CHECK(erase_count == erases);
+    CHECK(compact_pending);
+    check_contents(-1);         // From the cache
+
+    // The monitor's pass: erase, then the deferred sets reach flash
+    CHECK(config_store_service() == pdTRUE);
+    CHECK(erase_count == erases + 1U);
+    CHECK(!compact_pending && active_generation == generation + 2U);
+    config_store_init();
+    check_contents(-1);
+}
+
+int main(void)
+{
+    long budget;
+
+    config_store_set_flash_ops(&ram_flash_ops);
+
+    for (budget = 0; !scenario_run(budget); budget++) {
+        power_off = 0;
+        op_budget = -1;
+        config_store_init();
+        check_contents(budget);
+        check_still_writable(budget);
+    }
+
+    // The uncut run: every set read back after a plain remount
+    op_budget = -1;
+    config_store_init();
+    check_contents(budget);
+    CHECK(active_generation >= 3);  // Compacted more than once
+    printf("config_store: %ld cut points replayed\n", budget);
+
+    test_full_bank_deferred();
+
+    return SIM_TEST_RESULT();
+}
@@ -0,0 +1,289 @@
+/**
+ ******************************************************************************
+ * @file           : test_led_curve.c
+ * @brief          : LED Brightness Curves - Step by Step Against Closed Forms
+ ******************************************************************************
+ * @description
+ * led_curve.c on its own, every output compared with a floating-point
+ * reference:
+ * ┌──────────┬───────────────────────────────────────────────────────────┐
+ * │ Curve    │ Reference                                                 │
+ * ├──────────┼───────────────────────────────────────────────────────────┤
+ * │ LINEAR   │ round(level × DUTY_MAX / 255), every level                │
+ * │ GAMMA    │ round((level / 255)^2.2 × DUTY_MAX), every level          │
+ * │ Fade     │ from + trunc((to - from) × t / duration), every ms        │
+ * │ Breathe  │ Triangle with its apex at h = period / 2:                 │
+ * │          │ floor(peak × φ / h) rising, floor(peak × (P - φ) / (P - h))│
+ * │          │ falling, φ = t mod P; every ms of three periods           │
+ * └──────────┴───────────────────────────────────────────────────────────┘
+ * Then LED_SYNC mode 3 on the simulated board: each PD12-PD15 compare
+ * value in the pin log must be led_curve_duty(led_curve_breathe()) of its
+ * frame, 1 ms apart, identical on every LED of the group - also when the
+ * group starts while the PWM DMA is already streaming.
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include "led_curve.h"
+#include "led_pwm.h"
+#include <math.h>
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define PIN_FIRST       12U     // PD12 = LED_GREEN .. PD15 = LED_BLUE
+#define BREATHE_MS      3000U   // Pin log window on the board
+#define MAX_CHANGES     BREATHE_MS
+
+/** Duty changes of one LED: frame (ms since start) or time (ns), value */
+typedef struct {
+    uint64_t at;
+    uint16_t duty;
+} duty_change_t;
+
+static duty_change_t expected[MAX_CHANGES];
+static duty_change_t logged[LED_COUNT][MAX_CHANGES];
+static size_t logged_count[LED_COUNT];
+
+/** Closed-form triangle, apex at period / 2 (rounded down) */
+static uint8_t breathe_reference(uint8_t peak, uint32_t t_ms, uint32_t period_ms)
+{
+    double half = (double)(period_ms / 2U);
+    double phase = (double)(t_ms % period_ms);
+
+    if (phase < half) {
+        return (uint8_t)floor(peak * phase / half);
+    }
+    return (uint8_t)floor(peak * ((double)period_ms - phase) / ((double)period_ms - half));
+}
+
+/**
+ * @brief  Compare values of PD12-PD15 from the pin log, per LED
+ * @retval None
+ */
+static void collect_duty(void)
+{
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        logged_count[led] = 0;
+    }
+    for (size_t i = 0; i < sim_pin_log_count(); i++) {
+        const sim_pin_event_t *e = sim_pin_log_get(i);
+
+        if (e->port != 'D' || e->pin < PIN_FIRST || e->pin >= PIN_FIRST + LED_COUNT) {
+            continue;
+        }
+        uint8_t led = (uint8_t)(e->pin - PIN_FIRST);
+        if (logged_count[led] < MAX_CHANGES) {
+            logged[led][logged_count[led]].at = e->ns;
+            logged[led][logged_count[led]].duty = (uint16_t)e->value;
+            logged_count[led]++;
+        }
+    }
+}
+
+/**
+ * @brief  Duty changes a breathing LED makes, frame by frame from 0
+ * @param  from_duty: Duty before the breath starts
+ * @retval Number of changes in expected[]
+ */
+static size_t expected_duty(uint16_t from_duty, uint32_t period_ms, uint32_t frames)
+{
+    size_t n = 0;
+    uint16_t duty = from_duty;
+
+    for (uint32_t f = 0; f < frames && n < MAX_CHANGES; f++) {
+        uint16_t next = led_curve_duty(led_curve_breathe(LED_LEVEL_MAX, f, period_ms), LED_CURVE_GAMMA);
+
+        if (next != duty) {
+            expected[n].at = f;
+            expected[n].duty = next;
+            n++;
+            duty = next;
+        }
+    }
+    return n;
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void test_duty(void)
+{
+    unsigned int mismatches = 0;
+
+    for (unsigned int level = 0; level <= LED_LEVEL_MAX; level++) {
+        uint16_t linear = (uint16_t)floor(level * (double)LED_CURVE_DUTY_MAX / LED_LEVEL_MAX + 0.5);
+        uint16_t gamma = (uint16_t)floor(pow(level / (double)LED_LEVEL_MAX, 2.2) * LED_CURVE_DUTY_MAX + 0.5);
+
+        if (led_curve_duty((uint8_t)level, LED_CURVE_LINEAR) != linear
+                || led_curve_duty((uint8_t)level, LED_CURVE_GAMMA) != gamma) {
+            fprintf(stderr, "level %u: linear %u (ref %u), gamma %u (ref %u)\n", level,
+                    led_curve_duty((uint8_t)level, LED_CURVE_LINEAR), linear,
+                    led_curve_duty((uint8_t)level, LED_CURVE_GAMMA), gamma);
+            mismatches++;
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(led_curve_duty(0, LED_CURVE_GAMMA) == 0);
+    CHECK(led_curve_duty(LED_LEVEL_MAX, LED_CURVE_GAMMA) == LED_CURVE_DUTY_MAX);
+    CHECK(led_curve_duty(LED_LEVEL_MAX, LED_CURVE_LINEAR) == LED_CURVE_DUTY_MAX);
+}
+
+static void test_fade(void)
+{
+    static const uint8_t ends[][2] = { { 0, 255 }, { 255, 0 }, { 17, 200 }, { 90, 90 } };
+    static const uint32_t durations[] = { 1, 7, 100, 999 };
+    unsigned int mismatches = 0;
+
+    for (size_t e = 0; e < sizeof(ends) / sizeof(ends[0]); e++) {
+        for (size_t d = 0; d < sizeof(durations) / sizeof(durations[0]); d++) {
+            uint8_t from = ends[e][0];
+            uint8_t to = ends[e][1];
+
+            for (uint32_t t = 0; t <= durations[d] + 5U; t++) {
+                uint8_t ref = (t >= durations[d]) ? to
+                            : (uint8_t)(from + trunc(((double)to - from) * t / durations[d]));
+
+                if (led_curve_fade(from, to, t, durations[d]) != ref) {
+                    mismatches++;
+                }
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(led_curve_fade(10, 20, 0, 0) == 20);      // No duration: jump
+}
+
+static void test_breathe(void)
+{
+    static const uint8_t peaks[] = { 255, 128, 1 };
+    static const uint32_t periods[] = { 2, 3, 10, 101, 400, 2000 };
+    unsigned int mismatches = 0;
+
+    for (size_t p = 0; p < sizeof(peaks) / sizeof(peaks[0]); p++) {
+        for (size_t i = 0; i < sizeof(periods) / sizeof(periods[0]); i++) {
+            uint32_t period = periods[i];
+
+            for (uint32_t t = 0; t < 3U * period; t++) {
+                uint8_t level = led_curve_breathe(peaks[p], t, period);
+
+                if (level != breathe_reference(peaks[p], t, period)) {
+                    if (mismatches++ < 5U) {
+                        fprintf(stderr, "breathe(%u, %u, %u) = %u, reference %u\n", peaks[p], t,
+                                period, level, breathe_reference(peaks[p], t, period));
+                    }
+                }
+            }
+
+            // Dark at the start of every breath, full at its apex
+            CHECK(led_curve_breathe(peaks[p], period, period) == 0);
+            CHECK(led_curve_breathe(peaks[p], period + period / 2U, period) == peaks[p]);
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // Even periods are symmetric
+    for (uint32_t t = 1; t < 200U; t++) {
+        CHECK(led_curve_breathe(255, t, 400) == led_curve_breathe(255, 400U - t, 400));
+    }
+    CHECK(led_curve_breathe(77, 12345, 0) == 77);   // No period: hold at peak
+    CHECK(led_curve_breathe(77, 12345, 1) == 77);
+}
+
+/**
+ * @brief  Start a breathing group and check its PWM output frame by frame
+ * @param  mask: LED_MASK() bits of the group
+ * @retval None
+ */
+static void check_board_breathe(uint8_t mask, uint32_t period_ms)
+{
+    char text[48];
+    char line[64];
+    uint16_t before[LED_COUNT];
+    uint8_t first = LED_COUNT;
+
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        before[led] = (uint16_t)(&htim4.Instance->CCR1)[led];   // CCR1..CCR4
+        if ((mask & LED_MASK(led)) && first == LED_COUNT) {
+            first = led;
+        }
+    }
+
+    sim_pin_log_clear();
+    snprintf(text, sizeof(text), "LED_SYNC:%u,%u,3\r\n", mask, period_ms);
+    esp_send(text);
+    sim_kernel_run_ms(BREATHE_MS);
+    CHECK(esp_expect("OK:LedSync", line, sizeof(line)));
+    collect_duty();
+
+    // The breath's first frames from the duty the LED had
+    size_t n = expected_duty(before[first], period_ms, BREATHE_MS - 100U);
+    CHECK(n > 10U && logged_count[first] >= n);
+    if (n == 0 || logged_count[first] < n) {
+        return;
+    }
+    uint64_t origin = logged[first][0].at - expected[0].at * SIM_NS_PER_MS;
+
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        if ((mask & LED_MASK(led)) == 0) {
+            // Outside the group: off once the group starts
+            for (size_t i = 0; i < logged_count[led]; i++) {
+                CHECK(logged[led][i].at < origin || logged[led][i].duty == 0);
+            }
+            CHECK((&htim4.Instance->CCR1)[led] == 0);
+            continue;
+        }
+        CHECK(before[led] == before[first]);    // Same starting point
+        CHECK(logged_count[led] == logged_count[first]);
+
+        unsigned int mismatches = 0;
+        for (size_t i = 0; i < n && i < logged_count[led]; i++) {
+            if (logged[led][i].duty != expected[i].duty
+                    || logged[led][i].at != origin + expected[i].at * SIM_NS_PER_MS) {
+                if (mismatches++ < 3U) {
+                    fprintf(stderr, "PD%u change %zu: duty %u at +%lld ns, expected %u at frame %llu\n",
+                            PIN_FIRST + led, i, logged[led][i].duty,
+                            (long long)(logged[led][i].at - origin), expected[i].duty,
+                            (unsigned long long)expected[i].at);
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+    printf("LED_SYNC:%u,%u,3: %zu duty changes per LED match the curve\n", mask, period_ms, n);
+}
+
+static void test_board_breathe(void)
+{
+    char line[64];
+
+    sim_test_boot();
+    esp_send("LED_CMD:4\r\n");
+    sim_kernel_run_ms(20);
+    CHECK(esp_expect("OK:AllOFF", line, sizeof(line)));
+
+    // DMA idle before: the group starts the stream
+    check_board_breathe(0x0F, 400);
+    CHECK(!led_pwm_is_steady());
+
+    // DMA streaming: the new group starts on the next frame, together
+    esp_send("LED_CMD:4\r\n");
+    sim_kernel_run_ms(20);
+    CHECK(esp_expect("OK:AllOFF", line, sizeof(line)));
+    esp_send("LED_SYNC:2,1000,3\r\n");
+    sim_kernel_run_ms(517);
+    CHECK(esp_expect("OK:LedSync", line, sizeof(line)));
+    check_board_breathe(0x05, 250);
+}
+
+int main(void)
+{
+    test_duty();
+    test_fade();
+    test_breathe();
+    test_board_breathe();
+
+    return SIM_TEST_RESULT();
+}
@@ -0,0 +1,264 @@
+/**
+ ******************************************************************************
+ * @file           : test_led_frame.c
+ * @brief          : Binary Frame Codec and CRC16
+ ******************************************************************************
+ * @description
+ * Codec (led_frame.h):
+ * - CRC16-CCITT against the standard check value
+ * - Encode → byte-wise parse round trip for every payload length, with
+ *   non-SYNC noise between frames
+ * - Every single-bit error and every truncation of a frame is rejected,
+ *   and the parser resynchronizes on the next frame
+ * - Length limits on both the encoder and the parser
+ *
+ * Link (esp8266_comm_task.c on the simulated board):
+ * - PING and LED_CMD frames get PONG and ACK frames, seq echoed
+ * - A corrupted frame gets no reply, and ASCII lines still work after it
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include "led_frame.h"
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+static uint32_t rng_state = 0x9E3779B9UL;
+
+/** xorshift32: reproducible across runs */
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/** Random byte that is never LED_FRAME_SYNC */
+static uint8_t noise_byte(void)
+{
+    uint8_t byte;
+
+    do {
+        byte = (uint8_t)rng();
+    } while (byte == LED_FRAME_SYNC);
+    return byte;
+}
+
+/**
+ * @brief  Feed bytes to a parser
+ * @param  completed: [OUT] Number of LED_FRAME_COMPLETE results
+ * @retval Result of the last byte
+ */
+static led_frame_result_t feed(led_frame_parser_t *parser, const uint8_t *bytes, size_t len,
+                               int *completed)
+{
+    led_frame_result_t result = LED_FRAME_INCOMPLETE;
+
+    for (size_t i = 0; i < len; i++) {
+        result = led_frame_parse_byte(parser, bytes[i]);
+        if (result == LED_FRAME_COMPLETE) {
+            (*completed)++;
+        }
+    }
+    return result;
+}
+
+/*============================================================================
+ * Codec
+ *===========================================================================*/
+
+static void test_crc(void)
+{
+    static const char check[] = "123456789";
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < sizeof(check) - 1U; i++) {
+        crc = led_frame_crc16_update(crc, (uint8_t)check[i]);
+    }
+    CHECK(crc == 0x29B1);   // CRC-16/CCITT-FALSE check value
+}
+
+static void test_round_trip(void)
+{
+    uint8_t payload[LED_FRAME_MAX_PAYLOAD];
+    uint8_t frame[LED_FRAME_MAX_SIZE];
+    led_frame_parser_t parser;
+
+    led_frame_parser_reset(&parser);
+    for (int run = 0; run < 2000; run++) {
+        uint8_t len = (uint8_t)(run % (LED_FRAME_MAX_PAYLOAD + 1));
+        uint8_t type = (uint8_t)rng();
+        int completed = 0;
+
+        for (uint8_t i = 0; i < len; i++) {
+            payload[i] = (uint8_t)rng();
+        }
+        size_t size = led_frame_encode(type, payload, len, frame, sizeof(frame));
+        CHECK(size == (size_t)len + LED_FRAME_OVERHEAD);
+
+        // Noise outside frames is ignored
+        for (uint32_t n = rng() % 4U; n > 0; n--) {
+            uint8_t byte = noise_byte();
+            CHECK(led_frame_parse_byte(&parser, byte) == LED_FRAME_INCOMPLETE);
+        }
+        CHECK(feed(&parser, frame, size, &completed) == LED_FRAME_COMPLETE);
+        CHECK(completed == 1);
+        CHECK(parser.type == type && parser.len == len);
+        CHECK(memcmp(parser.payload, payload, len) == 0);
+        CHECK(!led_frame_parser_busy(&parser));
+    }
+}
+
+static void test_corruption(void)
+{
+    uint8_t payload[LED_FRAME_MAX_PAYLOAD];
+    uint8_t frame[LED_FRAME_MAX_SIZE];
+    uint8_t corrupt[LED_FRAME_MAX_SIZE];
+    uint8_t valid[LED_FRAME_MAX_SIZE];
+    uint8_t pattern = 2;
+    size_t valid_size = led_frame_encode(LED_FRAME_LED_CMD, &pattern, 1, valid, sizeof(valid));
+    long accepted_bad = 0;
+    long lost_resync = 0;
+
+    for (uint8_t len = 0; len <= LED_FRAME_MAX_PAYLOAD; len++) {
+        for (uint8_t i = 0; i < len; i++) {
+            payload[i] = (uint8_t)rng();
+        }
+        size_t size = led_frame_encode(LED_FRAME_LED_SET, payload, len, frame, sizeof(frame));
+
+        // Every single-bit error after SYNC
+        for (size_t bit = 8; bit < size * 8U; bit++) {
+            led_frame_parser_t parser;
+            int completed = 0;
+
+            memcpy(corrupt, frame, size);
+            corrupt[bit / 8U] ^= (uint8_t)(1U << (bit % 8U));
+            led_frame_parser_reset(&parser);
+            feed(&parser, corrupt, size, &completed);
+            accepted_bad += completed;
+
+            // A frame whose LEN grew swallows what follows; the parser is
+            // back in sync within one maximum frame
+            for (size_t pad = 0; led_frame_parser_busy(&parser) && pad < LED_FRAME_MAX_SIZE; pad++) {
+                (void)led_frame_parse_byte(&parser, noise_byte());
+            }
+            completed = 0;
+            if (feed(&parser, valid, valid_size, &completed) != LED_FRAME_COMPLETE || completed != 1
+                    || parser.payload[0] != pattern) {
+                lost_resync++;
+            }
+        }
+
+        // Truncated frames: never complete, parser still busy
+        for (size_t cut = 1; cut < size; cut++) {
+            led_frame_parser_t parser;
+            int completed = 0;
+
+            led_frame_parser_reset(&parser);
+            feed(&parser, frame, cut, &completed);
+            CHECK(completed == 0);
+            CHECK(led_frame_parser_busy(&parser));
+        }
+    }
+    CHECK(accepted_bad == 0);
+    CHECK(lost_resync == 0);
+}
+
+static void test_limits(void)
+{
+    uint8_t payload[LED_FRAME_MAX_PAYLOAD + 1] = { 0 };
+    uint8_t frame[LED_FRAME_MAX_SIZE + 1];
+    led_frame_parser_t parser;
+
+    CHECK(led_frame_encode(LED_FRAME_LED_SET, payload, LED_FRAME_MAX_PAYLOAD + 1, frame, sizeof(frame)) == 0);
+    CHECK(led_frame_encode(LED_FRAME_LED_SET, payload, 4, frame, 4 + LED_FRAME_OVERHEAD - 1) == 0);
+    CHECK(led_frame_encode(LED_FRAME_PING, NULL, 0, frame, LED_FRAME_OVERHEAD) == LED_FRAME_OVERHEAD);
+
+    led_frame_parser_reset(&parser);
+    CHECK(led_frame_parse_byte(&parser, LED_FRAME_SYNC) == LED_FRAME_INCOMPLETE);
+    CHECK(led_frame_parse_byte(&parser, LED_FRAME_LED_SET) == LED_FRAME_INCOMPLETE);
+    CHECK(led_frame_parse_byte(&parser, LED_FRAME_MAX_PAYLOAD + 1) == LED_FRAME_LENGTH_ERROR);
+    CHECK(!led_frame_parser_busy(&parser));
+}
+
+/*============================================================================
+ * Link
+ *===========================================================================*/
+
+/** ESP8266-side parser for frames from the firmware */
+static led_frame_parser_t esp_parser;
+
+static void esp_send_frame(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    uint8_t frame[LED_FRAME_MAX_SIZE];
+    size_t size = led_frame_encode(type, payload, len, frame, sizeof(frame));
+
+    (void)sim_uart_rx(&huart2, frame, size);
+}
+
+/**
+ * @brief  Next frame from the firmware
+ * @retval 1 if a complete frame arrived (in esp_parser)
+ */
+static int esp_read_frame(void)
+{
+    uint8_t byte;
+
+    while (sim_uart_tx_read(&huart2, &byte, 1) == 1) {
+        if (led_frame_parse_byte(&esp_parser, byte) == LED_FRAME_COMPLETE) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void test_link(void)
+{
+    char line[64];
+    uint8_t cmd[2] = { 3, 42 };
+    uint8_t frame[LED_FRAME_MAX_SIZE];
+
+    sim_test_boot();
+    led_frame_parser_reset(&esp_parser);
+
+    esp_send("PROTO:BIN\r\n");
+    sim_kernel_run_ms(10);
+    CHECK(esp_expect(LED_FRAME_NEGOTIATE_ACK, line, sizeof(line)));
+
+    esp_send_frame(LED_FRAME_PING, NULL, 0);
+    sim_kernel_run_ms(10);
+    CHECK(esp_read_frame() && esp_parser.type == LED_FRAME_PONG && esp_parser.len == 0);
+
+    esp_send_frame(LED_FRAME_LED_CMD, cmd, sizeof(cmd));
+    sim_kernel_run_ms(10);
+    CHECK(esp_read_frame() && esp_parser.type == LED_FRAME_ACK && esp_parser.len == 3);
+    CHECK(esp_parser.payload[0] == LED_FRAME_ACK_OK && esp_parser.payload[1] == 3
+          && esp_parser.payload[2] == 42);
+
+    // Corrupted PING: dropped without a reply
+    size_t size = led_frame_encode(LED_FRAME_PING, NULL, 0, frame, sizeof(frame));
+    frame[size - 1U] ^= 0x01;
+    (void)sim_uart_rx(&huart2, frame, size);
+    sim_kernel_run_ms(10);
+    CHECK(!esp_read_frame());
+
+    // ASCII still handled after the dropped frame
+    (void)sim_uart_tx_read(&huart2, NULL, SIZE_MAX);
+    esp_send("PING\r\n");
+    sim_kernel_run_ms(10);
+    CHECK(esp_expect("PONG", line, sizeof(line)));
+}
+
+int main(void)
+{
+    test_crc();
+    test_round_trip();
+    test_corruption();
+    test_limits();
+    test_link();
+
+    return SIM_TEST_RESULT();
+}
@@ -0,0 +1,345 @@
+/**
+ ******************************************************************************
+ * @file           : test_led_params.c
+ * @brief          : LED_SET / LED_SCENE / LED_SYNC Parsers - Limits and Fuzz
+ ******************************************************************************
+ * @description
+ * Exercises the shared parsers and payload codec in led_frame.h, which
+ * both firmwares use to accept or reject commands:
+ * - Validator limits, one field at a time, on both sides of each bound
+ * - Malformed ASCII (missing or extra fields, signs, spaces, overlong
+ *   digits, trailing garbage)
+ * - Round trip of random valid scenes: format → parse and
+ *   encode → decode give back the same parameters
+ * - Fuzz: random text over the protocol alphabet, mutated valid scenes
+ *   and random binary payloads. Whatever is accepted must pass the
+ *   validator and survive a round trip through the canonical form
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include "led_frame.h"
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define FUZZ_TEXT_RUNS      200000U
+#define FUZZ_PAYLOAD_RUNS   200000U
+#define ROUND_TRIP_RUNS     20000U
+
+static uint32_t rng_state = 0x2545F491UL;
+
+/** xorshift32: reproducible across runs */
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint32_t rng_range(uint32_t lo, uint32_t hi)
+{
+    return lo + rng() % (hi - lo + 1U);
+}
+
+static int params_equal(const led_set_params_t *a, const led_set_params_t *b)
+{
+    return a->mask == b->mask && a->period_ms == b->period_ms
+        && a->duty == b->duty && a->phase_ms == b->phase_ms;
+}
+
+static int scenes_equal(const led_scene_t *a, const led_scene_t *b)
+{
+    if (a->count != b->count) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < a->count; i++) {
+        if (!params_equal(&a->group[i], &b->group[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief  Canonical ASCII form of a scene ("<group>;<group>...")
+ * @retval Length
+ */
+static int scene_format(const led_scene_t *scene, char *buf, size_t size)
+{
+    int len = 0;
+
+    for (uint8_t i = 0; i < scene->count; i++) {
+        const led_set_params_t *p = &scene->group[i];
+        len += snprintf(&buf[len], size - (size_t)len, "%s%u,%u,%u,%u", (i > 0) ? ";" : "",
+                        p->mask, p->period_ms, p->duty, p->phase_ms);
+    }
+    return len;
+}
+
+/** Random valid scene: disjoint masks, every field in range */
+static void scene_random(led_scene_t *scene)
+{
+    uint8_t free_leds = LED_SET_MASK_ALL;
+
+    scene->count = 0;
+    while (free_leds != 0 && scene->count < LED_SCENE_MAX_GROUPS) {
+        uint8_t mask = (uint8_t)(rng() & free_leds);
+        led_set_params_t *p = &scene->group[scene->count];
+
+        if (mask == 0) {
+            if (scene->count > 0 && (rng() & 1U)) {
+                break;
+            }
+            continue;
+        }
+        p->mask = mask;
+        p->period_ms = (uint16_t)rng_range(LED_SET_PERIOD_MIN_MS, LED_SET_PERIOD_MAX_MS);
+        p->duty = (uint8_t)rng_range(0, LED_SET_DUTY_MAX);
+        p->phase_ms = (uint16_t)rng_range(0, p->period_ms - 1U);
+        free_leds &= (uint8_t)~mask;
+        scene->count++;
+        if (rng() % 3U == 0) {
+            break;
+        }
+    }
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static int set_ok(const char *text)
+{
+    led_set_params_t p;
+
+    return led_set_parse(text, &p) == 0;
+}
+
+static int scene_ok(const char *text)
+{
+    led_scene_t scene;
+
+    return led_scene_parse(text, &scene) == 0;
+}
+
+static int sync_ok(const char *text)
+{
+    led_sync_params_t p;
+
+    return led_sync_parse(text, &p) == 0;
+}
+
+static void test_limits(void)
+{
+    // Mask
+    CHECK(!set_ok("0,500,50,0"));
+    CHECK(set_ok("1,500,50,0"));
+    CHECK(set_ok("15,500,50,0"));
+    CHECK(!set_ok("16,500,50,0"));
+    CHECK(!set_ok("256,500,50,0"));
+    // Period
+    CHECK(!set_ok("1,9,50,0"));
+    CHECK(set_ok("1,10,50,0"));
+    CHECK(set_ok("1,60000,50,0"));
+    CHECK(!set_ok("1,60001,50,0"));
+    CHECK(!set_ok("1,65536,50,0"));
+    // Duty
+    CHECK(set_ok("1,500,0,0"));
+    CHECK(set_ok("1,500,100,0"));
+    CHECK(!set_ok("1,500,101,0"));
+    // Phase below the period
+    CHECK(set_ok("1,500,50,499"));
+    CHECK(!set_ok("1,500,50,500"));
+
+    // LED_SYNC
+    CHECK(sync_ok("15,400,2"));
+    CHECK(sync_ok("15,400,3"));
+    CHECK(!sync_ok("15,400,4"));
+    CHECK(!sync_ok("0,400,0"));
+    CHECK(!sync_ok("15,9,0"));
+    CHECK(!sync_ok("15,60001,0"));
+
+    // Scenes: at most four groups, no shared LED
+    CHECK(scene_ok("1,200,50,0;2,2000,50,0;12,500,100,0"));
+    CHECK(scene_ok("1,200,50,0;2,200,50,0;4,200,50,0;8,200,50,0"));
+    CHECK(!scene_ok("1,200,50,0;2,200,50,0;4,200,50,0;8,200,50,0;1,200,50,0"));
+    CHECK(!scene_ok("3,200,50,0;2,200,50,0"));
+    CHECK(!scene_ok("1,200,50,0;2,200,50,200"));
+}
+
+static void test_malformed(void)
+{
+    static const char *const bad[] = {
+        "", "1", "1,500,50", "1,500,50,0,", "1,500,50,0,0", ",1,500,50,0",
+        "1,,500,50", "+1,500,50,0", "1,-500,50,0", " 1,500,50,0", "1, 500,50,0",
+        "1,500,50,0 ", "1,500,50,0x", "1;500;50;0", "000001,500,50,0",
+        "1,0000500,50,0", "1,500,50,99999999999",
+    };
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        int accepted = set_ok(bad[i]);
+
+        if (accepted) {
+            fprintf(stderr, "accepted \"%s\"\n", bad[i]);
+        }
+        CHECK(!accepted);
+    }
+
+    CHECK(set_ok("00001,00500,00050,00000"));   // 5 digits, leading zeros
+    CHECK(set_ok("1,500,50,0#17"));
+    CHECK(!scene_ok("1,200,50,0;"));
+    CHECK(!scene_ok(";1,200,50,0"));
+    CHECK(!scene_ok("1,200,50,0;;2,200,50,0"));
+    CHECK(scene_ok("1,200,50,0;2,200,50,0#4"));
+    CHECK(!sync_ok("15,400"));
+    CHECK(!sync_ok("15,400,2,0"));
+}
+
+static void test_round_trip(void)
+{
+    char text[128];
+    uint8_t payload[LED_SCENE_MAX_GROUPS * LED_SET_PAYLOAD_SIZE + 1];
+
+    for (uint32_t run = 0; run < ROUND_TRIP_RUNS; run++) {
+        led_scene_t scene;
+        led_scene_t parsed;
+        led_scene_t decoded;
+
+        scene_random(&scene);
+        CHECK(led_scene_validate(&scene) == 0);
+
+        scene_format(&scene, text, sizeof(text));
+        CHECK(led_scene_parse(text, &parsed) == 0 && scenes_equal(&scene, &parsed));
+
+        uint8_t len = led_scene_encode(&scene, payload);
+        CHECK(len == scene.count * LED_SET_PAYLOAD_SIZE);
+        CHECK(led_scene_decode(payload, len, &decoded) == 0 && scenes_equal(&scene, &decoded));
+
+        // Trailing seq byte accepted, any other length rejected
+        payload[len] = (uint8_t)run;
+        CHECK(led_scene_decode(payload, (uint8_t)(len + 1U), &decoded) == 0);
+        CHECK(led_scene_decode(payload, (uint8_t)(len - 1U), &decoded) != 0);
+
+        // A single group is also a valid LED_SET
+        if (scene.count == 1) {
+            led_set_params_t p;
+            CHECK(led_set_parse(text, &p) == 0 && params_equal(&p, &scene.group[0]));
+            CHECK(led_set_decode(payload, LED_SET_PAYLOAD_SIZE, &p) == 0
+                  && params_equal(&p, &scene.group[0]));
+        }
+
+        // LED_SYNC
+        led_sync_params_t sync = {
+            (uint8_t)rng_range(1, LED_SET_MASK_ALL),
+            (uint8_t)rng_range(0, LED_SYNC_MODE_COUNT - 1U),
+            (uint16_t)rng_range(LED_SET_PERIOD_MIN_MS, LED_SET_PERIOD_MAX_MS),
+        };
+        led_sync_params_t sync_back;
+        snprintf(text, sizeof(text), "%u,%u,%u", sync.mask, sync.period_ms, sync.mode);
+        CHECK(led_sync_parse(text, &sync_back) == 0 && sync_back.mask == sync.mask
+              && sync_back.period_ms == sync.period_ms && sync_back.mode == sync.mode);
+        led_sync_encode(&sync, payload);
+        CHECK(led_sync_decode(payload, LED_SYNC_PAYLOAD_SIZE, &sync_back) == 0
+              && sync_back.mask == sync.mask && sync_back.period_ms == sync.period_ms
+              && sync_back.mode == sync.mode);
+    }
+}
+
+static void test_fuzz_text(void)
+{
+    static const char alphabet[] = "0123456789012345678901234567890123456789,,,,,,;;;#x -";
+    char text[48];
+    char canonical[128];
+    uint32_t accepted = 0;
+
+    for (uint32_t run = 0; run < FUZZ_TEXT_RUNS; run++) {
+        size_t len;
+        led_scene_t scene;
+        led_scene_t again;
+
+        if (run & 1U) {
+            // Random text
+            len = rng() % (sizeof(text) - 1U);
+            for (size_t i = 0; i < len; i++) {
+                text[i] = alphabet[rng() % (sizeof(alphabet) - 1U)];
+            }
+        } else {
+            // A valid scene with a few characters replaced, inserted or dropped
+            scene_random(&scene);
+            len = (size_t)scene_format(&scene, canonical, sizeof(canonical));
+            len = (len < sizeof(text) - 1U) ? len : sizeof(text) - 1U;
+            memcpy(text, canonical, len);
+            for (uint32_t edits = rng_range(1, 3); edits > 0 && len > 0; edits--) {
+                size_t at = rng() % len;
+                char c = alphabet[rng() % (sizeof(alphabet) - 1U)];
+
+                switch (rng() % 3U) {
+                case 0:
+                    text[at] = c;
+                    break;
+                case 1:
+                    if (len < sizeof(text) - 1U) {
+                        memmove(&text[at + 1U], &text[at], len - at);
+                        text[at] = c;
+                        len++;
+                    }
+                    break;
+                default:
+                    memmove(&text[at], &text[at + 1U], len - at - 1U);
+                    len--;
+                    break;
+                }
+            }
+        }
+        text[len] = '\0';
+
+        if (led_scene_parse(text, &scene) != 0) {
+            continue;
+        }
+        accepted++;
+        CHECK(led_scene_validate(&scene) == 0);
+        scene_format(&scene, canonical, sizeof(canonical));
+        CHECK(led_scene_parse(canonical, &again) == 0 && scenes_equal(&scene, &again));
+    }
+    printf("text fuzz: %lu of %lu accepted\n", (unsigned long)accepted, (unsigned long)FUZZ_TEXT_RUNS);
+}
+
+static void test_fuzz_payload(void)
+{
+    uint8_t payload[LED_SCENE_MAX_GROUPS * LED_SET_PAYLOAD_SIZE + 2];
+    uint8_t encoded[sizeof(payload)];
+    uint32_t accepted = 0;
+
+    for (uint32_t run = 0; run < FUZZ_PAYLOAD_RUNS; run++) {
+        uint8_t len = (uint8_t)(rng() % sizeof(payload));
+        led_scene_t scene;
+
+        for (uint8_t i = 0; i < len; i++) {
+            // Bias towards the valid ranges so some payloads get through
+            uint32_t r = rng();
+            payload[i] = (uint8_t)(((r >> 8) & 3U) == 0 ? r : (r & 0x0F));
+        }
+        if (led_scene_decode(payload, len, &scene) != 0) {
+            continue;
+        }
+        accepted++;
+        CHECK(led_scene_validate(&scene) == 0);
+        CHECK(led_scene_encode(&scene, encoded) == scene.count * LED_SET_PAYLOAD_SIZE);
+        CHECK(memcmp(encoded, payload, scene.count * LED_SET_PAYLOAD_SIZE) == 0);
+    }
+    printf("payload fuzz: %lu of %lu accepted\n", (unsigned long)accepted, (unsigned long)FUZZ_PAYLOAD_RUNS);
+}
+
+int main(void)
+{
+    test_limits();
+    test_malformed();
+    test_round_trip();
+    test_fuzz_text();
+    test_fuzz_payload();
+
+    return SIM_TEST_RESULT();
+}
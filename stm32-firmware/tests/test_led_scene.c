@@ -0,0 +1,220 @@
+/**
+ ******************************************************************************
+ * @file           : test_led_scene.c
+ * @brief          : 4-LED Scene Change Latency - One LED_SCENE vs 4 × LED_SET
+ ******************************************************************************
+ * @description
+ * End-to-end latency of lighting all four LEDs, from the first command
+ * byte on the wire to (a) the last ACK read back by the ESP8266 and (b)
+ * the last LED output change in the pin log:
+ * ┌─────────────────────┬────────────────────────────────────────────────┐
+ * │ Path                │ Commands                                       │
+ * ├─────────────────────┼────────────────────────────────────────────────┤
+ * │ Unbatched, 1 by 1   │ 4 × LED_SET, next sent when the ACK is back    │
+ * │ Unbatched, 4 queued │ 4 × LED_SET back to back, 4 ACKs (the ESP8266  │
+ * │                     │ keeps up to MAX_INFLIGHT_COMMANDS in flight)   │
+ * │ Batched             │ 1 × LED_SCENE with 4 groups, 1 ACK             │
+ * └─────────────────────┴────────────────────────────────────────────────┘
+ * Each LED_SET replaces the whole pattern, so unbatched the LEDs come on
+ * one after the other and only the last one stays: the times measured
+ * there are a lower bound. The scene's four LEDs must switch at the same
+ * instant.
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include "led_pwm.h"
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define RUNS            20U
+#define POLL_NS         (50U * 1000U)   // ESP8266 loop() poll step
+#define PIN_FIRST       12U             // PD12 = LED_GREEN .. PD15 = LED_BLUE
+
+/** One group per LED: on (100% duty), different periods */
+static const char *const led_set[LED_COUNT] = {
+    "LED_SET:1,100,100,0",
+    "LED_SET:2,200,100,0",
+    "LED_SET:4,300,100,0",
+    "LED_SET:8,400,100,0",
+};
+static const char led_scene[] =
+    "LED_SCENE:1,100,100,0;2,200,100,0;4,300,100,0;8,400,100,0";
+
+typedef struct {
+    uint64_t ack_ns;            // To the last ACK
+    uint64_t led_ns;            // To the last LED change
+    uint64_t spread_ns;         // First to last LED change
+} scene_latency_t;
+
+static uint32_t rng_state = 0xC0FFEE11UL;
+
+/** xorshift32: reproducible across runs */
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/**
+ * @brief  Turn the LEDs off and wait a random part of a tick
+ * @retval None
+ */
+static void reset_leds(void)
+{
+    char line[64];
+
+    esp_send("LED_CMD:4\r\n");
+    sim_kernel_run_ms(20);
+    CHECK(esp_expect("OK:AllOFF", line, sizeof(line)));
+    sim_kernel_run_until(sim_now_ns() + rng() % SIM_NS_PER_MS);
+    sim_pin_log_clear();
+}
+
+/**
+ * @brief  Poll for ACKs until count have arrived
+ * @retval None
+ */
+static void wait_acks(unsigned int count, const char *ack)
+{
+    char line[64];
+    uint64_t start = sim_now_ns();
+
+    while (count > 0) {
+        sim_kernel_run_until(sim_now_ns() + POLL_NS);
+        while (esp_read_line(line, sizeof(line))) {
+            if (strncmp(line, "OK:", 3) == 0) {
+                CHECK_STR(line, ack);
+                count--;
+            }
+        }
+        if (sim_now_ns() - start > 100U * SIM_NS_PER_MS) {
+            CHECK(0);   // ACK lost
+            return;
+        }
+    }
+}
+
+/**
+ * @brief  First and last LED output change since start
+ * @retval None
+ */
+static void led_changes(uint64_t *first, uint64_t *last)
+{
+    uint64_t seen[LED_COUNT] = { 0 };
+
+    *first = UINT64_MAX;
+    *last = 0;
+    for (size_t i = 0; i < sim_pin_log_count(); i++) {
+        const sim_pin_event_t *e = sim_pin_log_get(i);
+
+        if (e->port == 'D' && e->pin >= PIN_FIRST && e->pin < PIN_FIRST + LED_COUNT
+                && seen[e->pin - PIN_FIRST] == 0) {
+            seen[e->pin - PIN_FIRST] = e->ns;
+        }
+    }
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        CHECK(seen[led] != 0);
+        *first = (seen[led] < *first) ? seen[led] : *first;
+        *last = (seen[led] > *last) ? seen[led] : *last;
+    }
+}
+
+/**
+ * @brief  Light all four LEDs one way and time it
+ * @param  mode: 0 = LED_SET 1 by 1, 1 = 4 LED_SET queued, 2 = LED_SCENE
+ * @retval Latencies from the first command byte
+ */
+static scene_latency_t run_once(int mode)
+{
+    scene_latency_t r;
+    uint64_t first;
+    uint64_t last;
+    char text[96];
+
+    reset_leds();
+    uint64_t start = sim_now_ns();
+
+    if (mode == 2) {
+        snprintf(text, sizeof(text), "%s\r\n", led_scene);
+        esp_send(text);
+        wait_acks(1, "OK:LedScene");
+    } else {
+        for (uint8_t led = 0; led < LED_COUNT; led++) {
+            snprintf(text, sizeof(text), "%s\r\n", led_set[led]);
+            esp_send(text);
+            if (mode == 0) {
+                wait_acks(1, "OK:LedSet");
+            }
+        }
+        if (mode == 1) {
+            wait_acks(LED_COUNT, "OK:LedSet");
+        }
+    }
+    r.ack_ns = sim_now_ns() - start;
+
+    sim_kernel_run_ms(5);
+    led_changes(&first, &last);
+    r.led_ns = last - start;
+    r.spread_ns = last - first;
+    return r;
+}
+
+/**
+ * @brief  Average over RUNS changes
+ * @retval Mean latencies, spread is the worst seen
+ */
+static scene_latency_t run(int mode)
+{
+    scene_latency_t sum = { 0, 0, 0 };
+
+    for (unsigned int i = 0; i < RUNS; i++) {
+        scene_latency_t r = run_once(mode);
+
+        sum.ack_ns += r.ack_ns;
+        sum.led_ns += r.led_ns;
+        sum.spread_ns = (r.spread_ns > sum.spread_ns) ? r.spread_ns : sum.spread_ns;
+    }
+    sum.ack_ns /= RUNS;
+    sum.led_ns /= RUNS;
+    return sum;
+}
+
+static void report(const char *name, const scene_latency_t *r)
+{
+    printf("%-20s ACK %5llu us, all LEDs %5llu us, LED spread %5llu us\n", name,
+           (unsigned long long)(r->ack_ns / SIM_NS_PER_US),
+           (unsigned long long)(r->led_ns / SIM_NS_PER_US),
+           (unsigned long long)(r->spread_ns / SIM_NS_PER_US));
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+int main(void)
+{
+    sim_test_boot();
+
+    scene_latency_t one_by_one = run(0);
+    scene_latency_t queued = run(1);
+    scene_latency_t batched = run(2);
+
+    report("4 x LED_SET, 1 by 1", &one_by_one);
+    report("4 x LED_SET, queued", &queued);
+    report("1 x LED_SCENE", &batched);
+
+    // The scene lands at one instant and beats both unbatched paths. Its
+    // 59-byte line takes ~5.1 ms on the wire against ~7.3 ms for the four
+    // LED_SET lines; 1 by 1 also pays three more ACK round trips
+    CHECK(batched.spread_ns == 0);
+    CHECK(batched.led_ns < queued.led_ns);
+    CHECK(batched.ack_ns < queued.ack_ns);
+    CHECK(batched.ack_ns * 10U < one_by_one.ack_ns * 6U);
+
+    return SIM_TEST_RESULT();
+}
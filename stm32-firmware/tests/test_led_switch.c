@@ -0,0 +1,219 @@
+/**
+ ******************************************************************************
+ * @file           : test_led_switch.c
+ * @brief          : 1 kHz Pattern Switching - No Lost Commands, No Stale Wakeups
+ ******************************************************************************
+ * @description
+ * Binary LED_CMD frames (7 bytes, 0.6 ms on the wire) arrive once per
+ * millisecond for 2 s, each to a random pattern. Every storm ends on a
+ * chosen pattern, which must then play exactly as if it had been the only
+ * command:
+ * ┌──────────┬──────────────────────────────────────────────────────────┐
+ * │ Final    │ Expected after the storm                                 │
+ * ├──────────┼──────────────────────────────────────────────────────────┤
+ * │ NONE, 1  │ No output change for 3 s, TIM7 stopped, LEDs idle        │
+ * │ 2        │ Green every 100 ms, orange every 1000 ms, nothing else   │
+ * │ 3        │ Green and orange together every 100 ms, nothing else     │
+ * └──────────┴──────────────────────────────────────────────────────────┘
+ * Every command is acknowledged OK, in order, with its seq echoed. A
+ * wakeup or edge left over from an earlier schedule shows up as an output
+ * change off the final pattern's grid, or as a TIM7 interrupt that moves
+ * no LED (sim_tim_updates()).
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include "led_frame.h"
+#include "led_effects.h"
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define STORM_MS        2000U
+#define SETTLE_MS       3000U
+#define PIN_GREEN       12U     // PD12, TIM4 CH1
+#define PIN_ORANGE      13U     // PD13, TIM4 CH2
+
+static uint32_t rng_state = 0x2545F491UL;
+
+/** xorshift32: reproducible across runs */
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/** ESP8266-side parser for frames from the firmware */
+static led_frame_parser_t esp_parser;
+
+/**
+ * @brief  Check the ACK frames received so far against the commands sent
+ * @param  sent: Pattern (1..4) of each command, indexed by command number
+ * @param  acked: [IN/OUT] Commands acknowledged so far
+ * @retval None
+ */
+static void read_acks(const uint8_t *sent, unsigned int *acked)
+{
+    uint8_t byte;
+
+    while (sim_uart_tx_read(&huart2, &byte, 1) == 1) {
+        if (led_frame_parse_byte(&esp_parser, byte) != LED_FRAME_COMPLETE
+                || esp_parser.type != LED_FRAME_ACK) {
+            continue;
+        }
+        CHECK(esp_parser.len == 3);
+        CHECK(esp_parser.payload[0] == LED_FRAME_ACK_OK);
+        CHECK(esp_parser.payload[1] == sent[*acked]);
+        CHECK(esp_parser.payload[2] == (uint8_t)*acked);
+        (*acked)++;
+    }
+}
+
+/**
+ * @brief  Switch patterns once per millisecond, ending on a given pattern
+ * @param  final: Last pattern sent (1..4, LED_CMD numbering)
+ * @retval None
+ */
+static void storm(uint8_t final)
+{
+    static uint8_t sent[STORM_MS];
+    unsigned int acked = 0;
+    uint64_t start = sim_now_ns();
+
+    for (unsigned int i = 0; i < STORM_MS; i++) {
+        uint8_t cmd[2];
+        uint8_t frame[LED_FRAME_MAX_SIZE];
+
+        sent[i] = (i == STORM_MS - 1U) ? final : (uint8_t)(1U + rng() % 4U);
+        cmd[0] = sent[i];
+        cmd[1] = (uint8_t)i;
+        size_t size = led_frame_encode(LED_FRAME_LED_CMD, cmd, sizeof(cmd), frame, sizeof(frame));
+        (void)sim_uart_rx(&huart2, frame, size);
+
+        sim_kernel_run_until(start + (uint64_t)(i + 1U) * SIM_NS_PER_MS);
+        read_acks(sent, &acked);
+    }
+    sim_kernel_run_ms(10);
+    read_acks(sent, &acked);
+
+    printf("Final pattern %u: %u commands, %u ACKed\n", final, STORM_MS, acked);
+    CHECK(acked == STORM_MS);
+    CHECK(sim_kernel_stats()->stream_dropped == 0);
+    CHECK(led_effects_get_pattern() == ((final == 4U) ? LED_PATTERN_NONE : (LED_Pattern_t)final));
+}
+
+/**
+ * @brief  Output changes of one pin since the pin log was cleared
+ * @param  times: [OUT] Time of each change (ns)
+ * @retval Number of changes
+ */
+static size_t pin_changes(uint8_t pin, uint64_t *times, size_t max)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < sim_pin_log_count(); i++) {
+        const sim_pin_event_t *e = sim_pin_log_get(i);
+
+        if (e->port == 'D' && e->pin == pin && n < max) {
+            times[n++] = e->ns;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief  Check that a pin changes every period_ms and at no other time
+ * @retval None
+ */
+static void check_grid(uint8_t pin, uint32_t period_ms, const uint64_t *times, size_t n)
+{
+    CHECK(n >= SETTLE_MS / period_ms - 1U && n <= SETTLE_MS / period_ms + 1U);
+    for (size_t i = 1; i < n; i++) {
+        uint64_t gap = times[i] - times[i - 1U];
+
+        // TIM7 counts at 2 kHz: edges may move by one count
+        if (gap + SIM_NS_PER_MS / 2U < period_ms * SIM_NS_PER_MS
+                || gap > period_ms * SIM_NS_PER_MS + SIM_NS_PER_MS / 2U) {
+            fprintf(stderr, "PD%u: %llu ns between changes, expected %u ms\n", pin,
+                    (unsigned long long)gap, period_ms);
+            CHECK(0);
+            break;
+        }
+    }
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void test_storm(uint8_t final)
+{
+    static uint64_t green[SETTLE_MS];
+    static uint64_t orange[SETTLE_MS];
+
+    storm(final);
+
+    // Let the last pattern's first keyframe go out, then watch
+    sim_kernel_run_ms(5);
+    sim_pin_log_clear();
+    uint32_t wakeups = sim_tim_updates(&htim7);
+    sim_kernel_run_ms(SETTLE_MS);
+    wakeups = sim_tim_updates(&htim7) - wakeups;
+
+    size_t n_green = pin_changes(PIN_GREEN, green, SETTLE_MS);
+    size_t n_orange = pin_changes(PIN_ORANGE, orange, SETTLE_MS);
+
+    switch (final) {
+        case 1:
+        case 4:
+            CHECK(sim_pin_log_count() == 0);
+            CHECK(wakeups == 0);
+            CHECK((htim7.Instance->CR1 & TIM_CR1_CEN) == 0);
+            CHECK(led_effects_is_idle());
+            break;
+
+        case 2:
+            check_grid(PIN_GREEN, 100, green, n_green);
+            check_grid(PIN_ORANGE, 1000, orange, n_orange);
+            CHECK(sim_pin_log_count() == n_green + n_orange);
+            CHECK(wakeups == n_green);      // Orange edges fall on green ones
+            break;
+
+        case 3:
+            check_grid(PIN_GREEN, 100, green, n_green);
+            CHECK(n_orange == n_green);
+            for (size_t i = 0; i < n_green && i < n_orange; i++) {
+                CHECK(green[i] == orange[i]);
+            }
+            CHECK(sim_pin_log_count() == n_green + n_orange);
+            CHECK(wakeups == n_green);
+            break;
+
+        default:
+            CHECK(0);
+            break;
+    }
+}
+
+int main(void)
+{
+    char line[64];
+
+    sim_test_boot();
+    led_frame_parser_reset(&esp_parser);
+
+    esp_send("PROTO:BIN\r\n");
+    sim_kernel_run_ms(10);
+    CHECK(esp_expect(LED_FRAME_NEGOTIATE_ACK, line, sizeof(line)));
+
+    test_storm(4);
+    test_storm(2);
+    test_storm(1);
+    test_storm(3);
+    test_storm(4);
+
+    return SIM_TEST_RESULT();
+}
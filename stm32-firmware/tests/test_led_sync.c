@@ -0,0 +1,224 @@
+/**
+ ******************************************************************************
+ * @file           : test_led_sync.c
+ * @brief          : LED Group Phase Error and Jitter from Pin Log Edges
+ ******************************************************************************
+ * @description
+ * Each locked group plays for 20 s on the simulated board. Every on-edge
+ * of PD12-PD15 is taken from the pin log (PWM compare 0 → non-zero) and
+ * compared with where it belongs on the group's shared time base:
+ *     ideal = first on-edge of the first LED + k * period + offset(LED)
+ * ┌───────────────────────┬──────────────────────────────────────────────┐
+ * │ Group                 │ offset(LED n of the group)                   │
+ * ├───────────────────────┼──────────────────────────────────────────────┤
+ * │ LED_SYNC in phase     │ 0                                            │
+ * │ LED_SYNC anti-phase   │ period / 2 for odd n                         │
+ * │ LED_SYNC chase        │ n * period / members                         │
+ * │ LED_CMD:3             │ 0 (green and orange, 200 ms)                 │
+ * └───────────────────────┴──────────────────────────────────────────────┘
+ * Reported per group: max phase error (worst |edge - ideal|, which bounds
+ * the skew between any two LEDs), max skew between LEDs that switch
+ * together, and max period jitter (worst |edge - previous edge - period|).
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include "led_pwm.h"
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define RUN_MS          20000U
+#define MAX_EDGES       2048U
+#define PIN_FIRST       12U         // PD12 = LED_GREEN .. PD15 = LED_BLUE
+
+/** TIM7 resolution: one 2 kHz count */
+#define TIM7_COUNT_NS   (SIM_NS_PER_MS / 2U)
+
+typedef struct {
+    const char *command;        // Sent over UART2
+    const char *ack;
+    uint8_t mask;               // LED_MASK() bits of the group
+    uint32_t period_ms;
+    int mode;                   // led_sync_mode_t
+} sync_case_t;
+
+typedef struct {
+    uint64_t phase_error_ns;
+    uint64_t skew_ns;
+    uint64_t jitter_ns;
+    size_t edges;
+} sync_report_t;
+
+/** On-edges of each LED */
+static uint64_t edges[LED_COUNT][MAX_EDGES];
+static size_t edge_count[LED_COUNT];
+
+static uint64_t abs_diff(uint64_t a, uint64_t b)
+{
+    return (a > b) ? a - b : b - a;
+}
+
+/**
+ * @brief  Collect the on-edges of PD12-PD15 from the pin log
+ * @retval None
+ */
+static void collect_edges(void)
+{
+    uint16_t level[LED_COUNT];
+
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        level[led] = 0;
+        edge_count[led] = 0;
+    }
+    for (size_t i = 0; i < sim_pin_log_count(); i++) {
+        const sim_pin_event_t *e = sim_pin_log_get(i);
+
+        if (e->port != 'D' || e->pin < PIN_FIRST || e->pin >= PIN_FIRST + LED_COUNT) {
+            continue;
+        }
+        uint8_t led = (uint8_t)(e->pin - PIN_FIRST);
+        if (level[led] == 0 && e->value != 0 && edge_count[led] < MAX_EDGES) {
+            edges[led][edge_count[led]++] = e->ns;
+        }
+        level[led] = e->value;
+    }
+}
+
+/**
+ * @brief  Offset of the n-th LED of a group on the shared time base
+ * @retval Nanoseconds after the group's first LED
+ */
+static uint64_t ideal_offset_ns(const sync_case_t *c, uint8_t n, uint8_t members)
+{
+    uint64_t period = c->period_ms * SIM_NS_PER_MS;
+
+    switch (c->mode) {
+        case 1:     // Anti-phase
+            return (n & 1U) ? period / 2U : 0;
+        case 2:     // Chase
+            return (uint64_t)n * (c->period_ms / members) * SIM_NS_PER_MS;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief  Measure a group from the edges collected
+ * @retval Worst phase error, skew and jitter
+ */
+static sync_report_t measure(const sync_case_t *c)
+{
+    sync_report_t r = { 0, 0, 0, 0 };
+    uint64_t period = c->period_ms * SIM_NS_PER_MS;
+    uint8_t members = 0;
+    uint8_t first = LED_COUNT;
+
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        if (c->mask & LED_MASK(led)) {
+            members++;
+            first = (first == LED_COUNT) ? led : first;
+        }
+    }
+    if (first == LED_COUNT || edge_count[first] == 0) {
+        CHECK(0);
+        return r;
+    }
+
+    // The time base: the first LED's first on-edge
+    uint64_t origin = edges[first][0];
+    uint8_t n = 0;
+
+    for (uint8_t led = 0; led < LED_COUNT; led++) {
+        if ((c->mask & LED_MASK(led)) == 0) {
+            CHECK(edge_count[led] == 0);    // Outside the group: off
+            continue;
+        }
+        uint64_t offset = ideal_offset_ns(c, n, members);
+
+        CHECK(edge_count[led] >= RUN_MS / c->period_ms - 1U);
+        for (size_t k = 0; k < edge_count[led]; k++) {
+            uint64_t t = edges[led][k];
+
+            // Nearest slot of this LED on the shared time base (the first
+            // LED's first edge need not be the earliest edge in the log)
+            int64_t since = (int64_t)(t - origin) - (int64_t)offset;
+            int64_t half = (since < 0) ? -(int64_t)period / 2 : (int64_t)period / 2;
+            int64_t slot = (since + half) / (int64_t)period;
+            uint64_t ideal = (uint64_t)((int64_t)(origin + offset) + slot * (int64_t)period);
+            uint64_t error = abs_diff(t, ideal);
+
+            r.phase_error_ns = (error > r.phase_error_ns) ? error : r.phase_error_ns;
+            if (k > 0) {
+                uint64_t jitter = abs_diff(t - edges[led][k - 1U], period);
+                r.jitter_ns = (jitter > r.jitter_ns) ? jitter : r.jitter_ns;
+            }
+        }
+        r.edges += edge_count[led];
+
+        // Skew against the first LED for LEDs meant to switch with it
+        if (offset == 0 && led != first) {
+            for (size_t k = 0; k < edge_count[led] && k < edge_count[first]; k++) {
+                uint64_t skew = abs_diff(edges[led][k], edges[first][k]);
+                r.skew_ns = (skew > r.skew_ns) ? skew : r.skew_ns;
+            }
+        }
+        n++;
+    }
+    return r;
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void test_group(const sync_case_t *c)
+{
+    char text[64];
+    char line[64];
+
+    snprintf(text, sizeof(text), "%s\r\n", c->command);
+    esp_send(text);
+    sim_kernel_run_ms(20);
+    CHECK(esp_expect(c->ack, line, sizeof(line)));
+
+    // Measure from a clean log, well after the change
+    sim_kernel_run_ms(c->period_ms);
+    sim_pin_log_clear();
+    sim_kernel_run_ms(RUN_MS);
+    collect_edges();
+
+    sync_report_t r = measure(c);
+
+    printf("%-22s %5zu edges, max phase error %4llu us, skew %4llu us, jitter %4llu us\n",
+           c->command, r.edges, (unsigned long long)(r.phase_error_ns / SIM_NS_PER_US),
+           (unsigned long long)(r.skew_ns / SIM_NS_PER_US),
+           (unsigned long long)(r.jitter_ns / SIM_NS_PER_US));
+
+    // One wakeup drives every LED that switches at that time: no skew at
+    // all; offsets and periods land on the TIM7 grid
+    CHECK(r.skew_ns == 0);
+    CHECK(r.phase_error_ns <= TIM7_COUNT_NS);
+    CHECK(r.jitter_ns <= TIM7_COUNT_NS);
+}
+
+int main(void)
+{
+    static const sync_case_t cases[] = {
+        { "LED_SYNC:15,400,0", "OK:LedSync", 0x0F, 400, 0 },
+        { "LED_SYNC:15,400,1", "OK:LedSync", 0x0F, 400, 1 },
+        { "LED_SYNC:15,400,2", "OK:LedSync", 0x0F, 400, 2 },
+        { "LED_SYNC:5,250,1",  "OK:LedSync", 0x05, 250, 1 },
+        { "LED_SYNC:14,50,2",  "OK:LedSync", 0x0E, 50,  2 },
+        { "LED_SYNC:15,40,2",  "OK:LedSync", 0x0F, 40,  2 },
+        { "LED_CMD:3",         "OK:Pattern3", 0x03, 200, 0 },
+    };
+
+    sim_test_boot();
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        test_group(&cases[i]);
+    }
+
+    return SIM_TEST_RESULT();
+}
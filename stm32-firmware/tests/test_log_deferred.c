@@ -0,0 +1,281 @@
+/**
+ ******************************************************************************
+ * @file           : test_log_deferred.c
+ * @brief          : Deferred Logging - Cost, Wire Bytes and Decoder Round Trip
+ ******************************************************************************
+ * @description
+ * print_task.c built into the test with PRINT_DEFERRED_BINARY = 1:
+ * ┌──────────────────┬────────────────────────────────────────────────────┐
+ * │ Part             │ Checked                                            │
+ * ├──────────────────┼────────────────────────────────────────────────────┤
+ * │ Cost per call    │ Host time of print_deferred() against snprintf +   │
+ * │                  │ print_message() for the same lines (printed)       │
+ * │ Bytes            │ Ring and wire bytes per record: 2 + pointer + one  │
+ * │                  │ uintptr_t per argument (printed for the target     │
+ * │                  │ too), against the formatted text                   │
+ * │ Round trip       │ UART3 capture of deferred records, TEXT records    │
+ * │                  │ and a drop summary, decoded by tools/log_decode.py │
+ * │                  │ from this executable: equal to snprintf's output   │
+ * └──────────────────┴────────────────────────────────────────────────────┘
+ * The drop summary names a flooding task, whose name is in RAM: it must
+ * arrive as text, not as an address the decoder cannot resolve.
+ ******************************************************************************
+ */
+
+#define PRINT_DEFERRED_BINARY   1
+
+#include "../src/print_task.c"
+
+#include "sim_test.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define CALLS           20000U
+#define FLOOD_LINES     100U
+#define TARGET_WORD     4U      // Pointer / argument width on the Cortex-M4
+
+static char expected[8192];
+static size_t expected_len = 0;
+
+static uint8_t capture[16384];
+static size_t capture_len = 0;
+
+/** Append what snprintf makes of a line to the expected decoder output */
+static void expect(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(&expected[expected_len], sizeof(expected) - expected_len, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        expected_len += (size_t)n;
+    }
+}
+
+/** Log a line deferred and expect it back from the decoder */
+#define LOG_AND_EXPECT(fmt, ...) \
+    do { \
+        CHECK(print_deferred(fmt, ##__VA_ARGS__) == pdPASS); \
+        expect(fmt, ##__VA_ARGS__); \
+    } while (0)
+
+/** Collect what UART3 has sent so far */
+static void capture_uart3(void)
+{
+    capture_len += sim_uart_tx_read(&huart3, &capture[capture_len], sizeof(capture) - capture_len);
+}
+
+static uint64_t host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint16_t ring_used(void)
+{
+    return (uint16_t)((print_ring_head - print_ring_tail + PRINT_RING_SIZE) % PRINT_RING_SIZE);
+}
+
+/** Empty the ring, as the print task would between calls */
+static void ring_drain(void)
+{
+    print_ring_tail = print_ring_head;
+}
+
+/**
+ * @brief  Decode the capture with tools/log_decode.py
+ * @param  out: [OUT] Decoded text
+ * @retval Length, or -1 if the decoder could not run
+ */
+static long run_decoder(char *out, size_t size)
+{
+    char path[] = "/tmp/test_log_deferred_XXXXXX";
+    char exe[512];
+    char command[1024];
+    int fd = mkstemp(path);
+
+    ssize_t exe_len = readlink("/proc/self/exe", exe, sizeof(exe) - 1U);
+    if (fd < 0 || exe_len <= 0) {
+        return -1;
+    }
+    exe[exe_len] = '\0';
+    if (write(fd, capture, capture_len) != (ssize_t)capture_len) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    close(fd);
+
+    snprintf(command, sizeof(command), "'%s' '%s' --base 0x%lx '%s' '%s'", PYTHON3_EXECUTABLE,
+             LOG_DECODE_PY, (unsigned long)FLASH_BASE, exe, path);
+    FILE *decoder = popen(command, "r");
+    if (decoder == NULL) {
+        unlink(path);
+        return -1;
+    }
+    size_t n = fread(out, 1, size - 1U, decoder);
+    out[n] = '\0';
+    int status = pclose(decoder);
+    unlink(path);
+    return (status == 0) ? (long)n : -1;
+}
+
+/** Logs faster than UART3 drains, then stays blocked */
+static void flood_task(void *parameters)
+{
+    (void)parameters;
+    for (uint32_t i = 0; i < FLOOD_LINES; i++) {
+        (void)print_deferred("[FLOOD] line %lu\r\n", (unsigned long)i);
+    }
+    for (;;) {
+        vTaskDelay(portMAX_DELAY);
+    }
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void test_cost(void)
+{
+    char text[PRINT_MESSAGE_MAX_SIZE];
+    uint64_t start;
+
+    // One line per argument count: deferred, then formatted by the caller
+    start = host_ns();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        (void)print_deferred("[APP] System initialized\r\n");
+        ring_drain();
+    }
+    double deferred_0 = (double)(host_ns() - start) / CALLS;
+    start = host_ns();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        snprintf(text, sizeof(text), "[APP] System initialized\r\n");
+        (void)print_message(text);
+        ring_drain();
+    }
+    double eager_0 = (double)(host_ns() - start) / CALLS;
+
+    start = host_ns();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        (void)print_deferred("[WATCHDOG] Registered '%s' (ID=%u, timeout=%lums)\r\n", "Print_Task", i & 3U, 5000UL);
+        ring_drain();
+    }
+    double deferred_3 = (double)(host_ns() - start) / CALLS;
+    start = host_ns();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        snprintf(text, sizeof(text), "[WATCHDOG] Registered '%s' (ID=%u, timeout=%lums)\r\n", "Print_Task", i & 3U, 5000UL);
+        (void)print_message(text);
+        ring_drain();
+    }
+    double eager_3 = (double)(host_ns() - start) / CALLS;
+
+    printf("0 args: print_deferred %6.1f ns, snprintf + print_message %6.1f ns per call\n", deferred_0, eager_0);
+    printf("3 args: print_deferred %6.1f ns, snprintf + print_message %6.1f ns per call\n", deferred_3, eager_3);
+}
+
+static void test_bytes(void)
+{
+    char text[PRINT_MESSAGE_MAX_SIZE];
+
+    for (uint8_t nargs = 0; nargs <= PRINT_DEFERRED_MAX_ARGS; nargs++) {
+        ring_drain();
+        switch (nargs) {
+            case 0: (void)print_deferred("[T] none\r\n"); break;
+            case 1: (void)print_deferred("[T] %u\r\n", 1); break;
+            case 2: (void)print_deferred("[T] %u %u\r\n", 1, 2); break;
+            case 3: (void)print_deferred("[T] %u %u %u\r\n", 1, 2, 3); break;
+            default: (void)print_deferred("[T] %u %u %u %u\r\n", 1, 2, 3, 4); break;
+        }
+        CHECK(ring_used() == sizeof(uint16_t) + sizeof(const char *) + nargs * sizeof(uintptr_t));
+
+        // On the wire: marker, address, count, arguments
+        uint8_t wire[64];
+        uint16_t len = print_stage_deferred((uint16_t)((print_ring_tail + sizeof(uint16_t)) % PRINT_RING_SIZE),
+                                            nargs, wire, sizeof(wire), pdTRUE);
+        CHECK(len == 2U + sizeof(const char *) + nargs * sizeof(uintptr_t));
+        CHECK(wire[0] == PRINT_DEFERRED_MARKER && wire[1 + sizeof(const char *)] == nargs);
+    }
+    ring_drain();
+
+    int text_len = snprintf(text, sizeof(text), "[WATCHDOG] Registered '%s' (ID=%u, timeout=%lums)\r\n",
+                            "Print_Task", 1U, 5000UL);
+    printf("3-argument line: %d bytes as text; deferred %zu bytes here, %u on the target\n", text_len,
+           2U + sizeof(const char *) + 3U * sizeof(uintptr_t), 2U + TARGET_WORD + 3U * TARGET_WORD);
+}
+
+static void test_round_trip(void)
+{
+    static char decoded[sizeof(expected) + 1024];
+    char ram_text[48];
+
+    // Only this test's lines from here on
+    print_set_log_level(LOG_LEVEL_NONE);
+    sim_kernel_run_ms(200);
+    (void)sim_uart_tx_read(&huart3, NULL, SIZE_MAX);
+
+    LOG_AND_EXPECT("[APP] System initialized\r\n");
+    LOG_AND_EXPECT("[LED] Pattern %u set\r\n", 2);
+    LOG_AND_EXPECT("[ESP8266] ✓ PONG received (%lu ms)\r\n", 42UL);
+    LOG_AND_EXPECT("[CFG] %s = %d\r\n", "led_period", -17);
+    LOG_AND_EXPECT("[TRACE] %08x %c%c|%-4d|%%\r\n", 0xBEEFU, 'o', 'k', -3);
+    LOG_AND_EXPECT("[TRACE] |%5u|%X|%lu|\r\n", 42U, 0xABCU, 4294967295UL);
+    LOG_AND_EXPECT("[WATCHDOG] Registered '%s' (ID=%u, timeout=%lums)\r\n", "Print_Task", 1U, 5000UL);
+
+    // TEXT records pass through the decoder unchanged
+    snprintf(ram_text, sizeof(ram_text), "[RAM] %s\r\n", "formatted by the caller");
+    CHECK(print_message(ram_text) == pdPASS);
+    expect("%s", ram_text);
+    LOG_AND_EXPECT("[CFG] %s = %d\r\n", "led_duty", 2147483647);
+
+    sim_kernel_run_ms(100);
+    capture_uart3();
+
+    // A task overruns the ring; its drops are summarized by name
+    TaskHandle_t flood;
+    CHECK(xTaskCreate(flood_task, "Log_Flood", configMINIMAL_STACK_SIZE, NULL,
+                      PRINT_TASK_PRIORITY + 1, &flood) == pdPASS);
+    sim_kernel_run_ms(PRINT_DROP_REPORT_MS + 2100U);
+    capture_uart3();
+
+    uint32_t dropped = print_get_dropped();
+    uint32_t kept = FLOOD_LINES - dropped;
+    CHECK(dropped > 0 && dropped < FLOOD_LINES);
+    for (uint32_t i = 0; i < kept; i++) {
+        expect("[FLOOD] line %lu\r\n", (unsigned long)i);
+    }
+    expect("[PRINT_TASK] %lu messages dropped (Log_Flood)\r\n", (unsigned long)dropped);
+
+    long n = run_decoder(decoded, sizeof(decoded));
+    CHECK(n >= 0);
+    if (n < 0) {
+        return;
+    }
+    printf("Round trip: %zu bytes on UART3 decoded to %ld bytes of text (%u lines dropped)\n",
+           capture_len, n, dropped);
+    CHECK((size_t)n == expected_len);
+    CHECK(memcmp(decoded, expected, expected_len) == 0);
+    if ((size_t)n != expected_len || memcmp(decoded, expected, expected_len) != 0) {
+        fprintf(stderr, "decoded:\n%s\nexpected:\n%s\n", decoded, expected);
+    }
+}
+
+int main(void)
+{
+    sim_test_boot();
+
+    test_cost();
+    test_bytes();
+    test_round_trip();
+
+    return SIM_TEST_RESULT();
+}
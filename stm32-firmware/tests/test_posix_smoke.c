@@ -0,0 +1,152 @@
+/**
+ ******************************************************************************
+ * @file           : test_posix_smoke.c
+ * @brief          : Smoke Test on the FreeRTOS POSIX Port
+ ******************************************************************************
+ * @description
+ * Built only when FREERTOS_KERNEL_PATH points at a FreeRTOS-Kernel
+ * checkout: the firmware boots on the real kernel, in real time, and a
+ * task plays the ESP8266 over the UART2 shim:
+ * ┌──────────────────┬─────────────────────────────────────────────────────┐
+ * │ Step             │ Checked                                             │
+ * ├──────────────────┼─────────────────────────────────────────────────────┤
+ * │ Boot             │ Boot log on UART3, no IWDG expiry                   │
+ * │ PING             │ PONG within SMOKE_REPLY_MS                          │
+ * │ LED_CMD:2#7      │ OK:Pattern2#7, and the PWM compares change          │
+ * │ Settle           │ Still answering a PING after SMOKE_SETTLE_MS (the   │
+ * │                  │ watchdog monitor has run), no IWDG expiry           │
+ * └──────────────────┴─────────────────────────────────────────────────────┘
+ * Only outcomes are checked, never timing: the port runs tasks as threads,
+ * so latencies depend on the host. A hang is caught by the ctest timeout.
+ ******************************************************************************
+ */
+
+#include "hal_sim.h"
+#include "sim_board.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*============================================================================
+ * Private Definitions
+ *===========================================================================*/
+
+#define SMOKE_BOOT_MS       500U    // Boot output done, tasks waiting
+#define SMOKE_REPLY_MS      1000U   // Longest wait for a reply
+#define SMOKE_SETTLE_MS     3000U   // More than one watchdog check period
+
+static int failures = 0;
+
+#define SMOKE_CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+/*============================================================================
+ * ESP8266 Side
+ *===========================================================================*/
+
+static char esp_rx[1024];
+static size_t esp_rx_len = 0;
+
+/**
+ * @brief  Send a line and wait for a reply that starts with a prefix
+ * @param  line: Line to send (with "\r\n")
+ * @param  prefix: Expected reply start
+ * @retval 1 if the reply arrived within SMOKE_REPLY_MS
+ */
+static int esp_exchange(const char *line, const char *prefix)
+{
+    esp_rx_len = 0;
+    (void)sim_uart_rx(&huart2, line, strlen(line));
+
+    for (uint32_t waited = 0; waited < SMOKE_REPLY_MS; waited += 10U) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+        esp_rx_len += sim_uart_tx_read(&huart2, &esp_rx[esp_rx_len], sizeof(esp_rx) - 1U - esp_rx_len);
+        esp_rx[esp_rx_len] = '\0';
+
+        // A complete reply line starting with the prefix
+        for (char *start = esp_rx; start != NULL && *start != '\0'; ) {
+            char *end = strstr(start, "\r\n");
+            if (end == NULL) {
+                break;
+            }
+            if (strncmp(start, prefix, strlen(prefix)) == 0) {
+                return 1;
+            }
+            start = end + 2;
+        }
+    }
+    fprintf(stderr, "no \"%s\" reply to %.*s", prefix, (int)strlen(line), line);
+    return 0;
+}
+
+/*============================================================================
+ * Tasks
+ *===========================================================================*/
+
+/** Stands in for the NVIC, as in led_sim: fires due HAL events each tick */
+static void sim_irq_task(void *parameters)
+{
+    (void)parameters;
+    for (;;) {
+        vTaskDelay(1);
+        (void)sim_hal_run_due();
+    }
+}
+
+/** Plays the ESP8266, then ends the process with the result */
+static void smoke_task(void *parameters)
+{
+    char boot_log[256];
+    size_t n;
+
+    (void)parameters;
+    vTaskDelay(pdMS_TO_TICKS(SMOKE_BOOT_MS));
+
+    n = sim_uart_tx_read(&huart3, boot_log, sizeof(boot_log));
+    SMOKE_CHECK(n > 0);
+    (void)sim_uart_tx_read(&huart2, NULL, SIZE_MAX);
+
+    SMOKE_CHECK(esp_exchange("PING\r\n", "PONG"));
+
+    sim_pin_log_clear();
+    SMOKE_CHECK(esp_exchange("LED_CMD:2#7\r\n", "OK:Pattern2#7"));
+    vTaskDelay(pdMS_TO_TICKS(200));
+    SMOKE_CHECK(sim_pin_log_count() > 0);
+
+    vTaskDelay(pdMS_TO_TICKS(SMOKE_SETTLE_MS));
+    SMOKE_CHECK(esp_exchange("PING\r\n", "PONG"));
+    SMOKE_CHECK(sim_iwdg_expiries() == 0);
+
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    fflush(stdout);
+    exit((failures == 0) ? 0 : 1);
+}
+
+/*============================================================================
+ * Main
+ *===========================================================================*/
+
+int main(void)
+{
+    sim_board_boot();
+
+    sim_clock_use_realtime();
+    if (xTaskCreate(sim_irq_task, "SIM_IRQ", configMINIMAL_STACK_SIZE * 4, NULL,
+                    configMAX_PRIORITIES - 1, NULL) != pdPASS
+            || xTaskCreate(smoke_task, "Smoke", configMINIMAL_STACK_SIZE * 4, NULL,
+                           tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+        fprintf(stderr, "test_posix_smoke: cannot create the test tasks\n");
+        return 1;
+    }
+    vTaskStartScheduler();
+
+    fprintf(stderr, "test_posix_smoke: scheduler returned\n");
+    return 1;
+}
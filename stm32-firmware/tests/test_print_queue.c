@@ -0,0 +1,231 @@
+/**
+ ******************************************************************************
+ * @file           : test_print_queue.c
+ * @brief          : Print Queue RAM and print_message() Cost - 256-byte Queue vs Ring
+ ******************************************************************************
+ * @description
+ * print_task.c built into the test, next to a model of the queue it
+ * replaced (xQueueCreate(PRINT_QUEUE_DEPTH, 256); print_message() copied
+ * the text into a 256-byte stack buffer with strncpy and xQueueSend
+ * copied the whole buffer into a queue slot):
+ * ┌──────────────────────┬───────────────────────┬────────────────────────┐
+ * │                      │ Old queue             │ Log ring               │
+ * ├──────────────────────┼───────────────────────┼────────────────────────┤
+ * │ Heap                 │ 5 × 256 + control     │ 0                      │
+ * │                      │ block                 │                        │
+ * │ Static               │ 0                     │ Ring, TX buffers, drop │
+ * │                      │                       │ counters               │
+ * │ Stack per caller     │ 256 (print_message)   │ 0                      │
+ * │ Storage per message  │ 256                   │ 2 + length, or 2 + a   │
+ * │                      │                       │ pointer for flash text │
+ * │ Copied per call      │ 256 + 256             │ length (or a pointer)  │
+ * └──────────────────────┴───────────────────────┴────────────────────────┘
+ * A UART3 that refuses a transfer (HAL_BUSY while a polled transmit holds
+ * it) must delay the staged buffer, not lose it.
+ *
+ * Per-call cost is host time (CLOCK_MONOTONIC) over many calls, printed
+ * for comparison only; the byte counts are checked. The host copies 256
+ * bytes in a few vector stores, so it understates what the old copies
+ * cost on the Cortex-M4. Static sizes are this host's (pointers are 8
+ * bytes here, 4 on the board).
+ ******************************************************************************
+ */
+
+#include "../src/print_task.c"
+
+#include "sim_test.h"
+#include <time.h>
+
+/*============================================================================
+ * Old Queue Model
+ *===========================================================================*/
+
+#define OLD_QUEUE_DEPTH     5U      // PRINT_QUEUE_DEPTH before the ring
+#define OLD_QUEUE_CB_BYTES  80U     // sizeof(StaticQueue_t) on Cortex-M4
+
+static char old_queue[OLD_QUEUE_DEPTH][PRINT_MESSAGE_MAX_SIZE];
+static uint32_t old_queue_head = 0;
+
+/**
+ * @brief  print_message() as it was: stack copy, then a full slot copy
+ * @note   Never full: the slot is reused, as if the print task kept up
+ */
+static BaseType_t old_print_message(const char *message)
+{
+    char buffer[PRINT_MESSAGE_MAX_SIZE];
+
+    if (message == NULL) {
+        return pdFAIL;
+    }
+    strncpy(buffer, message, PRINT_MESSAGE_MAX_SIZE - 1);
+    buffer[PRINT_MESSAGE_MAX_SIZE - 1] = '\0';
+
+    // xQueueSend: item size is the whole buffer
+    taskENTER_CRITICAL();
+    memcpy(old_queue[old_queue_head], buffer, PRINT_MESSAGE_MAX_SIZE);
+    old_queue_head = (old_queue_head + 1U) % OLD_QUEUE_DEPTH;
+    taskEXIT_CRITICAL();
+
+    // xQueueSend also readied the waiting print task
+    xTaskNotify(print_task_handle, PRINT_NOTIFY_DATA, eSetBits);
+    return pdPASS;
+}
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define CALLS           20000U
+
+static uint64_t host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint16_t ring_used(void)
+{
+    return (uint16_t)((print_ring_head - print_ring_tail + PRINT_RING_SIZE) % PRINT_RING_SIZE);
+}
+
+/** Empty the ring, as the print task would between calls */
+static void ring_drain(void)
+{
+    print_ring_tail = print_ring_head;
+}
+
+/**
+ * @brief  Host time per call of a print function
+ * @retval Nanoseconds per call
+ */
+static double cost_per_call(BaseType_t (*print)(const char *), const char *message)
+{
+    uint64_t start = host_ns();
+
+    for (uint32_t i = 0; i < CALLS; i++) {
+        (void)print(message);
+        ring_drain();
+    }
+    return (double)(host_ns() - start) / CALLS;
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void test_ram(void)
+{
+    size_t old_heap = OLD_QUEUE_DEPTH * PRINT_MESSAGE_MAX_SIZE + OLD_QUEUE_CB_BYTES;
+    size_t ring_static = sizeof(print_ring) + sizeof(print_tx_buffer) + sizeof(print_drops)
+                       + 4U * sizeof(uint32_t);     // print_drops_isr .. _pending
+
+    printf("Old queue: %zu bytes heap, 0 static, %u stack per caller + %u in the print task\n",
+           old_heap, PRINT_MESSAGE_MAX_SIZE, PRINT_MESSAGE_MAX_SIZE);
+    printf("Log ring:  0 bytes heap, %zu static (ring %zu, TX buffers %zu), 0 stack per caller\n",
+           ring_static, sizeof(print_ring), sizeof(print_tx_buffer));
+
+    // Messages held before anything is dropped, 40-character lines
+    size_t ring_holds = (PRINT_RING_SIZE - 1U) / (sizeof(uint16_t) + 40U);
+    printf("40-character lines held: old %u, ring %zu\n", OLD_QUEUE_DEPTH, ring_holds);
+    CHECK(ring_holds > OLD_QUEUE_DEPTH);
+}
+
+static void test_record_size(void)
+{
+    static const char flash_text[] = "[ESP8266] Connection OK\r\n";
+    char ram_text[64];
+
+    snprintf(ram_text, sizeof(ram_text), "[ESP8266] ← Received: '%s'\r\n", "LED_CMD:2");
+    ring_drain();
+
+    // RAM text: header + the used bytes
+    CHECK(print_message(ram_text) == pdPASS);
+    CHECK(ring_used() == sizeof(uint16_t) + strlen(ram_text));
+    ring_drain();
+
+    // Flash text: header + pointer, whatever its length
+    CHECK(print_message(flash_text) == pdPASS);
+    CHECK(ring_used() == sizeof(uint16_t) + sizeof(const char *));
+    ring_drain();
+
+    // Over-long text: truncated to the old per-message limit
+    char long_text[PRINT_MESSAGE_MAX_SIZE + 50];
+    memset(long_text, 'x', sizeof(long_text) - 1U);
+    long_text[sizeof(long_text) - 1U] = '\0';
+    CHECK(print_message(long_text) == pdPASS);
+    CHECK(ring_used() == sizeof(uint16_t) + PRINT_MESSAGE_MAX_SIZE - 1U);
+    ring_drain();
+}
+
+static void test_cost(void)
+{
+    static const char flash_text[] = "[LED] Pattern 2: green 100 ms / orange 1000 ms\r\n";
+    char short_text[64];
+    char long_text[201];
+
+    snprintf(short_text, sizeof(short_text), "[ESP8266] ← Received: '%s'\r\n", "LED_CMD:2");
+    memset(long_text, 'x', sizeof(long_text) - 1U);
+    long_text[sizeof(long_text) - 1U] = '\0';
+
+    const struct {
+        const char *name;
+        const char *text;
+    } cases[] = {
+        { "RAM, short", short_text },
+        { "flash", flash_text },
+        { "RAM, 200 B", long_text },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        double old_ns = cost_per_call(old_print_message, cases[i].text);
+        double ring_ns = cost_per_call(print_message, cases[i].text);
+
+        printf("print_message(%-10s %3zu chars): old queue %6.1f ns, ring %6.1f ns per call\n",
+               cases[i].name, strlen(cases[i].text), old_ns, ring_ns);
+    }
+    CHECK(print_get_dropped() == 0);
+}
+
+static void test_tx_busy(void)
+{
+    static const char *const lines[] = { "[TEST] first\r\n", "[TEST] second\r\n" };
+    char out[64];
+
+    // Boot output sent, UART3 idle
+    ring_drain();
+    while (!print_task_tx_idle() || print_ring_tail != print_ring_head) {
+        sim_kernel_run_ms(10);
+    }
+    (void)sim_uart_tx_read(&huart3, NULL, SIZE_MAX);
+
+    // UART3 held by someone else: the transfer is refused
+    huart3.gState = HAL_UART_STATE_BUSY;
+    CHECK(print_message(lines[0]) == pdPASS);
+    sim_kernel_run_ms(3U * PRINT_TX_RETRY_MS);
+    CHECK(sim_uart_tx_read(&huart3, NULL, SIZE_MAX) == 0);
+
+    // Released: the staged buffer goes out on the next retry, then the rest
+    huart3.gState = HAL_UART_STATE_READY;
+    sim_kernel_run_ms(PRINT_TX_RETRY_MS + 1U);
+    CHECK(print_message(lines[1]) == pdPASS);
+    sim_kernel_run_ms(10);
+
+    size_t n = sim_uart_tx_read(&huart3, out, sizeof(out) - 1U);
+    out[n] = '\0';
+    CHECK_STR(out, "[TEST] first\r\n[TEST] second\r\n");
+    CHECK(print_get_dropped() == 0);
+}
+
+int main(void)
+{
+    sim_test_boot();
+
+    test_ram();
+    test_record_size();
+    test_cost();
+    test_tx_busy();
+
+    return SIM_TEST_RESULT();
+}
@@ -0,0 +1,107 @@
+/**
+ ******************************************************************************
+ * @file           : test_runtime_stats.c
+ * @brief          : Run-Time Stats - DWT CYCCNT Wraparound
+ ******************************************************************************
+ * @description
+ * CYCCNT is a 32-bit count at 168 MHz and wraps every 25.6 s. The firmware
+ * is left mostly idle for STATS windows longer than one wrap, with the
+ * idle wait standing in for the idle hook's WFI (runtime_stats_add_sleep()
+ * for every idle stretch). The reported window length and sleep share must
+ * match the simulated time.
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include "runtime_stats.h"
+#include <stdlib.h>
+
+/*============================================================================
+ * Idle Hook Stand-In
+ *===========================================================================*/
+
+/** Idle waits above this are split, so each sleep fits a uint32_t */
+#define SLEEP_CHUNK_NS  (1000ULL * SIM_NS_PER_MS)
+
+static uint64_t slept_ns = 0;
+
+/**
+ * @brief  Idle until the deadline, accounted as sleep (WFI in the idle hook)
+ */
+static void sleeping_idle_wait(uint64_t deadline_ns)
+{
+    while (sim_now_ns() < deadline_ns) {
+        uint64_t from = sim_now_ns();
+        uint64_t to = (deadline_ns - from > SLEEP_CHUNK_NS) ? from + SLEEP_CHUNK_NS : deadline_ns;
+        uint32_t start = DWT->CYCCNT;
+
+        sim_clock_advance_to(to);
+        runtime_stats_add_sleep(DWT->CYCCNT - start);
+        slept_ns += to - from;
+    }
+}
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+/** When the last STATS was sent: the firmware's window starts there */
+static uint64_t stats_sent_ns = 0;
+
+/**
+ * @brief  Send STATS and read back ms= and sleep= (permille)
+ * @retval 1 if the reply arrived and parsed
+ */
+static int stats_window(unsigned long *ms, unsigned long *sleep)
+{
+    char line[256];
+
+    stats_sent_ns = sim_now_ns();
+    slept_ns = 0;
+    esp_send("STATS\r\n");
+    sim_kernel_run_ms(20);
+    if (!esp_expect("STATS:", line, sizeof(line))) {
+        return 0;
+    }
+    return sscanf(line, "STATS:ms=%lu,idle=%*u,sleep=%lu", ms, sleep) == 2;
+}
+
+/*============================================================================
+ * Test
+ *===========================================================================*/
+
+int main(void)
+{
+    static const uint32_t windows_ms[] = { 30000, 60000, 1000 };
+    unsigned long ms;
+    unsigned long sleep;
+
+    // Extension across one wrap: 0x100 cycles before it, 0x100 after
+    uint32_t last = 0xFFFFFF00UL;
+    CHECK(runtime_stats_extend(0, &last, 0x100UL) == 0x200ULL);
+    CHECK(last == 0x100UL);
+
+    sim_kernel_set_idle_wait(sleeping_idle_wait);
+    sim_test_boot();
+    CHECK(stats_window(&ms, &sleep));   // Baseline
+
+    for (size_t i = 0; i < sizeof(windows_ms) / sizeof(windows_ms[0]); i++) {
+        uint64_t start = stats_sent_ns;
+
+        sim_kernel_run_ms(windows_ms[i]);
+        uint64_t window_ns = sim_now_ns() - start;
+        unsigned long expected = (unsigned long)(slept_ns * 1000ULL / window_ns);
+
+        if (!stats_window(&ms, &sleep)) {
+            CHECK(0);
+            continue;
+        }
+        printf("window %lu ms: STATS ms=%lu sleep=%lu (expected ~%lu)\n",
+               (unsigned long)windows_ms[i], ms, sleep, expected);
+        CHECK(labs((long)ms - (long)(window_ns / SIM_NS_PER_MS)) <= 1);
+        CHECK(labs((long)sleep - (long)expected) <= 2);
+        CHECK(sleep >= 900);    // Mostly idle: a lost wrap would read ~150
+    }
+
+    return SIM_TEST_RESULT();
+}
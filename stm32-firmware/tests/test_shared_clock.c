@@ -0,0 +1,219 @@
+/**
+ ******************************************************************************
+ * @file           : test_shared_clock.c
+ * @brief          : Two Boards on One Shared Clock - LED_AT Edge Gap
+ ******************************************************************************
+ * @description
+ * Two simulated boards, each in its own process (the simulator keeps one
+ * board per process), run against one wall clock. Board B boots later
+ * than board A by a fraction of a tick that differs per case, so their
+ * RTOS ticks are out of phase. Each board's ESP8266 sends:
+ * ┌──────────────────┬───────────────────────────────────────────────────┐
+ * │ Wall time        │ Line                                              │
+ * ├──────────────────┼───────────────────────────────────────────────────┤
+ * │ TIME_AT (+phase) │ TIME:<wall ms when sent> (phase differs per board)│
+ * │ AT_SEND_AT       │ LED_AT:DUE_AT@LED_CMD:3 (same line to both)       │
+ * └──────────────────┴───────────────────────────────────────────────────┘
+ * Both boards play pattern 1 (green on) before, so the due tick shows as
+ * green's off-edge in the pin log, followed by one edge every 100 ms.
+ * The gap between the two boards' edges (k-th against k-th, on the wall
+ * clock) is measured the way test_led_sync.c measures one board's LEDs.
+ *
+ * TIME carries whole milliseconds and each board counts whole ticks from
+ * its own boot, so the boards can be up to ~2 ms apart. The edges then
+ * stay exactly that far apart: no drift over the run.
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define WALL_MS(ms)     ((uint64_t)(ms) * SIM_NS_PER_MS)
+
+#define TIME_AT         WALL_MS(3000)
+#define AT_SEND_AT      WALL_MS(4000)
+#define DUE_AT          WALL_MS(5000)
+#define WATCH_MS        1000U           // Edges collected after the due time
+#define MAX_EDGES       16U
+#define PIN_GREEN       12U             // PD12, TIM4 CH1
+
+/** Gap limit: one ms from TIME's resolution, one from the boot phase */
+#define MAX_GAP_NS      (2U * SIM_NS_PER_MS)
+
+/** Due edge against DUE_AT: the same, plus ~1 ms of UART time for TIME and
+ *  the PWM period the new compare value waits for */
+#define MAX_DUE_ERROR_NS (3U * SIM_NS_PER_MS)
+
+/** One board's place on the wall clock */
+typedef struct {
+    uint64_t boot_ns;           // Wall time of local time 0
+    uint64_t time_ns;           // Wall time its ESP8266 sends TIME
+} board_wall_t;
+
+typedef struct {
+    uint32_t failures;
+    uint32_t count;
+    uint64_t edge_ns[MAX_EDGES];    // Wall time of each PD12 change
+} board_result_t;
+
+/**
+ * @brief  Run one board until WATCH_MS after the due time
+ * @param  b: Boot and TIME instants on the wall clock
+ * @param  r: [OUT] PD12 changes from shortly before the due time
+ * @retval None
+ */
+static void run_board(const board_wall_t *b, board_result_t *r)
+{
+    char text[48];
+    char line[64];
+
+    sim_test_boot();
+    esp_send("LED_CMD:1\r\n");
+    sim_kernel_run_ms(20);
+    CHECK(esp_expect("OK:Pattern1", line, sizeof(line)));
+
+    sim_kernel_run_until(b->time_ns - b->boot_ns);
+    snprintf(text, sizeof(text), "TIME:%lu\r\n", (unsigned long)(b->time_ns / SIM_NS_PER_MS));
+    esp_send(text);
+
+    sim_kernel_run_until(AT_SEND_AT - b->boot_ns);
+    snprintf(text, sizeof(text), "LED_AT:%lu@LED_CMD:3\r\n", (unsigned long)(DUE_AT / SIM_NS_PER_MS));
+    esp_send(text);
+    sim_kernel_run_ms(20);
+    CHECK(esp_expect("OK:Pattern3", line, sizeof(line)));
+
+    sim_kernel_run_until(DUE_AT - WALL_MS(50) - b->boot_ns);
+    sim_pin_log_clear();
+    sim_kernel_run_until(DUE_AT + WALL_MS(WATCH_MS) - WALL_MS(50) - b->boot_ns);
+
+    r->count = 0;
+    for (size_t i = 0; i < sim_pin_log_count() && r->count < MAX_EDGES; i++) {
+        const sim_pin_event_t *e = sim_pin_log_get(i);
+
+        if (e->port == 'D' && e->pin == PIN_GREEN) {
+            r->edge_ns[r->count++] = e->ns + b->boot_ns;
+        }
+    }
+    r->failures = (uint32_t)sim_test_failures;
+}
+
+/**
+ * @brief  Run a board in a child process
+ * @param  b: Boot and TIME instants on the wall clock
+ * @param  r: [OUT] The child's result
+ * @retval 0 on success, -1 if the child could not run or report
+ */
+static int run_board_process(const board_wall_t *b, board_result_t *r)
+{
+    int fd[2];
+    int status;
+
+    if (pipe(fd) != 0) {
+        return -1;
+    }
+    fflush(NULL);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        board_result_t result;
+
+        close(fd[0]);
+        sim_test_failures = 0;      // Count this board's checks only
+        run_board(b, &result);
+        ssize_t written = write(fd[1], &result, sizeof(result));
+        fflush(NULL);
+        _exit(written == (ssize_t)sizeof(result) ? 0 : 1);
+    }
+
+    close(fd[1]);
+    ssize_t got = read(fd[0], r, sizeof(*r));
+    close(fd[0]);
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0
+            || got != (ssize_t)sizeof(*r)) {
+        return -1;
+    }
+    return 0;
+}
+
+static uint64_t abs_diff(uint64_t a, uint64_t b)
+{
+    return (a > b) ? a - b : b - a;
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+/**
+ * @brief  Two boards, one LED_AT
+ * @retval Largest gap between their edges (ns)
+ */
+static uint64_t test_pair(const board_wall_t *a, const board_wall_t *b)
+{
+    board_result_t ra;
+    board_result_t rb;
+    uint64_t gap = 0;
+
+    CHECK(run_board_process(a, &ra) == 0);
+    CHECK(run_board_process(b, &rb) == 0);
+    CHECK(ra.failures == 0 && rb.failures == 0);
+
+    // Off at the due tick, then every 100 ms
+    CHECK(ra.count == WATCH_MS / 100U && rb.count == ra.count);
+    for (uint32_t k = 0; k < ra.count && k < rb.count; k++) {
+        uint64_t d = abs_diff(ra.edge_ns[k], rb.edge_ns[k]);
+        gap = (d > gap) ? d : gap;
+    }
+    if (ra.count == 0 || rb.count == 0) {
+        return UINT64_MAX;
+    }
+
+    // The first edge is the due tick, a few ms at most from DUE_AT
+    CHECK(abs_diff(ra.edge_ns[0], DUE_AT) <= MAX_DUE_ERROR_NS);
+    CHECK(abs_diff(rb.edge_ns[0], DUE_AT) <= MAX_DUE_ERROR_NS);
+    // The gap is the same at every edge
+    CHECK(abs_diff(ra.edge_ns[ra.count - 1U], rb.edge_ns[rb.count - 1U])
+          == abs_diff(ra.edge_ns[0], rb.edge_ns[0]));
+
+    printf("B boots +%7.3f ms, TIME phase A %.2f / B %.2f ms: due edge A %+7.3f, B %+7.3f ms, gap %5.3f ms\n",
+           (double)(b->boot_ns - a->boot_ns) / SIM_NS_PER_MS,
+           (double)(a->time_ns % SIM_NS_PER_MS) / SIM_NS_PER_MS,
+           (double)(b->time_ns % SIM_NS_PER_MS) / SIM_NS_PER_MS,
+           ((double)ra.edge_ns[0] - (double)DUE_AT) / SIM_NS_PER_MS,
+           ((double)rb.edge_ns[0] - (double)DUE_AT) / SIM_NS_PER_MS,
+           (double)gap / SIM_NS_PER_MS);
+    return gap;
+}
+
+int main(void)
+{
+    uint64_t worst = 0;
+
+    // Board B boots 0..1 tick out of phase with A; TIME leaves each
+    // ESP8266 at its own sub-millisecond phase
+    for (uint32_t i = 0; i < 8U; i++) {
+        board_wall_t a = { 0, TIME_AT + (i * 110U % 1000U) * SIM_NS_PER_US };
+        board_wall_t b = {
+            WALL_MS(1234) + i * 125U * SIM_NS_PER_US,
+            TIME_AT + (i * 370U % 1000U) * SIM_NS_PER_US,
+        };
+        uint64_t gap = test_pair(&a, &b);
+
+        worst = (gap > worst) ? gap : worst;
+    }
+
+    printf("Worst gap between the boards' edges: %.3f ms\n", (double)worst / SIM_NS_PER_MS);
+    CHECK(worst <= MAX_GAP_NS);
+
+    return SIM_TEST_RESULT();
+}
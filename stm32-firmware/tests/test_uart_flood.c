@@ -0,0 +1,193 @@
+/**
+ ******************************************************************************
+ * @file           : test_uart_flood.c
+ * @brief          : UART2 Flood - No RX Loss While Replies Are Queued
+ ******************************************************************************
+ * @description
+ * The ESP8266 side writes commands back to back at the full 115200 baud
+ * line rate without waiting for replies. Replies go out through the
+ * non-blocking TX queue, so the comm task keeps draining RX while ACKs are
+ * still outstanding:
+ * ┌──────────────────────┬───────────────────────────────────────────────┐
+ * │ Flood                │ Expected                                      │
+ * ├──────────────────────┼───────────────────────────────────────────────┤
+ * │ 5 s of PING          │ Every PONG (reply as long as the command)     │
+ * │ FLOOD_ALL_ACKED      │ Every ACK, in order (ACK 2 bytes longer: the  │
+ * │ LED_CMD              │ TX queue absorbs the backlog)                 │
+ * │ FLOOD_OVERLOAD       │ No RX byte lost; replies the full queue       │
+ * │ LED_CMD              │ refuses are dropped whole, the rest in order  │
+ * └──────────────────────┴───────────────────────────────────────────────┘
+ * In every case no byte is lost on the RX side: no DMA overrun, nothing
+ * dropped by the stream buffer, and the link answers PING afterwards.
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+/**
+ * Each ACK is two bytes longer than its command, so a flood builds a TX
+ * backlog, and the run being sent keeps its ring space until TC. A burst
+ * this long (ten times MAX_INFLIGHT_COMMANDS on the ESP8266) is answered
+ * in full; longer floods outrun the 115200 baud reply path.
+ */
+#define FLOOD_ALL_ACKED     40U
+#define FLOOD_OVERLOAD      1000U
+
+/** Sequence numbers are 8 bit: seq i is sent as i % 256 */
+#define SEQ(i)  ((unsigned int)(i) % 256U)
+
+/** Pattern for command i (1..3; their ACKs all read "OK:PatternN#seq") */
+static unsigned int pattern_of(unsigned int i)
+{
+    return 1U + i % 3U;
+}
+
+/** Time each flood command's last byte arrives (ns) */
+static uint64_t arrival_ns[FLOOD_OVERLOAD];
+
+/**
+ * @brief  Put count LED_CMD lines on the wire back to back
+ * @retval Time the last byte arrives (ns)
+ */
+static uint64_t flood_led_cmd(unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++) {
+        char text[32];
+        int len = snprintf(text, sizeof(text), "LED_CMD:%u#%u\r\n", pattern_of(i), SEQ(i));
+
+        // Queued after the previous line: no gap on the wire
+        arrival_ns[i] = sim_uart_rx(&huart2, text, (size_t)len);
+    }
+    return arrival_ns[count - 1U];
+}
+
+/**
+ * @brief  Collect ACKs until the line has been quiet for a while
+ * @param  total: Commands sent
+ * @param  flood_end: Time the last command byte arrives (ns)
+ * @param  max_outstanding: [OUT] Commands received but not yet ACKed,
+ *         at its largest
+ * @retval ACKs received; each must be the next command's or a later one
+ */
+static unsigned int collect_acks(unsigned int total, uint64_t flood_end, unsigned int *max_outstanding)
+{
+    char line[64];
+    unsigned int acked = 0;
+    unsigned int next = 0;      // Lowest command an ACK may still answer
+
+    *max_outstanding = 0;
+    while (sim_now_ns() < flood_end + 200U * SIM_NS_PER_MS) {
+        sim_kernel_run_ms(1);
+        while (esp_read_line(line, sizeof(line))) {
+            unsigned int pattern;
+            unsigned int seq;
+
+            if (strncmp(line, "STM32_PING", 10) == 0) {
+                continue;
+            }
+            if (sscanf(line, "OK:Pattern%u#%u", &pattern, &seq) != 2) {
+                fprintf(stderr, "unexpected reply \"%s\"\n", line);
+                CHECK(0);
+                continue;
+            }
+            // Skip commands whose ACK the full queue refused
+            while (next < total && (SEQ(next) != seq || pattern_of(next) != pattern)) {
+                next++;
+            }
+            CHECK(next < total);
+            next++;
+            acked++;
+        }
+
+        // Commands received by now whose ACK has not come back yet
+        unsigned int arrived = 0;
+        while (arrived < total && arrival_ns[arrived] <= sim_now_ns()) {
+            arrived++;
+        }
+        if (arrived > next && arrived - next > *max_outstanding) {
+            *max_outstanding = arrived - next;
+        }
+    }
+    return acked;
+}
+
+/** RX path lost nothing so far */
+static void check_rx_lossless(void)
+{
+    CHECK(sim_kernel_stats()->stream_dropped == 0);
+    CHECK(sim_uart_rx_overruns(&huart2) == 0);
+}
+
+/** Link still answers after a flood */
+static void check_link_alive(void)
+{
+    char line[64];
+
+    (void)sim_uart_tx_read(&huart2, NULL, SIZE_MAX);
+    esp_rx_len = 0;
+    esp_send("PING\r\n");
+    sim_kernel_run_ms(10);
+    CHECK(esp_expect("PONG", line, sizeof(line)));
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void test_ping_flood(void)
+{
+    static char text[6 * 9600];
+    const unsigned int count = sizeof(text) / 6U;   // 5 s at 115200 baud
+    char line[64];
+    unsigned int pongs = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        memcpy(&text[i * 6U], "PING\r\n", 6);
+    }
+    uint64_t end = sim_uart_rx(&huart2, text, sizeof(text));
+
+    while (sim_now_ns() < end + 100U * SIM_NS_PER_MS) {
+        sim_kernel_run_ms(1);
+        while (esp_read_line(line, sizeof(line))) {
+            if (strcmp(line, "PONG") == 0) {
+                pongs++;
+            }
+        }
+    }
+    printf("PING flood: %u sent, %u PONG\n", count, pongs);
+    CHECK(pongs == count);
+    check_rx_lossless();
+}
+
+static void test_led_cmd_flood(unsigned int count, int expect_all)
+{
+    unsigned int max_outstanding;
+    uint64_t end = flood_led_cmd(count);
+    unsigned int acked = collect_acks(count, end, &max_outstanding);
+
+    printf("LED_CMD flood: %u sent, %u ACKed, up to %u ACKs outstanding\n",
+           count, acked, max_outstanding);
+    if (expect_all) {
+        CHECK(acked == count);
+    } else {
+        CHECK(acked > count / 2U);
+    }
+    CHECK(max_outstanding >= 4U);
+    check_rx_lossless();
+    check_link_alive();
+}
+
+int main(void)
+{
+    sim_test_boot();
+
+    test_ping_flood();
+    test_led_cmd_flood(FLOOD_ALL_ACKED, 1);
+    test_led_cmd_flood(FLOOD_OVERLOAD, 0);
+
+    return SIM_TEST_RESULT();
+}
@@ -0,0 +1,219 @@
+/**
+ ******************************************************************************
+ * @file           : test_uart_rx.c
+ * @brief          : UART2 RX - DMA / IDLE Reassembly and Pipelined Throughput
+ ******************************************************************************
+ * @description
+ * Reassembly (circular DMA, IDLE line and wrap events, stream buffer, line
+ * scanner):
+ * - Sequence-numbered commands cut at random points, with pauses long
+ *   enough for IDLE to fire mid-line, over many wraps of the 64-byte DMA
+ *   buffer; lines longer than the DMA buffer; CR, LF and CRLF endings
+ * - Every command answered exactly once, in order; nothing dropped
+ * - An overlong line is refused once and its tail is not run as a command
+ *
+ * Throughput: LED_CMD round trips over the 115200 baud link, stop-and-wait
+ * (the old ESP8266 behaviour) against up to four commands in flight
+ * (MAX_INFLIGHT_COMMANDS in the ESP8266 firmware).
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include "esp8266_comm_task.h"
+#include <stdlib.h>
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define PIPELINE_DEPTH      4U
+#define THROUGHPUT_COMMANDS 200U
+#define POLL_NS             (50U * 1000U)   // ESP8266 loop() poll step
+
+static uint32_t rng_state = 0x1234567UL;
+
+/** xorshift32: reproducible across runs */
+static uint32_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/**
+ * @brief  Put text on the wire in random pieces, pausing between them
+ * @retval None
+ */
+static void send_fragmented(const char *text)
+{
+    size_t len = strlen(text);
+    size_t at = 0;
+
+    while (at < len) {
+        size_t piece = 1U + rng() % 24U;
+
+        if (piece > len - at) {
+            piece = len - at;
+        }
+        (void)sim_uart_rx(&huart2, &text[at], piece);
+        at += piece;
+
+        // 0-3 ms: often past the one-character IDLE timeout
+        sim_kernel_run_until(sim_now_ns() + (uint64_t)(rng() % 3000U) * 1000U);
+    }
+}
+
+/** Pattern for sequence number i (1..4) */
+static unsigned int pattern_of(unsigned int i)
+{
+    return 1U + i % 4U;
+}
+
+/**
+ * @brief  Expected ASCII ACK for LED_CMD:<pattern_of(i)>#<i>
+ * @retval None
+ */
+static void led_cmd_ack(unsigned int i, char *buf, size_t size)
+{
+    unsigned int pattern = pattern_of(i);
+
+    if (pattern == 4U) {
+        snprintf(buf, size, "OK:AllOFF#%u", i % 256U);
+    } else {
+        snprintf(buf, size, "OK:Pattern%u#%u", pattern, i % 256U);
+    }
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void test_reassembly(void)
+{
+    static const char *const endings[] = { "\r\n", "\n", "\r" };
+    char text[160];
+    char line[160];
+    char expected[64];
+    unsigned int next_ack = 0;
+
+    for (unsigned int seq = 0; seq < 600; seq++) {
+        if (seq % 10U == 9U) {
+            // Longer than the DMA buffer: a four-group scene
+            snprintf(text, sizeof(text),
+                     "LED_SCENE:1,%u,50,0;2,500,50,0;4,500,50,100;8,500,50,200#%u%s",
+                     200U + seq, seq % 256U, endings[seq % 3U]);
+        } else {
+            snprintf(text, sizeof(text), "LED_CMD:%u#%u%s", pattern_of(seq), seq % 256U,
+                     endings[seq % 3U]);
+        }
+        send_fragmented(text);
+
+        sim_kernel_run_ms(5);
+        while (esp_read_line(line, sizeof(line))) {
+            if (line[0] == '\0' || strncmp(line, "STM32_PING", 10) == 0) {
+                continue;
+            }
+            if (next_ack % 10U == 9U) {
+                snprintf(expected, sizeof(expected), "OK:LedScene#%u", next_ack % 256U);
+            } else {
+                led_cmd_ack(next_ack, expected, sizeof(expected));
+            }
+            CHECK_STR(line, expected);
+            next_ack++;
+        }
+    }
+    CHECK(next_ack == 600U);
+    CHECK(sim_kernel_stats()->stream_dropped == 0);
+    CHECK(sim_uart_rx_overruns(&huart2) == 0);
+}
+
+static void test_overflow(void)
+{
+    char text[UART_RX_BUFFER_SIZE * 2];
+    char line[64];
+    int overflow_errors = 0;
+    int replies = 0;
+
+    // Overlong line whose tail would parse as a command, then two good ones
+    memset(text, 'X', UART_RX_BUFFER_SIZE + 10U);
+    strcpy(&text[UART_RX_BUFFER_SIZE + 10U], "LED_CMD:3\r\nPING\r\nLED_CMD:2\r\n");
+    send_fragmented(text);
+    sim_kernel_run_ms(50);
+
+    while (esp_read_line(line, sizeof(line))) {
+        if (strcmp(line, "ERROR:BufferOverflow") == 0) {
+            overflow_errors++;
+        } else if (strcmp(line, "PONG") == 0 || strcmp(line, "OK:Pattern2") == 0) {
+            replies++;
+        } else {
+            CHECK(strncmp(line, "OK:", 3) != 0);   // Not the tail's LED_CMD:3
+        }
+    }
+    CHECK(overflow_errors == 1);
+    CHECK(replies == 2);
+}
+
+/**
+ * @brief  Run LED_CMD round trips with up to depth commands in flight
+ * @retval Commands per second of simulated time
+ */
+static double run_throughput(unsigned int depth)
+{
+    char line[64];
+    unsigned int sent = 0;
+    unsigned int acked = 0;
+    uint64_t start = sim_now_ns();
+
+    while (acked < THROUGHPUT_COMMANDS) {
+        while (sent < THROUGHPUT_COMMANDS && sent - acked < depth) {
+            char text[32];
+            snprintf(text, sizeof(text), "LED_CMD:%u#%u\r\n", pattern_of(sent), sent % 256U);
+            esp_send(text);
+            sent++;
+        }
+        sim_kernel_run_until(sim_now_ns() + POLL_NS);
+        while (esp_read_line(line, sizeof(line))) {
+            char expected[32];
+
+            if (strncmp(line, "OK:", 3) != 0) {
+                continue;
+            }
+            led_cmd_ack(acked, expected, sizeof(expected));
+            CHECK_STR(line, expected);
+            acked++;
+        }
+        if (sim_now_ns() - start > 10ULL * 1000000000ULL) {
+            CHECK(0);   // ACKs lost
+            break;
+        }
+    }
+    return THROUGHPUT_COMMANDS * 1e9 / (double)(sim_now_ns() - start);
+}
+
+static void test_throughput(void)
+{
+    double stop_and_wait = run_throughput(1);
+    double pipelined = run_throughput(PIPELINE_DEPTH);
+
+    printf("LED_CMD throughput: %.0f cmd/s stop-and-wait, %.0f cmd/s with %u in flight (x%.2f)\n",
+           stop_and_wait, pipelined, PIPELINE_DEPTH, pipelined / stop_and_wait);
+
+    // One 14-byte command + one 15-16 byte ACK per round trip at 115200
+    // baud: ~2.7 ms stop-and-wait; pipelined only the ACKs' wire time
+    // (~1.35 ms) is left, the commands overlap with them
+    CHECK(stop_and_wait > 300.0 && stop_and_wait < 400.0);
+    CHECK(pipelined > 1.8 * stop_and_wait);
+    CHECK(sim_kernel_stats()->stream_dropped == 0);
+}
+
+int main(void)
+{
+    sim_test_boot();
+
+    test_reassembly();
+    test_overflow();
+    test_throughput();
+
+    return SIM_TEST_RESULT();
+}
@@ -0,0 +1,163 @@
+/**
+ ******************************************************************************
+ * @file           : test_uart_rx_chunk.c
+ * @brief          : ESP8266 RX Task - Wakeups and Cycles per Command by Chunk Size
+ ******************************************************************************
+ * @description
+ * esp8266_comm_task.c built into the test with ESP8266_COMM_PROFILE, once
+ * per chunk size:
+ * ┌───────────────────────┬────────────────────┬──────────────────────────┐
+ * │ Test                  │ UART_RX_CHUNK_SIZE │ RX task wakeups expected │
+ * ├───────────────────────┼────────────────────┼──────────────────────────┤
+ * │ test_uart_rx_chunk    │ 32 (default)       │ ⌈burst / 32⌉ per burst   │
+ * │ test_uart_rx_chunk_1  │ 1 (legacy)         │ One per byte             │
+ * └───────────────────────┴────────────────────┴──────────────────────────┘
+ * The same ESP8266 traffic goes through both: single commands with gaps
+ * between them, and bursts of four pipelined commands. The profiling
+ * counters give wakeups and receive + scan cycles per command line; the
+ * DWT counts on the host clock (sim_dwt_use_host_clock()), so cycles are
+ * this machine's time for the code scaled to 168 MHz - compare the two
+ * reports with each other, not with the board.
+ ******************************************************************************
+ */
+
+#define ESP8266_COMM_PROFILE        1
+#define ESP8266_COMM_PROFILE_LINES  UINT32_MAX  // Counters read here, never logged
+
+#include "../src/esp8266_comm_task.c"
+
+#include "sim_test.h"
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define ROUNDS          25U     // Each traffic pattern, repeated
+
+/** Commands sent one at a time, each answered before the next */
+static const char *const single[] = {
+    "PING\r\n",
+    "LED_CMD:2#1\r\n",
+    "LED_SET:5,500,50,0#2\r\n",
+    "LED_SCENE:1,100,100,0;2,200,100,0;4,300,100,0;8,400,100,0#3\r\n",
+    "LED_SYNC:15,400,2#4\r\n",
+    "LED_CMD:4#5\r\n",
+};
+
+/** One burst: four commands back to back (MAX_INFLIGHT_COMMANDS) */
+static const char *const pipelined[] = {
+    "LED_SET:1,100,50,0#10\r\n",
+    "LED_SET:2,200,50,50#11\r\n",
+    "LED_SET:4,300,50,100#12\r\n",
+    "LED_CMD:3#13\r\n",
+};
+
+#define COUNT_OF(a)     (sizeof(a) / sizeof((a)[0]))
+
+typedef struct {
+    uint32_t commands;
+    uint32_t bytes;
+    uint32_t min_wakeups;       // Σ ⌈burst / UART_RX_CHUNK_SIZE⌉
+    uint32_t replies;
+} traffic_t;
+
+static uint32_t chunks(size_t bytes)
+{
+    return (uint32_t)((bytes + UART_RX_CHUNK_SIZE - 1U) / UART_RX_CHUNK_SIZE);
+}
+
+/**
+ * @brief  Send a burst of lines back to back and wait for the replies
+ * @retval None
+ */
+static void send_burst(const char *const *lines, size_t count, traffic_t *t)
+{
+    char text[256];
+    char line[128];
+    size_t len = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        len += (size_t)snprintf(&text[len], sizeof(text) - len, "%s", lines[i]);
+    }
+    (void)esp_send(text);
+    sim_kernel_run_ms(50);
+
+    t->commands += (uint32_t)count;
+    t->bytes += (uint32_t)len;
+    t->min_wakeups += chunks(len);
+    while (esp_read_line(line, sizeof(line))) {
+        if (strncmp(line, "OK:", 3) == 0 || strcmp(line, "PONG") == 0) {
+            t->replies++;
+        }
+    }
+}
+
+/**
+ * @brief  Profile counters for one traffic pattern
+ * @retval None
+ */
+static void report(const char *name, const traffic_t *t)
+{
+    printf("%-10s chunk %2u: %4u lines, %5u bytes, %5u wakeups (%5.2f per line), %6lu cycles per line\n",
+           name, UART_RX_CHUNK_SIZE, profile_lines, t->bytes, profile_wakeups,
+           (double)profile_wakeups / profile_lines, (unsigned long)(profile_cycles / profile_lines));
+
+    CHECK(t->replies == t->commands);
+    CHECK(profile_lines == t->commands);
+    CHECK(profile_cycles > 0);
+    CHECK(sim_kernel_stats()->stream_dropped == 0);
+
+    // Never more than a chunk per wakeup; a burst can only split further
+    // where it crosses the end of the 64-byte DMA buffer
+    CHECK(profile_wakeups >= t->min_wakeups);
+    CHECK(profile_wakeups <= t->min_wakeups + t->bytes / UART_DMA_RX_BUFFER_SIZE + 1U);
+#if UART_RX_CHUNK_SIZE == 1
+    CHECK(profile_wakeups == t->bytes);
+#endif
+}
+
+static void profile_clear(void)
+{
+    profile_wakeups = 0;
+    profile_lines = 0;
+    profile_cycles = 0;
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void test_single(void)
+{
+    traffic_t t = { 0, 0, 0, 0 };
+
+    profile_clear();
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        for (size_t i = 0; i < COUNT_OF(single); i++) {
+            send_burst(&single[i], 1, &t);
+        }
+    }
+    report("single", &t);
+}
+
+static void test_pipelined(void)
+{
+    traffic_t t = { 0, 0, 0, 0 };
+
+    profile_clear();
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        send_burst(pipelined, COUNT_OF(pipelined), &t);
+    }
+    report("pipelined", &t);
+}
+
+int main(void)
+{
+    sim_test_boot();
+    sim_dwt_use_host_clock();
+
+    test_single();
+    test_pipelined();
+
+    return SIM_TEST_RESULT();
+}
@@ -0,0 +1,246 @@
+/**
+ ******************************************************************************
+ * @file           : test_uart_rx_isr.c
+ * @brief          : UART2 RX Interrupt Load - Replayed ESP8266 Traffic
+ ******************************************************************************
+ * @description
+ * Built twice from this file:
+ * ┌──────────────────────┬──────────────────┬─────────────────────────────┐
+ * │ Test                 │ UART_RX_USE_DMA  │ RX interrupts expected      │
+ * ├──────────────────────┼──────────────────┼─────────────────────────────┤
+ * │ test_uart_rx_isr     │ 1 (DMA + IDLE)   │ One per burst, plus one per │
+ * │                      │                  │ wrap of the 64-byte buffer  │
+ * │ test_uart_rx_isr_it  │ 0 (per byte)     │ One per byte                │
+ * └──────────────────────┴──────────────────┴─────────────────────────────┘
+ * Each replays the same ESP8266 captures: the lines and frames as the
+ * sketch sends them, with the gaps seen between them. Lines with no gap
+ * before them follow the previous one back to back, as the sketch writes
+ * pipelined commands (MAX_INFLIGHT_COMMANDS = 4). RX interrupt entries
+ * are counted by the HAL shim (sim_uart_rx_isrs()) and reported per
+ * command; every command must still be answered (TIME has no reply)
+ * and no byte lost.
+ ******************************************************************************
+ */
+
+#include "sim_test.h"
+#include "esp8266_comm_task.h"
+#include "led_frame.h"
+
+/*============================================================================
+ * Captures
+ *===========================================================================*/
+
+/** One command as captured: gap before it (us) and its text */
+typedef struct {
+    uint32_t gap_us;
+    const char *line;
+} capture_line_t;
+
+/** Web UI session: one command per HTTP request, TIME and PING between */
+static const capture_line_t capture_web[] = {
+    { 0,      "TIME:1717171717\r\n" },
+    { 20000,  "PING\r\n" },
+    { 150000, "LED_CMD:2#1\r\n" },
+    { 400000, "LED_SET:5,500,50,0#2\r\n" },
+    { 300000, "LED_SCENE:1,100,100,0;2,200,100,0;4,300,100,0;8,400,100,0#3\r\n" },
+    { 250000, "LED_SYNC:15,400,2#4\r\n" },
+    { 500000, "LED_AT:1717172900@LED_CMD:3#5\r\n" },
+    { 900000, "PING\r\n" },
+    { 120000, "LED_CMD:4#6\r\n" },
+};
+
+/** Scripted show: four commands in flight at a time */
+static const capture_line_t capture_pipelined[] = {
+    { 0,      "LED_CMD:1#10\r\n" },
+    { 0,      "LED_CMD:2#11\r\n" },
+    { 0,      "LED_CMD:3#12\r\n" },
+    { 0,      "LED_CMD:4#13\r\n" },
+    { 30000,  "LED_SET:1,100,50,0#14\r\n" },
+    { 0,      "LED_SET:2,200,50,50#15\r\n" },
+    { 0,      "LED_SET:4,300,50,100#16\r\n" },
+    { 0,      "LED_SET:8,400,50,150#17\r\n" },
+    { 30000,  "LED_SYNC:15,250,0#18\r\n" },
+    { 0,      "LED_SYNC:15,250,1#19\r\n" },
+    { 0,      "LED_SYNC:15,250,2#20\r\n" },
+    { 0,      "LED_CMD:4#21\r\n" },
+};
+
+/** Binary link: one LED_CMD frame per request, PINGs between */
+typedef struct {
+    uint32_t gap_us;
+    uint8_t type;               // led_frame_type_t
+    uint8_t payload[2];
+    uint8_t len;
+} capture_frame_t;
+
+static const capture_frame_t capture_binary[] = {
+    { 0,      LED_FRAME_PING,    { 0 },       0 },
+    { 100000, LED_FRAME_LED_CMD, { 2, 30 },   2 },
+    { 0,      LED_FRAME_LED_CMD, { 3, 31 },   2 },
+    { 200000, LED_FRAME_LED_CMD, { 1, 32 },   2 },
+    { 50000,  LED_FRAME_PING,    { 0 },       0 },
+    { 300000, LED_FRAME_LED_CMD, { 4, 33 },   2 },
+    { 0,      LED_FRAME_LED_CMD, { 2, 34 },   2 },
+    { 0,      LED_FRAME_LED_CMD, { 3, 35 },   2 },
+    { 0,      LED_FRAME_LED_CMD, { 4, 36 },   2 },
+};
+
+#define COUNT_OF(a)     (sizeof(a) / sizeof((a)[0]))
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+typedef struct {
+    const char *name;
+    uint32_t commands;
+    uint32_t bursts;            // Runs of commands with no gap between
+    uint32_t bytes;
+    uint32_t isrs;
+    uint32_t answers;           // Commands that get an ACK or PONG
+    uint32_t replies;
+} replay_report_t;
+
+static led_frame_parser_t esp_parser;
+
+/**
+ * @brief  Wait for the gap before the next command
+ * @param  gap_us: Gap on the capture (0 = back to back)
+ * @param  r: Report to count a new burst in
+ * @retval None
+ */
+static void replay_gap(uint32_t gap_us, replay_report_t *r)
+{
+    if (gap_us != 0 || r->commands == 0) {
+        // Let the previous burst go idle before the gap starts
+        sim_kernel_run_until(sim_now_ns() + (uint64_t)gap_us * SIM_NS_PER_US);
+        r->bursts++;
+    }
+}
+
+/**
+ * @brief  Count the ASCII replies that answer a command
+ * @retval None
+ */
+static void read_ascii_replies(replay_report_t *r)
+{
+    char line[128];
+
+    while (esp_read_line(line, sizeof(line))) {
+        if (strncmp(line, "OK:", 3) == 0 || strcmp(line, "PONG") == 0) {
+            r->replies++;
+        }
+    }
+}
+
+/**
+ * @brief  Count the ACK and PONG frames
+ * @retval None
+ */
+static void read_frame_replies(replay_report_t *r)
+{
+    uint8_t byte;
+
+    while (sim_uart_tx_read(&huart2, &byte, 1) == 1) {
+        if (led_frame_parse_byte(&esp_parser, byte) == LED_FRAME_COMPLETE
+                && (esp_parser.type == LED_FRAME_PONG
+                    || (esp_parser.type == LED_FRAME_ACK && esp_parser.payload[0] == LED_FRAME_ACK_OK))) {
+            r->replies++;
+        }
+    }
+}
+
+static void report(const replay_report_t *r)
+{
+    printf("%-10s %2u commands in %2u bursts, %4u bytes: %4u RX ISRs, %5.2f per command\n",
+           r->name, r->commands, r->bursts, r->bytes, r->isrs, (double)r->isrs / r->commands);
+}
+
+/**
+ * @brief  Check a replay: all answered, nothing lost, ISR count per mode
+ * @retval None
+ */
+static void check_replay(const replay_report_t *r)
+{
+    report(r);
+    CHECK(r->replies == r->answers);
+    CHECK(sim_uart_rx_overruns(&huart2) == 0);
+    CHECK(sim_kernel_stats()->stream_dropped == 0);
+
+#if UART_RX_USE_DMA
+    // IDLE ends each burst; a burst can also cross a buffer wrap (TC)
+    CHECK(r->isrs >= r->bursts);
+    CHECK(r->isrs <= r->bursts + r->bytes / UART_DMA_RX_BUFFER_SIZE + 1U);
+#else
+    CHECK(r->isrs == r->bytes);
+#endif
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void replay_ascii(const char *name, const capture_line_t *capture, size_t count)
+{
+    replay_report_t r = { name, 0, 0, 0, 0, 0, 0 };
+    uint32_t isrs = sim_uart_rx_isrs(&huart2);
+
+    for (size_t i = 0; i < count; i++) {
+        replay_gap(capture[i].gap_us, &r);
+        r.bytes += (uint32_t)strlen(capture[i].line);
+        (void)esp_send(capture[i].line);
+        r.commands++;
+        if (strncmp(capture[i].line, "TIME:", 5) != 0) {     // TIME is not acknowledged
+            r.answers++;
+        }
+        read_ascii_replies(&r);
+    }
+    sim_kernel_run_ms(100);
+    read_ascii_replies(&r);
+
+    r.isrs = sim_uart_rx_isrs(&huart2) - isrs;
+    check_replay(&r);
+}
+
+static void replay_binary(void)
+{
+    replay_report_t r = { "binary", 0, 0, 0, 0, 0, 0 };
+    char line[64];
+
+    esp_send(LED_FRAME_NEGOTIATE_REQ "\r\n");
+    sim_kernel_run_ms(10);
+    CHECK(esp_expect(LED_FRAME_NEGOTIATE_ACK, line, sizeof(line)));
+    led_frame_parser_reset(&esp_parser);
+
+    uint32_t isrs = sim_uart_rx_isrs(&huart2);
+
+    for (size_t i = 0; i < COUNT_OF(capture_binary); i++) {
+        uint8_t frame[LED_FRAME_MAX_SIZE];
+        size_t size = led_frame_encode((led_frame_type_t)capture_binary[i].type, capture_binary[i].payload,
+                                       capture_binary[i].len, frame, sizeof(frame));
+
+        replay_gap(capture_binary[i].gap_us, &r);
+        r.bytes += (uint32_t)size;
+        (void)sim_uart_rx(&huart2, frame, size);
+        r.commands++;
+        r.answers++;
+        read_frame_replies(&r);
+    }
+    sim_kernel_run_ms(100);
+    read_frame_replies(&r);
+
+    r.isrs = sim_uart_rx_isrs(&huart2) - isrs;
+    check_replay(&r);
+}
+
+int main(void)
+{
+    sim_test_boot();
+    printf("UART2 RX in %s mode\n", UART_RX_USE_DMA ? "DMA + IDLE" : "per-byte IT");
+
+    replay_ascii("web", capture_web, COUNT_OF(capture_web));
+    replay_ascii("pipelined", capture_pipelined, COUNT_OF(capture_pipelined));
+    replay_binary();
+
+    return SIM_TEST_RESULT();
+}
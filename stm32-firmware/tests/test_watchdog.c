@@ -0,0 +1,186 @@
+/**
+ ******************************************************************************
+ * @file           : test_watchdog.c
+ * @brief          : Task Watchdog - Overdue Decision and IWDG Reset Path
+ ******************************************************************************
+ * @description
+ * task_overdue() on its own:
+ * - Overdue only once more than timeout_ms has passed since the last feed
+ * - Elapsed time correct across a TickType_t wrap
+ *
+ * The monitor on the simulated board, with a test task registered in the
+ * free slot and fed from the test:
+ * ┌────────────────────────┬──────────────────────────────────────────────┐
+ * │ Test task              │ Expected                                     │
+ * ├────────────────────────┼──────────────────────────────────────────────┤
+ * │ Fed every 500 ms, 10 s │ No alert, IWDG refreshed (no expiry)         │
+ * │ Stops feeding          │ First alert within one check period of the   │
+ * │                        │ timeout; culprit in the backup registers;    │
+ * │                        │ IWDG no longer refreshed and expires         │
+ * │ Second task overdue    │ Alerted too, but the first culprit is kept   │
+ * └────────────────────────┴──────────────────────────────────────────────┘
+ * The boot-time read of the record: trusted only after an IWDG reset,
+ * "Watchdog" when the IWDG fired without a record, cleared either way.
+ ******************************************************************************
+ */
+
+#include "../src/watchdog.c"
+
+#include "sim_test.h"
+
+/*============================================================================
+ * Helpers
+ *===========================================================================*/
+
+#define TEST_TASK_NAME      "Test_Task"
+#define TEST_TIMEOUT_MS     2000U
+#define FEED_EVERY_MS       500U
+
+static unsigned int alerts = 0;
+static watchdog_id_t alert_id = WATCHDOG_INVALID_ID;
+static uint32_t alert_elapsed_ms = 0;
+static uint64_t alert_ns = 0;
+
+/** Alerts seen by the callback; the first one is kept */
+static void on_timeout(watchdog_id_t id, const char *task_name, uint32_t last_feed_ms)
+{
+    (void)task_name;
+    if (alerts++ == 0) {
+        alert_elapsed_ms = last_feed_ms;
+        alert_ns = sim_now_ns();
+    }
+    alert_id = id;
+}
+
+/** Culprit name as stored in BKP2R..BKP5R */
+static void backup_name(char *name, size_t size)
+{
+    const volatile uint32_t *words = &RTC->BKP2R;
+
+    for (size_t i = 0; i < size - 1U && i < 16U; i++) {
+        name[i] = (char)(words[i / 4] >> (8 * (i % 4)));
+    }
+    name[size - 1U] = '\0';
+}
+
+/*============================================================================
+ * Tests
+ *===========================================================================*/
+
+static void test_task_overdue(void)
+{
+    watchdog_entry_t entry = { "T", 1000, 0, pdTRUE };
+    uint32_t elapsed;
+
+    entry.last_feed_tick = 5000;
+    CHECK(!task_overdue(&entry, 5000, &elapsed) && elapsed == 0);
+    CHECK(!task_overdue(&entry, 6000, &elapsed) && elapsed == 1000);   // At the limit
+    CHECK(task_overdue(&entry, 6001, &elapsed) && elapsed == 1001);
+
+    // Fed just before the tick counter wrapped
+    entry.last_feed_tick = (TickType_t)(0U - 300U);
+    CHECK(!task_overdue(&entry, 700, &elapsed) && elapsed == 1000);
+    CHECK(task_overdue(&entry, 701, &elapsed) && elapsed == 1001);
+
+    entry.timeout_ms = 0;
+    entry.last_feed_tick = 42;
+    CHECK(!task_overdue(&entry, 42, &elapsed));
+    CHECK(task_overdue(&entry, 43, &elapsed));
+}
+
+static void test_reset_path(void)
+{
+    char name[17];
+
+    sim_test_boot();
+    watchdog_set_callback(on_timeout);
+
+    watchdog_id_t id = watchdog_register(TEST_TASK_NAME, TEST_TIMEOUT_MS);
+    CHECK(id != WATCHDOG_INVALID_ID);
+    CHECK(watchdog_register("One_Too_Many", 1000) == WATCHDOG_INVALID_ID);
+
+    // Healthy
+    for (unsigned int t = 0; t < 10000U; t += FEED_EVERY_MS) {
+        watchdog_feed(id);
+        sim_kernel_run_ms(FEED_EVERY_MS);
+    }
+    CHECK(alerts == 0);
+    CHECK(sim_iwdg_expiries() == 0);
+    CHECK(!reset_pending);
+
+    // Hung: no feed from here on
+    watchdog_feed(id);
+    uint64_t last_feed = sim_now_ns();
+    uint64_t expired_ns = 0;
+
+    while (sim_now_ns() - last_feed < 10000U * SIM_NS_PER_MS && expired_ns == 0) {
+        sim_kernel_run_ms(1);
+        if (sim_iwdg_expiries() != 0) {
+            expired_ns = sim_now_ns();
+        }
+    }
+
+    // Detected at the first check past the timeout, then again every
+    // timeout (the monitor restarts the count to avoid alert spam)
+    CHECK(alerts >= 1 && alerts <= 2);
+    CHECK(alert_id == id);
+    CHECK(alert_elapsed_ms > TEST_TIMEOUT_MS
+          && alert_elapsed_ms <= TEST_TIMEOUT_MS + WATCHDOG_CHECK_PERIOD_MS);
+    CHECK(alert_ns - last_feed <= (TEST_TIMEOUT_MS + WATCHDOG_CHECK_PERIOD_MS) * SIM_NS_PER_MS);
+
+    // Recorded for the next boot
+    CHECK(reset_pending);
+    CHECK(RTC->BKP0R == (WATCHDOG_BKP_MAGIC | id));
+    CHECK(RTC->BKP1R == alert_elapsed_ms);
+    backup_name(name, sizeof(name));
+    CHECK_STR(name, TEST_TASK_NAME);
+
+    // The last refresh was the check before the alert: the IWDG runs out
+    // WATCHDOG_IWDG_TIMEOUT_MS after it
+    CHECK(expired_ns != 0);
+    CHECK(expired_ns - alert_ns >= (WATCHDOG_IWDG_TIMEOUT_MS - WATCHDOG_CHECK_PERIOD_MS) * SIM_NS_PER_MS);
+    CHECK(expired_ns - alert_ns <= WATCHDOG_IWDG_TIMEOUT_MS * SIM_NS_PER_MS);
+
+    // A second overdue task is reported, the first culprit stays
+    watchdog_id_t other = (id == 0) ? 1 : 0;
+    watchdog_tasks[other].timeout_ms = 0;
+    sim_kernel_run_ms(WATCHDOG_CHECK_PERIOD_MS + 10U);
+    CHECK(alert_id == other);
+    CHECK(RTC->BKP0R == (WATCHDOG_BKP_MAGIC | id));
+    backup_name(name, sizeof(name));
+    CHECK_STR(name, TEST_TASK_NAME);
+}
+
+static void test_reset_record(void)
+{
+    // After an IWDG reset with a record
+    sim_rcc_set_reset_flag(RCC_FLAG_IWDGRST);
+    reset_record_read();
+    CHECK(watchdog_get_reset_culprit() != NULL);
+    CHECK_STR(watchdog_get_reset_culprit(), TEST_TASK_NAME);
+    CHECK(RTC->BKP0R == 0);
+
+    // IWDG without a record: the monitor itself stopped
+    reset_culprit = NULL;
+    sim_rcc_set_reset_flag(RCC_FLAG_IWDGRST);
+    reset_record_read();
+    CHECK(watchdog_get_reset_culprit() != NULL);
+    CHECK_STR(watchdog_get_reset_culprit(), "Watchdog");
+
+    // A stale record after any other reset is ignored and cleared
+    RTC->BKP0R = WATCHDOG_BKP_MAGIC | 1U;
+    reset_culprit = NULL;
+    sim_rcc_set_reset_flag(RCC_FLAG_PINRST);
+    reset_record_read();
+    CHECK(watchdog_get_reset_culprit() == NULL);
+    CHECK(RTC->BKP0R == 0);
+}
+
+int main(void)
+{
+    test_task_overdue();
+    test_reset_path();
+    test_reset_record();
+
+    return SIM_TEST_RESULT();
+}
@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+******************************************************************************
+@file           : latency_report.py
+@brief          : Per-stage latency report from /trace captures
+******************************************************************************
+@description
+Merges the ESP8266 and STM32 latency trace records served by the ESP8266's
+/trace endpoint and prints count / min / p50 / p90 / p99 / max and a log2
+histogram for every stage from HTTP request to LED update and back.
+
+Capture format (one block per /trace read; records are handed out once, so
+append successive reads to one file):
+    # led-trace esp_hz=1000000 stm_hz=168000000
+    E <seq> <http_in> <tx_start> <tx_done> <ack_rx> <http_out>
+    S <seq> <rx_isr> <task_wake> <dispatch> <applied> <ack>
+
+E and S records of a block are matched by sequence number (the correlation
+ID the ESP8266 already sends with every command). Both clocks are free
+running and wrap (2^32), so only differences within one board are taken
+directly. The UART link time is estimated NTP-style, assuming it is the
+same in both directions:
+    link = ((ack_rx - tx_done) - (stm ack - stm rx_isr)) / 2
+
+Stages (microseconds):
+    esp_handler       http_in  -> tx_start    request parsing, slot, logging
+    esp_uart_tx       tx_start -> tx_done     SoftwareSerial transmit
+    link_to_stm       tx_done  -> rx_isr      estimated (see above)
+    isr_to_task       rx_isr   -> task_wake   stream buffer + scheduling
+    task_to_dispatch  task_wake-> dispatch    line/frame assembly
+    apply             dispatch -> applied     parse + effects engine
+    ack               applied  -> ack         ACK queued on the UART
+    link_back         ack      -> ack_rx      estimated (see above)
+    esp_response      ack_rx   -> http_out    HTTP response written
+    http_to_led       http_in  -> applied     request to PWM update
+    total             http_in  -> http_out    full round trip
+
+Usage:
+    curl -s http://esp8266-led.local/trace >> trace.txt   (repeat)
+    python3 latency_report.py trace.txt [more.txt ...]
+    python3 latency_report.py < trace.txt
+
+Standard library only.
+******************************************************************************
+"""
+
+import sys
+from collections import defaultdict, deque
+
+WRAP = 1 << 32
+
+# Field indices
+HTTP_IN, TX_START, TX_DONE, ACK_RX, HTTP_OUT = range(5)
+RX_ISR, TASK_WAKE, DISPATCH, APPLIED, ACK = range(5)
+
+STAGES = [
+    "esp_handler", "esp_uart_tx", "link_to_stm", "isr_to_task",
+    "task_to_dispatch", "apply", "ack", "link_back", "esp_response",
+    "http_to_led", "total",
+]
+
+
+def delta(later, earlier):
+    """Difference of two wrapping 32-bit timestamps."""
+    return (later - earlier) % WRAP
+
+
+def read_blocks(lines):
+    """Yield (esp_hz, stm_hz, esp records, stm records) per capture block."""
+    block = None
+    for line in lines:
+        fields = line.split()
+        if not fields:
+            continue
+        if fields[0] == "#":
+            if block:
+                yield block
+            rates = dict(f.split("=", 1) for f in fields[2:] if "=" in f)
+            block = (int(rates.get("esp_hz", 1000000)), int(rates.get("stm_hz", 0)), [], [])
+        elif fields[0] in ("E", "S") and len(fields) == 7 and block:
+            record = [int(f) for f in fields[1:]]
+            (block[2] if fields[0] == "E" else block[3]).append(record)
+    if block:
+        yield block
+
+
+def match(esp_records, stm_records):
+    """Pair records by sequence number, oldest first (seq wraps at 256)."""
+    stm_by_seq = defaultdict(deque)
+    for record in stm_records:
+        stm_by_seq[record[0]].append(record[1:])
+    for record in esp_records:
+        queue = stm_by_seq.get(record[0])
+        if queue:
+            yield record[1:], queue.popleft()
+
+
+def stage_times(esp, stm, esp_hz, stm_hz):
+    """Stage name -> microseconds for one command (None if not measurable)."""
+    def us_esp(later, earlier):
+        return delta(esp[later], esp[earlier]) * 1e6 / esp_hz
+
+    def us_stm(later, earlier):
+        return delta(stm[later], stm[earlier]) * 1e6 / stm_hz
+
+    round_trip = us_esp(ACK_RX, TX_DONE)
+    residence = us_stm(ACK, RX_ISR)
+    if residence > round_trip:
+        return None  # Not the same command (seq reused across captures)
+    link = (round_trip - residence) / 2
+    applied = stm[APPLIED] != 0
+
+    return {
+        "esp_handler": us_esp(TX_START, HTTP_IN),
+        "esp_uart_tx": us_esp(TX_DONE, TX_START),
+        "link_to_stm": link,
+        "isr_to_task": us_stm(TASK_WAKE, RX_ISR),
+        "task_to_dispatch": us_stm(DISPATCH, TASK_WAKE),
+        "apply": us_stm(APPLIED, DISPATCH) if applied else None,
+        "ack": us_stm(ACK, APPLIED) if applied else None,
+        "link_back": link,
+        "esp_response": us_esp(HTTP_OUT, ACK_RX),
+        "http_to_led": (us_esp(TX_DONE, HTTP_IN) + link + us_stm(APPLIED, RX_ISR)) if applied else None,
+        "total": us_esp(HTTP_OUT, HTTP_IN),
+    }
+
+
+def percentile(sorted_values, p):
+    """Nearest-rank percentile."""
+    rank = max(1, -(-len(sorted_values) * p // 100))
+    return sorted_values[int(rank) - 1]
+
+
+def histogram(values, width=40):
+    """Log2 buckets: (upper bound us, count) for every non-empty range."""
+    buckets = defaultdict(int)
+    for v in values:
+        bound = 1
+        while bound < v:
+            bound *= 2
+        buckets[bound] += 1
+    peak = max(buckets.values())
+    for bound in sorted(buckets):
+        count = buckets[bound]
+        print(f"    <= {bound:>8} us {count:>6}  {'#' * max(1, count * width // peak)}")
+
+
+def main():
+    paths = sys.argv[1:]
+    lines = []
+    if paths:
+        for path in paths:
+            with open(path) as f:
+                lines.extend(f)
+    else:
+        lines = sys.stdin.readlines()
+
+    samples = defaultdict(list)
+    commands = skipped = 0
+    for esp_hz, stm_hz, esp_records, stm_records in read_blocks(lines):
+        if stm_hz == 0:
+            skipped += len(esp_records)  # No TR:END seen yet: STM32 rate unknown
+            continue
+        for esp, stm in match(esp_records, stm_records):
+            times = stage_times(esp, stm, esp_hz, stm_hz)
+            if times is None:
+                skipped += 1
+                continue
+            commands += 1
+            for stage, value in times.items():
+                if value is not None:
+                    samples[stage].append(value)
+
+    if commands == 0:
+        print("No matched E/S records (capture /trace again after some commands)")
+        return 1
+
+    print(f"{commands} commands matched, {skipped} skipped\n")
+    print(f"{'stage':<18}{'n':>6}{'min':>10}{'p50':>10}{'p90':>10}{'p99':>10}{'max':>10}   (us)")
+    for stage in STAGES:
+        values = sorted(samples[stage])
+        if not values:
+            continue
+        print(f"{stage:<18}{len(values):>6}{values[0]:>10.0f}{percentile(values, 50):>10.0f}"
+              f"{percentile(values, 90):>10.0f}{percentile(values, 99):>10.0f}{values[-1]:>10.0f}")
+
+    for stage in STAGES:
+        if samples[stage]:
+            print(f"\n{stage}:")
+            histogram(samples[stage])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
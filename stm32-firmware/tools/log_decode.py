@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""
+******************************************************************************
+@file           : log_decode.py
+@brief          : Host decoder for deferred binary logs (UART3)
+******************************************************************************
+@description
+Expands the binary records emitted by print_deferred() when the firmware is
+built with PRINT_DEFERRED_BINARY=1. Plain text on the stream is passed
+through unchanged.
+
+Record layout (little-endian, W = pointer width: 4 B on the target):
+    [0xFE][format address (W)][nargs (1 B)][nargs x uintptr_t args (W each)]
+
+The format string (and any %s argument that points into flash) is read from
+the firmware ELF, so only addresses ship over the wire. W follows the ELF
+class, so the 64-bit host simulation decodes too; --base gives the run-time
+address of a position-independent image's first byte (__executable_start).
+
+Usage:
+    python3 log_decode.py Debug/stm32-firmware.elf < capture.bin
+    python3 log_decode.py Debug/stm32-firmware.elf /dev/ttyUSB0
+    python3 log_decode.py --base 0x55d4c8a00000 build/tests/test_log_deferred capture.bin
+
+Standard library only (no pyelftools / pyserial needed). Configure the
+serial port first, e.g. `stty -F /dev/ttyUSB0 115200 raw`.
+******************************************************************************
+"""
+
+import codecs
+import re
+import struct
+import sys
+
+MARKER = 0xFE
+SHF_ALLOC = 0x2
+SHT_PROGBITS = 1
+PT_LOAD = 1
+ELFCLASS32 = 1
+ELFCLASS64 = 2
+
+# printf conversion: flags, width, precision, length, conversion character
+CONVERSION = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|t)?([diuxXocsp%])")
+
+
+class Firmware:
+    """Allocated ELF sections, addressable by run-time address."""
+
+    def __init__(self, path, base=None):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF" or data[4] not in (ELFCLASS32, ELFCLASS64):
+            raise ValueError(f"{path}: not an ELF file")
+
+        if data[4] == ELFCLASS32:
+            self.word = 4
+            phoff, shoff = struct.unpack_from("<II", data, 0x1C)
+            phentsize, phnum, shentsize, shnum = struct.unpack_from("<HHHH", data, 0x2A)
+            section = "<IIIIII"         # name, type, flags, addr, offset, size
+            program = "<III"            # type, offset, vaddr
+        else:
+            self.word = 8
+            phoff, shoff = struct.unpack_from("<QQ", data, 0x20)
+            phentsize, phnum, shentsize, shnum = struct.unpack_from("<HHHH", data, 0x36)
+            section = "<IIQQQQ"
+            program = "<IIQQ"           # type, flags, offset, vaddr
+
+        # Load bias: where the first loaded segment sits at run time
+        bias = 0
+        if base is not None:
+            vaddrs = []
+            for i in range(phnum):
+                fields = struct.unpack_from(program, data, phoff + i * phentsize)
+                if fields[0] == PT_LOAD:
+                    vaddrs.append(fields[-1])
+            bias = base - min(vaddrs)
+
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from(
+                section, data, shoff + i * shentsize)
+            if sh_type == SHT_PROGBITS and flags & SHF_ALLOC and size:
+                self.sections.append((addr + bias, data[offset:offset + size]))
+
+    def string(self, addr):
+        """Return the NUL-terminated string at a target address, or None."""
+        for base, blob in self.sections:
+            if base <= addr < base + len(blob):
+                end = blob.find(b"\0", addr - base)
+                return blob[addr - base:end if end >= 0 else len(blob)].decode("utf-8", "replace")
+        return None
+
+
+def render(fw, fmt, args):
+    """Apply C printf semantics for the conversions print_deferred allows."""
+    args = list(args)
+    out = []
+    pos = 0
+    for m in CONVERSION.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, precision, length, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        value = args.pop(0) if args else 0
+        spec = "%" + flags + width + ("." + precision if precision else "")
+        # int is 32 bits on both; long follows the argument width
+        bits = 8 * fw.word if length in ("l", "ll", "z", "t") else 32
+        integer = value & ((1 << bits) - 1)
+        if conv == "s":
+            text = fw.string(value)
+            if text is None:
+                text = f"<ram:0x{value:0{2 * fw.word}x}>"  # Not in the ELF (RAM string)
+            out.append((spec + "s") % text)
+        elif conv in "di":
+            if integer >= 1 << (bits - 1):
+                integer -= 1 << bits
+            out.append((spec + "d") % integer)
+        elif conv == "u":
+            out.append((spec + "d") % integer)
+        elif conv == "c":
+            out.append(chr(value & 0xFF))
+        elif conv == "p":
+            out.append(f"0x{value:0{2 * fw.word}x}")
+        else:
+            out.append((spec + conv) % integer)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def decode(fw, stream, write):
+    """Decode a byte stream, writing text to the write callback."""
+    buf = b""
+    text_decoder = codecs.getincrementaldecoder("utf-8")("replace")
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            break
+        buf += chunk
+
+        while buf:
+            if buf[0] != MARKER:
+                end = buf.find(bytes([MARKER]))
+                text, buf = (buf, b"") if end < 0 else (buf[:end], buf[end:])
+                write(text_decoder.decode(text))
+                continue
+
+            word = "I" if fw.word == 4 else "Q"
+            if len(buf) < 2 + fw.word:
+                break
+            addr, nargs = struct.unpack_from("<" + word + "B", buf, 1)
+            size = 2 + fw.word * (1 + nargs)
+            if len(buf) < size:
+                break
+            args = struct.unpack_from("<%d%s" % (nargs, word), buf, 2 + fw.word)
+            buf = buf[size:]
+
+            fmt = fw.string(addr)
+            if fmt is None:
+                write(f"<unknown format 0x{addr:0{2 * fw.word}x} args={list(args)}>\r\n")
+            else:
+                write(render(fw, fmt, args))
+
+
+def main():
+    argv = sys.argv[1:]
+    base = None
+    if len(argv) >= 2 and argv[0] == "--base":
+        base = int(argv[1], 0)
+        argv = argv[2:]
+    if len(argv) not in (1, 2):
+        sys.stderr.write(__doc__)
+        return 2
+
+    fw = Firmware(argv[0], base)
+    stream = open(argv[1], "rb", buffering=0) if len(argv) == 2 else sys.stdin.buffer
+
+    def write(text):
+        # UTF-8 whatever the locale: log text is passed through as sent
+        sys.stdout.buffer.write(text.encode("utf-8"))
+        sys.stdout.flush()
+
+    try:
+        decode(fw, stream, write)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())